@@ -0,0 +1,125 @@
+// Measures BatchAnalyzer throughput in MB/s of field text, with 1, 2, 4, ...
+// threads up to the number of hardware threads, against counting the tokens of
+// the same documents one field at a time on the caller's thread; and then the
+// same for the text of all the documents as one large text, with
+// BatchAnalyzer::analyzeText().
+//
+// Usage: BatchAnalyzer_bench [number of documents, 100000 by default]
+
+#include <algorithm> // min()
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lucanthrope/analysis/BatchAnalyzer.h"
+#include "lucanthrope/analysis/StopAnalyzer.h"
+#include "lucanthrope/document/Document.h"
+
+using namespace lucanthrope;
+
+static std::string makeText(uint64_t &x, size_t words) {
+  static const char *const vocabulary[] = {
+      "The",  "quick", "brown", "fox",   "jumps", "over",       "the",
+      "lazy", "dog",   "and",   "an",    "index", "tokenizer,", "reads",
+      "text", "at",    "2024",  "MB/s.", "Of",    "course!",    "it"};
+  std::string text;
+  for (size_t i = 0; i < words; i++) {
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    text.append(vocabulary[x % (sizeof vocabulary / sizeof *vocabulary)]);
+    text.push_back(' ');
+  }
+  return text;
+}
+
+int main(int argc, char **argv) {
+  size_t numDocuments =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  std::vector<Document> docs(numDocuments);
+  uint64_t x = 88172645463325252ull;
+  size_t bytes = 0;
+  for (auto &doc : docs) {
+    doc.add(Field::text("title", makeText(x, 8)));
+    doc.add(Field::unstored("body", makeText(x, 50 + x % 400)));
+    for (const Field &field : doc)
+      bytes += field.getStringValue().size();
+  }
+  double mb = bytes / double(1024 * 1024);
+  StopAnalyzer analyzer;
+  size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+  auto start = std::chrono::steady_clock::now();
+  size_t serialTokens = 0;
+  for (const Document &doc : docs)
+    for (const Field &field : doc) {
+      std::istringstream input(field.getStringValue());
+      TokenStream &stream = analyzer.reusableTokenStream(input, field.getName());
+      while (stream.next())
+        serialTokens++;
+    }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cout << "one field at a time: " << mb / seconds << " MB/s\n";
+
+  for (size_t threads = 1;; threads *= 2) {
+    threads = std::min(threads, maxThreads);
+    BatchAnalyzer batch(analyzer, threads);
+    start = std::chrono::steady_clock::now();
+    BatchAnalyzer::Result result = batch.analyze(docs);
+    seconds = std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    size_t tokens = 0;
+    for (auto &doc : result.documents)
+      tokens += doc.size();
+    std::cout << "BatchAnalyzer, " << threads << " threads: " << mb / seconds
+              << " MB/s, " << result.terms.size() << " terms\n";
+    if (tokens != serialTokens) {
+      std::cerr << "token counts disagree\n";
+      return 1;
+    }
+    if (threads == maxThreads)
+      break;
+  }
+
+  // The same text as one large field value
+  std::string text;
+  text.reserve(bytes + 2 * numDocuments);
+  for (const Document &doc : docs)
+    for (const Field &field : doc)
+      text.append(field.getStringValue()).push_back('\n');
+  mb = text.size() / double(1024 * 1024);
+  start = std::chrono::steady_clock::now();
+  std::istringstream whole(text);
+  TokenStream &stream = analyzer.reusableTokenStream(whole, "log");
+  size_t wholeTokens = 0;
+  while (stream.next())
+    wholeTokens++;
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+  std::cout << "one large text: " << mb / seconds << " MB/s\n";
+  for (size_t threads = 1;; threads *= 2) {
+    threads = std::min(threads, maxThreads);
+    BatchAnalyzer batch(analyzer, threads);
+    start = std::chrono::steady_clock::now();
+    BatchAnalyzer::Result result = batch.analyzeText(text, "log");
+    seconds = std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    std::cout << "analyzeText, " << threads << " threads: " << mb / seconds
+              << " MB/s\n";
+    if (result.documents[0].size() != wholeTokens) {
+      std::cerr << "token counts disagree\n";
+      return 1;
+    }
+    if (threads == maxThreads)
+      break;
+  }
+  return 0;
+}
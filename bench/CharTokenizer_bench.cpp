@@ -0,0 +1,201 @@
+// Measures CharTokenizer throughput in MB/s, reading from an istream and from
+// memory, against the former implementation which read the istream one
+// character at a time with istream::get(); and Utf8LowerCaseTokenizer, on the
+// same ASCII text and on multilingual text.
+//
+// Usage: CharTokenizer_bench [megabytes of text, 64 by default]
+
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/Utf8Tokenizer.h"
+
+using namespace lucanthrope;
+
+// CharTokenizer::next() as it was before reading text in chunks, and before
+// TokenView: every term is copied into a new Token
+template <typename Predicate, typename Normalizer>
+class LegacyCharTokenizer : public Tokenizer {
+private:
+  Predicate isTokenChar;
+  Normalizer normalize;
+  std::string buffer;
+  uint64_t offset = 0;
+  Token tok;
+
+public:
+  LegacyCharTokenizer(std::istream &input) : Tokenizer(input) {}
+
+  virtual bool next() override {
+    buffer.clear();
+    size_t tok_len = 0;
+    uint64_t start_pos = 0;
+    while (true) {
+      if (input_->eof()) {
+        if (tok_len)
+          break; // collect last token
+        return false;
+      }
+      char c = input_->get();
+      offset++;
+      if (isTokenChar(c)) {
+        if (!tok_len) // start of the token
+          start_pos = offset - 1;
+        buffer.push_back(normalize(c));
+        tok_len++;
+      } else if (tok_len) // end of the token
+        break;
+    }
+    tok = Token(buffer, start_pos, start_pos + tok_len);
+    view.term = &tok.termText[0];
+    view.termLength = tok.termText.size();
+    view.startPos = tok.startPos;
+    view.endPos = tok.endPos;
+    return true;
+  }
+};
+
+static std::string makeText(size_t size) {
+  static const char *const words[] = {
+      "The",  "quick", "brown", "fox",   "jumps", "over",       "the",
+      "lazy", "dog",   "and",   "an",    "index", "tokenizer,", "reads",
+      "text", "at",    "2024",  "MB/s.", "Of",    "course!"};
+  std::string text;
+  text.reserve(size + 16);
+  uint64_t x = 88172645463325252ull;
+  while (text.size() < size) {
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    text.append(words[x % (sizeof words / sizeof *words)]);
+    text.push_back(x % 11 ? ' ' : '\n');
+  }
+  return text;
+}
+
+struct Result {
+  size_t tokens = 0;
+  uint64_t hash = 0; // of terms and offsets
+};
+
+template <typename TokenizerType, typename Source>
+static Result run(const char *name, const std::string &text, Source source) {
+  auto start = std::chrono::steady_clock::now();
+  Result result;
+  TokenizerType tokenizer(source);
+  while (tokenizer.next()) {
+    const TokenView &tok = tokenizer.getTokenView();
+    result.tokens++;
+    result.hash = result.hash * 31 + tok.startPos * 7 + tok.endPos;
+    for (char c : tok.termText())
+      result.hash = result.hash * 131 + static_cast<unsigned char>(c);
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cout << name << ": " << result.tokens << " tokens, "
+            << text.size() / seconds / (1024 * 1024) << " MB/s\n";
+  return result;
+}
+
+// Counts token boundaries byte by byte with std::isalpha(), and with
+// a CharScanner<isalpha_predicate>.
+static bool compareScan(const std::string &text) {
+  std::cout << "Token boundaries\n";
+  auto start = std::chrono::steady_clock::now();
+  size_t scalar = 0;
+  bool in = false;
+  for (char c : text) {
+    bool alpha = std::isalpha(static_cast<unsigned char>(c));
+    scalar += alpha != in;
+    in = alpha;
+  }
+  auto mid = std::chrono::steady_clock::now();
+  size_t simd = 0;
+  const char *end = text.data() + text.size();
+  in = false;
+  CharScanner<isalpha_predicate> scanner;
+  for (const char *p = text.data(); (p = scanner.find(p, end, !in)) != end;
+       in = !in)
+    simd++;
+  auto stop = std::chrono::steady_clock::now();
+  double mb = text.size() / double(1024 * 1024);
+  std::cout << "  std::isalpha() : "
+            << mb / std::chrono::duration<double>(mid - start).count()
+            << " MB/s\n  CharScanner    : "
+            << mb / std::chrono::duration<double>(stop - mid).count()
+            << " MB/s\n";
+  return scalar == simd;
+}
+
+// Mostly non-ASCII text of about size bytes
+static std::string makeMultilingualText(size_t size) {
+  static const char *const words[] = {
+      "Größe", "naïve",  "Привет", "мир",    "東京",   "Ελληνικά",
+      "हिन्दी",  "straße", "CAFÉ",   "Ⱥtlas", "données", "the"};
+  std::string text;
+  text.reserve(size + 32);
+  uint64_t x = 88172645463325252ull;
+  while (text.size() < size) {
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    text.append(words[x % (sizeof words / sizeof *words)]);
+    text.push_back(x % 11 ? ' ' : '\n');
+  }
+  return text;
+}
+
+// Utf8LowerCaseTokenizer must tokenize ASCII text like LowerCaseTokenizer, and
+// about as fast
+static bool compareUtf8(const std::string &text,
+                        const std::string &multilingual) {
+  std::cout << "Utf8LowerCaseTokenizer\n";
+  Result ascii = run<LowerCaseTokenizer, std::string_view>(
+      "  ASCII, LowerCaseTokenizer    ", text, std::string_view(text));
+  Result utf8 = run<Utf8LowerCaseTokenizer, std::string_view>(
+      "  ASCII, Utf8LowerCaseTokenizer", text, std::string_view(text));
+  std::istringstream stream(multilingual);
+  run<Utf8LowerCaseTokenizer, std::istream &>(
+      "  multilingual, istream        ", multilingual, stream);
+  run<Utf8LowerCaseTokenizer, std::string_view>(
+      "  multilingual, memory         ", multilingual,
+      std::string_view(multilingual));
+  return ascii.tokens == utf8.tokens && ascii.hash == utf8.hash;
+}
+
+template <typename Predicate, typename Normalizer>
+static bool compare(const char *name, const std::string &text) {
+  std::cout << name << '\n';
+  std::istringstream legacyStream(text);
+  Result legacy = run<LegacyCharTokenizer<Predicate, Normalizer>,
+                      std::istream &>("  istream::get()", text, legacyStream);
+  std::istringstream stream(text);
+  Result chunked = run<CharTokenizer<Predicate, Normalizer>, std::istream &>(
+      "  istream chunks", text, stream);
+  Result memory = run<CharTokenizer<Predicate, Normalizer>, std::string_view>(
+      "  memory        ", text, std::string_view(text));
+  return legacy.tokens == chunked.tokens && legacy.hash == chunked.hash &&
+         chunked.tokens == memory.tokens && chunked.hash == memory.hash;
+}
+
+int main(int argc, char **argv) {
+  size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+  std::string text = makeText(megabytes * 1024 * 1024);
+  // Only letter tokenizers are compared: the legacy tokenizer passes EOF to
+  // the predicate as a character, which whitespace tokenizers add to the last
+  // token
+  bool same = compare<isalpha_predicate, tolower_normalizer>(
+      "LowerCaseTokenizer", text);
+  same &= compare<isalpha_predicate, noop_normalizer>("AlphaCharTokenizer<>",
+                                                      text);
+  same &= compareScan(text);
+  same &= compareUtf8(text, makeMultilingualText(text.size()));
+  if (!same) {
+    std::cerr << "tokenizers disagree\n";
+    return 1;
+  }
+  return 0;
+}
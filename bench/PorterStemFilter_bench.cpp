@@ -0,0 +1,139 @@
+// Measures stemming in MB/s of text of Zipf-distributed words: the cost of a
+// Chain of a LowerCaseTokenizer alone, with a stage which runs the Porter or
+// English stemmer on every token, and with PorterStemFilter and
+// EnglishStemFilter, whose StemCache skips the stemmer for recent terms; and
+// how much stemming shrinks the dictionary, in a TermInterner.
+//
+// Usage: PorterStemFilter_bench [megabytes of text, 64 by default]
+
+#include <chrono>
+#include <cmath> // pow()
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lucanthrope/analysis/Chain.h"
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/PorterStemFilter.h"
+#include "lucanthrope/analysis/TermInterner.h"
+
+using namespace lucanthrope;
+
+// StemFilter::Stage without the cache
+template <typename Stemmer> struct UncachedStemStage {
+  bool accept(TokenView &view) {
+    view.termLength = Stemmer::stem(view.term, view.termLength);
+    return true;
+  }
+};
+
+// Passes tokens as they are
+struct NoStage {
+  bool accept(TokenView &) { return true; }
+};
+
+// Text of words made of roots and suffixes, their ranks by Zipf's law
+static std::string makeText(size_t size) {
+  static const char *const roots[] = {
+      "connect", "relat",  "generat", "nation",  "form",   "condition",
+      "operat",  "effect", "adjust",  "depend",  "commun", "hope",
+      "care",    "happi",  "sens",    "electr",  "motor",  "plaster",
+      "trouble", "agree",  "consist", "knight",  "allow",  "replac",
+      "digit",   "ration", "differ",  "vietnam", "feudal", "decis"};
+  static const char *const suffixes[] = {
+      "",     "s",     "ing",   "ed",     "ion",  "ions",   "ional",
+      "ness", "ly",    "ation", "ations", "able", "ful",    "ive",
+      "ize",  "izing", "er",    "ers",    "ment", "ments",  "ally",
+      "ity",  "ities", "ism",   "ist",    "ists", "ousness"};
+  std::vector<std::string> words;
+  for (int prefix = 0; prefix < 8; prefix++)
+    for (const char *root : roots)
+      for (const char *suffix : suffixes)
+        words.push_back(std::string("re", prefix % 2 ? 2 : 0) +
+                        (prefix / 2 ? std::string(prefix / 2, 'x') : "") +
+                        root + suffix);
+  // cumulative Zipf weights, by rank
+  std::vector<double> cumulative;
+  double total = 0;
+  for (size_t rank = 1; rank <= words.size(); rank++)
+    cumulative.push_back(total += 1 / std::pow(double(rank), 1.0));
+  std::string text;
+  text.reserve(size + 32);
+  uint64_t x = 88172645463325252ull;
+  while (text.size() < size) {
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    double u = double(x >> 11) / double(1ull << 53) * total;
+    size_t lo = 0, hi = cumulative.size() - 1;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (cumulative[mid] < u)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    text.append(words[lo]);
+    text.push_back(x % 11 ? ' ' : '\n');
+  }
+  return text;
+}
+
+struct Result {
+  size_t tokens = 0;
+  size_t terms = 0;
+  uint64_t hash = 0; // of terms
+};
+
+template <typename... Stages>
+static Result measure(const char *name, const std::string &text,
+                      Stages... stages) {
+  auto start = std::chrono::steady_clock::now();
+  Chain<LowerCaseTokenizer, Stages...> stream{std::string_view(text),
+                                               stages...};
+  Result result;
+  while (stream.advance()) {
+    const TokenView &view = stream.getTokenView();
+    result.tokens++;
+    for (char c : view.termText())
+      result.hash = result.hash * 131 + static_cast<unsigned char>(c);
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  // distinct terms, not timed
+  TermInterner terms;
+  Chain<LowerCaseTokenizer, Stages...> again{std::string_view(text),
+                                              stages...};
+  terms.addAll(again);
+  result.terms = terms.size();
+  std::cout << name << ": " << result.tokens << " tokens, " << result.terms
+            << " terms, " << text.size() / seconds / (1024 * 1024)
+            << " MB/s\n";
+  return result;
+}
+
+int main(int argc, char **argv) {
+  size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+  std::string text = makeText(megabytes * 1024 * 1024);
+
+  Result plain = measure("no stemming        ", text, NoStage());
+  Result porter = measure("Porter, uncached   ", text,
+                          UncachedStemStage<PorterStemmer>());
+  Result porterCached =
+      measure("PorterStemFilter   ", text, PorterStemFilter::Stage());
+  Result english = measure("English, uncached  ", text,
+                           UncachedStemStage<EnglishStemmer>());
+  Result englishCached =
+      measure("EnglishStemFilter  ", text, EnglishStemFilter::Stage());
+
+  if (porter.tokens != plain.tokens || porter.hash != porterCached.hash ||
+      english.hash != englishCached.hash ||
+      porter.terms != porterCached.terms ||
+      english.terms != englishCached.terms) {
+    std::cerr << "stemmers disagree\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,214 @@
+// Measures StopAnalyzer's analysis chain in MB/s, built of TokenFilters which
+// call each other's virtual next(), and built as a Chain, both through the
+// TokenStream interface and through Chain::advance(); and the cost of a stop
+// word lookup, in a PerfectHashSet and in a std::unordered_set as StopFilter
+// used to do it; and the cost of analyzing short fields with a new stream per
+// field (getTokenStream()) and with a reused one (reusableTokenStream()), of
+// an istream or of the text in memory.
+//
+// Usage: StopAnalyzer_bench [megabytes of text, 64 by default]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator> // begin(), end()
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "lucanthrope/analysis/Chain.h"
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/LowerCaseFilter.h"
+#include "lucanthrope/analysis/PerfectHashSet.h"
+#include "lucanthrope/analysis/StopAnalyzer.h"
+#include "lucanthrope/analysis/StopFilter.h"
+
+using namespace lucanthrope;
+
+// StopFilter::Stage as it was before perfect hashing
+class UnorderedSetStopStage {
+private:
+  const std::unordered_set<std::string> *stopWords;
+  std::string key;
+
+public:
+  explicit UnorderedSetStopStage(const std::unordered_set<std::string> &words)
+      : stopWords(&words) {}
+
+  bool accept(TokenView &view) {
+    key.assign(view.term, view.termLength);
+    return stopWords->find(key) == stopWords->end();
+  }
+};
+
+static std::string makeText(size_t size) {
+  static const char *const words[] = {
+      "The",   "quick", "brown", "fox",  "jumps", "over",       "the",
+      "lazy",  "dog",   "and",   "an",   "index", "tokenizer,", "reads",
+      "text",  "at",    "2024",  "MB/s", "Of",    "course!",    "it",
+      "THERE", "is",    "a",     "WAS",  "such",  "Analysis",   "into"};
+  std::string text;
+  text.reserve(size + 16);
+  uint64_t x = 88172645463325252ull;
+  while (text.size() < size) {
+    x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+    text.append(words[x % (sizeof words / sizeof *words)]);
+    text.push_back(x % 11 ? ' ' : '\n');
+  }
+  return text;
+}
+
+struct Result {
+  size_t tokens = 0;
+  uint64_t hash = 0; // of terms and offsets
+};
+
+static void add(Result &result, const TokenView &tok) {
+  result.tokens++;
+  result.hash = result.hash * 31 + tok.startPos * 7 + tok.endPos;
+  for (char c : tok.termText())
+    result.hash = result.hash * 131 + static_cast<unsigned char>(c);
+}
+
+template <typename Run>
+static Result measure(const char *name, const std::string &text, Run run) {
+  std::istringstream input(text);
+  auto start = std::chrono::steady_clock::now();
+  Result result = run(input);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cout << name << ": " << result.tokens << " tokens, "
+            << text.size() / seconds / (1024 * 1024) << " MB/s\n";
+  return result;
+}
+
+int main(int argc, char **argv) {
+  size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+  std::string text = makeText(megabytes * 1024 * 1024);
+  StopAnalyzer analyzer;
+  PerfectHashSet stopWords = StopAnalyzer::EnglishStopWordSet.set();
+
+  Result filters = measure(
+      "TokenFilters    ", text, [&stopWords](std::istream &input) {
+        std::unique_ptr<TokenStream> tokenizer(new LowerCaseTokenizer(input));
+        StopFilter stream(std::move(tokenizer), stopWords);
+        Result result;
+        while (stream.next())
+          add(result, stream.getTokenView());
+        return result;
+      });
+  Result adapter =
+      measure("Chain, next()   ", text, [&analyzer](std::istream &input) {
+        std::unique_ptr<TokenStream> stream = analyzer.getTokenStream(input);
+        Result result;
+        while (stream->next())
+          add(result, stream->getTokenView());
+        return result;
+      });
+  Result chain =
+      measure("Chain, advance()", text, [&stopWords](std::istream &input) {
+        Chain<LowerCaseTokenizer, StopFilter> stream(
+            input, StopFilter::Stage(stopWords));
+        Result result;
+        while (stream.advance())
+          add(result, stream.getTokenView());
+        return result;
+      });
+  std::unordered_set<std::string> stopWordsSet(
+      std::begin(StopAnalyzer::EnglishStopWords),
+      std::end(StopAnalyzer::EnglishStopWords));
+  Result unordered =
+      measure("unordered_set   ", text, [&stopWordsSet](std::istream &input) {
+        Chain<LowerCaseTokenizer, UnorderedSetStopStage> stream(
+            input, UnorderedSetStopStage(stopWordsSet));
+        Result result;
+        while (stream.advance())
+          add(result, stream.getTokenView());
+        return result;
+      });
+
+  // Lookups of the first terms of the text, few enough to stay in cache
+  std::vector<std::string> terms;
+  LowerCaseTokenizer tokenizer{std::string_view(text)};
+  while (terms.size() < 10000 && tokenizer.next())
+    terms.emplace_back(tokenizer.getTokenView().termText());
+  constexpr int kRounds = 1000;
+  auto start = std::chrono::steady_clock::now();
+  size_t perfectHits = 0;
+  for (int round = 0; round < kRounds; round++)
+    for (auto &term : terms)
+      perfectHits += stopWords.contains(term);
+  auto mid = std::chrono::steady_clock::now();
+  size_t unorderedHits = 0;
+  std::string key;
+  for (int round = 0; round < kRounds; round++)
+    for (auto &term : terms) {
+      key.assign(term.data(), term.size());
+      unorderedHits += stopWordsSet.count(key);
+    }
+  auto stop = std::chrono::steady_clock::now();
+  double lookups = double(terms.size()) * kRounds;
+  std::cout << "lookup, PerfectHashSet: "
+            << std::chrono::duration<double, std::nano>(mid - start).count() /
+                   lookups
+            << " ns\nlookup, unordered_set : "
+            << std::chrono::duration<double, std::nano>(stop - mid).count() /
+                   lookups
+            << " ns\n";
+
+  // Short fields, as in documents of titles or tags
+  std::vector<std::string> fields;
+  for (size_t pos = 0; fields.size() < 100000 && pos + 48 <= text.size();
+       pos += 48)
+    fields.push_back(text.substr(pos, 48));
+  std::istringstream field;
+  Result fresh, reused;
+  start = std::chrono::steady_clock::now();
+  for (auto &value : fields) {
+    field.clear();
+    field.str(value);
+    std::unique_ptr<TokenStream> stream = analyzer.getTokenStream(field);
+    while (stream->next())
+      add(fresh, stream->getTokenView());
+  }
+  mid = std::chrono::steady_clock::now();
+  for (auto &value : fields) {
+    field.clear();
+    field.str(value);
+    TokenStream &stream = analyzer.reusableTokenStream(field);
+    while (stream.next())
+      add(reused, stream.getTokenView());
+  }
+  stop = std::chrono::steady_clock::now();
+  Result inPlace;
+  for (auto &value : fields) {
+    TokenStream &stream = analyzer.reusableTokenStream(std::string_view(value));
+    while (stream.next())
+      add(inPlace, stream.getTokenView());
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::cout << "field, getTokenStream()     : "
+            << std::chrono::duration<double, std::nano>(mid - start).count() /
+                   fields.size()
+            << " ns\nfield, reusableTokenStream(): "
+            << std::chrono::duration<double, std::nano>(stop - mid).count() /
+                   fields.size()
+            << " ns\nfield, in memory           : "
+            << std::chrono::duration<double, std::nano>(end - stop).count() /
+                   fields.size()
+            << " ns\n";
+
+  if (fresh.tokens != reused.tokens || fresh.hash != reused.hash ||
+      inPlace.tokens != reused.tokens || inPlace.hash != reused.hash ||
+      perfectHits != unorderedHits || unordered.tokens != chain.tokens ||
+      unordered.hash != chain.hash || filters.tokens != adapter.tokens || filters.hash != adapter.hash ||
+      filters.tokens != chain.tokens || filters.hash != chain.hash) {
+    std::cerr << "analysis chains disagree\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+
+namespace lucanthrope {
+
+// CRC-32C (Castagnoli), the checksum of index file footers (see
+// IndexOutput::writeChecksumFooter()). Uses the SSE4.2 crc32 instruction when
+// the CPU has it, and slicing-by-8 tables otherwise.
+class CRC32C {
+private:
+  uint32_t crc_ = 0;
+
+public:
+  void update(const char *data, size_t size) { crc_ = extend(crc_, data, size); }
+
+  uint32_t getValue() const { return crc_; }
+
+  void reset() { crc_ = 0; }
+
+  // Returns the checksum of A followed by data, where crc is the checksum of
+  // A (0 for empty A).
+  static uint32_t extend(uint32_t crc, const char *data, size_t size);
+
+  // Returns the checksum of A followed by B, given the checksums of A and B
+  // and the length of B. Costs O(log(lengthB)), which lets chunks of a file
+  // be checksummed independently (e.g. in parallel).
+  static uint32_t combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+};
+
+} // namespace lucanthrope
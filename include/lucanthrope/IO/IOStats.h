@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint> // uint64_t
+
+namespace lucanthrope {
+
+// I/O counters of a group of streams. An operation is one fill of an input's
+// buffer or one flush of an output's buffer; bytes are counted as they move
+// between a buffer and the underlying storage (a memory-mapped input counts
+// its whole range on the first fill).
+struct IOCounters {
+  uint64_t bytesRead = 0;
+  uint64_t readOps = 0;
+  uint64_t bytesWritten = 0;
+  uint64_t writeOps = 0;
+};
+
+// Same as IOCounters, updated concurrently by streams.
+struct AtomicIOCounters {
+  std::atomic<uint64_t> bytesRead{0};
+  std::atomic<uint64_t> readOps{0};
+  std::atomic<uint64_t> bytesWritten{0};
+  std::atomic<uint64_t> writeOps{0};
+
+  void countRead(uint64_t bytes) {
+    bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+    readOps.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void countWrite(uint64_t bytes) {
+    bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+    writeOps.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  IOCounters load() const {
+    IOCounters ret;
+    ret.bytesRead = bytesRead.load(std::memory_order_relaxed);
+    ret.readOps = readOps.load(std::memory_order_relaxed);
+    ret.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    ret.writeOps = writeOps.load(std::memory_order_relaxed);
+    return ret;
+  }
+};
+
+} // namespace lucanthrope
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio> // BUFSIZ
 #include <stdint.h>
 
 namespace lucanthrope {
@@ -56,6 +57,12 @@ public:
   // Maximum length (in bytes) of the varint encoding of a 64-bit value.
   static constexpr size_t kMaxVarintLength64 = 10;
 
+  // Checksum footer (see IndexOutput::writeChecksumFooter()): Int32 magic,
+  // Int32 algorithm id, then Int64 checksum of every byte before it.
+  static constexpr uint32_t kFooterMagic = 0xc02893e8;
+  static constexpr uint32_t kChecksumCRC32C = 0;
+  static constexpr size_t kFooterLength = 16;
+
   // Whether or not an external buffer may be installed. For example, a client
   // might want to provide external buffer if a set of files are to be written
   // one after another, in which case it could be more efficient to reuse a
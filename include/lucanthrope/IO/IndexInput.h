@@ -2,27 +2,40 @@
 
 #include <cstddef> // size_t
 #include <cstdint>
+#include <memory> // unique_ptr
 #include <stdint.h>
 #include <string>
+#include <utility> // move()
 
+#include "IOStats.h"
 #include "IndexIOBase.h"
 
 namespace lucanthrope {
 
+class IndexOutput;
+
 class IndexInput : public IndexIOBase {
+  // IndexOutput::copyBytes() writes directly from our buffer
+  friend IndexOutput;
+
 protected:
   // One more pointer is required (points to the one-past-the-last byte that was
   // read from source into buffer). Buffer has to be filled with the new data
   // when bufCur == sentinel.
   char *sentinel = nullptr;
 
+  // Throws IndexCorruptionException unless [offset, offset + length) lies
+  // within [0, size); used by slice() implementations.
+  static void checkSliceBounds(uint64_t offset, uint64_t length,
+                               uint64_t size);
+
 public:
   IndexInput() = default;
   virtual ~IndexInput() override = default;
 
   void setExternalBuffer(char *bufferStart, size_t size) {
     IndexIOBase::setExternalBuffer(bufferStart, size);
-    bufCur = bufEnd;
+    bufCur = sentinel = bufEnd;
   }
 
   size_t getNumReadableBytes() const { return sentinel - bufCur; }
@@ -30,7 +43,13 @@ public:
   bool hasPendingData() const { return getNumReadableBytes() > 0; }
 
   // If all buffered data was consumed, then try
-  bool eof() { return !hasPendingData() && !fillImpl(); }
+  bool eof() { return !hasPendingData() && !fill(); }
+
+  // Every fill of the buffer is counted in counters; nullptr disables
+  // counting.
+  void setIOCounters(std::shared_ptr<AtomicIOCounters> counters) {
+    ioCounters_ = std::move(counters);
+  }
 
   // Data input Interface:
 
@@ -61,7 +80,42 @@ public:
       buff.push_back(readByte());
   }
 
+  // Reads size bytes and returns their CRC32C. Bytes are checksummed straight
+  // in the buffer, without copying. Throws if less than size bytes are left.
+  uint32_t checksumBytes(uint64_t size);
+
+  // Reads the checksum footer of a stream of length bytes into checksum;
+  // returns false if the stream has no footer. Changes the position.
+  bool readChecksumFooter(uint64_t length, uint64_t &checksum);
+
+  // Checks the checksum footer of a stream of length bytes which was written
+  // with IndexOutput::writeChecksumFooter(): reads the whole stream from the
+  // beginning and leaves it positioned at the footer's start. Throws
+  // IndexCorruptionException if there is no footer or the checksum doesn't
+  // match.
+  void verifyChecksumFooter(uint64_t length);
+
+  // Returns an independent stream which reads bytes [offset, offset + length)
+  // of this stream's source, with positions starting at 0. The slice shares
+  // the source (file blocks, descriptor, or mapping) with this stream, nothing
+  // is copied; this stream's position and buffer are not affected. The slice
+  // may outlive this stream. Slices of slices are supported. The slice doesn't
+  // inherit I/O counters of this stream.
+  // Throws exception if the range is out of this stream's bounds.
+  virtual std::unique_ptr<IndexInput> slice(uint64_t offset,
+                                            uint64_t length) const = 0;
+
 private:
+  std::shared_ptr<AtomicIOCounters> ioCounters_;
+
+  bool fill() {
+    if (!fillImpl())
+      return false;
+    if (ioCounters_)
+      ioCounters_->countRead(getNumReadableBytes());
+    return true;
+  }
+
   // Reads as mush data as possible into buffer, sets bufCur to the beginning of
   // read bytes, sets sentinel to the next byte after read bytes. Returns true
   // on success, returns false if there is no more data in the source, throws an
@@ -2,12 +2,19 @@
 
 #include <cstddef> // size_t
 #include <cstdint>
+#include <memory> // shared_ptr
 #include <string_view>
+#include <utility> // move()
 
+#include "CRC32C.h"
+#include "IOStats.h"
 #include "IndexIOBase.h"
+#include "RateLimiter.h"
 
 namespace lucanthrope {
 
+class IndexInput;
+
 class IndexOutput : public IndexIOBase {
 public:
   IndexOutput() = default;
@@ -30,6 +37,18 @@ public:
 
   virtual void sync() { flush(); }
 
+  // Every flush of the buffer is paid for in rateLimiter before it is written;
+  // nullptr disables limiting.
+  void setRateLimiter(std::shared_ptr<RateLimiter> rateLimiter) {
+    rateLimiter_ = std::move(rateLimiter);
+  }
+
+  // Every flush of the buffer is counted in counters; nullptr disables
+  // counting.
+  void setIOCounters(std::shared_ptr<AtomicIOCounters> counters) {
+    ioCounters_ = std::move(counters);
+  }
+
   // Data output Interface:
   IndexOutput &writeByte(char c);
 
@@ -48,13 +67,68 @@ public:
         .write(str.data(), str.size());
   }
 
+  // Makes the output checksum the bytes it flushes, for getChecksum() and
+  // writeChecksumFooter(); must be called before anything is flushed. Outputs
+  // don't checksum by default, so that the many which never write a footer
+  // (RAM, cached and merge outputs, ...) don't pay for CRC32C on every flush.
+  void enableChecksum() {
+    assert(!flushed_ && "Bytes were flushed without a checksum!");
+    checksummed_ = true;
+  }
+
+  // Returns CRC32C of every byte written so far, in the order of writing; it
+  // is meaningless after seek(). Requires enableChecksum().
+  uint32_t getChecksum() const {
+    assert(checksummed_ && "Checksum is not enabled!");
+    return CRC32C::extend(checksum_.getValue(), bufStart,
+                          getNumWritableBytes());
+  }
+
+  // Ends the file with a checksum footer (see IndexIOBase::kFooterMagic),
+  // which IndexInput::verifyChecksumFooter() and verifyChecksums() check.
+  // Requires enableChecksum().
+  IndexOutput &writeChecksumFooter() {
+    writeInt32(kFooterMagic).writeInt32(kChecksumCRC32C);
+    return writeInt64(getChecksum());
+  }
+
+  // Copies size bytes from input, starting at its current position. Bytes are
+  // written straight from input's buffer, so no intermediate copy is made.
+  // Throws if input has less than size bytes left.
+  IndexOutput &copyBytes(IndexInput &input, uint64_t size);
+
+protected:
+  // For implementations which write into storage directly (e.g. RAM blocks)
+  // and may drop buffered bytes without calling writeImpl(): counts bytes
+  // [bufStart, bufCur) as written.
+  void countUnflushed() {
+    if (ioCounters_ && bufCur != bufStart)
+      ioCounters_->countWrite(getNumWritableBytes());
+  }
+
 private:
+  std::shared_ptr<RateLimiter> rateLimiter_;
+  std::shared_ptr<AtomicIOCounters> ioCounters_;
+  // Checksum of bytes which were flushed, if checksummed_
+  CRC32C checksum_;
+  bool checksummed_ = false;
+  bool flushed_ = false;
+
   // Flushes the buffer which is known to be non-empty and resets the position
   // to the beginning of the buffer. Throws an exception if something is wrong.
   void flushNonEmpty() {
     assert(getNumWritableBytes() && "Buffer is currently empty!");
+    size_t size = getNumWritableBytes();
+    if (rateLimiter_)
+      rateLimiter_->acquire(size);
+    // before writeImpl(), which may move the buffer
+    if (checksummed_)
+      checksum_.update(bufStart, size);
+    flushed_ = true;
     writeImpl();
     bufCur = bufStart;
+    if (ioCounters_)
+      ioCounters_->countWrite(size);
   }
 
   // Copy data into the buffer. Size must not be greater than the number of
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint> // uint64_t
+#include <mutex>
+
+namespace lucanthrope {
+
+// Token bucket which limits the rate at which bytes are written. The bucket
+// holds up to burstBytes tokens and is refilled at bytesPerSec. acquire()
+// takes tokens for the bytes which are about to be written, and sleeps if the
+// bucket runs into debt, until the debt would have been repaid; a request
+// larger than the bucket is thus allowed, but is paid for in full. One limiter
+// may be shared by any number of streams and threads, which then share the
+// rate.
+class RateLimiter {
+public:
+  // bytesPerSec == 0 disables limiting. burstBytes == 0 means bytesPerSec / 10,
+  // i.e. 100 ms worth of writing.
+  explicit RateLimiter(uint64_t bytesPerSec, uint64_t burstBytes = 0);
+
+  RateLimiter(const RateLimiter &) = delete;
+  RateLimiter &operator=(const RateLimiter &) = delete;
+
+  // Takes effect for subsequent acquire() calls.
+  void setRate(uint64_t bytesPerSec, uint64_t burstBytes = 0);
+
+  uint64_t getRate();
+
+  // Blocks until writing bytes would not exceed the rate.
+  void acquire(uint64_t bytes);
+
+  // Total time spent sleeping in acquire(), in nanoseconds.
+  uint64_t getPausedNanos();
+
+private:
+  std::mutex mu_;
+  uint64_t rate_;
+  uint64_t burst_;
+  // May become negative (debt)
+  double tokens_;
+  // steady_clock time of the last refill, in nanoseconds
+  int64_t lastRefill_;
+  uint64_t pausedNanos_ = 0;
+};
+
+} // namespace lucanthrope
@@ -1,18 +1,32 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <istream>
 #include <memory>
+#include <mutex>
+#include <streambuf>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <utility> // move()
 
 namespace lucanthrope {
 
 class TokenStream;
 
+// Reads text in memory in place, unlike std::stringbuf, which copies it
+class StringViewBuf : public std::streambuf {
+public:
+  void reset(std::string_view text) {
+    char *p = const_cast<char *>(text.data());
+    setg(p, p, p + text.size());
+  }
+};
+
 // A Token is an occurence of a term from the text of a field.  It consists of
 // a term's text, the start and end offset of the term in the text of the field,
 // and a reference to type string.
@@ -29,7 +43,7 @@ class TokenStream;
 struct Token {
   std::string termText;  // the text of the term
   uint64_t startPos;     // start in source text
-  int endPos;            // end in source text
+  uint64_t endPos;       // end in source text
   std::string_view type; // lexical type
 
   Token() = default;
@@ -62,6 +76,24 @@ struct Token {
   }
 };
 
+// A token whose term text lives in a buffer owned by the TokenStream which
+// produced it (usually the Tokenizer at the start of an analysis chain), valid
+// until that stream's next call to next(). TokenFilters rewrite the term in
+// place, so once the buffer has grown to the longest term, analysis does no
+// heap allocation per token. A filter which needs more room than termLength
+// points term to a buffer of its own.
+struct TokenView {
+  char *term = nullptr;
+  size_t termLength = 0;
+  uint64_t startPos = 0;
+  uint64_t endPos = 0;
+  std::string_view type;
+
+  std::string_view termText() const {
+    return std::string_view(term, termLength);
+  }
+};
+
 // A TokenStream enumerates the sequence of tokens, either from
 // fields of a document or from query text.
 //
@@ -70,7 +102,19 @@ struct Token {
 // TokenFilter, a TokenStream whose input is another TokenStream.
 class TokenStream {
 protected:
-  Token tok;
+  // The last lexed token, which next() sets
+  TokenView view;
+
+private:
+  // getToken()'s copy of view
+  mutable Token tok;
+
+  // The istream of the default reset(std::string_view)
+  struct MemoryInput {
+    StringViewBuf buf;
+    std::istream stream{&buf};
+  };
+  std::unique_ptr<MemoryInput> memory_;
 
 public:
   TokenStream() = default;
@@ -81,16 +125,41 @@ public:
   // Tries to parse next token in the stream, returns true on success,
   // false if the end of stream is reached. Throws an exception if something is
   // wrong (I/O error, unable to parse a token, etc.). If next() returns true,
-  // then getToken() returns lvalue refernce to the token just lexed.
+  // then getTokenView() and getToken() return the token just lexed.
   //
-  // FIXME! This has to be rewritten so that this function is not virtual.
-  // Calling virtual function for each token sounds like a bad idea, but let's
-  // keep it simple for now.
+  // Calling a virtual function for each token of each stream of an analysis
+  // chain is expensive; Chain (see Chain.h) composes a tokenizer and filters
+  // so that only the chain's next() is virtual.
   virtual bool next() = 0;
 
-  // Retuns the last lexed token; next() must be called (and evaluate to true)
-  // before this function is called.
-  const Token &getToken() const { return tok; }
+  // Makes the stream start over on input, as if it were just constructed on
+  // it, so that it can be reused (see Analyzer::reusableTokenStream()).
+  virtual void reset(std::istream &input) = 0;
+
+  // Makes the stream start over on text in memory, which must outlive the
+  // stream's use of it. Tokenizers which scan memory directly override this;
+  // other streams read the text through an istream of their own.
+  virtual void reset(std::string_view text) {
+    if (!memory_)
+      memory_.reset(new MemoryInput);
+    memory_->buf.reset(text);
+    memory_->stream.clear();
+    reset(memory_->stream);
+  }
+
+  // Returns the last lexed token, without copying its term; next() must be
+  // called (and evaluate to true) before this function is called.
+  const TokenView &getTokenView() const { return view; }
+
+  // Returns a copy of the last lexed token which owns its term text; it's
+  // overwritten by the next call. Prefer getTokenView() on hot paths.
+  const Token &getToken() const {
+    tok.termText.assign(view.term, view.termLength);
+    tok.startPos = view.startPos;
+    tok.endPos = view.endPos;
+    tok.type = view.type;
+    return tok;
+  }
 };
 
 // An Analyzer builds TokenStreams, which analyze text.  It thus represents a
@@ -100,28 +169,145 @@ public:
 // characters from the Reader into raw Tokens.  One or more TokenFilters may
 // then be applied to the output of the Tokenizer.
 class Analyzer {
+private:
+  // Identifies the analyzer in threads' caches; never reused
+  const uint64_t id_;
+
+  // Streams of reusableTokenStream(), by thread and then by field name (all
+  // under "" if sameStreamForAllFields()). A thread's entry is dropped by
+  // releaseThreadStreams(), or when the thread exits, so the map doesn't grow
+  // with threads which are gone. It's shared with those threads, so that one
+  // exiting while the analyzer is destroyed is safe.
+  using FieldStreams =
+      std::unordered_map<std::string, std::unique_ptr<TokenStream>>;
+  struct ThreadStreams {
+    std::mutex mu;
+    std::unordered_map<std::thread::id, FieldStreams> byThread;
+
+    // Destroys the calling thread's streams
+    void release();
+  };
+  const std::shared_ptr<ThreadStreams> streams_;
+
+  // The streams of the analyzer the calling thread used last, and the field
+  // and stream it used last
+  struct LastStream {
+    uint64_t analyzer = 0;
+    FieldStreams *streams = nullptr;
+    std::string field;
+    TokenStream *stream = nullptr;
+  };
+
+  static LastStream &lastStream() {
+    static thread_local LastStream last;
+    return last;
+  }
+
+  static uint64_t nextId() {
+    static std::atomic<uint64_t> id(1);
+    return id.fetch_add(1, std::memory_order_relaxed);
+  }
+
 public:
-  Analyzer() = default;
+  Analyzer() : id_(nextId()), streams_(std::make_shared<ThreadStreams>()) {}
 
   Analyzer(const Analyzer &) = delete;
   Analyzer &operator=(const Analyzer &) = delete;
-  virtual ~Analyzer() = default;
+  virtual ~Analyzer();
   // Creates a TokenStream which tokenizes all the text in the provided istream.
   // istream is owned by Document, so getTokenStream() doesn't take ownership
   virtual std::unique_ptr<TokenStream> getTokenStream(
       std::istream &input,
       [[maybe_unused]] std::string_view fieldName = std::string_view()) = 0;
+
+  // True if getTokenStream() builds the same chain whatever the field name,
+  // so that reusableTokenStream() can keep one stream per thread for all
+  // fields rather than one per thread and field.
+  virtual bool sameStreamForAllFields() const { return false; }
+
+  // Returns a TokenStream like getTokenStream() does, but the stream is
+  // created once per thread and field and then reset onto each new input, so
+  // that analyzing many short fields doesn't allocate a chain for each. The
+  // stream belongs to the analyzer; it's valid until the calling thread calls
+  // reusableTokenStream() of this analyzer again for the same field (for any
+  // field if sameStreamForAllFields()), the thread calls
+  // releaseThreadStreams() or exits, or the analyzer is destroyed.
+  virtual TokenStream &
+  reusableTokenStream(std::istream &input,
+                      std::string_view fieldName = std::string_view()) {
+    TokenStream *stream = cachedStream(fieldName);
+    if (stream) {
+      stream->reset(input);
+      return *stream;
+    }
+    return cacheStream(fieldName, getTokenStream(input, fieldName));
+  }
+
+  // Same as reusableTokenStream(input, fieldName), of text in memory, e.g.
+  // the value of a Field (see Field::getTextValue()); tokenizers which can
+  // scan memory directly do, without an istream. text must outlive the use of
+  // the stream.
+  virtual TokenStream &
+  reusableTokenStream(std::string_view text,
+                      std::string_view fieldName = std::string_view()) {
+    TokenStream *stream = cachedStream(fieldName);
+    if (!stream) {
+      std::istream none(nullptr);
+      stream = &cacheStream(fieldName, getTokenStream(none, fieldName));
+    }
+    stream->reset(text);
+    return *stream;
+  }
+
+  // Destroys the calling thread's streams of reusableTokenStream(), e.g. when
+  // a pooled thread is done with the analyzer for a while. Streams of a
+  // thread are destroyed anyway when it exits.
+  virtual void releaseThreadStreams();
+
+private:
+  // The calling thread's stream of this analyzer for fieldName, if it has one
+  TokenStream *cachedStream(std::string_view fieldName) {
+    LastStream &last = lastStream();
+    if (sameStreamForAllFields())
+      fieldName = std::string_view();
+    if (last.analyzer != id_) {
+      if (!useThreadStreams(last))
+        return nullptr;
+    } else if (last.stream && last.field == fieldName) {
+      return last.stream;
+    }
+    // Only this thread changes its FieldStreams, so reading it needs no lock
+    auto it = last.streams->find(std::string(fieldName));
+    if (it == last.streams->end())
+      return nullptr;
+    last.field.assign(fieldName);
+    last.stream = it->second.get();
+    return last.stream;
+  }
+
+  // Points last at the calling thread's streams of this analyzer; false if
+  // it has none
+  bool useThreadStreams(LastStream &last);
+
+  // Makes stream the calling thread's stream of this analyzer for fieldName
+  TokenStream &cacheStream(std::string_view fieldName,
+                           std::unique_ptr<TokenStream> stream);
 };
 
 // A Tokenizer is a TokenStream whose input is a Reader.
 class Tokenizer : public TokenStream {
 protected:
-  // The text source for this Tokenizer.
-  std::istream &input_;
+  // The text source for this Tokenizer; nullptr if the tokenizer reads text
+  // directly from memory.
+  std::istream *input_;
 
 public:
-  Tokenizer(std::istream &input) : input_(input) {}
+  Tokenizer(std::istream &input) : input_(&input) {}
+  Tokenizer() : input_(nullptr) {}
   virtual ~Tokenizer() = default;
+
+  using TokenStream::reset;
+  virtual void reset(std::istream &input) override { input_ = &input; }
 };
 
 // A TokenFilter is a TokenStream whose input is another token stream.
@@ -134,6 +320,10 @@ protected:
 public:
   TokenFilter(std::unique_ptr<TokenStream> input) : input_(std::move(input)){};
   virtual ~TokenFilter() = default;
+
+  virtual void reset(std::istream &input) override { input_->reset(input); }
+
+  virtual void reset(std::string_view text) override { input_->reset(text); }
 };
 
 } // namespace lucanthrope
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <istream>
+#include <memory> // unique_ptr
+#include <string_view>
+#include <vector>
+
+#include "TermInterner.h"
+
+namespace lucanthrope {
+
+class Analyzer;
+class Document;
+class ThreadPool;
+
+// Analyzes many documents at once, across a thread pool. The tokenized fields
+// (see Field::isTokenized()) of a batch of documents go through the token
+// streams of an analyzer (Analyzer::reusableTokenStream(), so that each
+// thread reuses its own), and come out as compact arrays of interned term ids,
+// positions and offsets, one structure of arrays per document.
+//
+// Documents are split into contiguous ranges, a few per thread; each range's
+// terms are interned by its task into a TermInterner, and the ranges' terms
+// are then merged in document order. Term ids are thus dense, from 0, in the
+// order of the terms' first occurrences in the batch, whatever the number of
+// threads is.
+//
+// analyzeText() is the same for one large text, e.g. a log file: the text is
+// cut at whitespace into chunks, which are tokenized concurrently and merged
+// back, in order, into the tokens of a single field.
+class BatchAnalyzer {
+public:
+  // The tokens of a document, in field order and then in stream order: token
+  // i is term termIds[i], at position positions[i], and spans
+  // [startOffsets[i], endOffsets[i]) of its field's value.
+  struct DocumentTokens {
+    // The tokens of the field at index fields[f] in the document are
+    // [fieldStarts[f], fieldStarts[f + 1])
+    std::vector<uint32_t> fields;
+    std::vector<uint64_t> fieldStarts;
+    std::vector<uint32_t> termIds;
+    // Positions count the tokens of each field name from 0: the text of
+    // fields with the same name is treated as though appended. Like
+    // fieldStarts, they are 64-bit: analyzeText() of a large enough text
+    // has more than 2^32 tokens.
+    std::vector<uint64_t> positions;
+    std::vector<uint64_t> startOffsets;
+    std::vector<uint64_t> endOffsets;
+
+    size_t size() const { return termIds.size(); }
+  };
+
+  struct Result {
+    TermInterner terms;                    // by term id
+    std::vector<DocumentTokens> documents; // in the order of the batch
+  };
+
+  // Zero numThreads means ThreadPool::defaultThreadCount().
+  explicit BatchAnalyzer(Analyzer &analyzer, size_t numThreads = 0);
+  ~BatchAnalyzer();
+
+  BatchAnalyzer(const BatchAnalyzer &) = delete;
+  BatchAnalyzer &operator=(const BatchAnalyzer &) = delete;
+
+  // Analyzes the numDocuments documents at documents. istream-valued fields
+  // are read to their end. If the analyzer throws, the first exception is
+  // rethrown once every task is done.
+  Result analyze(const Document *documents, size_t numDocuments);
+
+  Result analyze(const std::vector<Document> &documents) {
+    return analyze(documents.data(), documents.size());
+  }
+
+  // Analyzes text as the value of a field named fieldName, e.g. a memory-mapped
+  // file, in chunks of at least kMinChunkSize bytes cut at ASCII whitespace.
+  // The result has one document, of one field, at index 0; its tokens are
+  // those a token stream of the analyzer returns for the whole text, with
+  // offsets in the text, as long as the stream ends every token at ASCII
+  // whitespace and keeps no state from one token to the next, as every
+  // tokenizer and filter here does.
+  Result analyzeText(std::string_view text, std::string_view fieldName = {});
+
+  // Same as analyzeText(text, fieldName), of the text read from input to its
+  // end, a few chunks per thread at a time.
+  Result analyzeText(std::istream &input, std::string_view fieldName = {});
+
+  static constexpr size_t kMinChunkSize = 1 << 20;
+
+private:
+  Analyzer &analyzer_;
+  std::unique_ptr<ThreadPool> pool_;
+
+  // Tokenizes the chunks of text, which starts at offset base of the field's
+  // value, into result's only document
+  void analyzeChunks(std::string_view text, uint64_t base,
+                     std::string_view fieldName, Result &result);
+};
+
+} // namespace lucanthrope
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility> // forward(), move()
+
+#include "Analysis.h"
+
+namespace lucanthrope {
+
+// The stage type of a filter in a Chain: Filter::Stage if Filter has one,
+// Filter itself otherwise. A stage is a cheap, copyable function object with
+//   bool accept(TokenView &view);
+// which may rewrite the token in place (see TokenView), and returns false if
+// the token is to be dropped.
+template <typename Filter, typename = void> struct StageOf {
+  using type = Filter;
+};
+
+template <typename Filter>
+struct StageOf<Filter, std::void_t<typename Filter::Stage>> {
+  using type = typename Filter::Stage;
+};
+
+template <typename Filter> using StageOf_t = typename StageOf<Filter>::type;
+
+// An analysis chain composed at compile time, e.g.
+//   Chain<LowerCaseTokenizer, StopFilter> chain(input, StopFilter::Stage(words));
+// is the token stream of StopFilter(LowerCaseTokenizer(input)), but the
+// tokenizer and the filters' stages are members of concrete types, called
+// without virtual dispatch, so the compiler can inline the whole pipeline into
+// one loop. advance() is that loop; next() is the TokenStream interface for
+// existing callers (e.g. Analyzer::getTokenStream()), which costs one virtual
+// call per token instead of one per stream in the chain.
+template <typename TokenizerType, typename... Filters>
+class Chain final : public TokenStream {
+private:
+  TokenizerType tokenizer;
+  std::tuple<StageOf_t<Filters>...> stages;
+
+public:
+  // Source is the tokenizer's input: std::istream & or std::string_view.
+  template <typename Source>
+  explicit Chain(Source &&source, StageOf_t<Filters>... stages)
+      : tokenizer(std::forward<Source>(source)), stages(std::move(stages)...) {}
+
+  // Same as next(), but not virtual.
+  bool advance() {
+    // qualified, so that the tokenizer's next() is called directly
+    while (tokenizer.TokenizerType::next()) {
+      view = tokenizer.getTokenView();
+      if (std::apply(
+              [this](auto &...stage) { return (stage.accept(view) && ...); },
+              stages))
+        return true;
+    }
+    return false;
+  }
+
+  virtual bool next() override { return advance(); }
+
+  virtual void reset(std::istream &input) override { tokenizer.reset(input); }
+
+  // Makes the chain start over on text in memory.
+  virtual void reset(std::string_view text) override { tokenizer.reset(text); }
+};
+
+} // namespace lucanthrope
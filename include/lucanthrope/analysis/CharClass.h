@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <type_traits>
+
+#if defined(__AVX512BW__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace lucanthrope {
+
+// A set of characters known at compile time, given as inclusive byte ranges
+// Bounds = first1, last1, first2, last2, ...; if Complement is true, the set
+// is every character which is in none of the ranges.
+//
+// Membership is tested through a 256-entry lookup table, so it doesn't depend
+// on the C library or on the current locale. Contiguous buffers are scanned
+// through membership bitmasks of 64 bytes, computed 64, 32 or 16 bytes at a
+// time by AVX-512BW, AVX2 or SSE2 compare-and-movemask kernels, whichever is
+// the widest the compiler is allowed to use (x86-64 always has SSE2; build
+// with e.g. -march=native for the others).
+template <bool Complement, unsigned char... Bounds> struct CharClass {
+  static_assert(sizeof...(Bounds) && sizeof...(Bounds) % 2 == 0,
+                "Bounds must be pairs of first and last characters");
+
+private:
+  static constexpr unsigned char bounds[] = {Bounds...};
+  static constexpr size_t kNumRanges = sizeof...(Bounds) / 2;
+
+  static constexpr bool inRanges(char ch) {
+    unsigned char c = static_cast<unsigned char>(ch);
+    bool ret = false;
+    for (size_t r = 0; r < kNumRanges; r++)
+      ret |= bounds[2 * r] <= c && c <= bounds[2 * r + 1];
+    return ret;
+  }
+
+  static constexpr std::array<bool, 256> makeTable() {
+    std::array<bool, 256> ret{};
+    for (size_t c = 0; c < 256; c++)
+      ret[c] = inRanges(static_cast<char>(c)) != Complement;
+    return ret;
+  }
+
+public:
+  static constexpr std::array<bool, 256> table = makeTable();
+
+  static constexpr bool contains(char c) {
+    return table[static_cast<unsigned char>(c)];
+  }
+
+  constexpr bool operator()(char c) const { return contains(c); }
+
+  // Returns a bitmask of the 64 bytes at p: bit i is set iff p[i] is a member.
+  static uint64_t mask64(const char *p) {
+    // A byte c is in [first, last] iff (c - first) mod 256 <= last - first,
+    // i.e. iff min(c - first, last - first) == c - first (unsigned)
+#if defined(__AVX512BW__)
+    __m512i v = _mm512_loadu_si512(p);
+    uint64_t in = 0;
+    for (size_t r = 0; r < kNumRanges; r++)
+      in |= _mm512_cmple_epu8_mask(
+          _mm512_sub_epi8(v, _mm512_set1_epi8(bounds[2 * r])),
+          _mm512_set1_epi8(bounds[2 * r + 1] - bounds[2 * r]));
+#elif defined(__AVX2__)
+    uint64_t in = 0;
+    for (int half = 0; half < 2; half++) {
+      __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 32 * half));
+      __m256i bits = _mm256_setzero_si256();
+      for (size_t r = 0; r < kNumRanges; r++) {
+        __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(bounds[2 * r]));
+        bits = _mm256_or_si256(
+            bits, _mm256_cmpeq_epi8(
+                      _mm256_min_epu8(d, _mm256_set1_epi8(bounds[2 * r + 1] -
+                                                          bounds[2 * r])),
+                      d));
+      }
+      in |= static_cast<uint64_t>(
+                static_cast<uint32_t>(_mm256_movemask_epi8(bits)))
+            << (32 * half);
+    }
+#elif defined(__SSE2__)
+    uint64_t in = 0;
+    for (int quarter = 0; quarter < 4; quarter++) {
+      __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * quarter));
+      __m128i bits = _mm_setzero_si128();
+      for (size_t r = 0; r < kNumRanges; r++) {
+        __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(bounds[2 * r]));
+        bits = _mm_or_si128(
+            bits,
+            _mm_cmpeq_epi8(
+                _mm_min_epu8(
+                    d, _mm_set1_epi8(bounds[2 * r + 1] - bounds[2 * r])),
+                d));
+      }
+      in |= static_cast<uint64_t>(_mm_movemask_epi8(bits)) << (16 * quarter);
+    }
+#else
+    uint64_t in = 0;
+    for (size_t i = 0; i < 64; i++)
+      in |= static_cast<uint64_t>(inRanges(p[i])) << i;
+#endif
+    return Complement ? ~in : in;
+  }
+
+  // Returns the first character in [p, end) which is a member of the set if
+  // member is true, or which isn't if member is false; end if there is none.
+  static const char *find(const char *p, const char *end, bool member) {
+    for (; end - p >= 64; p += 64) {
+      uint64_t bits = mask64(p);
+      if (!member)
+        bits = ~bits;
+      if (bits)
+        return p + __builtin_ctzll(bits);
+    }
+    while (p != end && contains(*p) != member)
+      p++;
+    return p;
+  }
+};
+
+// Finds members and non-members of Class in a buffer like Class::find(), but
+// keeps the bitmask of the last 64-byte block, so that finding the boundaries
+// of short runs (e.g. of words) costs a shift and a count of trailing zeros
+// rather than a pass over the bytes. Call reset() when the buffer changes.
+template <typename Class> class CharScanner {
+private:
+  const char *block_ = nullptr;
+  uint64_t bits_ = 0;
+
+public:
+  void reset() { block_ = nullptr; }
+
+  const char *find(const char *p, const char *end, bool member) {
+    if (block_ && p >= block_ && p < block_ + 64) {
+      uint64_t bits = member ? bits_ : ~bits_;
+      bits >>= p - block_;
+      if (bits)
+        return p + __builtin_ctzll(bits);
+      p = block_ + 64;
+    }
+    for (; end - p >= 64; p += 64) {
+      block_ = p;
+      bits_ = Class::mask64(p);
+      uint64_t bits = member ? bits_ : ~bits_;
+      if (bits)
+        return p + __builtin_ctzll(bits);
+    }
+    block_ = nullptr;
+    while (p != end && Class::contains(*p) != member)
+      p++;
+    return p;
+  }
+};
+
+// True if Predicate is a CharClass, or derives from one, so that CharTokenizer
+// can scan for token boundaries with a CharScanner.
+template <typename Predicate, typename = void>
+struct isCharClass : std::false_type {};
+
+template <typename Predicate>
+struct isCharClass<Predicate,
+                   std::void_t<decltype(Predicate::mask64(
+                       static_cast<const char *>(nullptr)))>>
+    : std::true_type {};
+
+} // namespace lucanthrope
@@ -1,15 +1,46 @@
 #pragma once
 
-#include <cctype>  // isalpha(), tolower(), toupper()
 #include <cstddef> // size_t
 #include <cstdint>
 #include <istream>
+#include <memory> // unique_ptr
+#include <streambuf>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "Analysis.h"
+#include "CharClass.h"
 
 namespace lucanthrope {
 
+namespace {
+
+struct noop_normalizer {
+  constexpr char operator()(char c) const { return c; }
+};
+
+// Maps ASCII letters only, whatever the locale is
+struct tolower_normalizer {
+  constexpr char operator()(char c) const {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+  }
+};
+
+struct toupper_normalizer {
+  constexpr char operator()(char c) const {
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - ('a' - 'A')) : c;
+  }
+};
+
+// ASCII letters, i.e. std::isalpha() in the "C" locale
+struct isalpha_predicate : CharClass<false, 'A', 'Z', 'a', 'z'> {};
+
+struct iswhitespace_predicate
+    : CharClass<true, ' ', ' ', '\t', '\t', '\n', '\n'> {};
+
+} // unnamed namespace
+
 // Class template for simple, character-oriented tokenizers.
 // Predicate and Normalizer are function objects. For Predicate pred and
 // Normalizer norm:
@@ -19,8 +50,19 @@ namespace lucanthrope {
 // boundaries and are not included in tokens;
 // - char norm(char c) is called on each token character c to normalize it
 // before it is added to the token.
+//
+// Text is read either from an istream, kChunkSize bytes at a time straight
+// from its streambuf, or directly from memory (the constructors taking
+// std::string_view; the text must outlive the tokenizer). Either way tokens
+// are scanned within a chunk, and only tokens which span chunks are assembled
+// across reads. Terms are normalized into a buffer which is reused from token
+// to token (see TokenView). If Predicate is a CharClass (see CharClass.h), token
+// boundaries are found through its SIMD bitmasks rather than byte by byte.
 template <typename Predicate, typename Normalizer>
 class CharTokenizer : public Tokenizer {
+public:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
 private:
   // Remember that until C++20 the closure type associated with a
   // lambda-expression has no default constructor, so don't call constructor
@@ -28,87 +70,142 @@ private:
   Predicate isTokenChar;
   Normalizer normalize;
   std::string buffer;
+  // Finds token boundaries if Predicate is a CharClass
+  std::conditional_t<isCharClass<Predicate>::value, CharScanner<Predicate>,
+                     std::nullptr_t>
+      scanner{};
+  // Holds the current chunk of an istream source
+  std::unique_ptr<char[]> chunk;
+  // The unscanned part of the current chunk is [cur, end); begin is at offset
+  // in the text
+  const char *begin = nullptr;
+  const char *cur = nullptr;
+  const char *end = nullptr;
   uint64_t offset = 0;
 
+  // Returns the first character in [p, end) which is a token character if
+  // tokenChar is true, or which isn't if tokenChar is false; end if none.
+  const char *scan(const char *p, bool tokenChar) {
+    if constexpr (isCharClass<Predicate>::value) {
+      return scanner.find(p, end, tokenChar);
+    } else {
+      while (p != end && isTokenChar(*p) != tokenChar)
+        p++;
+      return p;
+    }
+  }
+
+  void restart(const char *first, const char *last) {
+    begin = cur = first;
+    end = last;
+    offset = 0;
+    if constexpr (isCharClass<Predicate>::value)
+      scanner.reset();
+  }
+
+  // Replaces the current chunk by the next one; returns false at the end of
+  // the text.
+  bool fill() {
+    offset += end - begin;
+    begin = cur = end;
+    if constexpr (isCharClass<Predicate>::value)
+      scanner.reset();
+    if (!input_ || !*input_)
+      return false;
+    std::streambuf *buf = input_->rdbuf();
+    std::streamsize n = buf ? buf->sgetn(chunk.get(), kChunkSize) : 0;
+    if (n <= 0) {
+      input_->setstate(std::ios_base::eofbit);
+      return false;
+    }
+    begin = cur = chunk.get();
+    end = begin + n;
+    return true;
+  }
+
 public:
-  CharTokenizer(std::istream &input) : Tokenizer(input) {}
+  CharTokenizer(std::istream &input)
+      : Tokenizer(input), chunk(new char[kChunkSize]) {}
 
   CharTokenizer(std::istream &input, Predicate pred)
-      : Tokenizer(input), isTokenChar(pred) {}
+      : Tokenizer(input), isTokenChar(pred), chunk(new char[kChunkSize]) {}
 
   CharTokenizer(std::istream &input, Normalizer norm)
-      : Tokenizer(input), normalize(norm) {}
+      : Tokenizer(input), normalize(norm), chunk(new char[kChunkSize]) {}
 
   CharTokenizer(std::istream &input, Predicate pred, Normalizer norm)
-      : Tokenizer(input), isTokenChar(pred), normalize(norm) {}
+      : Tokenizer(input), isTokenChar(pred), normalize(norm),
+        chunk(new char[kChunkSize]) {}
 
-  virtual ~CharTokenizer() = default;
+  CharTokenizer(std::string_view text)
+      : begin(text.data()), cur(text.data()), end(text.data() + text.size()) {}
 
-  virtual bool next() override {
-    buffer.clear();
-    size_t tok_len = 0;
-    uint64_t start_pos;
-    while (true) {
-      if (input_.eof()) {
-        if (tok_len)
-          break; // collect last token
-        return false;
-      }
-      char c = input_.get();
-      offset++;
-      if (isTokenChar(c)) {
-        if (!tok_len) // start of the token
-          start_pos = offset - 1;
-        buffer.push_back(normalize(c));
-        tok_len++;
-      } else if (tok_len) // end of the token
-        break;
-    }
-    tok = Token(buffer, start_pos, start_pos + tok_len);
-    return true;
-  }
-};
+  CharTokenizer(std::string_view text, Predicate pred)
+      : isTokenChar(pred), begin(text.data()), cur(text.data()),
+        end(text.data() + text.size()) {}
 
-namespace {
+  CharTokenizer(std::string_view text, Normalizer norm)
+      : normalize(norm), begin(text.data()), cur(text.data()),
+        end(text.data() + text.size()) {}
 
-struct noop_normalizer {
-  char operator()(char c) { return c; }
-};
+  CharTokenizer(std::string_view text, Predicate pred, Normalizer norm)
+      : isTokenChar(pred), normalize(norm), begin(text.data()),
+        cur(text.data()), end(text.data() + text.size()) {}
 
-struct tolower_normalizer {
-  char operator()(char c) { return std::tolower(c); }
-};
+  virtual ~CharTokenizer() = default;
 
-struct toupper_normalizer {
-  char operator()(char c) { return std::toupper(c); }
-};
+  virtual void reset(std::istream &input) override {
+    Tokenizer::reset(input);
+    if (!chunk) // read from memory so far
+      chunk.reset(new char[kChunkSize]);
+    restart(nullptr, nullptr);
+  }
 
-struct isalpha_predicate {
-  bool operator()(char c) { return std::isalpha(c); }
-};
+  // Makes the tokenizer start over on text in memory.
+  virtual void reset(std::string_view text) override {
+    input_ = nullptr;
+    restart(text.data(), text.data() + text.size());
+  }
 
-struct iswhitespace_predicate {
-  bool operator()(char c) {
-    if (c == ' ' || c == '\t' || c == '\n')
-      return false;
+  virtual bool next() override {
+    while (true) { // skip token boundaries
+      cur = scan(cur, true);
+      if (cur != end)
+        break;
+      if (!fill())
+        return false;
+    }
+    uint64_t start_pos = offset + (cur - begin);
+    buffer.clear();
+    while (true) {
+      const char *tok_end = scan(cur, false);
+      size_t old_size = buffer.size();
+      buffer.append(cur, tok_end);
+      if constexpr (!std::is_same_v<Normalizer, noop_normalizer>)
+        for (size_t i = old_size; i < buffer.size(); i++)
+          buffer[i] = normalize(buffer[i]);
+      cur = tok_end;
+      if (cur != end || !fill()) // the token continues in the next chunk
+        break;
+    }
+    view.term = &buffer[0];
+    view.termLength = buffer.size();
+    view.startPos = start_pos;
+    view.endPos = start_pos + buffer.size();
     return true;
   }
 };
 
-} // unnamed namespace
-
-// Tokenizer that divides text at non-letters, as determined by std::isalpha()
+// Tokenizer that divides text at non-letters (ASCII letters are letters)
 template <class Normalizer = noop_normalizer>
 using AlphaCharTokenizer = CharTokenizer<isalpha_predicate, Normalizer>;
 
-// Tokenizer that divides text at non-letters, as determined by std::isalpha(),
-// and converts each token character to lower case, as determined by
-// std::tolower()
+// Tokenizer that divides text at non-letters, and converts each token character
+// to lower case
 using LowerCaseTokenizer = AlphaCharTokenizer<tolower_normalizer>;
 
-// Tokenizer that divides text at non-letters, as determined by std::isalpha(),
-// and converts each token character to upper case, as determined by
-// std::toupper()
+// Tokenizer that divides text at non-letters, and converts each token character
+// to upper case
 using UpperCaseTokenizer = AlphaCharTokenizer<toupper_normalizer>;
 
 // Tokenizer that divides text at whitespace: adjacent sequences of
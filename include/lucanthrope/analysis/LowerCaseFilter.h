@@ -8,18 +8,29 @@
 
 namespace lucanthrope {
 
-// Normalizes token text to lower case.
+// Normalizes token text to lower case, in place.
 class LowerCaseFilter : public TokenFilter {
+public:
+  // The filter as a Chain stage
+  struct Stage {
+    bool accept(TokenView &view) {
+      for (char *p = view.term; p != view.term + view.termLength; p++)
+        *p = std::tolower(static_cast<unsigned char>(*p));
+      return true;
+    }
+  };
+
+private:
+  Stage stage;
+
 public:
   LowerCaseFilter(std::unique_ptr<TokenStream> input)
       : TokenFilter(std::move(input)) {}
   virtual ~LowerCaseFilter() = default;
-  virtual bool next() {
+  virtual bool next() override {
     if (input_->next()) {
-      tok = input_.get()->getToken();
-      for (auto &ch : tok.termText)
-        ch = std::tolower(ch);
-      return true;
+      view = input_->getTokenView();
+      return stage.accept(view);
     }
     return false;
   }
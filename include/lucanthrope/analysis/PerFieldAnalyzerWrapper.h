@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <functional> // less<>
+#include <map>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <vector>
 
 #include "Analysis.h"
 
@@ -11,9 +14,25 @@ namespace lucanthrope {
 // This analyzer is used to facilitate scenarios where different fields require
 // different analysis techniques.  Use addAnalyzer() to add a non-default
 // analyzer on a field name basis.
+//
+// Callers which analyze the same fields over and over can resolve each field
+// name once with fieldId(), and then pass the id instead of the name: the
+// analyzer of a field id is a single array load, while a field name costs a
+// lookup by name (which doesn't allocate either).
 class PerFieldAnalyzerWrapper : public Analyzer {
+public:
+  using FieldId = uint32_t;
+
 private:
-  std::unordered_map<std::string, Analyzer *> analyzerMap;
+  struct Field {
+    Analyzer *analyzer;
+    std::string_view name; // a key of fieldIds
+  };
+
+  // std::less<> for lookups by string_view; keys are stable, unlike the
+  // strings of an unordered_map on rehash
+  std::map<std::string, FieldId, std::less<>> fieldIds;
+  std::vector<Field> fields; // by id
   Analyzer &defaultAnalyzer;
 
 public:
@@ -22,20 +41,74 @@ public:
   // the one provided here.
   PerFieldAnalyzerWrapper(Analyzer &default_) : defaultAnalyzer(default_) {}
 
+  // Returns the id of the field, which is stable for the life of the wrapper;
+  // ids are dense, from 0. A field without an id gets one, with the default
+  // analyzer until addAnalyzer() is called for it. Like addAnalyzer(), this
+  // mustn't be called concurrently with the analysis of any field.
+  FieldId fieldId(std::string_view fieldName) {
+    auto it = fieldIds.find(fieldName);
+    if (it == fieldIds.end()) {
+      it = fieldIds.emplace(std::string(fieldName), fields.size()).first;
+      fields.push_back({&defaultAnalyzer, it->first});
+    }
+    return it->second;
+  }
+
   // Defines an analyzer to use for the specified field.
-  void addAnalyzer(const std::string &filedName, Analyzer *analyzer) {
-    analyzerMap[filedName] = analyzer;
+  void addAnalyzer(std::string_view fieldName, Analyzer *analyzer) {
+    fields[fieldId(fieldName)].analyzer = analyzer;
+  }
+
+  // The analyzer of a field; id must come from fieldId()
+  Analyzer &getAnalyzer(FieldId id) const { return *fields[id].analyzer; }
+
+  Analyzer &getAnalyzer(std::string_view fieldName) const {
+    auto it = fieldIds.find(fieldName);
+    return it == fieldIds.end() ? defaultAnalyzer
+                                : *fields[it->second].analyzer;
   }
 
   virtual std::unique_ptr<TokenStream>
   getTokenStream(std::istream &input,
                  std::string_view fieldName = std::string_view()) override {
-    if (!fieldName.size())
-      return defaultAnalyzer.getTokenStream(input);
-    auto it = analyzerMap.find(std::string(fieldName.data(), fieldName.size()));
-    if (it != analyzerMap.end())
-      return it->second->getTokenStream(input);
-    return defaultAnalyzer.getTokenStream(input);
+    return getAnalyzer(fieldName).getTokenStream(input, fieldName);
+  }
+
+  std::unique_ptr<TokenStream> getTokenStream(std::istream &input,
+                                              FieldId id) {
+    const Field &field = fields[id];
+    return field.analyzer->getTokenStream(input, field.name);
+  }
+
+  // The stream of the field's analyzer, from that analyzer's cache
+  virtual TokenStream &
+  reusableTokenStream(std::istream &input,
+                      std::string_view fieldName = std::string_view()) override {
+    return getAnalyzer(fieldName).reusableTokenStream(input, fieldName);
+  }
+
+  TokenStream &reusableTokenStream(std::istream &input, FieldId id) {
+    const Field &field = fields[id];
+    return field.analyzer->reusableTokenStream(input, field.name);
+  }
+
+  virtual TokenStream &
+  reusableTokenStream(std::string_view text,
+                      std::string_view fieldName = std::string_view()) override {
+    return getAnalyzer(fieldName).reusableTokenStream(text, fieldName);
+  }
+
+  TokenStream &reusableTokenStream(std::string_view text, FieldId id) {
+    const Field &field = fields[id];
+    return field.analyzer->reusableTokenStream(text, field.name);
+  }
+
+  // Releases the calling thread's streams of every analyzer of the wrapper
+  virtual void releaseThreadStreams() override {
+    defaultAnalyzer.releaseThreadStreams();
+    for (const Field &field : fields)
+      field.analyzer->releaseThreadStreams();
+    Analyzer::releaseThreadStreams();
   }
 };
 
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm> // sort(), unique()
+#include <array>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <stdexcept> // logic_error
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lucanthrope {
+
+namespace perfect_hash {
+
+// Little-endian load of n <= 8 bytes; compilers turn it into a single load.
+constexpr uint64_t load(const char *p, int n) {
+  uint64_t ret = 0;
+  for (int i = 0; i < n; i++)
+    ret |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+  return ret;
+}
+
+constexpr uint64_t mix(uint64_t h, uint64_t value) {
+  h = (h ^ value) * 0xbf58476d1ce4e5b9ull;
+  return h ^ (h >> 31);
+}
+
+// Words of up to 16 bytes, i.e. almost all, are hashed without a loop, from
+// two loads which overlap unless the word is 8 or 16 bytes long.
+constexpr uint64_t hash(std::string_view word, uint64_t seed) {
+  const char *p = word.data();
+  const size_t n = word.size();
+  uint64_t h = seed ^ (n * 0x9e3779b97f4a7c15ull);
+  if (n > 16) {
+    for (size_t i = 0; i + 8 < n; i += 8)
+      h = mix(h, load(p + i, 8));
+    h = mix(h, load(p + n - 8, 8));
+  } else if (n >= 8) {
+    h = mix(mix(h, load(p, 8)), load(p + n - 8, 8));
+  } else if (n >= 4) {
+    h = mix(h, load(p, 4) << 32 | load(p + n - 4, 4));
+  } else if (n) {
+    h = mix(h, load(p, 1) << 16 | load(p + n / 2, 1) << 8 | load(p + n - 1, 1));
+  }
+  h *= 0xd6e8feb86659fd93ull;
+  return h ^ (h >> 32);
+}
+
+// Slot of a word with hash h in a bucket with displacement d
+constexpr size_t slot(uint64_t h, uint32_t d, size_t slotMask) {
+  return static_cast<size_t>((h >> 40) + d * ((h >> 16) | 1)) & slotMask;
+}
+
+constexpr size_t powerOfTwoAtLeast(size_t n) {
+  size_t ret = 1;
+  while (ret < n)
+    ret *= 2;
+  return ret;
+}
+
+constexpr size_t numBuckets(size_t numWords) {
+  return powerOfTwoAtLeast(numWords / 3 + 1);
+}
+
+constexpr size_t numSlots(size_t numWords) {
+  return powerOfTwoAtLeast(numWords + numWords / 4 + 1);
+}
+
+// Tries to build the tables of a hash-and-displace perfect hash of distinct,
+// non-empty list of words with seed: words fall into buckets by hash, and the
+// words of a bucket are placed into distinct free slots by the bucket's
+// displacement, largest buckets first. slots[s] becomes the word in slot s;
+// free slots get words[0], so that a lookup which lands on a free slot
+// compares the word with a member and is still right. byBucket, bucketStart
+// and slotWords are scratch space of words.size(), numBuckets + 1 and
+// numSlots elements. Words and Slots are arrays of string_views, the others
+// are arrays of uint32_t. Returns false if some bucket can't be placed with
+// this seed.
+template <typename Words, typename Displacements, typename Slots,
+          typename ByBucket, typename BucketStart, typename SlotWords>
+constexpr bool build(const Words &words, uint64_t seed,
+                     Displacements &displacements, Slots &slots,
+                     ByBucket &byBucket, BucketStart &bucketStart,
+                     SlotWords &slotWords) {
+  constexpr uint32_t kFree = ~uint32_t(0);
+  const size_t n = words.size();
+  const size_t buckets = displacements.size();
+  const size_t slotMask = slots.size() - 1;
+  for (size_t b = 0; b <= buckets; b++)
+    bucketStart[b] = 0;
+  for (size_t i = 0; i < n; i++)
+    bucketStart[(hash(words[i], seed) & (buckets - 1)) + 1]++;
+  size_t maxSize = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    maxSize = maxSize > bucketStart[b + 1] ? maxSize : bucketStart[b + 1];
+    bucketStart[b + 1] += bucketStart[b];
+  }
+  // Words of bucket b go to byBucket[bucketStart[b], bucketStart[b + 1]);
+  // displacements serve as fill cursors meanwhile
+  for (size_t b = 0; b < buckets; b++)
+    displacements[b] = bucketStart[b];
+  for (size_t i = 0; i < n; i++)
+    byBucket[displacements[hash(words[i], seed) & (buckets - 1)]++] =
+        static_cast<uint32_t>(i);
+  for (size_t b = 0; b < buckets; b++)
+    displacements[b] = 0;
+  for (size_t s = 0; s <= slotMask; s++)
+    slotWords[s] = kFree;
+
+  for (size_t size = maxSize; size >= 1; size--) {
+    for (size_t b = 0; b < buckets; b++) {
+      if (bucketStart[b + 1] - bucketStart[b] != size)
+        continue;
+      uint32_t d = 0;
+      for (;; d++) {
+        if (d > 8 * (slotMask + 1))
+          return false;
+        size_t placed = 0;
+        for (; placed < size; placed++) {
+          uint32_t word = byBucket[bucketStart[b] + placed];
+          size_t s = slot(hash(words[word], seed), d, slotMask);
+          if (slotWords[s] != kFree)
+            break;
+          slotWords[s] = word;
+        }
+        if (placed == size)
+          break;
+        while (placed--) // roll back
+          slotWords[slot(hash(words[byBucket[bucketStart[b] + placed]], seed),
+                         d, slotMask)] = kFree;
+      }
+      displacements[b] = d;
+    }
+  }
+  for (size_t s = 0; s <= slotMask; s++)
+    slots[s] = words[slotWords[s] == kFree ? 0 : slotWords[s]];
+  return true;
+}
+
+} // namespace perfect_hash
+
+// A set of words with perfect hashing: contains() hashes the word once, reads
+// a displacement, and compares the word with the only candidate, without any
+// other branch. This class doesn't own the tables; see StaticPerfectHashSet
+// for sets built at compile time and DynamicPerfectHashSet for sets built at
+// run time.
+class PerfectHashSet {
+private:
+  const uint32_t *displacements_ = nullptr;
+  const std::string_view *slots_ = nullptr;
+  size_t bucketMask_ = 0;
+  size_t slotMask_ = 0;
+  uint64_t seed_ = 0;
+
+public:
+  // The empty set
+  constexpr PerfectHashSet() = default;
+
+  constexpr PerfectHashSet(const uint32_t *displacements, size_t numBuckets,
+                           const std::string_view *slots, size_t numSlots,
+                           uint64_t seed)
+      : displacements_(displacements), slots_(slots),
+        bucketMask_(numBuckets - 1), slotMask_(numSlots - 1), seed_(seed) {}
+
+  constexpr bool contains(std::string_view word) const {
+    if (!slots_)
+      return false;
+    uint64_t h = perfect_hash::hash(word, seed_);
+    return slots_[perfect_hash::slot(h, displacements_[h & bucketMask_],
+                                     slotMask_)] == word;
+  }
+};
+
+// A PerfectHashSet of N > 0 distinct words built at compile time, e.g.
+//   static constexpr StaticPerfectHashSet<2> set({"a", "an"});
+template <size_t N> class StaticPerfectHashSet {
+private:
+  static constexpr size_t kNumBuckets = perfect_hash::numBuckets(N);
+  static constexpr size_t kNumSlots = perfect_hash::numSlots(N);
+
+  std::array<uint32_t, kNumBuckets> displacements_{};
+  std::array<std::string_view, kNumSlots> slots_{};
+  uint64_t seed_ = 0;
+
+public:
+  constexpr StaticPerfectHashSet(const char *const (&words)[N]) {
+    std::array<std::string_view, N> views{};
+    for (size_t i = 0; i < N; i++)
+      views[i] = words[i];
+    std::array<uint32_t, N> byBucket{};
+    std::array<uint32_t, kNumBuckets + 1> bucketStart{};
+    std::array<uint32_t, kNumSlots> slotWords{};
+    while (!perfect_hash::build(views, seed_, displacements_, slots_, byBucket,
+                                bucketStart, slotWords))
+      if (++seed_ == 1000) // words aren't distinct
+        throw std::logic_error("StaticPerfectHashSet: duplicate words");
+  }
+
+  constexpr PerfectHashSet set() const {
+    return PerfectHashSet(displacements_.data(), kNumBuckets, slots_.data(),
+                          kNumSlots, seed_);
+  }
+};
+
+// A PerfectHashSet of words given at run time; duplicates are ignored.
+class DynamicPerfectHashSet {
+private:
+  std::vector<std::string> words_;
+  std::vector<uint32_t> displacements_;
+  std::vector<std::string_view> slots_;
+  uint64_t seed_ = 0;
+
+public:
+  template <typename Iterator>
+  DynamicPerfectHashSet(Iterator first, Iterator last) : words_(first, last) {
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+    if (words_.empty())
+      return;
+    std::vector<std::string_view> views(words_.begin(), words_.end());
+    displacements_.resize(perfect_hash::numBuckets(views.size()));
+    slots_.resize(perfect_hash::numSlots(views.size()));
+    std::vector<uint32_t> byBucket(views.size());
+    std::vector<uint32_t> bucketStart(displacements_.size() + 1);
+    std::vector<uint32_t> slotWords(slots_.size());
+    while (!perfect_hash::build(views, seed_, displacements_, slots_, byBucket,
+                                bucketStart, slotWords))
+      seed_++;
+  }
+
+  explicit DynamicPerfectHashSet(const std::vector<std::string> &words)
+      : DynamicPerfectHashSet(words.begin(), words.end()) {}
+
+  // set() refers to the strings
+  DynamicPerfectHashSet(const DynamicPerfectHashSet &) = delete;
+  DynamicPerfectHashSet &operator=(const DynamicPerfectHashSet &) = delete;
+
+  size_t size() const { return words_.size(); }
+
+  PerfectHashSet set() const {
+    if (words_.empty())
+      return PerfectHashSet();
+    return PerfectHashSet(displacements_.data(), displacements_.size(),
+                          slots_.data(), slots_.size(), seed_);
+  }
+};
+
+} // namespace lucanthrope
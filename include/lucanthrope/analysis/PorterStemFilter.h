@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // memcmp(), memcpy()
+#include <memory>  // unique_ptr
+#include <string_view>
+#include <utility> // move()
+#include <vector>
+
+#include "Analysis.h"
+#include "PerfectHashSet.h" // perfect_hash::hash()
+#include "PorterStemmer.h"
+
+namespace lucanthrope {
+
+// Remembers the stems of recently seen terms, so that most tokens, whose terms
+// are frequent (terms are distributed by Zipf's law), skip the stemming
+// algorithm. The cache is a direct-mapped table of kSlots terms of up to
+// kMaxLength bytes and their stems, indexed by a hash of the term: a term
+// evicts whichever term had its slot, so the cache's memory is bounded. Each
+// thread has its own cache per Stemmer (see local()), so the cache needs no
+// locks; stems don't depend on the stream, so a thread's streams share it.
+template <typename Stemmer> class StemCache {
+public:
+  static constexpr size_t kSlots = 4096;
+  static constexpr size_t kMaxLength = 22;
+
+private:
+  struct Slot {
+    uint8_t length = 0; // of the term; 0 if the slot is free
+    uint8_t stemLength = 0;
+    char term[kMaxLength];
+    char stem[kMaxLength];
+  };
+
+  std::vector<Slot> slots;
+
+public:
+  StemCache() : slots(kSlots) {}
+
+  // The calling thread's cache
+  static StemCache &local() {
+    static thread_local StemCache cache;
+    return cache;
+  }
+
+  // Stems the term [term, term + length) in place, like Stemmer::stem();
+  // returns its new length.
+  size_t stem(char *term, size_t length) {
+    if (length == 0 || length > kMaxLength)
+      return Stemmer::stem(term, length);
+    uint64_t h = perfect_hash::hash(std::string_view(term, length), 0);
+    Slot &slot = slots[h & (kSlots - 1)];
+    if (slot.length == length && std::memcmp(slot.term, term, length) == 0) {
+      std::memcpy(term, slot.stem, slot.stemLength);
+      return slot.stemLength;
+    }
+    std::memcpy(slot.term, term, length);
+    slot.length = static_cast<uint8_t>(length);
+    size_t stemLength = Stemmer::stem(term, length);
+    std::memcpy(slot.stem, term, stemLength);
+    slot.stemLength = static_cast<uint8_t>(stemLength);
+    return stemLength;
+  }
+};
+
+// Stems each term with Stemmer, in place in the token's buffer (stems are
+// never longer than their terms), through the calling thread's StemCache.
+// Terms are expected to be in lower case, e.g. from a LowerCaseTokenizer.
+template <typename Stemmer> class StemFilter : public TokenFilter {
+public:
+  // The filter as a Chain stage
+  struct Stage {
+    bool accept(TokenView &view) {
+      view.termLength =
+          StemCache<Stemmer>::local().stem(view.term, view.termLength);
+      return true;
+    }
+  };
+
+private:
+  Stage stage;
+
+public:
+  StemFilter(std::unique_ptr<TokenStream> input)
+      : TokenFilter(std::move(input)) {}
+  virtual ~StemFilter() = default;
+  virtual bool next() override {
+    if (input_->next()) {
+      view = input_->getTokenView();
+      return stage.accept(view);
+    }
+    return false;
+  }
+};
+
+// Stems terms by the Porter algorithm
+using PorterStemFilter = StemFilter<PorterStemmer>;
+
+// Stems terms by the Snowball English ("Porter2") algorithm
+using EnglishStemFilter = StemFilter<EnglishStemmer>;
+
+} // namespace lucanthrope
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstring> // memcpy(), memmove()
+#include <string_view>
+
+namespace lucanthrope {
+
+namespace stemming {
+
+// A suffix of a stemming rule, and what the rule does with it
+struct Suffix {
+  std::string_view text;
+  int action;
+};
+
+// A word being stemmed in place, with the operations of the Snowball
+// definitions of the Porter and English stemmers. Stemming only ever shortens
+// a word, or replaces letters, so it stays within its buffer. A 'y' which is
+// to be treated as a consonant is marked 'Y' while the word is stemmed.
+class Word {
+public:
+  char *w;
+  size_t n;
+  // The regions R1 and R2 are [p1, n) and [p2, n)
+  size_t p1 = 0;
+  size_t p2 = 0;
+
+private:
+  bool yMarked = false;
+
+public:
+  Word(char *word, size_t length) : w(word), n(length) {}
+
+  static constexpr bool isVowel(char c) {
+    return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' ||
+           c == 'y';
+  }
+
+  bool vowel(size_t i) const { return isVowel(w[i]); }
+
+  bool endsWith(std::string_view suffix, size_t end) const {
+    return suffix.size() <= end &&
+           std::string_view(w + end - suffix.size(), suffix.size()) == suffix;
+  }
+
+  bool endsWith(std::string_view suffix) const { return endsWith(suffix, n); }
+
+  // The longest suffix of w[0, end) among suffixes, or nullptr; start is set
+  // to where it starts.
+  template <size_t N>
+  const Suffix *longest(const Suffix (&suffixes)[N], size_t end,
+                        size_t &start) const {
+    const Suffix *ret = nullptr;
+    for (const Suffix &suffix : suffixes)
+      if ((!ret || suffix.text.size() > ret->text.size()) &&
+          endsWith(suffix.text, end))
+        ret = &suffix;
+    if (ret)
+      start = end - ret->text.size();
+    return ret;
+  }
+
+  template <size_t N>
+  const Suffix *longest(const Suffix (&suffixes)[N], size_t &start) const {
+    return longest(suffixes, n, start);
+  }
+
+  // Replaces w[start, n) by replacement, which isn't longer
+  void replace(size_t start, std::string_view replacement) {
+    std::memcpy(w + start, replacement.data(), replacement.size());
+    n = start + replacement.size();
+  }
+
+  // True if w[0, end) has a vowel
+  bool hasVowel(size_t end) const {
+    for (size_t i = 0; i < end; i++)
+      if (vowel(i))
+        return true;
+    return false;
+  }
+
+  // Marks an initial y, and each y after a vowel, as a consonant
+  void markY() {
+    for (size_t i = 0; i < n; i++)
+      if (w[i] == 'y' && (i == 0 || vowel(i - 1))) {
+        w[i] = 'Y';
+        yMarked = true;
+      }
+  }
+
+  void unmarkY() {
+    if (yMarked)
+      for (size_t i = 0; i < n; i++)
+        if (w[i] == 'Y')
+          w[i] = 'y';
+  }
+
+  // The region which follows the first non-vowel after a vowel in w[i, n)
+  size_t regionFrom(size_t i) const {
+    while (i < n && !vowel(i))
+      i++;
+    while (i < n && vowel(i))
+      i++;
+    return i < n ? i + 1 : n;
+  }
+
+  void markRegions(size_t from = 0) {
+    p1 = from ? from : regionFrom(0);
+    p2 = regionFrom(p1);
+  }
+
+  // True if w[0, end) ends with a short syllable: a non-vowel other than w, x
+  // and Y, after a vowel, after a non-vowel
+  bool shortSyllable(size_t end) const {
+    if (end < 3)
+      return false;
+    char c = w[end - 1];
+    return !vowel(end - 1) && c != 'w' && c != 'x' && c != 'Y' &&
+           vowel(end - 2) && !vowel(end - 3);
+  }
+};
+
+} // namespace stemming
+
+// The Porter stemming algorithm (M.F. Porter, "An algorithm for suffix
+// stripping", 1980), as defined in Snowball, which gives the output of the
+// published algorithm. Words are expected to be in lower case; bytes other
+// than ASCII letters count as consonants.
+class PorterStemmer {
+private:
+  using Suffix = stemming::Suffix;
+
+  static void step1a(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"sses", 1}, {"ies", 2}, {"ss", 0}, {"s", 3}};
+    static constexpr std::string_view kReplacements[] = {"", "ss", "i", ""};
+    size_t start;
+    if (const Suffix *suffix = word.longest(kSuffixes, start))
+      if (suffix->action)
+        word.replace(start, kReplacements[suffix->action]);
+  }
+
+  static void step1b(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {{"eed", 1}, {"ed", 2}, {"ing", 2}};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (!suffix)
+      return;
+    if (suffix->action == 1) {
+      if (start >= word.p1)
+        word.replace(start, "ee");
+      return;
+    }
+    if (!word.hasVowel(start))
+      return;
+    word.n = start;
+    static constexpr Suffix kEndings[] = {
+        {"at", 1}, {"bl", 1}, {"iz", 1}, {"bb", 2}, {"dd", 2}, {"ff", 2},
+        {"gg", 2}, {"mm", 2}, {"nn", 2}, {"pp", 2}, {"rr", 2}, {"tt", 2}};
+    size_t at;
+    const Suffix *ending = word.longest(kEndings, at);
+    if (ending && ending->action == 1)
+      word.w[word.n++] = 'e';
+    else if (ending)
+      word.n--;
+    else if (word.n == word.p1 && word.shortSyllable(word.n))
+      word.w[word.n++] = 'e';
+  }
+
+  static void step1c(stemming::Word &word) {
+    if (word.n && (word.w[word.n - 1] == 'y' || word.w[word.n - 1] == 'Y') &&
+        word.hasVowel(word.n - 1))
+      word.w[word.n - 1] = 'i';
+  }
+
+  static void step2(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"tional", 0},  {"enci", 1},    {"anci", 2},    {"abli", 3},
+        {"entli", 4},   {"eli", 5},     {"izer", 6},    {"ization", 6},
+        {"ational", 7}, {"ation", 7},   {"ator", 7},    {"alli", 8},
+        {"aliti", 8},   {"alism", 8},   {"fulness", 9}, {"ousli", 10},
+        {"ousness", 10}, {"iveness", 11}, {"iviti", 11}, {"biliti", 12}};
+    static constexpr std::string_view kReplacements[] = {
+        "tion", "ence", "ance", "able", "ent", "e",  "ize",
+        "ate",  "al",   "ful",  "ous",  "ive", "ble"};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (suffix && start >= word.p1)
+      word.replace(start, kReplacements[suffix->action]);
+  }
+
+  static void step3(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"alize", 0}, {"icate", 1}, {"iciti", 1}, {"ical", 1},
+        {"ative", 2}, {"ful", 2},   {"ness", 2}};
+    static constexpr std::string_view kReplacements[] = {"al", "ic", ""};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (suffix && start >= word.p1)
+      word.replace(start, kReplacements[suffix->action]);
+  }
+
+  static void step4(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"al", 1},   {"ance", 1}, {"ence", 1}, {"er", 1},   {"ic", 1},
+        {"able", 1}, {"ible", 1}, {"ant", 1},  {"ement", 1}, {"ment", 1},
+        {"ent", 1},  {"ou", 1},   {"ism", 1},  {"ate", 1},  {"iti", 1},
+        {"ous", 1},  {"ive", 1},  {"ize", 1},  {"ion", 2}};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (!suffix || start < word.p2)
+      return;
+    if (suffix->action == 2 &&
+        !(start && (word.w[start - 1] == 's' || word.w[start - 1] == 't')))
+      return;
+    word.n = start;
+  }
+
+  static void step5(stemming::Word &word) {
+    if (word.endsWith("e")) {
+      size_t start = word.n - 1;
+      if (start >= word.p2 ||
+          (start >= word.p1 && !word.shortSyllable(start)))
+        word.n = start;
+    }
+    if (word.endsWith("ll") && word.n - 1 >= word.p2)
+      word.n--;
+  }
+
+public:
+  // Stems the word [term, term + length) in place; returns its new length.
+  static size_t stem(char *term, size_t length) {
+    stemming::Word word(term, length);
+    word.markY();
+    word.markRegions();
+    step1a(word);
+    step1b(word);
+    step1c(word);
+    step2(word);
+    step3(word);
+    step4(word);
+    step5(word);
+    word.unmarkY();
+    return word.n;
+  }
+};
+
+// The Snowball English stemmer ("Porter2"), Porter's revision of his
+// algorithm, which stems more words correctly; e.g. "generously" and
+// "generate" don't both stem to "gener", and "dying" stems to "die". Words are
+// expected to be in lower case; bytes other than ASCII letters count as
+// consonants.
+class EnglishStemmer {
+private:
+  using Suffix = stemming::Suffix;
+
+  // Words which are stemmed to exceptional forms, or not at all
+  static bool exception(stemming::Word &word) {
+    static constexpr std::string_view kExceptions[][2] = {
+        {"skis", "ski"},     {"skies", "sky"},   {"idly", "idl"},
+        {"gently", "gentl"}, {"ugly", "ugli"},   {"early", "earli"},
+        {"only", "onli"},    {"singly", "singl"}, {"sky", "sky"},
+        {"news", "news"},    {"howe", "howe"},   {"atlas", "atlas"},
+        {"cosmos", "cosmos"}, {"bias", "bias"},  {"andes", "andes"}};
+    std::string_view text(word.w, word.n);
+    for (const auto &exception : kExceptions)
+      if (text == exception[0]) {
+        word.replace(0, exception[1]);
+        return true;
+      }
+    return false;
+  }
+
+  // The start of R1, if the word starts with a prefix whose R1 is
+  // exceptional; 0 otherwise
+  static size_t exceptionalRegion(const stemming::Word &word) {
+    static constexpr std::string_view kPrefixes[] = {
+        "arsen", "commun", "emerg", "gener", "inter",
+        "later", "organ",  "past",  "univers"};
+    std::string_view text(word.w, word.n);
+    for (std::string_view prefix : kPrefixes)
+      if (text.substr(0, prefix.size()) == prefix)
+        return prefix.size();
+    return 0;
+  }
+
+  static bool shortSyllable(const stemming::Word &word, size_t end) {
+    return word.shortSyllable(end) ||
+           (end == 2 && word.vowel(0) && !word.vowel(1)) ||
+           word.endsWith("past", end);
+  }
+
+  static void step1a(stemming::Word &word) {
+    static constexpr Suffix kApostrophes[] = {{"'s'", 0}, {"'s", 0}, {"'", 0}};
+    size_t start;
+    if (word.longest(kApostrophes, start))
+      word.n = start;
+    static constexpr Suffix kSuffixes[] = {{"sses", 1}, {"ied", 2}, {"ies", 2},
+                                           {"ss", 0},   {"us", 0},  {"s", 3}};
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (!suffix)
+      return;
+    switch (suffix->action) {
+    case 1:
+      word.replace(start, "ss");
+      break;
+    case 2:
+      word.replace(start, start >= 2 ? "i" : "ie");
+      break;
+    case 3: // if there's a vowel before the letter before the s
+      if (start && word.hasVowel(start - 1))
+        word.n = start;
+      break;
+    }
+  }
+
+  static void step1b(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"eed", 1},  {"eedly", 1}, {"ed", 2},
+        {"edly", 2}, {"ingly", 2}, {"ing", 3}};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (!suffix)
+      return;
+    std::string_view before(word.w, start);
+    if (suffix->action == 1) {
+      if (start >= word.p1 && before != "succ" && before != "proc" &&
+          before != "exc")
+        word.replace(start, "ee");
+      return;
+    }
+    if (suffix->action == 3) {
+      static constexpr Suffix kBefore[] = {
+          {"even", 2}, {"cann", 2}, {"inn", 2}, {"earr", 2},
+          {"herr", 2}, {"out", 2},  {"y", 1}};
+      size_t at;
+      const Suffix *prefix = word.longest(kBefore, start, at);
+      if (prefix && prefix->action == 1 && start == 2 && !word.vowel(0)) {
+        word.replace(1, "ie"); // e.g. "dying"
+        return;
+      }
+      if (prefix && prefix->action == 2 && at == 0) // e.g. "inning"
+        return;
+    }
+    if (!word.hasVowel(start))
+      return;
+    word.n = start;
+    static constexpr Suffix kEndings[] = {
+        {"at", 1}, {"bl", 1}, {"iz", 1}, {"bb", 2}, {"dd", 2}, {"ff", 2},
+        {"gg", 2}, {"mm", 2}, {"nn", 2}, {"pp", 2}, {"rr", 2}, {"tt", 2}};
+    size_t at;
+    const Suffix *ending = word.longest(kEndings, at);
+    if (ending && ending->action == 1) {
+      word.w[word.n++] = 'e';
+    } else if (ending) {
+      char c = word.w[0];
+      if (!(word.n == 3 && (c == 'a' || c == 'e' || c == 'o')))
+        word.n--;
+    } else if (word.n == word.p1 && shortSyllable(word, word.n)) {
+      word.w[word.n++] = 'e';
+    }
+  }
+
+  static void step1c(stemming::Word &word) {
+    size_t n = word.n;
+    if (n > 2 && (word.w[n - 1] == 'y' || word.w[n - 1] == 'Y') &&
+        !word.vowel(n - 2))
+      word.w[n - 1] = 'i';
+  }
+
+  static void step2(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"tional", 0},  {"enci", 1},     {"anci", 2},     {"abli", 3},
+        {"entli", 4},   {"izer", 5},     {"ization", 5},  {"ational", 6},
+        {"ation", 6},   {"ator", 6},     {"alism", 7},    {"aliti", 7},
+        {"alli", 7},    {"fulness", 8},  {"fulli", 8},    {"ousli", 9},
+        {"ousness", 9}, {"iveness", 10}, {"iviti", 10},   {"biliti", 11},
+        {"bli", 11},    {"ogist", 12},   {"ogi", 13},     {"lessli", 14},
+        {"li", 15}};
+    static constexpr std::string_view kReplacements[] = {
+        "tion", "ence", "ance", "able", "ent", "ize", "ate",
+        "al",   "ful",  "ous",  "ive",  "ble", "og",  "og", "less"};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (!suffix || start < word.p1)
+      return;
+    if (suffix->action == 13) { // "ogi" after l
+      if (start && word.w[start - 1] == 'l')
+        word.replace(start, "og");
+    } else if (suffix->action == 15) { // "li" after a valid li-ending
+      if (start && std::string_view("cdeghkmnrt").find(word.w[start - 1]) !=
+                       std::string_view::npos)
+        word.n = start;
+    } else {
+      word.replace(start, kReplacements[suffix->action]);
+    }
+  }
+
+  static void step3(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"tional", 0}, {"ational", 1}, {"alize", 2}, {"icate", 3},
+        {"iciti", 3},  {"ical", 3},    {"ful", 4},   {"ness", 4},
+        {"ative", 5}};
+    static constexpr std::string_view kReplacements[] = {"tion", "ate", "al",
+                                                         "ic",   ""};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (!suffix || start < word.p1)
+      return;
+    if (suffix->action == 5) {
+      if (start >= word.p2)
+        word.n = start;
+    } else {
+      word.replace(start, kReplacements[suffix->action]);
+    }
+  }
+
+  static void step4(stemming::Word &word) {
+    static constexpr Suffix kSuffixes[] = {
+        {"al", 1},   {"ance", 1}, {"ence", 1}, {"er", 1},    {"ic", 1},
+        {"able", 1}, {"ible", 1}, {"ant", 1},  {"ement", 1}, {"ment", 1},
+        {"ent", 1},  {"ism", 1},  {"ate", 1},  {"iti", 1},   {"ous", 1},
+        {"ive", 1},  {"ize", 1},  {"ion", 2}};
+    size_t start;
+    const Suffix *suffix = word.longest(kSuffixes, start);
+    if (!suffix || start < word.p2)
+      return;
+    if (suffix->action == 2 &&
+        !(start && (word.w[start - 1] == 's' || word.w[start - 1] == 't')))
+      return;
+    word.n = start;
+  }
+
+  static void step5(stemming::Word &word) {
+    if (word.endsWith("e")) {
+      size_t start = word.n - 1;
+      if (start >= word.p2 ||
+          (start >= word.p1 && !shortSyllable(word, start)))
+        word.n = start;
+    } else if (word.endsWith("ll") && word.n - 1 >= word.p2) {
+      word.n--;
+    }
+  }
+
+public:
+  // Stems the word [term, term + length) in place; returns its new length.
+  static size_t stem(char *term, size_t length) {
+    stemming::Word word(term, length);
+    if (exception(word) || word.n < 3)
+      return word.n;
+    if (word.w[0] == '\'') {
+      std::memmove(word.w, word.w + 1, --word.n);
+    }
+    word.markY();
+    word.markRegions(exceptionalRegion(word));
+    step1a(word);
+    step1b(word);
+    step1c(word);
+    step2(word);
+    step3(word);
+    step4(word);
+    step5(word);
+    word.unmarkY();
+    return word.n;
+  }
+};
+
+} // namespace lucanthrope
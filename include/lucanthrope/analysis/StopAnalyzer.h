@@ -1,13 +1,13 @@
 #pragma once
 
-#include <cstddef> // size_t
-#include <memory>  // unique_ptr
+#include <memory> // unique_ptr
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "Analysis.h"
+#include "Chain.h"
 #include "CharTokenizer.h"
+#include "PerfectHashSet.h"
 #include "StopFilter.h"
 
 namespace lucanthrope {
@@ -22,31 +22,34 @@ public:
       "or",    "s",    "such", "t",  "that", "the", "their", "then", "there",
       "these", "those","they", "this", "to", "was",  "were", "will", "with"};
 
+  // EnglishStopWords, perfectly hashed at compile time
+  static constexpr StaticPerfectHashSet<sizeof EnglishStopWords /
+                                        sizeof(char *)>
+      EnglishStopWordSet{EnglishStopWords};
+
 private:
-  std::unordered_set<std::string> stopWords;
+  // Custom stop words, if any
+  std::unique_ptr<DynamicPerfectHashSet> customStopWords;
+  PerfectHashSet stopWords;
 
 public:
   // Builds an analyzer which removes words in EnglishCommonWords
-  StopAnalyzer() {
-    size_t n = sizeof EnglishStopWords / sizeof(char *);
-    const char *const *ptr = EnglishStopWords;
-    while (n--)
-      stopWords.insert(*ptr++);
-  }
+  StopAnalyzer() : stopWords(EnglishStopWordSet.set()) {}
 
   // Builds an analyzer which removes words in the provided vector
-  StopAnalyzer(const std::vector<std::string> &words) {
-    for (auto &word : words)
-      stopWords.insert(word);
-  }
+  StopAnalyzer(const std::vector<std::string> &words)
+      : customStopWords(new DynamicPerfectHashSet(words)),
+        stopWords(customStopWords->set()) {}
+
+  virtual bool sameStreamForAllFields() const override { return true; }
 
   virtual std::unique_ptr<TokenStream>
   getTokenStream(std::istream &input,
                  [[maybe_unused]] std::string_view fieldName =
                      std::string_view()) override {
-    std::unique_ptr<TokenStream> tokenizer(new LowerCaseTokenizer(input));
     return std::unique_ptr<TokenStream>(
-        new StopFilter(std::move(tokenizer), stopWords));
+        new Chain<LowerCaseTokenizer, StopFilter>(
+            input, StopFilter::Stage(stopWords)));
   }
 };
 
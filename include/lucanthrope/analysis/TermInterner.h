@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "Analysis.h"
+#include "PerfectHashSet.h" // perfect_hash::hash()
+
+namespace lucanthrope {
+
+// Maps terms to dense ids, from 0 in the order they're first seen, and counts
+// the occurrences of terms in the document being analyzed: the sink at the end
+// of an analysis chain, where an in-memory indexer starts. add() takes a
+// token's bytes straight from its TokenView, so no std::string is made for a
+// token, nor kept for a term: the bytes of terms are appended to one arena,
+// and the table is open addressing, with linear probing, over slots of 8
+// bytes, which hold a term's id and 32 bits of its hash. A probe compares
+// bytes only when those bits match.
+//
+// E.g. the terms of a document and their frequencies:
+//   TermInterner terms;
+//   terms.addAll(analyzer.reusableTokenStream(input, "body"));
+//   for (TermInterner::TermId id : terms.documentTerms())
+//     use(terms.term(id), terms.frequency(id));
+//   terms.endDocument();
+class TermInterner {
+public:
+  using TermId = uint32_t;
+  static constexpr TermId kNoTerm = UINT32_MAX;
+
+private:
+  struct Slot {
+    TermId id = kNoTerm; // kNoTerm if the slot is free
+    uint32_t hash = 0;
+  };
+
+  // Slots are at most half full, a power of two of them
+  std::vector<Slot> slots;
+  size_t slotMask = 0;
+  // The bytes of term id are arena[starts[id], starts[id + 1])
+  std::vector<char> arena;
+  std::vector<size_t> starts{0};
+  // By id: occurrences in the current document, and the number of documents
+  // the term occurred in
+  std::vector<uint32_t> frequencies;
+  std::vector<uint32_t> documentFrequencies;
+  // The terms of the current document, in the order they're first seen
+  std::vector<TermId> documentTerms_;
+
+  static uint32_t hashOf(std::string_view term) {
+    return static_cast<uint32_t>(perfect_hash::hash(term, 0));
+  }
+
+  // The index of the slot of term, which has hash h: either its own, or the
+  // free slot where it belongs
+  size_t slotOf(std::string_view term, uint32_t h) const {
+    for (size_t i = h & slotMask;; i = (i + 1) & slotMask) {
+      const Slot &slot = slots[i];
+      if (slot.id == kNoTerm)
+        return i;
+      if (slot.hash == h && term == this->term(slot.id))
+        return i;
+    }
+  }
+
+  void rehash(size_t numSlots) {
+    std::vector<Slot> old(numSlots);
+    old.swap(slots);
+    slotMask = numSlots - 1;
+    for (const Slot &slot : old) {
+      if (slot.id == kNoTerm)
+        continue;
+      size_t i = slot.hash & slotMask;
+      while (slots[i].id != kNoTerm)
+        i = (i + 1) & slotMask;
+      slots[i] = slot;
+    }
+  }
+
+public:
+  explicit TermInterner(size_t expectedTerms = 0) {
+    size_t numSlots = 16;
+    while (numSlots < 2 * expectedTerms)
+      numSlots *= 2;
+    rehash(numSlots);
+  }
+
+  // The number of distinct terms
+  size_t size() const { return starts.size() - 1; }
+
+  std::string_view term(TermId id) const {
+    return std::string_view(arena.data() + starts[id],
+                            starts[id + 1] - starts[id]);
+  }
+
+  // The id of term, kNoTerm if it was never interned
+  TermId find(std::string_view term) const {
+    return slots[slotOf(term, hashOf(term))].id;
+  }
+
+  // The id of term, which gets one if it's new; doesn't count the term.
+  TermId intern(std::string_view term) {
+    uint32_t h = hashOf(term);
+    size_t i = slotOf(term, h);
+    if (slots[i].id != kNoTerm)
+      return slots[i].id;
+    TermId id = static_cast<TermId>(size());
+    if (2 * (id + 1) > slots.size()) {
+      rehash(2 * slots.size());
+      i = slotOf(term, h);
+    }
+    slots[i].id = id;
+    slots[i].hash = h;
+    arena.insert(arena.end(), term.begin(), term.end());
+    starts.push_back(arena.size());
+    frequencies.push_back(0);
+    documentFrequencies.push_back(0);
+    return id;
+  }
+
+  // Interns term, and counts an occurrence of it in the current document.
+  TermId add(std::string_view term) {
+    TermId id = intern(term);
+    if (frequencies[id]++ == 0) {
+      documentTerms_.push_back(id);
+      documentFrequencies[id]++;
+    }
+    return id;
+  }
+
+  TermId add(const TokenView &view) {
+    return add(std::string_view(view.term, view.termLength));
+  }
+
+  // Adds the remaining tokens of stream; returns how many there were.
+  // Stream is TokenStream, or a concrete stream such as a Chain, whose next()
+  // is then called directly.
+  template <typename Stream> size_t addAll(Stream &stream) {
+    size_t n = 0;
+    for (; stream.next(); n++)
+      add(stream.getTokenView());
+    return n;
+  }
+
+  // The distinct terms added since endDocument(), in the order they were first
+  // added
+  const std::vector<TermId> &documentTerms() const { return documentTerms_; }
+
+  // The occurrences of term id added since endDocument()
+  uint32_t frequency(TermId id) const { return frequencies[id]; }
+
+  // The number of documents term id was added in, so far
+  uint32_t documentFrequency(TermId id) const {
+    return documentFrequencies[id];
+  }
+
+  // Ends the current document: its term frequencies go back to 0.
+  void endDocument() {
+    for (TermId id : documentTerms_)
+      frequencies[id] = 0;
+    documentTerms_.clear();
+  }
+};
+
+} // namespace lucanthrope
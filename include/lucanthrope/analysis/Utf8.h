@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+
+#if defined(__AVX512BW__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "UnicodeData.h"
+
+namespace lucanthrope {
+
+namespace utf8 {
+
+// What invalid sequences decode to
+constexpr char32_t kReplacement = 0xfffd;
+
+constexpr bool isContinuation(char c) {
+  return (static_cast<unsigned char>(c) & 0xc0) == 0x80;
+}
+
+// Length of the sequence which starts with byte c; 0 if c can't start one
+constexpr size_t sequenceLength(char c) {
+  unsigned char b = static_cast<unsigned char>(c);
+  return b < 0x80   ? 1
+         : b < 0xc2 ? 0
+         : b < 0xe0 ? 2
+         : b < 0xf0 ? 3
+         : b < 0xf5 ? 4
+                    : 0;
+}
+
+// Decodes the code point at p, p < end, into cp; returns its length in bytes.
+// An invalid sequence (a stray continuation byte, an overlong encoding, a
+// surrogate, a code point beyond U+10FFFF, a sequence cut short) decodes to
+// kReplacement, one byte at a time.
+constexpr size_t decode(const char *p, const char *end, char32_t &cp) {
+  unsigned char lead = static_cast<unsigned char>(*p);
+  if (lead < 0x80) {
+    cp = lead;
+    return 1;
+  }
+  size_t n = sequenceLength(*p);
+  if (!n || static_cast<size_t>(end - p) < n) {
+    cp = kReplacement;
+    return 1;
+  }
+  char32_t ret = lead & (0x7f >> n);
+  for (size_t i = 1; i < n; i++) {
+    if (!isContinuation(p[i])) {
+      cp = kReplacement;
+      return 1;
+    }
+    ret = ret << 6 | (static_cast<unsigned char>(p[i]) & 0x3f);
+  }
+  constexpr char32_t kMin[] = {0, 0, 0x80, 0x800, 0x10000};
+  if (ret < kMin[n] || ret > 0x10ffff || (ret >= 0xd800 && ret <= 0xdfff)) {
+    cp = kReplacement;
+    return 1;
+  }
+  cp = ret;
+  return n;
+}
+
+constexpr size_t encodedLength(char32_t cp) {
+  return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+}
+
+// Writes the encoding of valid code point cp at out; returns its length.
+constexpr size_t encode(char32_t cp, char *out) {
+  size_t n = encodedLength(cp);
+  if (n == 1) {
+    out[0] = static_cast<char>(cp);
+    return 1;
+  }
+  constexpr unsigned char kLead[] = {0, 0, 0xc0, 0xe0, 0xf0};
+  for (size_t i = n - 1; i > 0; i--, cp >>= 6)
+    out[i] = static_cast<char>(0x80 | (cp & 0x3f));
+  out[0] = static_cast<char>(kLead[n] | cp);
+  return n;
+}
+
+// Returns the end of the text [first, last) less an incomplete sequence at its
+// end, which may be completed by the text which follows.
+constexpr const char *completeEnd(const char *first, const char *last) {
+  for (const char *p = last; p != first && last - p < 4;) {
+    --p;
+    if (!isContinuation(*p)) {
+      size_t n = sequenceLength(*p);
+      return n > static_cast<size_t>(last - p) ? p : last;
+    }
+  }
+  return last;
+}
+
+// Returns a bitmask of the 64 bytes at p: bit i is set iff p[i] isn't ASCII,
+// i.e. is a byte of a multibyte sequence, or invalid. Like CharClass::mask64(),
+// computed by the widest of AVX-512BW, AVX2 and SSE2 the compiler may use.
+inline uint64_t nonAsciiMask64(const char *p) {
+#if defined(__AVX512BW__)
+  return _mm512_movepi8_mask(_mm512_loadu_si512(p));
+#elif defined(__AVX2__)
+  const __m256i *v = reinterpret_cast<const __m256i *>(p);
+  uint64_t ret = 0;
+  for (int half = 0; half < 2; half++)
+    ret |= static_cast<uint64_t>(static_cast<uint32_t>(
+               _mm256_movemask_epi8(_mm256_loadu_si256(v + half))))
+           << (32 * half);
+  return ret;
+#elif defined(__SSE2__)
+  const __m128i *v = reinterpret_cast<const __m128i *>(p);
+  uint64_t ret = 0;
+  for (int quarter = 0; quarter < 4; quarter++)
+    ret |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_loadu_si128(v + quarter)))
+           << (16 * quarter);
+  return ret;
+#else
+  uint64_t ret = 0;
+  for (size_t i = 0; i < 64; i++)
+    ret |= static_cast<uint64_t>(static_cast<unsigned char>(p[i]) >> 7) << i;
+  return ret;
+#endif
+}
+
+// True if the 64 bytes at p are all ASCII; cheaper than nonAsciiMask64(p) == 0
+inline bool isAscii64(const char *p) {
+#if defined(__AVX512BW__)
+  return !_mm512_movepi8_mask(_mm512_loadu_si512(p));
+#elif defined(__AVX2__)
+  const __m256i *v = reinterpret_cast<const __m256i *>(p);
+  return !_mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_loadu_si256(v), _mm256_loadu_si256(v + 1)));
+#elif defined(__SSE2__)
+  const __m128i *v = reinterpret_cast<const __m128i *>(p);
+  __m128i low = _mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1));
+  __m128i high = _mm_or_si128(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3));
+  return !_mm_movemask_epi8(_mm_or_si128(low, high));
+#else
+  return !nonAsciiMask64(p);
+#endif
+}
+
+} // namespace utf8
+
+// Unicode properties of code points, from the tables of UnicodeData.h
+namespace unicode {
+
+constexpr const unicode_data::Properties &propertiesOf(char32_t cp) {
+  using namespace unicode_data;
+  if (cp >= kLimit)
+    return kProperties[0];
+  return kProperties[kBlockData[kBlockIndex[cp >> kBlockShift] << kBlockShift |
+                                (cp & ((1u << kBlockShift) - 1))]];
+}
+
+// True for letters and combining marks, of which words are made
+constexpr bool isTokenChar(char32_t cp) { return propertiesOf(cp).tokenChar; }
+
+// The simple (one to one) lower case mapping
+constexpr char32_t toLower(char32_t cp) {
+  return static_cast<char32_t>(static_cast<int32_t>(cp) +
+                               propertiesOf(cp).lowerDelta);
+}
+
+} // namespace unicode
+
+} // namespace lucanthrope
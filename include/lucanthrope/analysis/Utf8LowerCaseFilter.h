@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // memcpy()
+#include <memory>  // unique_ptr
+#include <string>
+#include <utility> // move()
+
+#include "Analysis.h"
+#include "Utf8.h"
+
+namespace lucanthrope {
+
+// Normalizes UTF-8 token text to lower case by the Unicode simple case
+// mapping. Terms are rewritten in place, 8 bytes at a time while they're
+// ASCII; a term which gets longer, which takes one of the few letters whose
+// lower case is encoded with more bytes (e.g. U+023A), is rewritten into a
+// buffer of the filter instead. Invalid sequences are left as they are.
+class Utf8LowerCaseFilter : public TokenFilter {
+public:
+  // The filter as a Chain stage
+  class Stage {
+  private:
+    std::string grown; // holds terms which got longer
+
+    static uint64_t toLowerAscii(uint64_t bytes) {
+      // 0x80 in every byte which is 'A'..'Z': no byte is >= 0x80, so adding
+      // doesn't carry across bytes
+      constexpr uint64_t kOnes = 0x0101010101010101ull;
+      uint64_t aboveA = bytes + (0x80 - 'A') * kOnes;
+      uint64_t aboveZ = bytes + (0x80 - 'Z' - 1) * kOnes;
+      uint64_t upper = (aboveA ^ aboveZ) & 0x80 * kOnes;
+      return bytes | upper >> 2;
+    }
+
+  public:
+    bool accept(TokenView &view) {
+      char *p = view.term;
+      char *end = p + view.termLength;
+      for (; end - p >= 8; p += 8) {
+        uint64_t bytes;
+        std::memcpy(&bytes, p, 8);
+        if (bytes & 0x8080808080808080ull)
+          break;
+        bytes = toLowerAscii(bytes);
+        std::memcpy(p, &bytes, 8);
+      }
+      char *out = p;
+      while (p != end) {
+        if (!(*p & 0x80)) {
+          *out++ = *p >= 'A' && *p <= 'Z' ? *p + ('a' - 'A') : *p;
+          p++;
+          continue;
+        }
+        char32_t cp;
+        size_t n = utf8::decode(p, end, cp);
+        if (cp == utf8::kReplacement && n == 1) {
+          *out++ = *p++;
+          continue;
+        }
+        char32_t lower = unicode::toLower(cp);
+        if (out + utf8::encodedLength(lower) > p + n) {
+          grow(view, out, p);
+          return true;
+        }
+        out += utf8::encode(lower, out);
+        p += n;
+      }
+      view.termLength = out - view.term;
+      return true;
+    }
+
+  private:
+    // Finishes the term in grown; [view.term, out) is done, [p, end) is not
+    void grow(TokenView &view, char *out, const char *p) {
+      const char *end = view.term + view.termLength;
+      grown.assign(view.term, out);
+      char encoded[4];
+      while (p != end) {
+        char32_t cp;
+        size_t n = utf8::decode(p, end, cp);
+        if (cp == utf8::kReplacement && n == 1)
+          grown.push_back(*p);
+        else
+          grown.append(encoded, utf8::encode(unicode::toLower(cp), encoded));
+        p += n;
+      }
+      view.term = &grown[0];
+      view.termLength = grown.size();
+    }
+  };
+
+private:
+  Stage stage;
+
+public:
+  Utf8LowerCaseFilter(std::unique_ptr<TokenStream> input)
+      : TokenFilter(std::move(input)) {}
+  virtual ~Utf8LowerCaseFilter() = default;
+  virtual bool next() override {
+    if (input_->next()) {
+      view = input_->getTokenView();
+      return stage.accept(view);
+    }
+    return false;
+  }
+};
+
+} // namespace lucanthrope
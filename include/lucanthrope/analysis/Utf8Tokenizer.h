@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm> // copy(), max()
+#include <cstddef>   // size_t
+#include <cstdint>
+#include <cstring> // memmove()
+#include <istream>
+#include <memory> // unique_ptr
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "Analysis.h"
+#include "CharClass.h"
+#include "CharTokenizer.h"
+#include "Utf8.h"
+
+namespace lucanthrope {
+
+namespace {
+
+// Maps letters to lower case by the Unicode simple case mapping
+struct utf8_tolower_normalizer {
+  constexpr char operator()(char c) const { return tolower_normalizer()(c); }
+  constexpr char32_t operator()(char32_t cp) const {
+    return unicode::toLower(cp);
+  }
+};
+
+} // unnamed namespace
+
+// Tokenizer of UTF-8 text: tokens are adjacent sequences of letters and
+// combining marks (see unicode::isTokenChar()), so that words of any script
+// are kept whole. Normalizer is noop_normalizer or a function object with
+// - char norm(char c), called on each ASCII token character c, and
+// - char32_t norm(char32_t cp), called on each other token code point cp;
+// which normalize characters before they're added to the token.
+//
+// Text is read like CharTokenizer reads it, from an istream kChunkSize bytes at
+// a time, or directly from memory; a sequence cut by the end of a chunk is
+// carried over to the next one. Runs of ASCII text are found 64 bytes at a
+// time with SIMD, and scanned like AlphaCharTokenizer scans text, with the
+// bitmasks of a CharScanner<isalpha_predicate>; code points are decoded only
+// past the end of a run. Mostly ASCII text thus costs about what it costs
+// LowerCaseTokenizer. Invalid sequences decode to utf8::kReplacement, which
+// separates tokens.
+//
+// Token offsets are byte offsets in the text.
+template <typename Normalizer = noop_normalizer>
+class Utf8Tokenizer : public Tokenizer {
+public:
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+private:
+  Normalizer normalize;
+  // The term is buffer[0, length); the buffer only grows
+  std::string buffer;
+  size_t length = 0;
+  // Holds the current chunk of an istream source
+  std::unique_ptr<char[]> chunk;
+  // The unscanned part of the current chunk is [cur, end); begin is at offset
+  // in the text. [end, held) is an incomplete sequence, carried over to the
+  // next chunk.
+  const char *begin = nullptr;
+  const char *cur = nullptr;
+  const char *end = nullptr;
+  const char *held = nullptr;
+  uint64_t offset = 0;
+  // Scans ASCII text; [cur, asciiEnd) is ASCII, and asciiEnd is the first
+  // non-ASCII byte after it, or end
+  CharScanner<isalpha_predicate> scanner;
+  const char *asciiEnd = nullptr;
+  // Whether scan() passed over non-ASCII bytes since it was last cleared
+  bool sawNonAscii = false;
+
+  // Returns the first non-ASCII byte in [p, end), or end
+  const char *findNonAscii(const char *p) const {
+    for (; end - p >= 64; p += 64)
+      if (!utf8::isAscii64(p))
+        return p + __builtin_ctzll(utf8::nonAsciiMask64(p));
+    while (p != end && !(*p & 0x80))
+      p++;
+    return p;
+  }
+
+  // Returns the first code point in [p, end) which is a token character if
+  // tokenChar is true, or which isn't if tokenChar is false; end if none.
+  const char *scan(const char *p, bool tokenChar) {
+    while (true) {
+      if (p < asciiEnd) {
+        const char *found = scanner.find(p, asciiEnd, tokenChar);
+        if (found != asciiEnd)
+          return found;
+        p = asciiEnd;
+      }
+      if (p == end)
+        return end;
+      if (!(*p & 0x80)) {
+        asciiEnd = findNonAscii(p);
+        continue;
+      }
+      sawNonAscii = true;
+      char32_t cp;
+      size_t n = utf8::decode(p, end, cp);
+      if (unicode::isTokenChar(cp) == tokenChar)
+        return p;
+      p += n;
+    }
+  }
+
+  // Returns room for n more bytes of the term, at buffer[length]
+  char *grow(size_t n) {
+    if (buffer.size() < length + n)
+      buffer.resize(std::max(2 * buffer.size(), length + n));
+    return &buffer[length];
+  }
+
+  // Appends the token characters [first, last) to the term, normalized; ascii
+  // is true if they're all ASCII. Bytes are normalized as they're copied,
+  // rather than copied and then normalized in place, which matters for short
+  // terms.
+  void append(const char *first, const char *last, bool ascii) {
+    if (ascii) {
+      size_t n = last - first;
+      char *out = grow(n);
+      for (size_t i = 0; i < n; i++)
+        out[i] = normalize(first[i]);
+      length += n;
+      return;
+    }
+    while (first != last) {
+      char32_t cp;
+      size_t n = utf8::decode(first, last, cp);
+      if (n == 1) { // ASCII
+        *grow(1) = normalize(*first);
+        length++;
+      } else if constexpr (std::is_same_v<Normalizer, noop_normalizer>) {
+        std::copy(first, first + n, grow(n));
+        length += n;
+      } else {
+        // the normalized code point may be encoded with more or fewer bytes
+        length += utf8::encode(normalize(cp), grow(4));
+      }
+      first += n;
+    }
+  }
+
+  void restart(const char *first, const char *last) {
+    begin = cur = first;
+    end = held = last;
+    offset = 0;
+    asciiEnd = first;
+    scanner.reset();
+  }
+
+  // Replaces the current chunk by the next one; returns false at the end of
+  // the text.
+  bool fill() {
+    offset += end - begin;
+    scanner.reset();
+    size_t carry = held - end;
+    if (!input_ || !*input_) {
+      begin = cur = asciiEnd = end;
+      end = held;
+      return carry; // the text ends with an incomplete sequence
+    }
+    char *p = chunk.get();
+    if (carry)
+      std::memmove(p, end, carry);
+    std::streambuf *buf = input_->rdbuf();
+    std::streamsize n = buf ? buf->sgetn(p + carry, kChunkSize - carry) : 0;
+    if (n <= 0) {
+      input_->setstate(std::ios_base::eofbit);
+      n = 0;
+    }
+    begin = cur = asciiEnd = p;
+    held = p + carry + n;
+    end = n ? utf8::completeEnd(p, held) : held;
+    return held != p;
+  }
+
+public:
+  Utf8Tokenizer(std::istream &input)
+      : Tokenizer(input), chunk(new char[kChunkSize]) {}
+
+  Utf8Tokenizer(std::istream &input, Normalizer norm)
+      : Tokenizer(input), normalize(norm), chunk(new char[kChunkSize]) {}
+
+  Utf8Tokenizer(std::string_view text)
+      : begin(text.data()), cur(text.data()), end(text.data() + text.size()),
+        held(end), asciiEnd(begin) {}
+
+  Utf8Tokenizer(std::string_view text, Normalizer norm)
+      : normalize(norm), begin(text.data()), cur(text.data()),
+        end(text.data() + text.size()), held(end), asciiEnd(begin) {}
+
+  virtual ~Utf8Tokenizer() = default;
+
+  virtual void reset(std::istream &input) override {
+    Tokenizer::reset(input);
+    if (!chunk) // read from memory so far
+      chunk.reset(new char[kChunkSize]);
+    restart(nullptr, nullptr);
+  }
+
+  // Makes the tokenizer start over on text in memory.
+  virtual void reset(std::string_view text) override {
+    input_ = nullptr;
+    restart(text.data(), text.data() + text.size());
+  }
+
+  virtual bool next() override {
+    while (true) { // skip token boundaries
+      cur = scan(cur, true);
+      if (cur != end)
+        break;
+      if (!fill())
+        return false;
+    }
+    uint64_t start_pos = offset + (cur - begin);
+    length = 0;
+    while (true) {
+      sawNonAscii = false;
+      const char *tok_end = scan(cur, false);
+      append(cur, tok_end, !sawNonAscii);
+      cur = tok_end;
+      if (cur != end || !fill()) // the token continues in the next chunk
+        break;
+    }
+    view.term = &buffer[0];
+    view.termLength = length;
+    view.startPos = start_pos;
+    view.endPos = offset + (cur - begin);
+    return true;
+  }
+};
+
+// Tokenizer of UTF-8 text that converts each token character to lower case
+using Utf8LowerCaseTokenizer = Utf8Tokenizer<utf8_tolower_normalizer>;
+
+} // namespace lucanthrope
@@ -8,6 +8,8 @@
 namespace lucanthrope {
 
 class WhiteSpaceAnalyzer : public Analyzer {
+  virtual bool sameStreamForAllFields() const override { return true; }
+
   virtual std::unique_ptr<TokenStream>
   getTokenStream(std::istream &input,
                  [[maybe_unused]] std::string_view fieldName =
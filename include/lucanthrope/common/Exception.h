@@ -20,6 +20,12 @@ public:
     // thrown when contents of an index file cannot be parsed, or, for example,
     // when FieldInfos doesn't contain some field when it has to be there
     IndexCorruptionException,
+    // thrown when a directory cannot allocate memory for a new file without
+    // exceeding its configured memory budget
+    RAMBudgetExceededException,
+    // thrown when an operation is not supported by an object, e.g. writing to
+    // a read-only directory
+    UnsupportedOperationException,
   };
 
   Exception(Code code) : code_(code) {}
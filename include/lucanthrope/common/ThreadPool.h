@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef> // size_t
+#include <functional>
+#include <future>
+#include <memory> // make_shared()
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits> // invoke_result_t
+#include <utility>     // move()
+#include <vector>
+
+namespace lucanthrope {
+
+// Minimal fixed-size thread pool. Tasks are executed in FIFO order, and their
+// results (or exceptions) are delivered through std::future returned by
+// submit(). Destructor waits for all submitted tasks to complete.
+//
+// Tasks must not wait for futures of other tasks submitted to the same pool:
+// if all workers do that, nobody is left to run the awaited tasks.
+class ThreadPool {
+private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::queue<std::function<void()>> tasks_;
+  std::vector<std::thread> workers_;
+  bool stop_ = false;
+
+  void run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty()) // stop_ is set and there is nothing left to do
+          return;
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+      task();
+    }
+  }
+
+public:
+  // Returns a reasonable number of threads for CPU-bound work; never zero.
+  static size_t defaultThreadCount() {
+    size_t n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+  }
+
+  // Starts numThreads workers; zero means defaultThreadCount().
+  explicit ThreadPool(size_t numThreads = 0) {
+    if (!numThreads)
+      numThreads = defaultThreadCount();
+    workers_.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; i++)
+      workers_.emplace_back([this] { run(); });
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &worker : workers_)
+      worker.join();
+  }
+
+  size_t size() const { return workers_.size(); }
+
+  // Schedules f() for execution on one of the workers.
+  template <typename F>
+  std::future<std::invoke_result_t<F>> submit(F &&f) {
+    using R = std::invoke_result_t<F>;
+    // std::function requires copyable callables, hence shared_ptr
+    auto task =
+        std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    std::future<R> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      tasks_.emplace([task] { (*task)(); });
+    }
+    cv_.notify_one();
+    return result;
+  }
+};
+
+// Waits for every future in the range, then rethrows the first exception (if
+// any). Unlike calling get() in a loop, this never leaves tasks running that
+// may still reference caller's stack when an exception propagates.
+template <typename T> void waitAll(std::vector<std::future<T>> &futures) {
+  for (auto &f : futures)
+    f.wait();
+  for (auto &f : futures)
+    f.get();
+}
+
+} // namespace lucanthrope
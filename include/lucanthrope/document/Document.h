@@ -3,7 +3,7 @@
 #include <cassert>
 #include <cstddef>
 #include <istream>
-#include <memory> // unique_ptr
+#include <memory> // shared_ptr, unique_ptr
 #include <string>
 #include <string_view>
 #include <utility> // move()
@@ -12,6 +12,27 @@
 
 namespace lucanthrope {
 
+// A field value which a Field refers to, rather than copies: bytes, e.g. of
+// a document in the buffer of a bulk loader, or of a memory-mapped file.
+//
+// If owner is set, it keeps the bytes alive, and the Field shares it; e.g.
+// mapFile() returns a span which owns its mapping. Otherwise the bytes belong
+// to the caller, and must outlive the Field, and any token stream reading them.
+struct ByteSpan {
+  std::string_view bytes;
+  std::shared_ptr<const void> owner;
+
+  // The bytes [offset, offset + length) of the span, with the same owner
+  ByteSpan slice(size_t offset, size_t length) const {
+    return {bytes.substr(offset, length), owner};
+  }
+
+  // Maps the file at path, read-only; throws Exception (FileNotFoundException,
+  // IOErrorException) if it can't. An empty file maps to an empty span. The
+  // file mustn't be truncated while the mapping is in use.
+  static ByteSpan mapFile(const std::string &path);
+};
+
 // A field is a section of a Document.  Each field has two parts, a name and a
 // value.  Values may be free text, provided as a string or as a std::istream,
 // or they may be atomic keywords, which are not further processed.  Such
@@ -22,7 +43,7 @@ private:
   std::string name_;
   // Using std::variant allows us to easily extend to other value types in the
   // future.
-  std::variant<std::string, std::unique_ptr<std::istream>> value_;
+  std::variant<std::string, std::unique_ptr<std::istream>, ByteSpan> value_;
   unsigned char isStored_ : 1;
   unsigned char isIndexed_ : 1;
   unsigned char isTokenized_ : 1;
@@ -63,6 +84,16 @@ public:
            "Value cannot be null!");
   }
 
+  // Constructs a field whose value is span, which isn't copied; see ByteSpan
+  // for how long the bytes must live. Unlike a string value, the span may be
+  // empty, e.g. the mapping of an empty file: it has no tokens.
+  Field(std::string_view name, ByteSpan value, bool store, bool index,
+        bool token)
+      : name_(name), value_(std::move(value)), isStored_(store),
+        isIndexed_(index), isTokenized_(token) {
+    assert(!name_.empty() && "Name cannot be empty!");
+  }
+
   // Copying is prohibited due to owned std::istream.
   Field(const Field &) = delete;
   Field &operator=(const Field &) = delete;
@@ -106,20 +137,37 @@ public:
     return Field(name, std::move(value));
   }
 
+  // Constructs a span-valued Field that is tokenized and indexed, and is
+  // stored in the index, like text(name, std::string_view), but the value
+  // isn't copied.
+  static Field text(std::string_view name, ByteSpan value) {
+    return Field(name, std::move(value), true, true, true);
+  }
+
+  // Constructs a span-valued Field that is tokenized and indexed, but that is
+  // not stored in the index; e.g. the body of a document in a large buffer, or
+  // a whole memory-mapped file.
+  static Field unstored(std::string_view name, ByteSpan value) {
+    return Field(name, std::move(value), false, true, true);
+  }
+
   const std::string &getName() const { return name_; }
 
-  // Returns true iff the value of the field is a string.  If false, then the
-  // value of the field is std::unique_ptr<std::istream>.
+  // Returns true iff the value of the field is a string.  Exactly one of
+  // isStringValue(), isIStreamValue() and isSpanValue() is true.
   bool isStringValue() const {
     return std::holds_alternative<std::string>(value_);
   }
 
-  // The value of the field as a Reader, or null.  If null, the String value
-  // is used.  Exactly one of stringValue() and readerValue() must be set.
+  // Returns true iff the value of the field is a std::istream, which is read
+  // once by analysis (see getIStreamValue()).
   bool isIStreamValue() const {
     return std::holds_alternative<std::unique_ptr<std::istream>>(value_);
   }
 
+  // Returns true iff the value of the field is a ByteSpan.
+  bool isSpanValue() const { return std::holds_alternative<ByteSpan>(value_); }
+
   // REQUIRES: isStringValue() == true
   const std::string &getStringValue() const {
     assert(isStringValue());
@@ -132,6 +180,22 @@ public:
     return *std::get<std::unique_ptr<std::istream>>(value_).get();
   }
 
+  // REQUIRES: isSpanValue() == true
+  const ByteSpan &getSpanValue() const {
+    assert(isSpanValue());
+    return std::get<ByteSpan>(value_);
+  }
+
+  // The value of a string- or span-valued field, which token streams can scan
+  // in memory (see Analyzer::reusableTokenStream(std::string_view)).
+  // REQUIRES: isIStreamValue() == false
+  std::string_view getTextValue() const {
+    assert(!isIStreamValue());
+    if (const std::string *value = std::get_if<std::string>(&value_))
+      return *value;
+    return std::get<ByteSpan>(value_).bytes;
+  }
+
   // True iff the value of the field is to be stored in the index for return
   // with search hits.  It is an error for this to be true if a field is
   // Reader-valued.
@@ -153,7 +217,9 @@ public:
     ret.append(isStored() ? "stored," : "not stored,")
         .append(isIndexed() ? "indexed," : "not indexed,")
         .append(isTokenized() ? "tokenized," : "not tokenized,")
-        .append(isStringValue() ? "string value)" : "istream value)");
+        .append(isStringValue()  ? "string value)"
+                : isSpanValue() ? "span value)"
+                                : "istream value)");
     return ret;
   }
 };
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <functional> // function
+#include <list>
+#include <memory> // shared_ptr, unique_ptr
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace lucanthrope {
+
+// Sharded, concurrent cache of fixed-size file blocks, which disk-backed
+// IndexInputs consult before issuing I/O (see FSDirectory::setBlockCache()).
+// It gives deterministic caching of the hottest index blocks under a fixed
+// memory budget, regardless of what happens to the OS page cache.
+//
+// Each shard is an independent S3-FIFO cache (Yang et al., "FIFO queues are
+// all you need for cache eviction", SOSP'23) protected by its own mutex:
+// - new blocks are inserted into a small FIFO queue, which takes about 10% of
+// the shard's budget; most one-hit wonders are evicted from it without ever
+// touching the main queue;
+// - blocks which were accessed again (hit at least once) while in the small
+// queue are promoted to the main FIFO queue when they reach its tail; blocks evicted from the small
+// queue leave their keys in a ghost queue, and a block whose key is found
+// there is inserted directly into the main queue;
+// - the main queue works like CLOCK: a block at its tail which was accessed
+// since it was (re)inserted is moved back to the head.
+//
+// Blocks of pinned files are never evicted (but they are counted against the
+// budget, so pinning too much leaves no room for anything else).
+//
+// Blocks are handed out as shared_ptr, so evicting or invalidating a block
+// never invalidates memory which is still used by a reader.
+class BlockCache {
+public:
+  // Identifies a version of a file (not a name, since files may be renamed).
+  struct FileKey {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    // Modification time in nanoseconds, protects against reuse of inode
+    // numbers by files created after the original one was deleted.
+    uint64_t version = 0;
+
+    bool operator==(const FileKey &other) const {
+      return device == other.device && inode == other.inode &&
+             version == other.version;
+    }
+  };
+
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size = 0; // less than getBlockSize() only for the last block
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    uint64_t bytesUsed = 0;
+    uint64_t blocks = 0;
+  };
+
+  // budgetBytes is split evenly between numShards shards. blockSize is the
+  // number of bytes in a cached block, it is also the I/O size of cached
+  // inputs.
+  explicit BlockCache(uint64_t budgetBytes, size_t blockSize = 64 * 1024,
+                      size_t numShards = 16);
+
+  BlockCache(const BlockCache &) = delete;
+  BlockCache &operator=(const BlockCache &) = delete;
+
+  size_t getBlockSize() const { return blockSize_; }
+
+  uint64_t getBudget() const { return budget_; }
+
+  // Returns the cached block number blockIndex of file, or loads it by calling
+  // load() (outside of any lock) and caches it. Exceptions thrown by load()
+  // propagate to the caller; nothing is cached in such case.
+  std::shared_ptr<const Block>
+  getOrLoad(const FileKey &file, uint64_t blockIndex,
+            const std::function<void(Block &)> &load);
+
+  // Returns the cached block or nullptr; counts a hit or a miss.
+  std::shared_ptr<const Block> get(const FileKey &file, uint64_t blockIndex);
+
+  // Caches block and returns it; if another thread has already cached the same
+  // block, then that one is returned instead.
+  std::shared_ptr<const Block> put(const FileKey &file, uint64_t blockIndex,
+                                   std::shared_ptr<const Block> block);
+
+  // Blocks of pinned files are never evicted.
+  void pinFile(const FileKey &file);
+  void unpinFile(const FileKey &file);
+
+  // Drops all blocks of file (e.g. after it was deleted).
+  void invalidateFile(const FileKey &file);
+
+  // Drops everything except pinned files' blocks.
+  void clear();
+
+  Stats getStats();
+
+private:
+  struct Key {
+    FileKey file;
+    uint64_t block;
+
+    bool operator==(const Key &other) const {
+      return block == other.block && file == other.file;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &k) const;
+  };
+
+  struct FileKeyHash {
+    size_t operator()(const FileKey &k) const;
+  };
+
+  struct Entry {
+    Key key;
+    std::shared_ptr<const Block> block;
+    uint8_t freq = 0; // saturates at 3
+    bool inMain = false;
+  };
+
+  using Queue = std::list<Entry>;
+
+  struct Shard {
+    std::mutex mu;
+    uint64_t budget = 0;
+    uint64_t smallBudget = 0;
+    Queue small;
+    Queue main;
+    uint64_t smallBytes = 0;
+    uint64_t mainBytes = 0;
+    std::unordered_map<Key, Queue::iterator, KeyHash> index;
+    std::list<Key> ghost;
+    std::unordered_map<Key, std::list<Key>::iterator, KeyHash> ghostIndex;
+    std::unordered_set<FileKey, FileKeyHash> pinned;
+    Stats stats;
+  };
+
+  const uint64_t budget_;
+  const size_t blockSize_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  // Per-entry bookkeeping cost, added to the size of block data
+  static constexpr uint64_t kEntryOverhead = sizeof(Entry) + sizeof(Key) +
+                                             sizeof(Block) + 8 * sizeof(void *);
+
+  static uint64_t chargeOf(const Entry &e) {
+    return e.block->size + kEntryOverhead;
+  }
+
+  Shard &shardOf(const Key &key) {
+    return *shards_[KeyHash()(key) % shards_.size()];
+  }
+
+  // REQUIRES: shard.mu is held
+  void evictLocked(Shard &shard);
+  void evictFromSmallLocked(Shard &shard);
+  bool evictFromMainLocked(Shard &shard);
+  void rememberGhostLocked(Shard &shard, const Key &key);
+  void eraseLocked(Shard &shard, Queue::iterator it);
+};
+
+} // namespace lucanthrope
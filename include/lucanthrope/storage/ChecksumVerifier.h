@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <memory>  // unique_ptr
+#include <string>
+#include <vector>
+
+namespace lucanthrope {
+
+class Directory;
+class ThreadPool;
+
+// Verifies checksum footers (see IndexOutput::writeChecksumFooter()) of
+// directory files in parallel. Every file is split into chunks of chunkSize
+// bytes, which are checksummed concurrently through slices of one input (so
+// a memory-mapped file is mapped once), and the chunk checksums are combined
+// with CRC32C::combine(). Small files are just one chunk each, so a directory
+// of many files is spread over the threads as well as a single huge file is.
+//
+// Files are read with IOContext::ReadOnce, which keeps them out of block
+// caches. Only footer reads are counted by the directory's I/O stats, since
+// slices don't inherit counters.
+class ChecksumVerifier {
+public:
+  enum class Status {
+    Ok,
+    Corrupted,  // the checksum doesn't match
+    NoChecksum, // the file has no footer, nothing to verify
+    Error,      // the file could not be read
+  };
+
+  struct FileResult {
+    std::string name;
+    Status status = Status::Ok;
+    uint64_t length = 0;
+    uint64_t expected = 0; // stored in the footer
+    uint32_t actual = 0;   // computed
+    // Wall time from the start of the first chunk to the end of the last one
+    double seconds = 0;
+    std::string error; // for Status::Error
+
+    double megabytesPerSecond() const {
+      return seconds > 0 ? static_cast<double>(length) / (1 << 20) / seconds
+                         : 0;
+    }
+  };
+
+  static constexpr uint64_t kDefaultChunkSize = 32 * 1024 * 1024;
+
+  // Zero numThreads means ThreadPool::defaultThreadCount().
+  explicit ChecksumVerifier(size_t numThreads = 0,
+                            uint64_t chunkSize = kDefaultChunkSize);
+  ~ChecksumVerifier();
+
+  ChecksumVerifier(const ChecksumVerifier &) = delete;
+  ChecksumVerifier &operator=(const ChecksumVerifier &) = delete;
+
+  // Verifies fnames of dir; results are in the same order. Problems with
+  // individual files are reported in their results, not thrown.
+  std::vector<FileResult> verify(Directory &dir,
+                                 const std::vector<std::string> &fnames);
+
+  // Verifies every file of dir (see Directory::listAll()).
+  std::vector<FileResult> verify(Directory &dir);
+
+private:
+  const uint64_t chunkSize_;
+  std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace lucanthrope
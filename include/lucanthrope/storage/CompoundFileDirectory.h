@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint> // uint64_t
+#include <memory>  // unique_ptr
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Directory.h"
+
+namespace lucanthrope {
+
+// Read-only directory which serves files packed by CompoundFileWriter. The
+// table of contents is read once, and the data file is opened once, by the
+// constructor; openInput() returns a slice of the data file (see
+// IndexInput::slice()), so opening a packed file allocates no file
+// descriptor, copies nothing, and takes no locks. All methods may be called
+// from different threads concurrently.
+//
+// Methods which would modify the directory throw
+// UnsupportedOperationException.
+class CompoundFileDirectory : public Directory {
+private:
+  struct Entry {
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  std::unordered_map<std::string, Entry> entries_;
+  // Never read directly, only sliced
+  std::unique_ptr<IndexInput> data_;
+
+  [[noreturn]] static void readOnly(const char *where);
+
+public:
+  // Opens compound file name (without extension) stored in dir. dir is used
+  // only by the constructor. Throws IndexCorruptionException if the table of
+  // contents is malformed, or exception in case of I/O error.
+  CompoundFileDirectory(Directory &dir, const std::string &name);
+
+  virtual ~CompoundFileDirectory() override;
+
+  virtual std::vector<std::string> listAll() override;
+
+  virtual void deleteFile(const std::string &fname) override;
+
+  virtual uint64_t fileLength(const std::string &fname) override;
+
+  virtual std::unique_ptr<IndexOutput>
+  createOutput(const std::string &fname,
+               const IOContext &context = IOContext()) override;
+
+  virtual void rename(const std::string &src,
+                      const std::string &target) override;
+
+  virtual void replace(const std::string &src,
+                       const std::string &target) override;
+
+  virtual std::unique_ptr<IndexInput>
+  openInput(const std::string &fname,
+            const IOContext &context = IOContext()) override;
+
+  virtual std::unique_ptr<LockFile>
+  obtainLock(const std::string &fname) override;
+
+  virtual bool fileExists(const std::string &fname) override;
+};
+
+} // namespace lucanthrope
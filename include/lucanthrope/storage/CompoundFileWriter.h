@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint> // uint64_t
+#include <memory>  // unique_ptr
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "IOContext.h"
+
+namespace lucanthrope {
+
+class Directory;
+class IndexOutput;
+
+// Packs a set of files into a single compound file. The compound file
+// consists of two files: name + kDataExtension, which is the concatenation of
+// contents of all packed files, and name + kEntriesExtension, the table of
+// contents:
+//
+//   Int32 kMagic, Varint32 number of files,
+//   then for every file: String name, Varint64 offset, Varint64 length
+//
+// Both files end with a checksum footer (see
+// IndexOutput::writeChecksumFooter()).
+//
+// Compound files are read by CompoundFileDirectory.
+//
+// Typical usage:
+//   CompoundFileWriter writer(dir, "_3");
+//   for (auto &fname : dir.listSegment("_3"))
+//     writer.addFile(dir, fname);
+//   writer.finish();
+class CompoundFileWriter {
+public:
+  static constexpr std::string_view kDataExtension = ".cfs";
+  static constexpr std::string_view kEntriesExtension = ".cfe";
+  static constexpr uint32_t kMagic = 0x31454643; // "CFE1"
+
+  // Creates data file in dir; both files are written with context. Throws
+  // exception if it already exists, or in case of I/O error.
+  CompoundFileWriter(Directory &dir, const std::string &name,
+                     const IOContext &context = IOContext(IOContext::Flush));
+
+  // Deletes both files unless finish() was successful.
+  ~CompoundFileWriter();
+
+  CompoundFileWriter(const CompoundFileWriter &) = delete;
+  CompoundFileWriter &operator=(const CompoundFileWriter &) = delete;
+
+  // Appends file fname of directory src (which may be the same directory
+  // the compound file is written to). Throws exception if a file with the
+  // same name was already added, or in case of I/O error.
+  void addFile(Directory &src, const std::string &fname);
+
+  // Closes the data file and writes the table of contents. Neither file is
+  // synced. Throws exception in case of I/O error.
+  void finish();
+
+private:
+  struct Entry {
+    std::string name;
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  Directory &dir_;
+  const std::string dataName_;
+  const std::string entriesName_;
+  const IOContext context_;
+  std::unique_ptr<IndexOutput> data_;
+  uint64_t dataLength_ = 0;
+  std::vector<Entry> entries_;
+  std::unordered_set<std::string> names_;
+  bool finished_ = false;
+};
+
+} // namespace lucanthrope
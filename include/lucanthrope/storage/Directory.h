@@ -1,15 +1,22 @@
 #pragma once
 
+#include <array>
 #include <cstdint> // uint64_t
-#include <memory>  // unique_ptr
+#include <memory>  // shared_ptr, unique_ptr
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "../IO/IOStats.h"
+#include "IOContext.h"
+
 namespace lucanthrope {
 
 class IndexOutput;
 class IndexInput;
 class LockFile;
+class RateLimiter;
 
 // Directory provides an abstraction layer for storing a list of files. A
 // directory ontains only files (no sub-folder hierarchy).
@@ -42,21 +49,33 @@ public:
   virtual uint64_t fileLength(const std::string &fname) = 0;
 
   // Creates a new, empty file in the directory and returns a pointer to object
-  // for writing data to this file. Throws exception if the file already exists,
-  // or in case of I/O error.
+  // for writing data to this file. context.expectedSize is the number of bytes
+  // the caller expects to write (0 if unknown); it is only a hint, which
+  // implementations may use to decide where or how to store the file.
+  // Throws exception if the file already exists, or in case of I/O error.
   virtual std::unique_ptr<IndexOutput>
-  createOutput(const std::string &fname) = 0;
+  createOutput(const std::string &fname,
+               const IOContext &context = IOContext()) = 0;
 
   // Renames file src to target, where target must not already exist in the
   // directory. Throws exception if the file named target already exists, or in
   // case of I/O error.
   virtual void rename(const std::string &src, const std::string &target) = 0;
 
+  // Renames file src to target, replacing target if it already exists, in one
+  // step: target names either its old contents or those of src, and never
+  // nothing, even after a crash once the directory is synced. Throws exception
+  // if src doesn't exist, if either file is still being written, or in case of
+  // I/O error.
+  virtual void replace(const std::string &src, const std::string &target) = 0;
+
   // Returns a pointer to object for reading an existing file.
   // Note that a file may exist, but be unavailable for reading (because writer
   // didn't finish yet), exception is thrown in such case. Throws exception if
   // fname points to a non-existing file, or in case of I/O error.
-  virtual std::unique_ptr<IndexInput> openInput(const std::string &fname) = 0;
+  virtual std::unique_ptr<IndexInput>
+  openInput(const std::string &fname,
+            const IOContext &context = IOContext()) = 0;
 
   // Acquires and returns a pointer to the lock file for a directory.
   // Used to prevent concurrent write access to the same directory by multiple
@@ -72,11 +91,83 @@ public:
   // Throws exception in case of I/O error.
   virtual bool fileExists(const std::string &fname) = 0;
 
-  // Atomically removes all files that belong to the specified segment without
-  // throwing. This is indended to be used in exception handlers when an
-  // unrecoverable error occurred while writing index files. No-op by deafault.
+  // Returns true if the named file exists and can be opened for reading, i.e.
+  // it is neither still being written nor a lock file. The default returns
+  // fileExists(fname), which suits directories whose files are readable while
+  // they are written (such as FSDirectory).
+  // Throws exception in case of I/O error.
+  virtual bool fileCommitted(const std::string &fname) {
+    return fileExists(fname);
+  }
+
+  // Copies file src of directory from into a new file dest in this directory.
+  // The contents are streamed, i.e. no more than one buffer of each stream is
+  // held in memory. If copying fails, partially written dest is deleted.
+  // Throws exception if src doesn't exist, dest already exists, or in case of
+  // I/O error.
+  virtual void copyFrom(Directory &from, const std::string &src,
+                        const std::string &dest);
+
+  // Makes the named files durable: once this returns, their contents (and
+  // names) survive a crash or a power loss. Implementations may merge
+  // concurrent calls into one group commit. No-op by default, which suits
+  // directories that are not durable anyway.
+  // Throws exception if any of the files doesn't exist, or in case of I/O
+  // error.
+  virtual void sync([[maybe_unused]] const std::vector<std::string> &fnames) {}
+
+  // Returns the name of the segment which file fname belongs to: the part of
+  // the name before the first '.' or '_' which is not its first character
+  // (e.g. "_3" for both "_3.cfs" and "_3_1.del"). A name which contains
+  // neither is a segment name itself.
+  static std::string_view segmentOf(std::string_view fname) {
+    size_t end = fname.find_first_of("._", 1);
+    return fname.substr(0, end);
+  }
+
+  // Returns names of all files that belong to the specified segment (see
+  // segmentOf()). The default implementation filters listAll().
+  // Throws exception in case of I/O error.
+  virtual std::vector<std::string> listSegment(const std::string &segment);
+
+  // Atomically removes all files that belong to the specified segment (see
+  // segmentOf()) without throwing. This is indended to be used in exception
+  // handlers when an unrecoverable error occurred while writing index files.
+  // No-op by deafault.
   virtual void
   deleteSegment([[maybe_unused]] const std::string &segment) noexcept {}
+
+  // Returns I/O counters of all streams which were opened by this directory
+  // with the given context.
+  virtual IOCounters getIOStats(IOContext::Context context);
+
+  // Outputs created with IOContext::Merge afterwards are throttled by
+  // rateLimiter (nullptr disables throttling). The limiter may be shared
+  // between directories, which then share the rate.
+  virtual void setMergeRateLimiter(std::shared_ptr<RateLimiter> rateLimiter);
+
+  std::shared_ptr<RateLimiter> getMergeRateLimiter();
+
+protected:
+  // Attaches a stream created by this directory to I/O counters of context
+  // and, for merge outputs, to the merge rate limiter. Implementations call it
+  // for every stream they return.
+  void track(IndexOutput &output, const IOContext &context);
+  void track(IndexInput &input, const IOContext &context);
+
+private:
+  // Shared with streams, which may outlive the directory
+  std::shared_ptr<std::array<AtomicIOCounters, IOContext::kNumContexts>>
+      ioCounters_ = std::make_shared<
+          std::array<AtomicIOCounters, IOContext::kNumContexts>>();
+  std::mutex rateLimiterMu_;
+  std::shared_ptr<RateLimiter> mergeRateLimiter_;
+
+  std::shared_ptr<AtomicIOCounters> countersOf(IOContext::Context context) {
+    // aliasing constructor: shares ownership of the whole array
+    return std::shared_ptr<AtomicIOCounters>(ioCounters_,
+                                             &(*ioCounters_)[context]);
+  }
 };
 
 } // namespace lucanthrope
\ No newline at end of file
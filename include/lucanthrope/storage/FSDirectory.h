@@ -0,0 +1,144 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint> // uint64_t
+#include <memory>  // unique_ptr
+#include <mutex>
+#include <string>
+#include <utility> // move()
+#include <vector>
+
+#include "BlockCache.h"
+#include "Directory.h"
+
+namespace lucanthrope {
+
+class FSDirectoryLockFile;
+class ThreadPool;
+
+// Directory implementation which stores files in a file system folder. Reads
+// and writes go straight to file descriptors (pread()/pwrite()), so streams
+// opened by FSDirectory never share file offsets and may be used from
+// different threads concurrently (but each stream must be used by one thread
+// at a time).
+//
+// If useMMap is true, then files are mapped into memory by openInput(), and
+// IndexInput buffer is the mapped region itself, i.e. reading involves no
+// copying into intermediate buffers and no system calls.
+//
+// If a BlockCache is installed (setBlockCache()), then inputs which are not
+// memory-mapped read files in cache-sized blocks through the cache. Inputs
+// opened with IOContext::ReadOnce or IOContext::Merge bypass the cache, so
+// that streaming through big files doesn't evict blocks which searches need
+// (memory-mapped ones are advised to be read sequentially instead).
+//
+// sync() is a group commit: while one thread is syncing, files requested by
+// other threads are collected into the next batch, which is then synced by a
+// single one of them. A batch is synced either with parallel fdatasync()
+// calls (kSyncThreads at a time), or, if setUseSyncFS(true) was called on
+// Linux, with a single syncfs() of the whole file system, which pays off when
+// a batch holds many files and the file system isn't shared with other busy
+// writers. The directory itself is fsync()'ed after every batch, which makes
+// new and renamed files durable.
+//
+// Only POSIX systems are supported for now.
+class FSDirectory : public Directory {
+  friend FSDirectoryLockFile;
+
+private:
+  const std::string path_;
+  bool useMMap_;
+  std::shared_ptr<BlockCache> cache_;
+
+  // Group commit state, guarded by syncMu_
+  struct SyncBatch;
+  std::mutex syncMu_;
+  std::condition_variable syncCv_;
+  bool syncing_ = false;
+  // Requests which arrive while a batch is being synced
+  std::shared_ptr<SyncBatch> nextBatch_;
+  // Used only by the leader of a batch, of which there is one at a time
+  std::unique_ptr<ThreadPool> syncPool_;
+  bool useSyncFS_ = false;
+
+  // Syncs files of a batch and the directory, by syncfs() if viaSyncFS;
+  // called by the leader without syncMu_.
+  void syncBatch(const SyncBatch &batch, bool viaSyncFS);
+
+  // Returns full path for a file in this directory.
+  std::string pathOf(const std::string &fname) const;
+
+  // Returns the key which identifies the current version of the file in the
+  // block cache.
+  BlockCache::FileKey fileKeyOf(const std::string &fname) const;
+
+  // Removes lock file from directory.
+  // This is called by FSDirectoryLockFile's destructor.
+  void releaseLock(const std::string &fname) noexcept;
+
+public:
+  // Opens the directory at path, creating it (and its parents) if it does not
+  // exist. Throws exception in case of I/O error.
+  explicit FSDirectory(const std::string &path, bool useMMap = false);
+
+  virtual ~FSDirectory() override;
+
+  // Number of concurrent fdatasync() calls made by sync().
+  static constexpr size_t kSyncThreads = 4;
+
+  const std::string &getPath() const { return path_; }
+
+  bool getUseMMap() const { return useMMap_; }
+
+  // Affects only inputs opened after the call.
+  void setUseMMap(bool useMMap) { useMMap_ = useMMap; }
+
+  // Installs block cache (nullptr removes it); the same cache may be shared by
+  // several directories. Affects only inputs opened after the call.
+  void setBlockCache(std::shared_ptr<BlockCache> cache) {
+    cache_ = std::move(cache);
+  }
+
+  const std::shared_ptr<BlockCache> &getBlockCache() const { return cache_; }
+
+  // Whether sync() uses syncfs() (only supported on Linux, ignored
+  // elsewhere).
+  void setUseSyncFS(bool useSyncFS);
+
+  // Blocks of a pinned file are never evicted from the block cache. Throws
+  // exception if there is no block cache, if fname doesn't exist, or in case
+  // of I/O error.
+  void pinFile(const std::string &fname);
+  void unpinFile(const std::string &fname);
+
+  virtual std::vector<std::string> listAll() override;
+
+  virtual void deleteFile(const std::string &fname) override;
+
+  virtual uint64_t fileLength(const std::string &fname) override;
+
+  virtual std::unique_ptr<IndexOutput>
+  createOutput(const std::string &fname,
+               const IOContext &context = IOContext()) override;
+
+  virtual void rename(const std::string &src,
+                      const std::string &target) override;
+
+  virtual void replace(const std::string &src,
+                       const std::string &target) override;
+
+  virtual std::unique_ptr<IndexInput>
+  openInput(const std::string &fname,
+            const IOContext &context = IOContext()) override;
+
+  virtual std::unique_ptr<LockFile>
+  obtainLock(const std::string &fname) override;
+
+  virtual bool fileExists(const std::string &fname) override;
+
+  virtual void deleteSegment(const std::string &segment) noexcept override;
+
+  virtual void sync(const std::vector<std::string> &fnames) override;
+};
+
+} // namespace lucanthrope
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+
+namespace lucanthrope {
+
+// Describes what a stream is opened for. Directories account I/O separately
+// for every context (see Directory::getIOStats()), throttle outputs of merges
+// (see Directory::setMergeRateLimiter()), and may use the context as a hint of
+// how to store or read a file.
+struct IOContext {
+  enum Context {
+    Default,
+    // writing a freshly indexed segment
+    Flush,
+    // reading and writing files of segments which are being merged
+    Merge,
+    // serving queries
+    Search,
+    // the file is going to be read sequentially, exactly once (e.g. when it is
+    // copied); caches are not populated with it
+    ReadOnce,
+  };
+  static constexpr size_t kNumContexts = 5;
+
+  Context context = Default;
+  // Number of bytes the caller expects to write (0 if unknown); only
+  // meaningful for outputs
+  uint64_t expectedSize = 0;
+
+  IOContext() = default;
+  IOContext(Context c, uint64_t expected = 0)
+      : context(c), expectedSize(expected) {}
+};
+
+} // namespace lucanthrope
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <map>
+#include <memory> // shared_ptr, unique_ptr
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Directory.h"
+
+namespace lucanthrope {
+
+class FileDescriptor;
+class LogIndexOutput;
+class LogIndexInput;
+class LogStructuredDirectoryLockFile;
+
+// Directory implementation which stores the bytes of all its files in a few
+// large append-only log files in a file system folder. Creating a file costs
+// no file system metadata operations, and syncing any number of small files
+// costs one fdatasync() per log they were appended to plus one manifest
+// write, which is what makes this directory pay off for workloads that create
+// and delete lots of small, short-lived files.
+//
+// Layout of the folder:
+// - "log.<N>" files hold file contents. Outputs buffer their writes and
+// append whole buffers to the active log (concurrent outputs reserve disjoint
+// ranges under a mutex and write them outside of it), so a file is a list of
+// extents (log, offset, length). Once the active log grows past maxLogSize,
+// a new one is started.
+// - "MANIFEST" maps file names to extents. It is rewritten (through a
+// temporary file and rename()) by sync(), compact() and the destructor; only
+// files listed in it survive a reopen. It ends with a checksum footer, which
+// is verified on open. Logs which are not referenced by the manifest are
+// deleted on open.
+//
+// Deleting a file only drops its extents from the map. compact() reclaims
+// the space: live extents of every log which is mostly garbage are copied to
+// the active log, the manifest is rewritten, and then the log is deleted.
+// With backgroundCompaction, a thread calls compact() every
+// kCompactionIntervalMillis, and sooner when deletions produce a lot of garbage.
+// Inputs hold the descriptors of the logs they read, so compaction never
+// breaks them.
+//
+// Outputs do not support seeking backwards. Deletions and renames become
+// durable with the next manifest write. Locks are held in memory, i.e. they
+// only exclude users of this object. Only POSIX systems are supported.
+class LogStructuredDirectory : public Directory {
+  friend LogIndexOutput;
+  friend LogIndexInput;
+  friend LogStructuredDirectoryLockFile;
+
+private:
+  struct Extent {
+    uint64_t log = 0;
+    uint64_t offset = 0; // in the log
+    uint64_t length = 0;
+    // Keeps the log open for readers, even after it's compacted away
+    std::shared_ptr<const FileDescriptor> fd;
+  };
+
+  // Committed files are immutable, so readers share them without locking.
+  struct FileInfo {
+    uint64_t length = 0;
+    std::vector<Extent> extents;
+  };
+
+  struct Log {
+    std::shared_ptr<const FileDescriptor> fd;
+    uint64_t size = 0;      // bytes reserved so far
+    uint64_t liveBytes = 0; // bytes of extents which somebody may still use
+    bool dirty = false;     // written to since the last fdatasync()
+  };
+
+  const std::string path_;
+  const uint64_t maxLogSize_;
+
+  // Guards everything below
+  std::mutex mu_;
+  // nullptr stands for a file which is still being written
+  std::unordered_map<std::string, std::shared_ptr<const FileInfo>> files_;
+  std::unordered_set<std::string> locks_;
+  std::map<uint64_t, Log> logs_;
+  uint64_t activeLog_ = 0;
+  uint64_t nextLog_ = 0;
+  // Incremented by every change of files_ which the manifest must reflect
+  uint64_t version_ = 0;
+  // Bytes of deleted extents since the last compaction
+  uint64_t garbageBytes_ = 0;
+
+  // Serializes manifest writes
+  std::mutex manifestMu_;
+  // version_ which the manifest on disk reflects, guarded by manifestMu_
+  uint64_t manifestVersion_ = 0;
+  // Serializes compactions
+  std::mutex compactMu_;
+
+  // Background compaction
+  std::thread bgThread_;
+  std::mutex bgMu_;
+  std::condition_variable bgCv_;
+  bool bgStop_ = false;
+  bool bgWakeUp_ = false;
+
+  // Returns full path of a file in the folder at dir.
+  static std::string pathIn(const std::string &dir, const std::string &fname);
+  static std::string logPathIn(const std::string &dir, uint64_t log);
+  std::string logPath(uint64_t log) const { return logPathIn(path_, log); }
+
+  // Reads the manifest, opens the logs it references and deletes the rest.
+  void recover();
+
+  // Starts a new active log.
+  // REQUIRES: mu_ is held
+  void rollLocked();
+
+  // Appends size bytes to the active log and returns where they went. The
+  // bytes are counted as live until releaseLocked() is called.
+  Extent append(const char *data, size_t size);
+
+  // Turns bytes of extent into garbage (it is no longer referenced).
+  // REQUIRES: mu_ is held
+  void releaseLocked(const Extent &extent);
+
+  // Called by LogIndexOutput's destructor.
+  void commit(const std::string &fname, std::shared_ptr<const FileInfo> info);
+
+  // Called by LogIndexOutput's destructor instead of commit() if the file
+  // couldn't be written completely: releases its extents and its name.
+  void abandon(const std::string &fname, const FileInfo &info);
+
+  // Makes the current map of committed files durable: syncs the logs which
+  // were appended to, then replaces the manifest. No-op if the map didn't
+  // change since the last write, so concurrent callers share one write.
+  void writeManifest();
+
+  // Copies extents of committed files which lie in victims to the active
+  // log. Files which are renamed or deleted meanwhile are left alone.
+  void moveFilesOut(const std::unordered_set<uint64_t> &victims);
+
+  void backgroundLoop();
+
+  // Called by LogStructuredDirectoryLockFile's destructor.
+  void releaseLock(const std::string &fname) noexcept;
+
+public:
+  static constexpr uint64_t kDefaultMaxLogSize = 64 * 1024 * 1024;
+  // compact() rewrites logs whose share of garbage is at least this
+  static constexpr double kCompactionGarbageRatio = 0.5;
+  static constexpr int kCompactionIntervalMillis = 1000;
+
+  // Opens the directory at path, creating it (and its parents) if it does not
+  // exist, and recovers the files listed in its manifest.
+  // Throws exception in case of I/O error or corrupted manifest.
+  explicit LogStructuredDirectory(const std::string &path,
+                                  uint64_t maxLogSize = kDefaultMaxLogSize,
+                                  bool backgroundCompaction = false);
+
+  // Stops background compaction and writes the manifest (errors are only
+  // reported to stderr). All streams must be closed by now.
+  virtual ~LogStructuredDirectory() override;
+
+  const std::string &getPath() const { return path_; }
+
+  // Reclaims space of deleted files (see the class comment) and returns the
+  // number of bytes of logs which were deleted.
+  // Throws exception in case of I/O error.
+  uint64_t compact();
+
+  // Total size of all logs, and the part of it which live files occupy.
+  uint64_t logBytes();
+  uint64_t liveBytes();
+
+  virtual std::vector<std::string> listAll() override;
+
+  virtual void deleteFile(const std::string &fname) override;
+
+  virtual uint64_t fileLength(const std::string &fname) override;
+
+  virtual std::unique_ptr<IndexOutput>
+  createOutput(const std::string &fname,
+               const IOContext &context = IOContext()) override;
+
+  virtual void rename(const std::string &src,
+                      const std::string &target) override;
+
+  virtual void replace(const std::string &src,
+                       const std::string &target) override;
+
+  virtual std::unique_ptr<IndexInput>
+  openInput(const std::string &fname,
+            const IOContext &context = IOContext()) override;
+
+  virtual std::unique_ptr<LockFile>
+  obtainLock(const std::string &fname) override;
+
+  virtual bool fileExists(const std::string &fname) override;
+
+  virtual bool fileCommitted(const std::string &fname) override;
+
+  virtual void deleteSegment(const std::string &segment) noexcept override;
+
+  // Writes the manifest (see writeManifest()); all fnames must be committed.
+  virtual void sync(const std::vector<std::string> &fnames) override;
+};
+
+} // namespace lucanthrope
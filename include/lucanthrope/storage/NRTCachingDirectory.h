@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint> // uint64_t
+#include <memory>  // unique_ptr
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Directory.h"
+#include "RAMDirectory.h"
+
+namespace lucanthrope {
+
+// Wrapper around another (typically on-disk) directory, which keeps small
+// freshly created files in RAM. This is intended for near-real-time indexing,
+// where segments are flushed frequently and are small: writing them to
+// RAMDirectory saves the file system round-trip and the fsync, and they can be
+// moved to the delegate later, in bulk.
+//
+// createOutput() puts a file into the cache if its expected size is at most
+// maxFileSize, and the cache would not grow beyond maxCachedBytes because of
+// it; otherwise the file is created in the delegate. A file of unknown
+// expected size (0) is considered small. Cached files are moved to the
+// delegate by sync(), by unCache(), when the directory is destroyed and, if
+// background uncaching is enabled, by a background thread once the cache is
+// more than half full.
+//
+// All other operations look into the cache first, then into the delegate.
+// Lock files are always created in the delegate.
+class NRTCachingDirectory : public Directory {
+private:
+  Directory &delegate_;
+  RAMDirectory cache_;
+  const uint64_t maxFileSize_;
+  const uint64_t maxCachedBytes_;
+
+  // Serializes moving files out of the cache with deleteFile(), rename() and
+  // replace(), so that a file which is being deleted or renamed doesn't get
+  // resurrected in the delegate under its old name.
+  std::mutex uncacheMu_;
+
+  // Background uncaching
+  std::mutex bgMu_;
+  std::condition_variable bgCv_;
+  bool bgWakeUp_ = false;
+  bool bgStop_ = false;
+  std::thread bgThread_;
+
+  // Moves fname from the cache to the delegate; the caller is responsible for
+  // syncing it. Returns false if the file is not in the cache, or if it is
+  // still being written.
+  // REQUIRES: uncacheMu_ is held
+  bool unCacheLocked(const std::string &fname);
+
+  // Moves all committed files to the delegate and makes them durable.
+  void unCacheAll();
+
+  void backgroundLoop();
+
+public:
+  // delegate is not owned, and must outlive this directory.
+  NRTCachingDirectory(Directory &delegate, uint64_t maxFileSize,
+                      uint64_t maxCachedBytes, bool backgroundUncache = false);
+
+  // Moves all cached files to the delegate.
+  // REQUIRES: no one is holding a file for reading or writing
+  virtual ~NRTCachingDirectory() override;
+
+  Directory &getDelegate() { return delegate_; }
+
+  // Number of bytes held by the cache.
+  uint64_t ramBytesUsed() { return cache_.ramBytesUsed(); }
+
+  // Returns names of files which are currently held in RAM.
+  std::vector<std::string> listCachedFiles() { return cache_.listAll(); }
+
+  // Moves fname from the cache to the delegate and makes it durable there.
+  // Returns false if fname is not cached (or is still being written).
+  bool unCache(const std::string &fname);
+
+  // Makes the named files durable: cached files are moved to the delegate,
+  // then all of them are synced there with a single Directory::sync() call.
+  // Files which are still being written are skipped. Throws exception in case
+  // of I/O error.
+  virtual void sync(const std::vector<std::string> &fnames) override;
+
+  virtual std::vector<std::string> listAll() override;
+
+  virtual void deleteFile(const std::string &fname) override;
+
+  virtual uint64_t fileLength(const std::string &fname) override;
+
+  virtual std::unique_ptr<IndexOutput>
+  createOutput(const std::string &fname,
+               const IOContext &context = IOContext()) override;
+
+  virtual void rename(const std::string &src,
+                      const std::string &target) override;
+
+  virtual void replace(const std::string &src,
+                       const std::string &target) override;
+
+  virtual std::unique_ptr<IndexInput>
+  openInput(const std::string &fname,
+            const IOContext &context = IOContext()) override;
+
+  virtual std::unique_ptr<LockFile>
+  obtainLock(const std::string &fname) override;
+
+  virtual bool fileExists(const std::string &fname) override;
+
+  virtual bool fileCommitted(const std::string &fname) override;
+
+  // Sums the counters of the cache and the delegate, which open all streams.
+  virtual IOCounters getIOStats(IOContext::Context context) override;
+
+  // Installs the limiter in the delegate; merge outputs which are cached in
+  // RAM are not throttled.
+  virtual void
+  setMergeRateLimiter(std::shared_ptr<RateLimiter> rateLimiter) override;
+
+  virtual void deleteSegment(const std::string &segment) noexcept override;
+};
+
+} // namespace lucanthrope
@@ -1,13 +1,17 @@
 #pragma once
 
 #include <algorithm> // min()
+#include <atomic>
 #include <cassert>
+#include <cstddef> // size_t
 #include <cstdint> // uint64_t
 #include <cstring> // memcpy()
 #include <memory>  // unique_ptr
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility> // pair
 
 #include "Directory.h"
 
@@ -41,11 +45,20 @@ private:
   // there are no readers. If RAMFile object was removed from directory via
   // deleteFile(), but there is at least one reader, then RAMFile object's
   // deallocation will be triggered by the last reader that will close its
-  // stream. All changes to ref count are synchronized with each other by
-  // RAMDirectory's mutex.
+  // stream. Committed RAMFile objects are immutable, so several directories
+  // may share one (see snapshot()); each of them holds its own reference.
+  // That's why ref count is atomic rather than guarded by a directory's mutex,
+  // and why readers don't need the directory they came from.
   // To conclude, if pointers to IndexOutput and IndexInput are properly
   // managed, then it looks like RAMFile objects are thread-safe,
   // exception-safe, and memory-safe
+  //
+  // Every byte that RAMFile object allocates (the object itself, its name,
+  // blocks and block table) is charged to the parent's blockBytes_ counter,
+  // and is returned back only when RAMFile object is deallocated. That is, a
+  // file which was deleted but is still open for reading keeps being counted by
+  // ramBytesUsed() until its last reader is closed. The counter is shared with
+  // the file, so that it can outlive its parent.
   struct RAMFile {
     static constexpr int kBlockSize = 4096;
     // File state
@@ -56,18 +69,25 @@ private:
     // Reference count is managed by RAMDirectory once RAMFile object is
     // commited to directory, which always happens even when exception were
     // thrown.
-    mutable int refs_ = 0;
+    mutable std::atomic<int> refs_{0};
     uint64_t lastModified = 0;
+    // Number of bytes charged to account by this file
+    uint64_t charged = 0;
 
-    // These are used by for parent.commit(name), parent.unrefReader()
+    // These are used by for parent.commit(name); parent is only valid while
+    // the file is being written
     const std::string name;
-    RAMDirectory *parent;
+    RAMDirectory *parent = nullptr;
+    // parent's blockBytes_
+    std::shared_ptr<std::atomic<uint64_t>> account;
 
     // This is only called to "initialize" RAMDirectory::dummy_file
     RAMFile() {}
 
-    RAMFile(RAMDirectory *d, const std::string &fname) noexcept
-        : name(fname), parent(d) {}
+    RAMFile(RAMDirectory *d, const std::string &fname)
+        : name(fname), parent(d), account(d->blockBytes_) {
+      charge(sizeof(RAMFile) + heapBytes(name));
+    }
 
     RAMFile(const RAMFile &) = delete;
     RAMFile &operator=(const RAMFile &) = delete;
@@ -76,23 +96,103 @@ private:
       assert(refs_ == 0 && "Reference count is not zero");
       for (char *block : blocks_)
         delete[] block;
+      if (account)
+        *account -= charged;
     }
 
     void alloc() {
       char *result = new char[kBlockSize];
-      blocks_.push_back(result);
+      size_t capacity = blocks_.capacity();
+      try {
+        blocks_.push_back(result);
+      } catch (...) {
+        delete[] result;
+        throw;
+      }
+      charge(kBlockSize + (blocks_.capacity() - capacity) * sizeof(char *));
+    }
+
+    void charge(uint64_t bytes) {
+      charged += bytes;
+      *account += bytes;
     }
 
     uint64_t size() const { return length; }
 
     void finish_writing() { parent->commit(name, this); }
-    void finish_reading() const { parent->unrefReader(this); }
+    // Drops a reference held by a reader or a directory, deallocates the file
+    // when it was the last one.
+    void unref() const noexcept {
+      if (refs_.fetch_sub(1) == 1)
+        delete this;
+    }
+
+    void finish_reading() const { unref(); }
   };
 
   // all uncomitted/lock files point to this file
   static const RAMFile dummy_file;
   std::mutex mu_;
   std::unordered_map<std::string, RAMFile *> files;
+  using FileEntry = std::unordered_map<std::string, RAMFile *>::value_type;
+
+  // Secondary index of files map: segment name (see Directory::segmentOf()) ->
+  // entries of files map which belong to the segment. Entries of unordered_map
+  // never move, even when it is rehashed, so pointers to them stay valid until
+  // they are erased.
+  std::unordered_map<std::string, std::unordered_set<FileEntry *>> segments_;
+
+  // Memory accounting. blockBytes_ is updated by RAMFile objects without
+  // holding mu_ (writers allocate blocks concurrently), everything else is
+  // guarded by mu_.
+  std::shared_ptr<std::atomic<uint64_t>> blockBytes_ =
+      std::make_shared<std::atomic<uint64_t>>(0);
+  // Sum of RAMFile::charged of files in files map which are charged to other
+  // directories' blockBytes_ (i.e. were obtained via snapshot())
+  uint64_t sharedBytes_ = 0;
+  // Sum of heapBytes() of all keys in files map and segments_
+  uint64_t keyBytes_ = 0;
+  // Sum of kSegmentEntryBytes and the bucket arrays of entries of segments_,
+  // so that ramBytesUsed() doesn't have to visit every segment
+  uint64_t segmentBytes_ = 0;
+  // 0 means "no budget"
+  uint64_t ramBudget_ = 0;
+  // Not owned; may be nullptr
+  Directory *fallback_ = nullptr;
+
+  // Approximate per-entry cost of files map: the node holding the pair, plus
+  // the "next" pointer and the cached hash code (libstdc++, libc++ and MSVC
+  // are all close to this).
+  static constexpr uint64_t kFileTableEntryBytes =
+      sizeof(std::pair<const std::string, RAMFile *>) + 2 * sizeof(void *);
+  // Same for segments_: an entry of a set of segment's files, and an entry of
+  // segments_ itself
+  static constexpr uint64_t kSegmentFileEntryBytes = 3 * sizeof(void *);
+  static constexpr uint64_t kSegmentEntryBytes =
+      sizeof(std::pair<const std::string, std::unordered_set<FileEntry *>>) +
+      2 * sizeof(void *);
+
+  // Number of bytes allocated on the heap by s (zero for strings which fit
+  // into small string buffer).
+  static uint64_t heapBytes(const std::string &s) {
+    const char *obj = reinterpret_cast<const char *>(&s);
+    if (s.data() >= obj && s.data() < obj + sizeof(s))
+      return 0;
+    return s.capacity() + 1;
+  }
+
+  // Inserts fname into files map and segments_, updates keyBytes_ and
+  // segmentBytes_. Strong exception guarantee.
+  // REQUIRES: mu_ is held, fname is not in files map
+  void insertLocked(const std::string &fname, RAMFile *file);
+
+  // Erases it from files map and segments_, updates keyBytes_ and
+  // segmentBytes_.
+  // REQUIRES: mu_ is held
+  void eraseLocked(std::unordered_map<std::string, RAMFile *>::iterator it);
+
+  // REQUIRES: mu_ is held
+  uint64_t ramBytesUsedLocked() const;
 
   // Private member functions that are called only by RAMFile and RAMDirectoryLockFile:
 
@@ -102,21 +202,74 @@ private:
   // in turn called by RAMFileIndexOutput's destructor.
   void commit(const std::string &fname, RAMFile *file) noexcept;
 
-  // Decrements file's reference count. If file's reference count becomes zero,
-  // it gets deallocated. This is called by RAMFile's finish_reading(), which is
-  // in turn called by RAMFileIndexInput's destructor.
-  void unrefReader(const RAMFile *file) noexcept;
-
   // Removes lock file from directory.
-  // This is called by RAMDirectoryLockFile's destructor.
+  // This is called by RAMDirectoryLockFile's destructor, and by createOutput()
+  // and rename() to release a name they reserved.
   void releaseLock(const std::string &fname) noexcept;
 
 public:
   RAMDirectory() = default;
 
-  // REQUIRES: no one is holding a file for reading or writing
+  // Constructs a directory with the given RAM budget, see setRAMBudget().
+  explicit RAMDirectory(uint64_t ramBudget, Directory *fallback = nullptr)
+      : ramBudget_(ramBudget), fallback_(fallback) {}
+
+  // Files which are open for reading stay readable after the directory is
+  // destroyed.
+  // REQUIRES: no one is holding a file for writing, or a lock
   virtual ~RAMDirectory() override;
 
+  // Returns a new directory which holds every file committed to this one at
+  // the moment of the call. File contents are shared, not copied: the cost is
+  // proportional to the number of files, and each directory only takes a
+  // reference to every file. Files created, deleted or renamed afterwards in
+  // either directory are not visible to the other one. Files which are being
+  // written, lock files and files spilled to fallback directory are not
+  // included, and the snapshot has no RAM budget.
+  std::unique_ptr<RAMDirectory> snapshot();
+
+  // Returns the number of bytes currently held by this directory: file
+  // blocks, per-file bookkeeping, the file table, and files which were deleted
+  // but are still open for reading. Files shared with other directories via
+  // snapshot() are counted by every directory that holds them. Bytes held by
+  // fallback directory are not included.
+  uint64_t ramBytesUsed();
+
+  // Sets RAM budget (0 disables it). Once ramBytesUsed() plus expected size of
+  // a new file reaches the budget, createOutput() either creates the file in
+  // fallback directory (if it is not nullptr), or throws
+  // RAMBudgetExceededException. The budget is checked only when a file is
+  // created, so files which are already open for writing may grow past it.
+  // Fallback is not owned by RAMDirectory and must outlive it. Files spilled
+  // to fallback are visible through this directory just like its own files;
+  // however, rename() and replace() do not move files between the two.
+  void setRAMBudget(uint64_t ramBudget, Directory *fallback = nullptr);
+
+  uint64_t getRAMBudget();
+
+  // Copies every file of src into this directory using numThreads threads
+  // (zero means ThreadPool::defaultThreadCount()). Large files are split into
+  // chunks which are loaded in parallel, and every chunk is read straight into
+  // RAMFile blocks; use FSDirectory with useMMap = true to avoid any other
+  // copying. Files become visible only after all of them are loaded. RAM
+  // budget is honored: files which don't fit are copied to fallback directory
+  // if there is one, otherwise RAMBudgetExceededException is thrown before
+  // anything is loaded. Throws FileAlreadyExistsException if any of src's
+  // files already exists in this directory, or in case of I/O error; nothing
+  // is loaded in such case, and files already copied to fallback directory
+  // are deleted from it.
+  void loadFrom(Directory &src, size_t numThreads = 0);
+
+  // Copies every committed file of this directory (including files spilled to
+  // fallback directory) into dst using numThreads threads (zero means
+  // ThreadPool::defaultThreadCount()), and syncs them with a single
+  // dst.sync() call. Contents of each file are written block by block
+  // straight from RAMFile blocks. Files are pinned for the duration of the
+  // call, so they may be concurrently deleted. Throws
+  // exception if any of the files already exists in dst, or in case of I/O
+  // error.
+  void persistTo(Directory &dst, size_t numThreads = 0);
+
   virtual std::vector<std::string> listAll() override;
 
   virtual void deleteFile(const std::string &fname) override;
@@ -124,20 +277,43 @@ public:
   virtual uint64_t fileLength(const std::string &fname) override;
 
   virtual std::unique_ptr<IndexOutput>
-  createOutput(const std::string &fname) override;
+  createOutput(const std::string &fname,
+               const IOContext &context = IOContext()) override;
 
   virtual void rename(const std::string &src,
                       const std::string &target) override;
 
+  virtual void replace(const std::string &src,
+                       const std::string &target) override;
+
   virtual std::unique_ptr<IndexInput>
-  openInput(const std::string &fname) override;
+  openInput(const std::string &fname,
+            const IOContext &context = IOContext()) override;
 
   virtual std::unique_ptr<LockFile>
   obtainLock(const std::string &fname) override;
 
   virtual bool fileExists(const std::string &fname) override;
 
+  // Files which are not held in RAM are looked up in fallback directory.
+  virtual bool fileCommitted(const std::string &fname) override;
+
+  // Costs time proportional to the number of files in the segment. Files are
+  // deallocated after the mutex is released.
+  virtual std::vector<std::string>
+  listSegment(const std::string &segment) override;
+
+  // Costs time proportional to the number of files in the segment. Files which
+  // are still being written are skipped (they are removed by their writers'
+  // exception handlers). Deleted files are deallocated after the mutex is
+  // released, unless they are open for reading.
   virtual void deleteSegment(const std::string &segment) noexcept override;
+
+  // Files held in RAM can't be made durable, so only files spilled to
+  // fallback directory are synced (with a single fallback->sync() call).
+  // Throws exception if any of the files doesn't exist, or in case of I/O
+  // error.
+  virtual void sync(const std::vector<std::string> &fnames) override;
 };
 
 } // namespace lucanthrope
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <memory>  // unique_ptr
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lucanthrope {
+
+class Directory;
+
+// Where Replicator gets files from. Implementations must allow readChunk()
+// to be called from several threads concurrently.
+class ReplicationTransport {
+public:
+  struct FileInfo {
+    std::string name;
+    uint64_t length = 0;
+    // The value stored in the file's checksum footer, if it has one (see
+    // IndexOutput::writeChecksumFooter())
+    bool hasChecksum = false;
+    uint64_t checksum = 0;
+    // False for a file which can't be read yet (it's still being written, or
+    // is a lock file); only its name is known
+    bool committed = true;
+  };
+
+  virtual ~ReplicationTransport() = default;
+
+  // Returns the files of the primary, including files which can't be read
+  // yet (see FileInfo::committed). Throws exception in case of I/O error; a
+  // file which can't be read for any other reason is an error, not a missing
+  // file.
+  virtual std::vector<FileInfo> listFiles() = 0;
+
+  // Reads bytes [offset, offset + length) of fname into out. Throws exception
+  // if the range is out of the file's bounds, or in case of I/O error.
+  virtual void readChunk(const std::string &fname, uint64_t offset,
+                         uint64_t length, char *out) = 0;
+};
+
+// Serves a primary Directory of the same process directly.
+class DirectoryTransport : public ReplicationTransport {
+private:
+  Directory &dir_;
+
+public:
+  explicit DirectoryTransport(Directory &primary) : dir_(primary) {}
+
+  virtual std::vector<FileInfo> listFiles() override;
+
+  virtual void readChunk(const std::string &fname, uint64_t offset,
+                         uint64_t length, char *out) override;
+};
+
+// Stand-in for a network transport: requests and responses are serialized
+// over Unix domain socket pairs, served by threads which read the primary
+// through a DirectoryTransport. Every connection serves one request at a
+// time, so up to numConnections chunks are transferred concurrently.
+// Primary's errors are rethrown on the client side with the same code. A
+// connection which breaks is closed, and reopened by the next request which
+// gets it.
+class LocalSocketTransport : public ReplicationTransport {
+public:
+  explicit LocalSocketTransport(Directory &primary, size_t numConnections = 4);
+
+  // Closes the connections and waits for the serving threads.
+  virtual ~LocalSocketTransport() override;
+
+  LocalSocketTransport(const LocalSocketTransport &) = delete;
+  LocalSocketTransport &operator=(const LocalSocketTransport &) = delete;
+
+  virtual std::vector<FileInfo> listFiles() override;
+
+  virtual void readChunk(const std::string &fname, uint64_t offset,
+                         uint64_t length, char *out) override;
+
+private:
+  struct Connection;
+
+  DirectoryTransport server_;
+  std::vector<std::unique_ptr<Connection>> connections_;
+
+  // Connections which nobody uses right now
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::vector<Connection *> idle_;
+
+  // Stops serving threads; called with no requests in flight.
+  void closeAll();
+
+  // Opens a socket pair for connection, and starts its serving thread.
+  void connect(Connection &connection);
+  // Closes the socket pair of connection, and waits for its serving thread.
+  void disconnect(Connection &connection);
+
+  Connection *acquire();
+  void release(Connection *connection);
+
+  // Sends request, and returns the payload of a successful response.
+  std::string call(const std::string &request, char *out, uint64_t outLength);
+};
+
+} // namespace lucanthrope
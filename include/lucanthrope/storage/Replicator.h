@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <functional>
+#include <memory> // unique_ptr
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "ReplicationTransport.h"
+
+namespace lucanthrope {
+
+class Directory;
+class ThreadPool;
+
+// Copies files of a primary directory (reached through a ReplicationTransport)
+// into a replica Directory, so that replicas don't have to re-index.
+//
+// Index files are write-once, so a replica file is considered up to date if
+// it has the same name, length and footer checksum (when the primary file has
+// one) as the primary file. Everything else is copied in chunks of
+// chunkSize bytes: up to 2 * numThreads chunks are fetched concurrently,
+// while the calling thread writes them to their outputs in order. Each file
+// is written under a temporary name (name + kTempSuffix, which keeps the
+// file in its segment), and copies of files with checksums are verified as
+// they arrive.
+//
+// Once everything is copied and synced, the files are renamed into place (see
+// Directory::replace()), the commit file (e.g. "segments_N") last: readers
+// which open an index through its commit file see either the old or the new
+// file set, never a mix, and a crash leaves one of the two.
+// Finally, files which the previous replicate() installed and the primary no
+// longer has are deleted from the replica. Files which the primary is still
+// writing are neither copied nor deleted; if listing the primary's files
+// fails, nothing is deleted.
+class Replicator {
+public:
+  struct Stats {
+    size_t filesCopied = 0;
+    size_t filesUpToDate = 0;
+    size_t filesDeleted = 0;
+    uint64_t bytesCopied = 0;
+  };
+
+  static constexpr std::string_view kTempSuffix = ".replicating";
+  static constexpr uint64_t kDefaultChunkSize = 1024 * 1024;
+
+  // Zero numThreads means ThreadPool::defaultThreadCount().
+  Replicator(ReplicationTransport &source, Directory &replica,
+             size_t numThreads = 0, uint64_t chunkSize = kDefaultChunkSize);
+  ~Replicator();
+
+  Replicator(const Replicator &) = delete;
+  Replicator &operator=(const Replicator &) = delete;
+
+  // Only primary files for which filter returns true are replicated. By
+  // default, lock files ("*.lock") are skipped.
+  void setFilter(std::function<bool(const std::string &)> filter);
+
+  // Brings the replica up to date with the primary's current files (see the
+  // class comment); commitFile, if not empty, is renamed into place last.
+  // If copying fails, temporary files are deleted and the replica keeps its
+  // old file set. Throws exception in case of I/O error, or if a copy
+  // doesn't match its checksum.
+  Stats replicate(const std::string &commitFile = std::string());
+
+private:
+  ReplicationTransport &source_;
+  Directory &replica_;
+  const uint64_t chunkSize_;
+  std::unique_ptr<ThreadPool> pool_;
+  std::function<bool(const std::string &)> filter_;
+  // Files which the last replicate() installed
+  std::unordered_set<std::string> installed_;
+
+  // Returns true if fname of the replica matches info.
+  bool upToDate(const ReplicationTransport::FileInfo &info);
+
+  // Copies files to their temporary names.
+  void copy(const std::vector<ReplicationTransport::FileInfo> &files,
+            Stats &stats);
+};
+
+} // namespace lucanthrope
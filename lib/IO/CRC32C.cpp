@@ -0,0 +1,131 @@
+#include <cstring> // memcpy()
+
+#include "IO/CRC32C.h"
+
+namespace lucanthrope {
+
+// Reflected Castagnoli polynomial
+static constexpr uint32_t kPoly = 0x82f63b78;
+
+namespace {
+
+struct Tables {
+  uint32_t t[8][256];
+
+  Tables() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? (c >> 1) ^ kPoly : c >> 1;
+      t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++)
+      for (int k = 1; k < 8; k++)
+        t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+  }
+};
+
+} // namespace
+
+static const Tables &tables() {
+  static const Tables instance;
+  return instance;
+}
+
+static inline uint64_t loadLE64(const unsigned char *p) {
+  uint64_t ret = 0;
+  for (int i = 7; i >= 0; i--)
+    ret = (ret << 8) | p[i];
+  return ret;
+}
+
+static uint32_t extendSoftware(uint32_t crc, const char *data, size_t size) {
+  const uint32_t(*t)[256] = tables().t;
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+  uint32_t c = ~crc;
+  for (; size >= 8; size -= 8, p += 8) {
+    uint64_t word = loadLE64(p);
+    uint32_t lo = c ^ static_cast<uint32_t>(word);
+    uint32_t hi = static_cast<uint32_t>(word >> 32);
+    c = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^
+        t[4][lo >> 24] ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+        t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+  }
+  while (size--)
+    c = t[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+  return ~c;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LUCANTHROPE_CRC32C_SSE42 1
+
+__attribute__((target("sse4.2"))) static uint32_t
+extendSSE42(uint32_t crc, const char *data, size_t size) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+  uint64_t c = ~crc & 0xffffffffULL;
+  for (; size >= 8; size -= 8, p += 8) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word)); // x86 is little-endian
+    c = __builtin_ia32_crc32di(c, word);
+  }
+  uint32_t c32 = static_cast<uint32_t>(c);
+  while (size--)
+    c32 = __builtin_ia32_crc32qi(c32, *p++);
+  return ~c32;
+}
+#endif
+
+uint32_t CRC32C::extend(uint32_t crc, const char *data, size_t size) {
+#ifdef LUCANTHROPE_CRC32C_SSE42
+  static const bool hasSSE42 = __builtin_cpu_supports("sse4.2");
+  if (hasSSE42)
+    return extendSSE42(crc, data, size);
+#endif
+  return extendSoftware(crc, data, size);
+}
+
+// Combining works in GF(2): appending n zero bytes to a message is a linear
+// operator on the CRC register, computed by repeated squaring (the same
+// method as zlib's crc32_combine()).
+static uint32_t gf2MatrixTimes(const uint32_t *mat, uint32_t vec) {
+  uint32_t sum = 0;
+  for (; vec; vec >>= 1, mat++)
+    if (vec & 1)
+      sum ^= *mat;
+  return sum;
+}
+
+static void gf2MatrixSquare(uint32_t *square, const uint32_t *mat) {
+  for (int n = 0; n < 32; n++)
+    square[n] = gf2MatrixTimes(mat, mat[n]);
+}
+
+uint32_t CRC32C::combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) {
+  if (!lengthB)
+    return crcA;
+  uint32_t even[32]; // operator for an even power of two zero bits
+  uint32_t odd[32];  // operator for an odd power of two zero bits
+  // operator for one zero bit
+  odd[0] = kPoly;
+  uint32_t row = 1;
+  for (int n = 1; n < 32; n++, row <<= 1)
+    odd[n] = row;
+  gf2MatrixSquare(even, odd); // two zero bits
+  gf2MatrixSquare(odd, even); // four zero bits
+  // the first squaring below gives the operator for one zero byte
+  do {
+    gf2MatrixSquare(even, odd);
+    if (lengthB & 1)
+      crcA = gf2MatrixTimes(even, crcA);
+    lengthB >>= 1;
+    if (!lengthB)
+      break;
+    gf2MatrixSquare(odd, even);
+    if (lengthB & 1)
+      crcA = gf2MatrixTimes(odd, crcA);
+    lengthB >>= 1;
+  } while (lengthB);
+  return crcA ^ crcB;
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,106 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <algorithm> // min()
+#include <cassert>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <memory> // shared_ptr
+#include <string>
+#include <utility> // move()
+
+#include "IO/FileDescriptor.h"
+#include "IO/IndexInput.h"
+#include "storage/BlockCache.h"
+
+namespace lucanthrope {
+
+// Reads a file block by block through BlockCache. The buffer of this stream is
+// always the data of a cached block, so cache hits involve no copying and no
+// system calls; misses read a whole block with a single pread(). A slice reads
+// bytes [begin, end) of the file through the same cached blocks, and shares
+// the descriptor.
+class CachedFSIndexInput : public IndexInput {
+private:
+  std::shared_ptr<const FileDescriptor> fd;
+  const std::string path; // for error messages
+  const uint64_t begin;
+  const uint64_t end;
+  const uint64_t fileSize;
+  const std::shared_ptr<BlockCache> cache;
+  const BlockCache::FileKey key;
+  // File offset of the byte at sentinel
+  uint64_t fileOffset;
+  // Keeps the block which is the current buffer alive
+  std::shared_ptr<const BlockCache::Block> block;
+
+public:
+  // Reads len bytes at offset of the file of size fsize
+  CachedFSIndexInput(std::shared_ptr<const FileDescriptor> file,
+                     const std::string &fpath, uint64_t fsize, uint64_t offset,
+                     uint64_t len, std::shared_ptr<BlockCache> c,
+                     const BlockCache::FileKey &k)
+      : fd(std::move(file)), path(fpath), begin(offset), end(offset + len),
+        fileSize(fsize), cache(std::move(c)), key(k), fileOffset(offset) {}
+
+  // Buffers are always provided by the cache
+  virtual void initInternalBuffer() override {}
+
+  virtual bool fillImpl() override {
+    assert(!hasPendingData() && "Buffer is not empty!");
+    if (fileOffset >= end)
+      return false;
+    const size_t block_size = cache->getBlockSize();
+    const uint64_t index = fileOffset / block_size;
+    const uint64_t block_start = index * block_size;
+    std::shared_ptr<const BlockCache::Block> next = cache->get(key, index);
+    if (!next) {
+      // Blocks are shared by all slices, so a block always covers as much of
+      // the file as it can, regardless of this stream's range
+      size_t want = static_cast<size_t>(
+          std::min<uint64_t>(block_size, fileSize - block_start));
+      auto loaded = std::make_shared<BlockCache::Block>();
+      loaded->data.reset(new char[want]);
+      loaded->size = fd->pread(loaded->data.get(), want, block_start, path);
+      // A short read (the file shrank since it was opened) is used once,
+      // but not cached for every later reader of the block
+      if (loaded->size == want)
+        next = cache->put(key, index, std::move(loaded));
+      else
+        next = std::move(loaded);
+    }
+    if (block_start + next->size <= fileOffset) // file was truncated
+      return false;
+    block = std::move(next);
+    set(block->data.get(), block->size);
+    bufCur = bufStart + (fileOffset - block_start);
+    if (end - block_start < block->size)
+      sentinel = bufStart + (end - block_start);
+    else
+      sentinel = bufEnd;
+    fileOffset = block_start + (sentinel - bufStart);
+    return true;
+  }
+
+  virtual void seek(uint64_t seek_pos) override {
+    assert(seek_pos <= end - begin && "Seeking past the end of file!");
+    uint64_t target = begin + seek_pos;
+    uint64_t buffered = sentinel - bufStart;
+    if (bufStart && target < fileOffset && target >= fileOffset - buffered) {
+      bufCur = sentinel - (fileOffset - target);
+    } else {
+      fileOffset = target;
+      bufCur = sentinel = bufStart;
+    }
+    pos = seek_pos;
+  }
+
+  virtual std::unique_ptr<IndexInput> slice(uint64_t offset,
+                                            uint64_t len) const override {
+    checkSliceBounds(offset, len, end - begin);
+    return std::unique_ptr<IndexInput>(new CachedFSIndexInput(
+        fd, path, fileSize, begin + offset, len, cache, key));
+  }
+};
+
+} // namespace lucanthrope
@@ -0,0 +1,87 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <algorithm> // min()
+#include <cassert>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <memory> // shared_ptr, unique_ptr
+#include <string>
+#include <utility> // move()
+
+#include "IO/FileDescriptor.h"
+#include "IO/IndexInput.h"
+
+namespace lucanthrope {
+
+// Reads bytes [begin, end) of a file (the whole file, unless the stream is a
+// slice) with pread(). Slices share the descriptor.
+class FSIndexInput : public IndexInput {
+private:
+  std::shared_ptr<const FileDescriptor> fd;
+  const std::string path; // for error messages
+  const uint64_t begin;
+  const uint64_t end;
+  // File offset of the byte at sentinel
+  uint64_t fileOffset;
+  std::unique_ptr<char[]> internalBuffer;
+  size_t bufferSizeHint = 0;
+
+public:
+  FSIndexInput(std::shared_ptr<const FileDescriptor> file,
+               const std::string &fpath, uint64_t offset, uint64_t length)
+      : fd(std::move(file)), path(fpath), begin(offset), end(offset + length),
+        fileOffset(offset) {}
+
+  virtual bool supportsExternalBuffer() const override { return true; }
+
+  virtual void hintBufferSize(size_t hint) override { bufferSizeHint = hint; }
+
+  virtual size_t preferredBufferSize() const override { return 64 * 1024; }
+
+  virtual void initInternalBuffer() override {
+    size_t size = bufferSizeHint ? bufferSizeHint : preferredBufferSize();
+    internalBuffer.reset(new char[size]);
+    set(internalBuffer.get(), size);
+    bufCur = sentinel = bufStart;
+  }
+
+  virtual bool fillImpl() override {
+    assert(!hasPendingData() && "Buffer is not empty!");
+    if (!bufStart)
+      initInternalBuffer();
+    if (fileOffset >= end)
+      return false;
+    size_t want = static_cast<size_t>(
+        std::min<uint64_t>(getBufferSize(), end - fileOffset));
+    size_t got = fd->pread(bufStart, want, fileOffset, path);
+    if (!got) // file was truncated behind our back
+      return false;
+    bufCur = bufStart;
+    sentinel = bufStart + got;
+    fileOffset += got;
+    return true;
+  }
+
+  virtual void seek(uint64_t seek_pos) override {
+    assert(seek_pos <= end - begin && "Seeking past the end of file!");
+    uint64_t target = begin + seek_pos;
+    uint64_t buffered = sentinel - bufStart;
+    if (bufStart && target < fileOffset && target >= fileOffset - buffered) {
+      bufCur = sentinel - (fileOffset - target);
+    } else {
+      fileOffset = target;
+      bufCur = sentinel = bufStart;
+    }
+    pos = seek_pos;
+  }
+
+  virtual std::unique_ptr<IndexInput> slice(uint64_t offset,
+                                            uint64_t length) const override {
+    checkSliceBounds(offset, length, end - begin);
+    return std::unique_ptr<IndexInput>(
+        new FSIndexInput(fd, path, begin + offset, length));
+  }
+};
+
+} // namespace lucanthrope
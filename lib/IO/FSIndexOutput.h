@@ -0,0 +1,71 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <iostream>
+#include <memory> // unique_ptr
+#include <string>
+#include <utility> // move()
+
+#include "IO/FileDescriptor.h"
+#include "IO/IndexOutput.h"
+#include "common/Exception.h"
+
+namespace lucanthrope {
+
+class FSIndexOutput : public IndexOutput {
+private:
+  FileDescriptor fd;
+  const std::string path; // for error messages
+  std::unique_ptr<char[]> internalBuffer;
+  size_t bufferSizeHint = 0;
+
+public:
+  FSIndexOutput(FileDescriptor file, const std::string &fpath)
+      : fd(std::move(file)), path(fpath) {}
+
+  // Destructor cannot report errors, so call flush() or sync() explicitly
+  // before destroying the stream if write errors matter.
+  virtual ~FSIndexOutput() override {
+    try {
+      flush();
+    } catch (Exception &e) {
+      std::cerr << "WARNING: unable to flush " << path << ": " << e.what()
+                << '\n';
+    }
+  }
+
+  virtual bool supportsExternalBuffer() const override { return true; }
+
+  virtual void hintBufferSize(size_t hint) override { bufferSizeHint = hint; }
+
+  virtual void sync() override {
+    flush();
+    fd.datasync(path);
+  }
+
+  virtual void seek(uint64_t seek_pos) override {
+    flush();
+    pos = seek_pos;
+  }
+
+  // Larger buffer means fewer system calls
+  virtual size_t preferredBufferSize() const override { return 64 * 1024; }
+
+private:
+  virtual void initInternalBuffer() override {
+    size_t size = bufferSizeHint ? bufferSizeHint : preferredBufferSize();
+    internalBuffer.reset(new char[size]);
+    set(internalBuffer.get(), size);
+    bufCur = bufStart;
+  }
+
+  // pos is the file offset right after the last buffered byte
+  virtual void writeImpl() override {
+    size_t size = getNumWritableBytes();
+    fd.pwrite(bufStart, size, pos - size, path);
+  }
+};
+
+} // namespace lucanthrope
@@ -0,0 +1,143 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <cerrno>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // strerror()
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/Exception.h"
+
+namespace lucanthrope {
+
+// Throws an exception which describes failed system call; err is errno value.
+[[noreturn]] inline void throwIOError(const char *where,
+                                      const std::string &path, int err) {
+  Exception::Code code = Exception::Code::IOErrorException;
+  if (err == ENOENT)
+    code = Exception::Code::FileNotFoundException;
+  else if (err == EEXIST)
+    code = Exception::Code::FileAlreadyExistsException;
+  throw Exception(code, std::string("In ")
+                            .append(where)
+                            .append(": ")
+                            .append(path)
+                            .append(": ")
+                            .append(std::strerror(err)));
+}
+
+// Owns a POSIX file descriptor; closes it on destruction.
+class FileDescriptor {
+private:
+  int fd_ = -1;
+
+public:
+  FileDescriptor() = default;
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+  FileDescriptor(const FileDescriptor &) = delete;
+  FileDescriptor &operator=(const FileDescriptor &) = delete;
+  FileDescriptor(FileDescriptor &&other) noexcept : fd_(other.fd_) {
+    other.fd_ = -1;
+  }
+  FileDescriptor &operator=(FileDescriptor &&other) noexcept {
+    if (this != &other) {
+      reset();
+      fd_ = other.fd_;
+      other.fd_ = -1;
+    }
+    return *this;
+  }
+  ~FileDescriptor() { reset(); }
+
+  // Opens path or throws (see throwIOError() for the exception codes).
+  static FileDescriptor open(const std::string &path, int flags,
+                             mode_t mode = 0644) {
+    int fd;
+    do {
+      fd = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0)
+      throwIOError("open()", path, errno);
+    return FileDescriptor(fd);
+  }
+
+  int get() const { return fd_; }
+
+  explicit operator bool() const { return fd_ >= 0; }
+
+  void reset() noexcept {
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+  }
+
+  struct stat stat(const std::string &path) const {
+    struct stat st;
+    if (::fstat(fd_, &st))
+      throwIOError("fstat()", path, errno);
+    return st;
+  }
+
+  uint64_t size(const std::string &path) const {
+    return static_cast<uint64_t>(stat(path).st_size);
+  }
+
+  // Reads up to size bytes at offset; returns less than size only at EOF.
+  size_t pread(char *ptr, size_t size, uint64_t offset,
+               const std::string &path) const {
+    size_t done = 0;
+    while (done < size) {
+      ssize_t n = ::pread(fd_, ptr + done, size - done,
+                          static_cast<off_t>(offset + done));
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        throwIOError("pread()", path, errno);
+      }
+      if (n == 0)
+        break;
+      done += static_cast<size_t>(n);
+    }
+    return done;
+  }
+
+  // Writes exactly size bytes at offset or throws.
+  void pwrite(const char *ptr, size_t size, uint64_t offset,
+              const std::string &path) const {
+    while (size) {
+      ssize_t n = ::pwrite(fd_, ptr, size, static_cast<off_t>(offset));
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        throwIOError("pwrite()", path, errno);
+      }
+      ptr += n;
+      size -= static_cast<size_t>(n);
+      offset += static_cast<uint64_t>(n);
+    }
+  }
+
+  // Makes file contents durable.
+  void datasync(const std::string &path) const {
+#ifdef __APPLE__
+    int rc = ::fsync(fd_);
+#else
+    int rc = ::fdatasync(fd_);
+#endif
+    if (rc)
+      throwIOError("fdatasync()", path, errno);
+  }
+
+  // Flushes data and metadata; this is what makes directory entries durable.
+  void sync(const std::string &path) const {
+    if (::fsync(fd_))
+      throwIOError("fsync()", path, errno);
+  }
+};
+
+} // namespace lucanthrope
@@ -1,13 +1,27 @@
 #include <algorithm> // min()
 #include <cstring>   // memcpy()
 #include <cstdint>
+#include <string> // to_string()
 
+#include "IO/CRC32C.h"
 #include "IO/IndexIOBase.h"
 #include "IO/IndexInput.h"
 #include "common/Exception.h"
 
 namespace lucanthrope {
 
+void IndexInput::checkSliceBounds(uint64_t offset, uint64_t length,
+                                  uint64_t size) {
+  if (offset > size || length > size - offset)
+    throw Exception(Exception::Code::IndexCorruptionException,
+                    std::string("in IndexInput::slice(): slice [")
+                        .append(std::to_string(offset))
+                        .append(", ")
+                        .append(std::to_string(offset + length))
+                        .append(") is out of bounds of a stream of length ")
+                        .append(std::to_string(size)));
+}
+
 char IndexInput::readByte() {
   if (eof())
     throw Exception(
@@ -106,4 +120,50 @@ uint32_t IndexInput::readVarint32() {
   return ret;
 }
 
-} // namespace lucanthrope
\ No newline at end of file
+uint32_t IndexInput::checksumBytes(uint64_t size) {
+  uint32_t crc = 0;
+  while (size) {
+    if (eof())
+      throw Exception(Exception::Code::IndexCorruptionException,
+                      std::string_view("in IndexInput::checksumBytes(): "
+                                       "cannot read bytes, EOF is reached"));
+    size_t n = static_cast<size_t>(
+        std::min<uint64_t>(getNumReadableBytes(), size));
+    crc = CRC32C::extend(crc, bufCur, n);
+    bufCur += n;
+    pos += n;
+    size -= n;
+  }
+  return crc;
+}
+
+bool IndexInput::readChecksumFooter(uint64_t length, uint64_t &checksum) {
+  if (length < kFooterLength)
+    return false;
+  seek(length - kFooterLength);
+  if (readInt32() != kFooterMagic || readInt32() != kChecksumCRC32C)
+    return false;
+  checksum = readInt64();
+  return true;
+}
+
+void IndexInput::verifyChecksumFooter(uint64_t length) {
+  uint64_t expected;
+  if (!readChecksumFooter(length, expected))
+    throw Exception(Exception::Code::IndexCorruptionException,
+                    std::string_view("in IndexInput::verifyChecksumFooter(): "
+                                     "stream has no checksum footer"));
+  seek(0);
+  // The checksum covers the magic and the algorithm id too
+  uint32_t actual = checksumBytes(length - sizeof(uint64_t));
+  if (expected != actual)
+    throw Exception(Exception::Code::IndexCorruptionException,
+                    std::string("in IndexInput::verifyChecksumFooter(): "
+                                "checksum mismatch: expected ")
+                        .append(std::to_string(expected))
+                        .append(", actual ")
+                        .append(std::to_string(actual)));
+  seek(length - kFooterLength);
+}
+
+} // namespace lucanthrope
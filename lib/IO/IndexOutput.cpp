@@ -1,7 +1,10 @@
+#include <algorithm> // min()
 #include <cassert>
 #include <cstring> // memcpy()
 
+#include "IO/IndexInput.h"
 #include "IO/IndexOutput.h"
+#include "common/Exception.h"
 
 namespace lucanthrope {
 
@@ -38,6 +41,22 @@ IndexOutput &IndexOutput::write(const char *ptr, size_t size) {
   return *this;
 }
 
+IndexOutput &IndexOutput::copyBytes(IndexInput &input, uint64_t size) {
+  while (size) {
+    if (input.eof())
+      throw Exception(Exception::Code::IndexCorruptionException,
+                      std::string_view("in IndexOutput::copyBytes(): cannot "
+                                       "copy bytes, EOF is reached"));
+    size_t n = static_cast<size_t>(
+        std::min<uint64_t>(input.getNumReadableBytes(), size));
+    write(input.bufCur, n);
+    input.bufCur += n;
+    input.pos += n;
+    size -= n;
+  }
+  return *this;
+}
+
 void IndexOutput::copyToBuffer(const char *ptr, size_t size) {
   assert(size <= available() && "Buffer overrun!");
 
@@ -0,0 +1,110 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <algorithm> // min()
+#include <cassert>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <memory> // shared_ptr, unique_ptr
+#include <string>
+#include <utility> // move()
+
+#include "IO/FileDescriptor.h"
+#include "IO/IndexInput.h"
+#include "storage/LogStructuredDirectory.h"
+
+namespace lucanthrope {
+
+// Reads bytes [begin, end) of a file of LogStructuredDirectory (the whole
+// file, unless the stream is a slice) with pread() from the logs which hold
+// its extents. A fill never crosses an extent boundary. The stream shares the
+// immutable FileInfo, and through it the log descriptors, so it doesn't need
+// the directory it came from.
+class LogIndexInput : public IndexInput {
+private:
+  std::shared_ptr<const LogStructuredDirectory::FileInfo> info;
+  const std::string dirPath; // for error messages
+  const uint64_t begin;
+  const uint64_t end;
+  // File offset of the byte at sentinel
+  uint64_t fileOffset;
+  // The extent which holds fileOffset, and file offset of its first byte
+  size_t extent = 0;
+  uint64_t extentStart = 0;
+  std::unique_ptr<char[]> internalBuffer;
+  size_t bufferSizeHint = 0;
+
+  void locateExtent() {
+    if (fileOffset < extentStart) {
+      extent = 0;
+      extentStart = 0;
+    }
+    while (extentStart + info->extents[extent].length <= fileOffset) {
+      extentStart += info->extents[extent].length;
+      extent++;
+    }
+  }
+
+public:
+  LogIndexInput(std::shared_ptr<const LogStructuredDirectory::FileInfo> file,
+                const std::string &path, uint64_t offset, uint64_t length)
+      : info(std::move(file)), dirPath(path), begin(offset),
+        end(offset + length), fileOffset(offset) {}
+
+  virtual bool supportsExternalBuffer() const override { return true; }
+
+  virtual void hintBufferSize(size_t hint) override { bufferSizeHint = hint; }
+
+  virtual size_t preferredBufferSize() const override { return 64 * 1024; }
+
+  virtual void initInternalBuffer() override {
+    size_t size = bufferSizeHint ? bufferSizeHint : preferredBufferSize();
+    internalBuffer.reset(new char[size]);
+    set(internalBuffer.get(), size);
+    bufCur = sentinel = bufStart;
+  }
+
+  virtual bool fillImpl() override {
+    assert(!hasPendingData() && "Buffer is not empty!");
+    if (!bufStart)
+      initInternalBuffer();
+    if (fileOffset >= end)
+      return false;
+    locateExtent();
+    const LogStructuredDirectory::Extent &e = info->extents[extent];
+    uint64_t inExtent = fileOffset - extentStart;
+    size_t want = static_cast<size_t>(std::min<uint64_t>(
+        std::min<uint64_t>(getBufferSize(), end - fileOffset),
+        e.length - inExtent));
+    size_t got = e.fd->pread(bufStart, want, e.offset + inExtent,
+                             LogStructuredDirectory::logPathIn(dirPath, e.log));
+    if (!got) // log was truncated behind our back
+      return false;
+    bufCur = bufStart;
+    sentinel = bufStart + got;
+    fileOffset += got;
+    return true;
+  }
+
+  virtual void seek(uint64_t seek_pos) override {
+    assert(seek_pos <= end - begin && "Seeking past the end of file!");
+    uint64_t target = begin + seek_pos;
+    uint64_t buffered = sentinel - bufStart;
+    if (bufStart && target < fileOffset && target >= fileOffset - buffered) {
+      bufCur = sentinel - (fileOffset - target);
+    } else {
+      fileOffset = target;
+      bufCur = sentinel = bufStart;
+    }
+    pos = seek_pos;
+  }
+
+  virtual std::unique_ptr<IndexInput> slice(uint64_t offset,
+                                            uint64_t length) const override {
+    checkSliceBounds(offset, length, end - begin);
+    return std::unique_ptr<IndexInput>(
+        new LogIndexInput(info, dirPath, begin + offset, length));
+  }
+};
+
+} // namespace lucanthrope
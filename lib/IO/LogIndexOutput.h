@@ -0,0 +1,104 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <iostream>
+#include <memory> // shared_ptr, unique_ptr
+#include <string>
+#include <unordered_set>
+#include <utility> // move()
+
+#include "IO/FileDescriptor.h"
+#include "IO/IndexOutput.h"
+#include "common/Exception.h"
+#include "storage/LogStructuredDirectory.h"
+
+namespace lucanthrope {
+
+// Appends every flushed buffer to the active log of the parent directory and
+// remembers where it went; the file is committed by the destructor.
+class LogIndexOutput : public IndexOutput {
+private:
+  LogStructuredDirectory *parent;
+  const std::string name;
+  std::shared_ptr<LogStructuredDirectory::FileInfo> info;
+  std::unique_ptr<char[]> internalBuffer;
+  size_t bufferSizeHint = 0;
+
+public:
+  LogIndexOutput(LogStructuredDirectory *dir, const std::string &fname)
+      : parent(dir), name(fname),
+        info(std::make_shared<LogStructuredDirectory::FileInfo>()) {}
+  LogIndexOutput(const LogIndexOutput &) = delete;
+  LogIndexOutput &operator=(const LogIndexOutput &) = delete;
+
+  // Destructor cannot report errors, so call flush() explicitly before
+  // destroying the stream if write errors matter. If the last flush fails,
+  // the file would be truncated, so it is dropped rather than committed.
+  virtual ~LogIndexOutput() override {
+    try {
+      flush();
+    } catch (Exception &e) {
+      std::cerr << "WARNING: unable to flush " << name << ", the file is lost: "
+                << e.what() << '\n';
+      parent->abandon(name, *info);
+      return;
+    }
+    for (auto &extent : info->extents)
+      info->length += extent.length;
+    parent->commit(name, std::move(info));
+  }
+
+  virtual bool supportsExternalBuffer() const override { return true; }
+
+  virtual void hintBufferSize(size_t hint) override { bufferSizeHint = hint; }
+
+  // Syncs the logs which were written so far; the file itself becomes durable
+  // only after it's closed and the directory is synced.
+  virtual void sync() override {
+    flush();
+    std::unordered_set<uint64_t> synced;
+    for (auto &extent : info->extents)
+      if (synced.insert(extent.log).second)
+        extent.fd->datasync(parent->logPath(extent.log));
+  }
+
+  // Logs are append-only, so the only supported position is the current one.
+  virtual void seek(uint64_t seek_pos) override {
+    flush();
+    if (seek_pos != pos)
+      throw Exception(Exception::Code::UnsupportedOperationException,
+                      std::string("In LogIndexOutput::seek(): ")
+                          .append(name)
+                          .append(" can only be appended to"));
+  }
+
+  virtual size_t preferredBufferSize() const override { return 64 * 1024; }
+
+private:
+  virtual void initInternalBuffer() override {
+    size_t size = bufferSizeHint ? bufferSizeHint : preferredBufferSize();
+    internalBuffer.reset(new char[size]);
+    set(internalBuffer.get(), size);
+    bufCur = bufStart;
+  }
+
+  virtual void writeImpl() override {
+    // make sure nothing throws after the bytes are appended
+    info->extents.reserve(info->extents.size() + 1);
+    LogStructuredDirectory::Extent extent =
+        parent->append(bufStart, getNumWritableBytes());
+    if (!info->extents.empty()) {
+      LogStructuredDirectory::Extent &last = info->extents.back();
+      if (last.log == extent.log &&
+          last.offset + last.length == extent.offset) {
+        last.length += extent.length;
+        return;
+      }
+    }
+    info->extents.push_back(std::move(extent));
+  }
+};
+
+} // namespace lucanthrope
@@ -0,0 +1,101 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <cassert>
+#include <cstddef> // size_t
+#include <cstdint>
+#include <memory> // shared_ptr, unique_ptr
+#include <string>
+#include <utility> // move()
+
+#include <sys/mman.h>
+
+#include "IO/FileDescriptor.h"
+#include "IO/IndexInput.h"
+
+namespace lucanthrope {
+
+// Read-only mapping of a whole file.
+class MappedFile {
+private:
+  char *data_ = nullptr;
+  uint64_t length_ = 0;
+
+public:
+  // Maps length bytes of the file open as fd. The descriptor may be closed
+  // afterwards, the mapping stays valid.
+  MappedFile(const FileDescriptor &fd, uint64_t length, const std::string &path)
+      : length_(length) {
+    if (!length_) // mmap() refuses empty mappings
+      return;
+    void *p = ::mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (p == MAP_FAILED)
+      throwIOError("mmap()", path, errno);
+    data_ = static_cast<char *>(p);
+  }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() {
+    if (data_)
+      ::munmap(data_, length_);
+  }
+
+  char *data() const { return data_; }
+  uint64_t length() const { return length_; }
+
+  // Tells the kernel how the mapping is going to be accessed; advice is one of
+  // MADV_* constants. Failures are ignored, this is only a hint.
+  void advise(int advice) const {
+    if (data_)
+      ::madvise(data_, length_, advice);
+  }
+};
+
+// The buffer of this stream is the mapped range [begin, begin + length) of the
+// file itself (the whole file, unless the stream is a slice), so the first
+// fill exposes the whole range, and every subsequent fill reports EOF. Slices
+// share the mapping.
+class MMapIndexInput : public IndexInput {
+private:
+  std::shared_ptr<const MappedFile> map;
+  const uint64_t begin;
+  const uint64_t length;
+
+public:
+  MMapIndexInput(std::shared_ptr<const MappedFile> m, uint64_t offset,
+                 uint64_t len)
+      : map(std::move(m)), begin(offset), length(len) {}
+
+  virtual void initInternalBuffer() override {
+    set(map->data() + begin, length);
+    bufCur = bufStart;
+    sentinel = bufEnd;
+  }
+
+  virtual bool fillImpl() override {
+    assert(!hasPendingData() && "Buffer is not empty!");
+    if (bufStart || !length)
+      return false;
+    initInternalBuffer();
+    return true;
+  }
+
+  virtual void seek(uint64_t seek_pos) override {
+    assert(seek_pos <= length && "Seeking past the end of file!");
+    if (!length)
+      return;
+    if (!bufStart)
+      initInternalBuffer();
+    bufCur = bufStart + seek_pos;
+    pos = seek_pos;
+  }
+
+  virtual std::unique_ptr<IndexInput> slice(uint64_t offset,
+                                            uint64_t len) const override {
+    checkSliceBounds(offset, len, length);
+    return std::unique_ptr<IndexInput>(
+        new MMapIndexInput(map, begin + offset, len));
+  }
+};
+
+} // namespace lucanthrope
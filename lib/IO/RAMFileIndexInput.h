@@ -3,77 +3,90 @@
 
 #include <cassert>
 #include <cstddef> // size_t
+#include <cstdint>
+#include <memory> // unique_ptr
 
 #include "IO/IndexInput.h"
 #include "storage/RAMDirectory.h"
 
 namespace lucanthrope {
 
+// Reads bytes [begin, end) of a RAMFile (the whole file, unless the stream is
+// a slice). The buffer is always one of the file's blocks, clipped to the
+// range.
 class RAMFileIndexInput : public IndexInput {
 private:
+  static constexpr uint64_t kBlockSize = RAMDirectory::RAMFile::kBlockSize;
+
   RAMDirectory::RAMFile *file;
+  const uint64_t begin;
+  const uint64_t end;
   size_t current_block = 0;
-  size_t last_block = 0;       // last block index
-  size_t last_block_bytes = 0; // number of bytes in the last block
-
-public:
-  RAMFileIndexInput(RAMDirectory::RAMFile *f) : file(f) {
-    assert(file->length && "File is empty!");
 
+  // Makes the block which contains byte at (an absolute file offset) the
+  // buffer, and positions bufCur at it.
+  void setBlock(uint64_t at) {
+    current_block = static_cast<size_t>(at / kBlockSize);
+    set(file->blocks_[current_block], kBlockSize);
+    bufCur = bufStart + at % kBlockSize;
     // file->blocks_.size() may be "lying" about the number of blocks which
-    // actually have data (see comment in RAMFileIndexOutput.h), so last_block
-    // index is computed in another way
-    last_block = (file->length -1) / RAMDirectory::RAMFile::kBlockSize + 1;
-
-    // if file->length is a multiple of RAMDirectory::RAMFile::kBlockSize, then
-    // (file->length - 1) % RAMDirectory::RAMFile::kBlockSize + 1 ==
-    // RAMDirectory::RAMFile::kBlockSize, otherwise, (file->length - 1) %
-    // RAMDirectory::RAMFile::kBlockSize + 1 == file->length %
-    // RAMDirectory::RAMFile::kBlockSize
-    last_block_bytes =
-        (file->length - 1) % RAMDirectory::RAMFile::kBlockSize + 1;
-  }
-  ~RAMFileIndexInput() { file->finish_reading(); }
-
-  virtual void initInternalBuffer() override {
-    set(file->blocks_[0], RAMDirectory::RAMFile::kBlockSize);
-    bufCur = bufStart;
-    if (!last_block)
-      sentinel = bufCur + last_block_bytes;
+    // actually have data (see comment in RAMFileIndexOutput.h), so the end of
+    // data is computed from the range
+    uint64_t block_start = current_block * kBlockSize;
+    if (end - block_start < kBlockSize)
+      sentinel = bufStart + (end - block_start);
     else
       sentinel = bufEnd;
   }
 
+public:
+  // Takes over a reference to f which was acquired by the caller.
+  RAMFileIndexInput(RAMDirectory::RAMFile *f, uint64_t offset, uint64_t length)
+      : file(f), begin(offset), end(offset + length) {}
+  RAMFileIndexInput(RAMDirectory::RAMFile *f)
+      : RAMFileIndexInput(f, 0, f->length) {}
+  ~RAMFileIndexInput() { file->finish_reading(); }
+
+  virtual void initInternalBuffer() override { setBlock(begin); }
+
   virtual bool fillImpl() override {
     assert(!hasPendingData() && "Buffer is not empty!");
     if (!bufStart) {
+      if (begin == end) // empty file, always EOF
+        return false;
       initInternalBuffer();
       return true;
     }
-    if (current_block == last_block) // EOF
+    uint64_t next_block_start = (current_block + 1) * kBlockSize;
+    if (next_block_start >= end) // EOF
       return false;
-    current_block++;
-    set(file->blocks_[current_block], RAMDirectory::RAMFile::kBlockSize);
-    bufCur = bufStart;
-    if (current_block == last_block)
-      sentinel = bufCur + last_block_bytes;
-    else
-      sentinel = bufEnd;
+    setBlock(next_block_start);
     return true;
   }
 
   virtual void seek(uint64_t seek_pos) override {
-    assert(seek_pos < file->length &&
-           "Seeking past the end of  file is not supported!");
-    current_block = seek_pos / RAMDirectory::RAMFile::kBlockSize;
-    size_t block_offset = seek_pos % RAMDirectory::RAMFile::kBlockSize;
-    set(file->blocks_[current_block], RAMDirectory::RAMFile::kBlockSize);
-    bufCur = bufStart + block_offset;
-    if (current_block == last_block)
-      sentinel = bufStart + last_block_bytes;
-    else
-      sentinel = bufEnd;
+    assert(seek_pos <= end - begin && "Seeking past the end of file!");
+    pos = seek_pos;
+    if (begin == end)
+      return;
+    if (begin + seek_pos == end) {
+      // the block after the last one may not exist
+      setBlock(end - 1);
+      bufCur = sentinel;
+      return;
+    }
+    setBlock(begin + seek_pos);
+  }
+
+  virtual std::unique_ptr<IndexInput> slice(uint64_t offset,
+                                            uint64_t length) const override {
+    checkSliceBounds(offset, length, end - begin);
+    std::unique_ptr<IndexInput> ret(
+        new RAMFileIndexInput(file, begin + offset, length));
+    // Take the reference only after nothing can throw anymore
+    file->refs_++;
+    return ret;
   }
 };
 
-} // namespace lucanthrope
\ No newline at end of file
+} // namespace lucanthrope
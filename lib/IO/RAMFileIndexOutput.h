@@ -4,7 +4,6 @@
 #include <cassert>
 #include <cstddef> // size_t
 #include <cstdint>
-#include <vcruntime.h>
 
 #include "IO/IndexOutput.h"
 #include "storage/RAMDirectory.h"
@@ -22,6 +21,7 @@ public:
   RAMFileIndexOutput(const RAMFileIndexOutput &) = delete;
   RAMFileIndexOutput &operator=(const RAMFileIndexOutput &) = delete;
   ~RAMFileIndexOutput() {
+    countUnflushed(); // the last block never goes through writeImpl()
     if (file->length < pos) // "flush"
       file->length = pos;
     file->finish_writing();
@@ -53,6 +53,7 @@ private:
   }
 
   virtual void seek(uint64_t seek_pos) override {
+    countUnflushed();
     if (file->length < pos)
       file->length = pos;
     assert(seek_pos <= file->length &&
@@ -67,6 +68,7 @@ private:
         seek_pos % RAMDirectory::RAMFile::kBlockSize;
     set(file->blocks_[current_block], RAMDirectory::RAMFile::kBlockSize);
     bufCur = bufStart + offset_in_current_block;
+    bufStart = bufCur; // see writeImpl()
     pos = seek_pos;
   }
 
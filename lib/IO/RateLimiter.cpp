@@ -0,0 +1,59 @@
+#include <algorithm> // min()
+#include <chrono>
+#include <thread>
+
+#include "IO/RateLimiter.h"
+
+namespace lucanthrope {
+
+static int64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+RateLimiter::RateLimiter(uint64_t bytesPerSec, uint64_t burstBytes) {
+  setRate(bytesPerSec, burstBytes);
+}
+
+void RateLimiter::setRate(uint64_t bytesPerSec, uint64_t burstBytes) {
+  std::lock_guard<std::mutex> guard(mu_);
+  rate_ = bytesPerSec;
+  burst_ = burstBytes ? burstBytes : bytesPerSec / 10;
+  tokens_ = static_cast<double>(burst_);
+  lastRefill_ = nowNanos();
+}
+
+uint64_t RateLimiter::getRate() {
+  std::lock_guard<std::mutex> guard(mu_);
+  return rate_;
+}
+
+uint64_t RateLimiter::getPausedNanos() {
+  std::lock_guard<std::mutex> guard(mu_);
+  return pausedNanos_;
+}
+
+void RateLimiter::acquire(uint64_t bytes) {
+  int64_t pause;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    if (!rate_)
+      return;
+    int64_t now = nowNanos();
+    tokens_ = std::min(static_cast<double>(burst_),
+                       tokens_ + static_cast<double>(now - lastRefill_) *
+                                     static_cast<double>(rate_) / 1e9);
+    lastRefill_ = now;
+    tokens_ -= static_cast<double>(bytes);
+    if (tokens_ >= 0)
+      return;
+    // Concurrent callers queue up behind the debt, each one sleeps until its
+    // own share is repaid
+    pause = static_cast<int64_t>(-tokens_ * 1e9 / static_cast<double>(rate_));
+    pausedNanos_ += static_cast<uint64_t>(pause);
+  }
+  std::this_thread::sleep_for(std::chrono::nanoseconds(pause));
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,94 @@
+#include <memory> // shared_ptr, weak_ptr
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility> // move()
+#include <vector>
+
+#include "analysis/Analysis.h"
+
+namespace lucanthrope {
+
+void Analyzer::ThreadStreams::release() {
+  // Destroyed outside the lock
+  FieldStreams mine;
+  std::lock_guard<std::mutex> guard(mu);
+  auto it = byThread.find(std::this_thread::get_id());
+  if (it == byThread.end())
+    return;
+  mine = std::move(it->second);
+  byThread.erase(it);
+}
+
+Analyzer::~Analyzer() {
+  // The streams go with the analyzer, even if an exiting thread holds on to
+  // streams_ for a moment
+  std::unordered_map<std::thread::id, FieldStreams> all;
+  std::lock_guard<std::mutex> guard(streams_->mu);
+  all.swap(streams_->byThread);
+}
+
+void Analyzer::releaseThreadStreams() {
+  LastStream &last = lastStream();
+  if (last.analyzer == id_)
+    last = LastStream();
+  streams_->release();
+}
+
+bool Analyzer::useThreadStreams(LastStream &last) {
+  std::lock_guard<std::mutex> guard(streams_->mu);
+  auto it = streams_->byThread.find(std::this_thread::get_id());
+  if (it == streams_->byThread.end())
+    return false;
+  last.analyzer = id_;
+  last.streams = &it->second;
+  last.stream = nullptr;
+  return true;
+}
+
+TokenStream &Analyzer::cacheStream(std::string_view fieldName,
+                                   std::unique_ptr<TokenStream> stream) {
+  // Releases, when its thread exits, the thread's streams of the analyzers it
+  // cached any in which are still alive
+  struct ThreadReleaser {
+    std::vector<std::weak_ptr<ThreadStreams>> analyzers;
+
+    ~ThreadReleaser() {
+      for (auto &analyzer : analyzers)
+        if (std::shared_ptr<ThreadStreams> streams = analyzer.lock())
+          streams->release();
+    }
+  };
+
+  if (sameStreamForAllFields())
+    fieldName = std::string_view();
+  TokenStream &ret = *stream;
+  std::lock_guard<std::mutex> guard(streams_->mu);
+  auto inserted = streams_->byThread.try_emplace(std::this_thread::get_id());
+  inserted.first->second[std::string(fieldName)] = std::move(stream);
+  if (inserted.second) {
+    // This thread's first stream of the analyzer since it started or released
+    // its streams: have it released when the thread exits, and forget
+    // analyzers which are gone
+    static thread_local ThreadReleaser releaser;
+    auto &analyzers = releaser.analyzers;
+    bool known = false;
+    for (size_t i = 0; i < analyzers.size();) {
+      std::shared_ptr<ThreadStreams> streams = analyzers[i].lock();
+      if (!streams) {
+        analyzers[i] = std::move(analyzers.back());
+        analyzers.pop_back();
+        continue;
+      }
+      known = known || streams == streams_;
+      i++;
+    }
+    if (!known)
+      analyzers.push_back(streams_);
+  }
+  return ret;
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,265 @@
+#include <algorithm> // copy(), max(), min()
+#include <cstring>   // memcpy(), memmove()
+#include <future>
+#include <istream>
+#include <memory> // unique_ptr
+#include <string_view>
+#include <utility> // move(), pair
+
+#include "analysis/Analysis.h"
+#include "analysis/BatchAnalyzer.h"
+#include "common/ThreadPool.h"
+#include "document/Document.h"
+
+namespace lucanthrope {
+
+namespace {
+
+// The documents [first, last) of a batch, and the terms of their tokens,
+// interned by the range's task
+struct Range {
+  size_t first = 0;
+  size_t last = 0;
+  TermInterner terms;
+};
+
+// A chunk of a text, which starts at offset base in the text, and its tokens,
+// with the chunk's term ids and positions
+struct Chunk {
+  std::string_view text;
+  uint64_t base = 0;
+  TermInterner terms;
+  BatchAnalyzer::DocumentTokens tokens;
+};
+
+// Chunks are cut at whitespace, which ends a token for every tokenizer
+bool isSpace(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+} // unnamed namespace
+
+BatchAnalyzer::BatchAnalyzer(Analyzer &analyzer, size_t numThreads)
+    : analyzer_(analyzer), pool_(new ThreadPool(numThreads)) {}
+
+BatchAnalyzer::~BatchAnalyzer() = default;
+
+// Interns the terms of a range or chunk into the batch's terms; returns the
+// batch's ids of the terms, by their ids in the range or chunk
+static std::vector<uint32_t> mergeTerms(const TermInterner &terms,
+                                        TermInterner &batchTerms) {
+  std::vector<uint32_t> ids;
+  ids.reserve(terms.size());
+  for (TermInterner::TermId id = 0; id < terms.size(); id++)
+    ids.push_back(batchTerms.intern(terms.term(id)));
+  return ids;
+}
+
+// Analyzes the documents of range into their tokens, with the range's ids
+static void analyzeRange(Analyzer &analyzer, const Document *documents,
+                         Range &range,
+                         std::vector<BatchAnalyzer::DocumentTokens> &tokens) {
+  // The next position of each field name of the document
+  std::vector<std::pair<std::string_view, uint64_t>> positions;
+  for (size_t d = range.first; d < range.last; d++) {
+    BatchAnalyzer::DocumentTokens &doc = tokens[d];
+    positions.clear();
+    uint32_t f = 0;
+    for (const Field &field : documents[d]) {
+      if (!field.isTokenized()) {
+        f++;
+        continue;
+      }
+      auto position = positions.begin();
+      while (position != positions.end() && position->first != field.getName())
+        position++;
+      if (position == positions.end())
+        position = positions.emplace(positions.end(), field.getName(), 0);
+
+      doc.fields.push_back(f++);
+      doc.fieldStarts.push_back(doc.size());
+      // values in memory are scanned in place
+      TokenStream &stream =
+          field.isIStreamValue()
+              ? analyzer.reusableTokenStream(field.getIStreamValue(),
+                                             field.getName())
+              : analyzer.reusableTokenStream(field.getTextValue(),
+                                             field.getName());
+      while (stream.next()) {
+        const TokenView &view = stream.getTokenView();
+        doc.termIds.push_back(range.terms.intern(view.termText()));
+        doc.positions.push_back(position->second++);
+        doc.startOffsets.push_back(view.startPos);
+        doc.endOffsets.push_back(view.endPos);
+      }
+    }
+    doc.fieldStarts.push_back(doc.size());
+  }
+}
+
+BatchAnalyzer::Result BatchAnalyzer::analyze(const Document *documents,
+                                             size_t numDocuments) {
+  Result result;
+  result.documents.resize(numDocuments);
+  // A few ranges per thread, so that documents of uneven sizes even out
+  size_t numRanges = std::min(numDocuments, 4 * pool_->size());
+  std::vector<Range> ranges(numRanges);
+  {
+    std::vector<std::future<void>> futures;
+    futures.reserve(numRanges);
+    for (size_t r = 0; r < numRanges; r++) {
+      ranges[r].first = numDocuments * r / numRanges;
+      ranges[r].last = numDocuments * (r + 1) / numRanges;
+      futures.push_back(pool_->submit([this, documents, &ranges, &result, r] {
+        analyzeRange(analyzer_, documents, ranges[r], result.documents);
+      }));
+    }
+    waitAll(futures);
+  }
+
+  // Terms get their ids in the order of ranges, i.e. of documents. The first
+  // range's ids are already those.
+  std::vector<std::vector<uint32_t>> globalIds(numRanges);
+  for (size_t r = 0; r < numRanges; r++)
+    globalIds[r] = mergeTerms(ranges[r].terms, result.terms);
+  std::vector<std::future<void>> futures;
+  for (size_t r = 1; r < numRanges; r++)
+    futures.push_back(pool_->submit([&ranges, &result, &globalIds, r] {
+      for (size_t d = ranges[r].first; d < ranges[r].last; d++)
+        for (uint32_t &id : result.documents[d].termIds)
+          id = globalIds[r][id];
+    }));
+  waitAll(futures);
+  return result;
+}
+
+// Analyzes a chunk into its own tokens, with offsets in the text
+static void analyzeChunk(Analyzer &analyzer, std::string_view fieldName,
+                         Chunk &chunk) {
+  TokenStream &stream = analyzer.reusableTokenStream(chunk.text, fieldName);
+  BatchAnalyzer::DocumentTokens &tokens = chunk.tokens;
+  for (uint64_t position = 0; stream.next(); position++) {
+    const TokenView &view = stream.getTokenView();
+    tokens.termIds.push_back(chunk.terms.intern(view.termText()));
+    tokens.positions.push_back(position);
+    tokens.startOffsets.push_back(chunk.base + view.startPos);
+    tokens.endOffsets.push_back(chunk.base + view.endPos);
+  }
+}
+
+void BatchAnalyzer::analyzeChunks(std::string_view text, uint64_t base,
+                                  std::string_view fieldName, Result &result) {
+  // A few chunks per thread, of at least kMinChunkSize bytes
+  size_t numChunks = 4 * pool_->size();
+  size_t chunkSize = std::max(text.size() / numChunks + 1, kMinChunkSize);
+  std::vector<Chunk> chunks;
+  for (size_t first = 0; first < text.size();) {
+    size_t last = std::min(first + chunkSize, text.size());
+    while (last < text.size() && !isSpace(text[last]))
+      last++;
+    chunks.emplace_back();
+    chunks.back().text = text.substr(first, last - first);
+    chunks.back().base = base + first;
+    first = last;
+  }
+  std::vector<std::future<void>> futures;
+  futures.reserve(chunks.size());
+  for (Chunk &chunk : chunks)
+    futures.push_back(pool_->submit([this, fieldName, &chunk] {
+      analyzeChunk(analyzer_, fieldName, chunk);
+    }));
+  waitAll(futures);
+
+  // The chunks' tokens are appended in order, with the batch's term ids, and
+  // positions which continue from the previous chunk's
+  DocumentTokens &doc = result.documents[0];
+  std::vector<size_t> starts(chunks.size() + 1, doc.size());
+  std::vector<std::vector<uint32_t>> globalIds(chunks.size());
+  for (size_t c = 0; c < chunks.size(); c++) {
+    globalIds[c] = mergeTerms(chunks[c].terms, result.terms);
+    starts[c + 1] = starts[c] + chunks[c].tokens.size();
+  }
+  size_t size = starts.back();
+  doc.termIds.resize(size);
+  doc.positions.resize(size);
+  doc.startOffsets.resize(size);
+  doc.endOffsets.resize(size);
+  futures.clear();
+  for (size_t c = 0; c < chunks.size(); c++)
+    futures.push_back(pool_->submit([&doc, &chunks, &starts, &globalIds, c] {
+      const DocumentTokens &tokens = chunks[c].tokens;
+      size_t start = starts[c];
+      for (size_t i = 0; i < tokens.size(); i++) {
+        doc.termIds[start + i] = globalIds[c][tokens.termIds[i]];
+        doc.positions[start + i] = start + tokens.positions[i];
+      }
+      std::copy(tokens.startOffsets.begin(), tokens.startOffsets.end(),
+                doc.startOffsets.begin() + start);
+      std::copy(tokens.endOffsets.begin(), tokens.endOffsets.end(),
+                doc.endOffsets.begin() + start);
+    }));
+  waitAll(futures);
+}
+
+// A result with a single document of one field, at index 0, with no tokens
+static BatchAnalyzer::Result singleFieldResult() {
+  BatchAnalyzer::Result result;
+  result.documents.resize(1);
+  result.documents[0].fields.push_back(0);
+  result.documents[0].fieldStarts.push_back(0);
+  return result;
+}
+
+BatchAnalyzer::Result BatchAnalyzer::analyzeText(std::string_view text,
+                                                 std::string_view fieldName) {
+  Result result = singleFieldResult();
+  analyzeChunks(text, 0, fieldName, result);
+  result.documents[0].fieldStarts.push_back(result.documents[0].size());
+  return result;
+}
+
+BatchAnalyzer::Result BatchAnalyzer::analyzeText(std::istream &input,
+                                                 std::string_view fieldName) {
+  Result result = singleFieldResult();
+  // Text is read a few chunks per thread at a time; the text after the last
+  // whitespace of a read is carried over to the next one. A read without
+  // whitespace makes the buffer grow.
+  size_t bufferSize = 4 * pool_->size() * kMinChunkSize;
+  std::unique_ptr<char[]> buffer(new char[bufferSize]);
+  size_t held = 0;
+  uint64_t base = 0;
+  std::streambuf *buf = input.rdbuf();
+  while (true) {
+    std::streamsize n =
+        input && buf ? buf->sgetn(buffer.get() + held, bufferSize - held) : 0;
+    if (n <= 0)
+      input.setstate(std::ios_base::eofbit);
+    held += std::max<std::streamsize>(n, 0);
+    if (n <= 0) { // the rest of the text
+      analyzeChunks(std::string_view(buffer.get(), held), base, fieldName,
+                    result);
+      break;
+    }
+    size_t end = held;
+    while (end && !isSpace(buffer[end - 1]))
+      end--;
+    if (!end) {
+      if (held == bufferSize) {
+        std::unique_ptr<char[]> grown(new char[2 * bufferSize]);
+        std::memcpy(grown.get(), buffer.get(), held);
+        buffer = std::move(grown);
+        bufferSize *= 2;
+      }
+      continue;
+    }
+    analyzeChunks(std::string_view(buffer.get(), end), base, fieldName,
+                  result);
+    std::memmove(buffer.get(), buffer.get() + end, held - end);
+    held -= end;
+    base += end;
+  }
+  result.documents[0].fieldStarts.push_back(result.documents[0].size());
+  return result;
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,23 @@
+#include <memory> // make_shared()
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "IO/FileDescriptor.h" // private header
+#include "IO/MMapIndexInput.h" // private header
+#include "document/Document.h"
+
+namespace lucanthrope {
+
+ByteSpan ByteSpan::mapFile(const std::string &path) {
+  FileDescriptor fd = FileDescriptor::open(path, O_RDONLY);
+  uint64_t length = fd.size(path);
+  auto map = std::make_shared<const MappedFile>(fd, length, path);
+  // values are mostly tokenized from start to end
+  map->advise(MADV_SEQUENTIAL);
+  return {std::string_view(map->data(), map->length()), map};
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,258 @@
+#include <algorithm> // min()
+#include <iterator>  // prev()
+#include <utility>   // move()
+
+#include "storage/BlockCache.h"
+
+namespace lucanthrope {
+
+// splitmix64 finalizer
+static inline uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+size_t BlockCache::FileKeyHash::operator()(const FileKey &k) const {
+  return static_cast<size_t>(mix(k.device ^ mix(k.inode ^ mix(k.version))));
+}
+
+size_t BlockCache::KeyHash::operator()(const Key &k) const {
+  return static_cast<size_t>(mix(FileKeyHash()(k.file) ^ mix(k.block)));
+}
+
+BlockCache::BlockCache(uint64_t budgetBytes, size_t blockSize,
+                       size_t numShards)
+    : budget_(budgetBytes), blockSize_(blockSize) {
+  if (!numShards)
+    numShards = 1;
+  shards_.reserve(numShards);
+  for (size_t i = 0; i < numShards; i++) {
+    shards_.emplace_back(new Shard());
+    shards_.back()->budget = budgetBytes / numShards;
+    shards_.back()->smallBudget = shards_.back()->budget / 10;
+  }
+}
+
+std::shared_ptr<const BlockCache::Block>
+BlockCache::get(const FileKey &file, uint64_t blockIndex) {
+  Key key{file, blockIndex};
+  Shard &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mu);
+  auto it = shard.index.find(key);
+  if (it == shard.index.end()) {
+    shard.stats.misses++;
+    return nullptr;
+  }
+  shard.stats.hits++;
+  Entry &e = *it->second;
+  e.freq = std::min<uint8_t>(e.freq + 1, 3);
+  return e.block;
+}
+
+std::shared_ptr<const BlockCache::Block>
+BlockCache::put(const FileKey &file, uint64_t blockIndex,
+                std::shared_ptr<const Block> block) {
+  Key key{file, blockIndex};
+  Shard &shard = shardOf(key);
+  std::lock_guard<std::mutex> guard(shard.mu);
+  auto it = shard.index.find(key);
+  if (it != shard.index.end()) // somebody was faster
+    return it->second->block;
+
+  Entry entry;
+  entry.key = key;
+  entry.block = std::move(block);
+  auto ghost = shard.ghostIndex.find(key);
+  Queue::iterator pos;
+  if (ghost != shard.ghostIndex.end()) {
+    // It was evicted from the small queue too early last time
+    shard.ghost.erase(ghost->second);
+    shard.ghostIndex.erase(ghost);
+    entry.inMain = true;
+    shard.main.push_front(std::move(entry));
+    pos = shard.main.begin();
+    shard.mainBytes += chargeOf(*pos);
+  } else {
+    shard.small.push_front(std::move(entry));
+    pos = shard.small.begin();
+    shard.smallBytes += chargeOf(*pos);
+  }
+  try {
+    shard.index.emplace(key, pos);
+  } catch (...) {
+    if (pos->inMain) {
+      shard.mainBytes -= chargeOf(*pos);
+      shard.main.erase(pos);
+    } else {
+      shard.smallBytes -= chargeOf(*pos);
+      shard.small.erase(pos);
+    }
+    throw;
+  }
+  shard.stats.insertions++;
+  std::shared_ptr<const Block> ret = pos->block;
+  evictLocked(shard);
+  return ret;
+}
+
+std::shared_ptr<const BlockCache::Block>
+BlockCache::getOrLoad(const FileKey &file, uint64_t blockIndex,
+                      const std::function<void(Block &)> &load) {
+  std::shared_ptr<const Block> block = get(file, blockIndex);
+  if (block)
+    return block;
+  std::shared_ptr<Block> loaded = std::make_shared<Block>();
+  load(*loaded);
+  return put(file, blockIndex, std::move(loaded));
+}
+
+void BlockCache::eraseLocked(Shard &shard, Queue::iterator it) {
+  shard.index.erase(it->key);
+  if (it->inMain) {
+    shard.mainBytes -= chargeOf(*it);
+    shard.main.erase(it);
+  } else {
+    shard.smallBytes -= chargeOf(*it);
+    shard.small.erase(it);
+  }
+}
+
+void BlockCache::rememberGhostLocked(Shard &shard, const Key &key) {
+  // Remember about as many keys as the main queue can hold
+  size_t capacity =
+      static_cast<size_t>(shard.budget / (blockSize_ + kEntryOverhead)) + 1;
+  try {
+    shard.ghost.push_front(key);
+    try {
+      shard.ghostIndex.emplace(key, shard.ghost.begin());
+    } catch (...) {
+      shard.ghost.pop_front();
+      throw;
+    }
+  } catch (...) {
+    return; // ghosts are only a hint
+  }
+  while (shard.ghost.size() > capacity) {
+    shard.ghostIndex.erase(shard.ghost.back());
+    shard.ghost.pop_back();
+  }
+}
+
+void BlockCache::evictFromSmallLocked(Shard &shard) {
+  auto it = std::prev(shard.small.end());
+  if (it->freq > 0 || shard.pinned.count(it->key.file)) {
+    // Accessed again while it was in the small queue: promote
+    uint64_t charge = chargeOf(*it);
+    it->inMain = true;
+    it->freq = 0;
+    shard.main.splice(shard.main.begin(), shard.small, it);
+    shard.smallBytes -= charge;
+    shard.mainBytes += charge;
+    return;
+  }
+  Key key = it->key;
+  eraseLocked(shard, it);
+  rememberGhostLocked(shard, key);
+  shard.stats.evictions++;
+}
+
+bool BlockCache::evictFromMainLocked(Shard &shard) {
+  // Every block is moved to the head at most 4 times (freq <= 3), unless
+  // it's pinned; that bounds the number of iterations.
+  size_t attempts = 4 * shard.main.size() + 1;
+  while (!shard.main.empty() && attempts--) {
+    auto it = std::prev(shard.main.end());
+    if (shard.pinned.count(it->key.file) || it->freq > 0) {
+      if (it->freq > 0)
+        it->freq--;
+      shard.main.splice(shard.main.begin(), shard.main, it);
+      continue;
+    }
+    eraseLocked(shard, it);
+    shard.stats.evictions++;
+    return true;
+  }
+  return false;
+}
+
+void BlockCache::evictLocked(Shard &shard) {
+  while (shard.smallBytes + shard.mainBytes > shard.budget) {
+    if (!shard.small.empty() &&
+        (shard.smallBytes > shard.smallBudget || shard.main.empty())) {
+      evictFromSmallLocked(shard);
+      continue;
+    }
+    if (evictFromMainLocked(shard))
+      continue;
+    if (shard.small.empty())
+      return; // everything left is pinned
+    evictFromSmallLocked(shard);
+  }
+}
+
+void BlockCache::pinFile(const FileKey &file) {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->mu);
+    shard->pinned.insert(file);
+  }
+}
+
+void BlockCache::unpinFile(const FileKey &file) {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->mu);
+    shard->pinned.erase(file);
+    evictLocked(*shard);
+  }
+}
+
+void BlockCache::invalidateFile(const FileKey &file) {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->mu);
+    for (Queue *queue : {&shard->small, &shard->main})
+      for (auto it = queue->begin(); it != queue->end();)
+        if (it->key.file == file)
+          eraseLocked(*shard, it++);
+        else
+          ++it;
+    for (auto it = shard->ghost.begin(); it != shard->ghost.end();)
+      if (it->file == file) {
+        shard->ghostIndex.erase(*it);
+        it = shard->ghost.erase(it);
+      } else
+        ++it;
+  }
+}
+
+void BlockCache::clear() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->mu);
+    for (Queue *queue : {&shard->small, &shard->main})
+      for (auto it = queue->begin(); it != queue->end();)
+        if (!shard->pinned.count(it->key.file))
+          eraseLocked(*shard, it++);
+        else
+          ++it;
+    shard->ghost.clear();
+    shard->ghostIndex.clear();
+  }
+}
+
+BlockCache::Stats BlockCache::getStats() {
+  Stats ret;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> guard(shard->mu);
+    ret.hits += shard->stats.hits;
+    ret.misses += shard->stats.misses;
+    ret.insertions += shard->stats.insertions;
+    ret.evictions += shard->stats.evictions;
+    ret.bytesUsed += shard->smallBytes + shard->mainBytes;
+    ret.blocks += shard->index.size();
+  }
+  return ret;
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,135 @@
+#include <algorithm> // min(), max()
+#include <chrono>
+#include <future>
+#include <utility> // move()
+
+#include "IO/CRC32C.h"
+#include "IO/IndexIOBase.h"
+#include "IO/IndexInput.h"
+#include "common/Exception.h"
+#include "common/ThreadPool.h"
+#include "storage/ChecksumVerifier.h"
+#include "storage/Directory.h"
+
+namespace lucanthrope {
+
+using Clock = std::chrono::steady_clock;
+
+ChecksumVerifier::ChecksumVerifier(size_t numThreads, uint64_t chunkSize)
+    : chunkSize_(chunkSize ? chunkSize : kDefaultChunkSize),
+      pool_(new ThreadPool(numThreads)) {}
+
+ChecksumVerifier::~ChecksumVerifier() = default;
+
+// Opens fname and reads its footer; returns nullptr unless there is a
+// checksum to verify.
+static std::unique_ptr<IndexInput>
+openFooter(Directory &dir, ChecksumVerifier::FileResult &result) {
+  std::unique_ptr<IndexInput> input;
+  try {
+    result.length = dir.fileLength(result.name);
+    if (result.length < IndexIOBase::kFooterLength) {
+      result.status = ChecksumVerifier::Status::NoChecksum;
+      return input;
+    }
+    input = dir.openInput(result.name, IOContext(IOContext::ReadOnce));
+    if (!input->readChecksumFooter(result.length, result.expected)) {
+      result.status = ChecksumVerifier::Status::NoChecksum;
+      input.reset();
+    }
+  } catch (Exception &e) {
+    result.status = ChecksumVerifier::Status::Error;
+    result.error = e.what();
+    input.reset();
+  }
+  return input;
+}
+
+std::vector<ChecksumVerifier::FileResult>
+ChecksumVerifier::verify(Directory &dir,
+                         const std::vector<std::string> &fnames) {
+  std::vector<FileResult> results(fnames.size());
+  std::vector<std::unique_ptr<IndexInput>> inputs(fnames.size());
+  {
+    std::vector<std::future<void>> footers;
+    footers.reserve(fnames.size());
+    for (size_t i = 0; i < fnames.size(); i++) {
+      results[i].name = fnames[i];
+      footers.push_back(pool_->submit([&dir, &results, &inputs, i] {
+        inputs[i] = openFooter(dir, results[i]);
+      }));
+    }
+    waitAll(footers);
+  }
+
+  struct Chunk {
+    size_t file = 0;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    uint32_t crc = 0;
+    Clock::time_point start;
+    Clock::time_point end;
+    std::string error;
+  };
+  std::vector<Chunk> chunks;
+  for (size_t i = 0; i < fnames.size(); i++) {
+    if (!inputs[i])
+      continue;
+    // The checksum covers everything but itself
+    uint64_t covered = results[i].length - sizeof(uint64_t);
+    for (uint64_t offset = 0; offset < covered; offset += chunkSize_) {
+      chunks.emplace_back();
+      chunks.back().file = i;
+      chunks.back().offset = offset;
+      chunks.back().length = std::min(chunkSize_, covered - offset);
+    }
+  }
+  std::vector<std::future<void>> tasks;
+  tasks.reserve(chunks.size());
+  for (auto &chunk : chunks)
+    tasks.push_back(pool_->submit([&inputs, &chunk] {
+      chunk.start = Clock::now();
+      try {
+        std::unique_ptr<IndexInput> slice =
+            inputs[chunk.file]->slice(chunk.offset, chunk.length);
+        chunk.crc = slice->checksumBytes(chunk.length);
+      } catch (Exception &e) {
+        chunk.error = e.what();
+      }
+      chunk.end = Clock::now();
+    }));
+  waitAll(tasks);
+
+  // Chunks of a file are adjacent and ordered by offset
+  for (size_t c = 0; c < chunks.size();) {
+    FileResult &result = results[chunks[c].file];
+    Clock::time_point start = chunks[c].start;
+    Clock::time_point end = chunks[c].end;
+    uint32_t crc = 0;
+    size_t file = chunks[c].file;
+    for (; c < chunks.size() && chunks[c].file == file; c++) {
+      Chunk &chunk = chunks[c];
+      if (!chunk.error.empty() && result.status != Status::Error) {
+        result.status = Status::Error;
+        result.error = std::move(chunk.error);
+      }
+      crc = CRC32C::combine(crc, chunk.crc, chunk.length);
+      start = std::min(start, chunk.start);
+      end = std::max(end, chunk.end);
+    }
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    if (result.status == Status::Error)
+      continue;
+    result.actual = crc;
+    if (result.actual != result.expected)
+      result.status = Status::Corrupted;
+  }
+  return results;
+}
+
+std::vector<ChecksumVerifier::FileResult>
+ChecksumVerifier::verify(Directory &dir) {
+  return verify(dir, dir.listAll());
+}
+
+} // namespace lucanthrope
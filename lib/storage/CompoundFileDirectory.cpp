@@ -0,0 +1,131 @@
+#include <algorithm> // min()
+
+#include "IO/IndexInput.h"
+#include "IO/IndexOutput.h"
+#include "common/Exception.h"
+#include "storage/CompoundFileDirectory.h"
+#include "storage/CompoundFileWriter.h"
+#include "storage/LockFile.h"
+
+namespace lucanthrope {
+
+CompoundFileDirectory::CompoundFileDirectory(Directory &dir,
+                                             const std::string &name) {
+  const std::string entries_name =
+      std::string(name).append(CompoundFileWriter::kEntriesExtension);
+  const std::string data_name =
+      std::string(name).append(CompoundFileWriter::kDataExtension);
+  uint64_t data_length = dir.fileLength(data_name);
+  // files lie before the footer
+  data_length -= std::min<uint64_t>(data_length, IndexIOBase::kFooterLength);
+  std::unique_ptr<IndexInput> toc =
+      dir.openInput(entries_name, IOContext(IOContext::ReadOnce));
+  // The table is small, so it's always verified; the data file is verified
+  // on demand (see ChecksumVerifier)
+  toc->verifyChecksumFooter(dir.fileLength(entries_name));
+  toc->seek(0);
+  if (toc->readInt32() != CompoundFileWriter::kMagic)
+    throw Exception(
+        Exception::Code::IndexCorruptionException,
+        std::string("In CompoundFileDirectory::CompoundFileDirectory(): ")
+            .append(entries_name)
+            .append(" is not a compound file table of contents"));
+  uint32_t count = toc->readVarint32();
+  entries_.reserve(count);
+  std::string fname;
+  while (count--) {
+    toc->readString(fname);
+    Entry entry;
+    entry.offset = toc->readVarint64();
+    entry.length = toc->readVarint64();
+    if (entry.offset > data_length || entry.length > data_length - entry.offset)
+      throw Exception(
+          Exception::Code::IndexCorruptionException,
+          std::string("In CompoundFileDirectory::CompoundFileDirectory(): "
+                      "File named ")
+              .append(fname)
+              .append(" lies out of bounds of ")
+              .append(data_name));
+    if (!entries_.emplace(fname, entry).second)
+      throw Exception(
+          Exception::Code::IndexCorruptionException,
+          std::string("In CompoundFileDirectory::CompoundFileDirectory(): "
+                      "File named ")
+              .append(fname)
+              .append(" is listed twice in ")
+              .append(entries_name));
+  }
+  data_ = dir.openInput(data_name);
+}
+
+CompoundFileDirectory::~CompoundFileDirectory() = default;
+
+void CompoundFileDirectory::readOnly(const char *where) {
+  throw Exception(Exception::Code::UnsupportedOperationException,
+                  std::string("In CompoundFileDirectory::")
+                      .append(where)
+                      .append("(): CompoundFileDirectory is read-only"));
+}
+
+std::vector<std::string> CompoundFileDirectory::listAll() {
+  std::vector<std::string> ret;
+  ret.reserve(entries_.size());
+  for (auto &p : entries_)
+    ret.push_back(p.first);
+  return ret;
+}
+
+void CompoundFileDirectory::deleteFile(const std::string &) {
+  readOnly("deleteFile");
+}
+
+uint64_t CompoundFileDirectory::fileLength(const std::string &fname) {
+  auto it = entries_.find(fname);
+  if (it == entries_.end())
+    throw Exception(
+        Exception::Code::FileNotFoundException,
+        std::string("In CompoundFileDirectory::fileLength(): File named ")
+            .append(fname)
+            .append(" is not found in CompoundFileDirectory"));
+  return it->second.length;
+}
+
+std::unique_ptr<IndexOutput>
+CompoundFileDirectory::createOutput(const std::string &, const IOContext &) {
+  readOnly("createOutput");
+}
+
+void CompoundFileDirectory::rename(const std::string &, const std::string &) {
+  readOnly("rename");
+}
+
+void CompoundFileDirectory::replace(const std::string &, const std::string &) {
+  readOnly("replace");
+}
+
+std::unique_ptr<IndexInput>
+CompoundFileDirectory::openInput(const std::string &fname,
+                                 const IOContext &context) {
+  auto it = entries_.find(fname);
+  if (it == entries_.end())
+    throw Exception(
+        Exception::Code::FileNotFoundException,
+        std::string("In CompoundFileDirectory::openInput(): File named ")
+            .append(fname)
+            .append(" is not found in CompoundFileDirectory"));
+  std::unique_ptr<IndexInput> input =
+      data_->slice(it->second.offset, it->second.length);
+  track(*input, context);
+  return input;
+}
+
+std::unique_ptr<LockFile>
+CompoundFileDirectory::obtainLock(const std::string &) {
+  readOnly("obtainLock");
+}
+
+bool CompoundFileDirectory::fileExists(const std::string &fname) {
+  return entries_.find(fname) != entries_.end();
+}
+
+} // namespace lucanthrope
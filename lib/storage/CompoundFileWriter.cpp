@@ -0,0 +1,79 @@
+#include <iostream>
+#include <utility> // move()
+
+#include "IO/IndexInput.h"
+#include "IO/IndexOutput.h"
+#include "common/Exception.h"
+#include "storage/CompoundFileWriter.h"
+#include "storage/Directory.h"
+
+namespace lucanthrope {
+
+CompoundFileWriter::CompoundFileWriter(Directory &dir, const std::string &name,
+                                       const IOContext &context)
+    : dir_(dir), dataName_(std::string(name).append(kDataExtension)),
+      entriesName_(std::string(name).append(kEntriesExtension)),
+      context_(context.context) {
+  data_ = dir_.createOutput(dataName_, context);
+  data_->enableChecksum();
+}
+
+CompoundFileWriter::~CompoundFileWriter() {
+  if (finished_)
+    return;
+  // RAMDirectory doesn't allow deleting uncommited files
+  data_.reset();
+  for (const std::string *fname : {&dataName_, &entriesName_}) {
+    try {
+      if (dir_.fileExists(*fname))
+        dir_.deleteFile(*fname);
+    } catch (Exception &e) {
+      std::cerr << "WARNING: unable to delete incomplete compound file "
+                << *fname << ": " << e.what() << '\n';
+    }
+  }
+}
+
+void CompoundFileWriter::addFile(Directory &src, const std::string &fname) {
+  if (finished_ || !data_)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In CompoundFileWriter::addFile(): ")
+                        .append(dataName_)
+                        .append(" is already closed"));
+  if (names_.count(fname))
+    throw Exception(Exception::Code::FileAlreadyExistsException,
+                    std::string("In CompoundFileWriter::addFile(): File named ")
+                        .append(fname)
+                        .append(" is already added to ")
+                        .append(dataName_));
+  uint64_t length = src.fileLength(fname);
+  if (length) {
+    std::unique_ptr<IndexInput> input =
+        src.openInput(fname, IOContext(IOContext::ReadOnce));
+    data_->copyBytes(*input, length);
+  }
+  names_.insert(fname);
+  entries_.push_back(Entry{fname, dataLength_, length});
+  dataLength_ += length;
+}
+
+void CompoundFileWriter::finish() {
+  if (finished_)
+    return;
+  data_->writeChecksumFooter().flush();
+  data_.reset();
+  std::unique_ptr<IndexOutput> out = dir_.createOutput(entriesName_, context_);
+  out->enableChecksum();
+  out->writeInt32(kMagic);
+  out->writeVarint32(static_cast<uint32_t>(entries_.size()));
+  for (auto &entry : entries_) {
+    out->writeString(entry.name);
+    out->writeVarint64(entry.offset);
+    out->writeVarint64(entry.length);
+  }
+  out->writeChecksumFooter().flush();
+  out.reset();
+  finished_ = true;
+}
+
+} // namespace lucanthrope
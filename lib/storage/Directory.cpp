@@ -0,0 +1,65 @@
+#include <memory>
+#include <utility> // move()
+
+#include "IO/IndexInput.h"
+#include "IO/IndexOutput.h"
+#include "IO/RateLimiter.h"
+#include "storage/Directory.h"
+
+namespace lucanthrope {
+
+std::vector<std::string> Directory::listSegment(const std::string &segment) {
+  std::vector<std::string> ret;
+  for (auto &fname : listAll())
+    if (segmentOf(fname) == segment)
+      ret.push_back(std::move(fname));
+  return ret;
+}
+
+void Directory::copyFrom(Directory &from, const std::string &src,
+                         const std::string &dest) {
+  uint64_t length = from.fileLength(src);
+  std::unique_ptr<IndexOutput> output =
+      createOutput(dest, IOContext(IOContext::Default, length));
+  try {
+    if (length) {
+      std::unique_ptr<IndexInput> input =
+          from.openInput(src, IOContext(IOContext::ReadOnce));
+      output->copyBytes(*input, length);
+    }
+    output->flush();
+  } catch (...) {
+    output.reset(); // RAMDirectory doesn't allow deleting uncommited files
+    try {
+      deleteFile(dest);
+    } catch (...) {
+    }
+    throw;
+  }
+}
+
+IOCounters Directory::getIOStats(IOContext::Context context) {
+  return (*ioCounters_)[context].load();
+}
+
+void Directory::setMergeRateLimiter(std::shared_ptr<RateLimiter> rateLimiter) {
+  std::lock_guard<std::mutex> guard(rateLimiterMu_);
+  mergeRateLimiter_ = std::move(rateLimiter);
+}
+
+std::shared_ptr<RateLimiter> Directory::getMergeRateLimiter() {
+  std::lock_guard<std::mutex> guard(rateLimiterMu_);
+  return mergeRateLimiter_;
+}
+
+void Directory::track(IndexOutput &output, const IOContext &context) {
+  output.setIOCounters(countersOf(context.context));
+  if (context.context == IOContext::Merge)
+    output.setRateLimiter(getMergeRateLimiter());
+}
+
+void Directory::track(IndexInput &input, const IOContext &context) {
+  input.setIOCounters(countersOf(context.context));
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,311 @@
+#include <cerrno>
+#include <cstdio> // rename(), renameat2()
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory> // make_shared()
+#include <system_error>
+#include <unordered_set>
+
+#include <fcntl.h> // AT_FDCWD
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "IO/CachedFSIndexInput.h" // private header
+#include "IO/FSIndexInput.h"  // private header
+#include "IO/FSIndexOutput.h" // private header
+#include "IO/FileDescriptor.h" // private header
+#include "IO/IndexInput.h"
+#include "IO/IndexOutput.h"
+#include "IO/MMapIndexInput.h" // private header
+#include "common/Exception.h"
+#include "common/ThreadPool.h"
+#include "storage/FSDirectory.h"
+#include "storage/FSDirectoryLockFile.h" // private header
+
+namespace lucanthrope {
+
+FSDirectory::FSDirectory(const std::string &path, bool useMMap)
+    : path_(path), useMMap_(useMMap) {
+  std::error_code ec;
+  std::filesystem::create_directories(path_, ec);
+  if (ec || !std::filesystem::is_directory(path_, ec))
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In FSDirectory::FSDirectory(): ")
+                        .append(path_)
+                        .append(" is not a directory and cannot be created"));
+}
+
+struct FSDirectory::SyncBatch {
+  std::unordered_set<std::string> fnames;
+  bool done = false;
+  std::exception_ptr error;
+};
+
+FSDirectory::~FSDirectory() = default;
+
+void FSDirectory::setUseSyncFS(bool useSyncFS) {
+  std::lock_guard<std::mutex> guard(syncMu_);
+  useSyncFS_ = useSyncFS;
+}
+
+std::string FSDirectory::pathOf(const std::string &fname) const {
+  std::string ret(path_);
+  if (!ret.empty() && ret.back() != '/')
+    ret.push_back('/');
+  return ret.append(fname);
+}
+
+static BlockCache::FileKey keyOf(const struct stat &st) {
+  BlockCache::FileKey key;
+  key.device = static_cast<uint64_t>(st.st_dev);
+  key.inode = static_cast<uint64_t>(st.st_ino);
+#ifdef __APPLE__
+  const struct timespec &mtime = st.st_mtimespec;
+#else
+  const struct timespec &mtime = st.st_mtim;
+#endif
+  key.version = static_cast<uint64_t>(mtime.tv_sec) * 1000000000ULL +
+                static_cast<uint64_t>(mtime.tv_nsec);
+  return key;
+}
+
+BlockCache::FileKey FSDirectory::fileKeyOf(const std::string &fname) const {
+  std::string path = pathOf(fname);
+  struct stat st;
+  if (::stat(path.c_str(), &st))
+    throwIOError("FSDirectory::fileKeyOf()", path, errno);
+  return keyOf(st);
+}
+
+void FSDirectory::pinFile(const std::string &fname) {
+  if (!cache_)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string_view("In FSDirectory::pinFile(): there is no "
+                                     "block cache"));
+  cache_->pinFile(fileKeyOf(fname));
+}
+
+void FSDirectory::unpinFile(const std::string &fname) {
+  if (!cache_)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string_view("In FSDirectory::unpinFile(): there is no "
+                                     "block cache"));
+  cache_->unpinFile(fileKeyOf(fname));
+}
+
+void FSDirectory::releaseLock(const std::string &fname) noexcept {
+  std::string path = pathOf(fname);
+  if (::unlink(path.c_str()))
+    std::cerr << "WARNING: unable to remove lock file " << path
+              << ", directory will stay locked!\n";
+}
+
+std::vector<std::string> FSDirectory::listAll() {
+  std::vector<std::string> ret;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(path_, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (it->is_regular_file(ec))
+      ret.push_back(it->path().filename().string());
+  }
+  if (ec)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In FSDirectory::listAll(): ")
+                        .append(path_)
+                        .append(": ")
+                        .append(ec.message()));
+  return ret;
+}
+
+void FSDirectory::deleteFile(const std::string &fname) {
+  std::string path = pathOf(fname);
+  struct stat st;
+  bool cached = cache_ && !::stat(path.c_str(), &st);
+  if (::unlink(path.c_str()))
+    throwIOError("FSDirectory::deleteFile()", path, errno);
+  if (cached) {
+    cache_->unpinFile(keyOf(st));
+    cache_->invalidateFile(keyOf(st));
+  }
+}
+
+uint64_t FSDirectory::fileLength(const std::string &fname) {
+  std::string path = pathOf(fname);
+  struct stat st;
+  if (::stat(path.c_str(), &st))
+    throwIOError("FSDirectory::fileLength()", path, errno);
+  return static_cast<uint64_t>(st.st_size);
+}
+
+std::unique_ptr<IndexOutput>
+FSDirectory::createOutput(const std::string &fname,
+                          const IOContext &context) {
+  std::string path = pathOf(fname);
+  FileDescriptor fd =
+      FileDescriptor::open(path, O_WRONLY | O_CREAT | O_EXCL);
+  std::unique_ptr<IndexOutput> output(new FSIndexOutput(std::move(fd), path));
+  track(*output, context);
+  return output;
+}
+
+void FSDirectory::rename(const std::string &src, const std::string &target) {
+  std::string src_path = pathOf(src);
+  std::string target_path = pathOf(target);
+  // Checking for the target and renaming must be one step, or a target
+  // created in between would be overwritten
+#if defined(__linux__) && defined(RENAME_NOREPLACE)
+  if (!::renameat2(AT_FDCWD, src_path.c_str(), AT_FDCWD, target_path.c_str(),
+                   RENAME_NOREPLACE))
+    return;
+  if (errno != EINVAL && errno != ENOSYS)
+    throwIOError("FSDirectory::rename()",
+                 errno == EEXIST ? target_path : src_path, errno);
+  // the file system doesn't support it; link() refuses existing targets too
+#endif
+  if (::link(src_path.c_str(), target_path.c_str()))
+    throwIOError("FSDirectory::rename()",
+                 errno == EEXIST ? target_path : src_path, errno);
+  if (::unlink(src_path.c_str())) {
+    int err = errno;
+    ::unlink(target_path.c_str());
+    throwIOError("FSDirectory::rename()", src_path, err);
+  }
+}
+
+void FSDirectory::replace(const std::string &src, const std::string &target) {
+  // rename() replaces an existing target atomically
+  std::string src_path = pathOf(src);
+  if (std::rename(src_path.c_str(), pathOf(target).c_str()))
+    throwIOError("FSDirectory::replace()", src_path, errno);
+}
+
+std::unique_ptr<IndexInput> FSDirectory::openInput(const std::string &fname,
+                                                   const IOContext &context) {
+  std::string path = pathOf(fname);
+  FileDescriptor fd = FileDescriptor::open(path, O_RDONLY);
+  struct stat st = fd.stat(path);
+  uint64_t length = static_cast<uint64_t>(st.st_size);
+  const bool sequential = context.context == IOContext::ReadOnce ||
+                          context.context == IOContext::Merge;
+  std::unique_ptr<IndexInput> input;
+  if (useMMap_) {
+    auto map = std::make_shared<const MappedFile>(fd, length, path);
+    if (sequential)
+      map->advise(MADV_SEQUENTIAL);
+    input.reset(new MMapIndexInput(std::move(map), 0, length));
+  } else {
+    auto shared_fd = std::make_shared<const FileDescriptor>(std::move(fd));
+    if (cache_ && !sequential)
+      input.reset(new CachedFSIndexInput(std::move(shared_fd), path, length, 0,
+                                         length, cache_, keyOf(st)));
+    else
+      input.reset(new FSIndexInput(std::move(shared_fd), path, 0, length));
+  }
+  track(*input, context);
+  return input;
+}
+
+std::unique_ptr<LockFile> FSDirectory::obtainLock(const std::string &fname) {
+  std::string path = pathOf(fname);
+  try {
+    FileDescriptor::open(path, O_WRONLY | O_CREAT | O_EXCL);
+  } catch (Exception &e) {
+    if (e.code() == Exception::Code::FileAlreadyExistsException)
+      return std::unique_ptr<LockFile>(); // lock is held by someone
+    throw;
+  }
+  try {
+    return std::unique_ptr<LockFile>(new FSDirectoryLockFile(this, fname));
+  } catch (...) {
+    ::unlink(path.c_str());
+    throw;
+  }
+}
+
+bool FSDirectory::fileExists(const std::string &fname) {
+  std::string path = pathOf(fname);
+  struct stat st;
+  if (!::stat(path.c_str(), &st))
+    return true;
+  if (errno != ENOENT)
+    throwIOError("FSDirectory::fileExists()", path, errno);
+  return false;
+}
+
+void FSDirectory::deleteSegment(const std::string &segment) noexcept {
+  try {
+    for (auto &fname : listSegment(segment)) {
+      try {
+        deleteFile(fname);
+      } catch (Exception &) {
+        // keep deleting the rest
+      }
+    }
+  } catch (...) {
+    std::cerr << "WARNING: unable to list " << path_ << ", segment " << segment
+              << " is not deleted\n";
+  }
+}
+
+void FSDirectory::syncBatch(const SyncBatch &batch, bool viaSyncFS) {
+  std::vector<std::future<void>> results;
+  if (!viaSyncFS) {
+    if (!syncPool_)
+      syncPool_.reset(new ThreadPool(kSyncThreads));
+    results.reserve(batch.fnames.size());
+    for (auto &fname : batch.fnames)
+      results.push_back(syncPool_->submit([this, &fname] {
+        std::string path = pathOf(fname);
+        FileDescriptor::open(path, O_RDONLY).datasync(path);
+      }));
+    waitAll(results);
+  } else {
+    // syncfs() doesn't complain about missing files
+    for (auto &fname : batch.fnames)
+      if (!fileExists(fname))
+        throwIOError("FSDirectory::sync()", pathOf(fname), ENOENT);
+  }
+  FileDescriptor dir = FileDescriptor::open(path_, O_RDONLY | O_DIRECTORY);
+#ifdef __linux__
+  if (viaSyncFS && ::syncfs(dir.get()))
+    throwIOError("syncfs()", path_, errno);
+#endif
+  dir.sync(path_);
+}
+
+void FSDirectory::sync(const std::vector<std::string> &fnames) {
+  if (fnames.empty())
+    return;
+  std::unique_lock<std::mutex> lock(syncMu_);
+  if (!nextBatch_)
+    nextBatch_ = std::make_shared<SyncBatch>();
+  std::shared_ptr<SyncBatch> batch = nextBatch_;
+  batch->fnames.insert(fnames.begin(), fnames.end());
+  // Wait until either somebody else syncs our batch, or nobody is syncing and
+  // we become the leader of our batch
+  syncCv_.wait(lock, [&] { return batch->done || !syncing_; });
+  if (!batch->done) {
+    syncing_ = true;
+    nextBatch_.reset(); // requests from now on go to the next batch
+    bool viaSyncFS = false;
+#ifdef __linux__
+    viaSyncFS = useSyncFS_;
+#endif
+    lock.unlock();
+    try {
+      syncBatch(*batch, viaSyncFS);
+    } catch (...) {
+      batch->error = std::current_exception();
+    }
+    lock.lock();
+    batch->done = true;
+    syncing_ = false;
+    syncCv_.notify_all();
+  }
+  if (batch->error)
+    std::rethrow_exception(batch->error);
+}
+
+} // namespace lucanthrope
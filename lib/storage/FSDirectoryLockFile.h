@@ -0,0 +1,22 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <string>
+
+#include "storage/FSDirectory.h"
+#include "storage/LockFile.h"
+
+namespace lucanthrope {
+
+class FSDirectoryLockFile : public LockFile {
+private:
+  FSDirectory *parent;
+  std::string name;
+
+public:
+  FSDirectoryLockFile(FSDirectory *dir, const std::string &fname)
+      : parent(dir), name(fname) {}
+  virtual ~FSDirectoryLockFile() override { parent->releaseLock(name); }
+};
+
+} // namespace lucanthrope
@@ -0,0 +1,712 @@
+#include <algorithm> // min()
+#include <cerrno>
+#include <chrono>
+#include <cstdio> // rename()
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <utility> // move()
+
+#include <unistd.h>
+
+#include "IO/FSIndexInput.h"  // private header
+#include "IO/FSIndexOutput.h" // private header
+#include "IO/FileDescriptor.h" // private header
+#include "IO/LogIndexInput.h"  // private header
+#include "IO/LogIndexOutput.h" // private header
+#include "common/Exception.h"
+#include "storage/LogStructuredDirectory.h"
+#include "storage/LogStructuredDirectoryLockFile.h" // private header
+
+namespace lucanthrope {
+
+// "LSD1"
+static constexpr uint32_t kManifestMagic = 0x3144534c;
+static const char *const kManifestName = "MANIFEST";
+static const char *const kManifestTmpName = "MANIFEST.tmp";
+static constexpr size_t kCopyBufferSize = 64 * 1024;
+
+LogStructuredDirectory::LogStructuredDirectory(const std::string &path,
+                                               uint64_t maxLogSize,
+                                               bool backgroundCompaction)
+    : path_(path), maxLogSize_(maxLogSize) {
+  std::error_code ec;
+  std::filesystem::create_directories(path_, ec);
+  if (ec || !std::filesystem::is_directory(path_, ec))
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In LogStructuredDirectory::"
+                                "LogStructuredDirectory(): ")
+                        .append(path_)
+                        .append(" is not a directory and cannot be created"));
+  recover();
+  if (backgroundCompaction)
+    bgThread_ = std::thread([this] { backgroundLoop(); });
+}
+
+LogStructuredDirectory::~LogStructuredDirectory() {
+  if (bgThread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(bgMu_);
+      bgStop_ = true;
+    }
+    bgCv_.notify_one();
+    bgThread_.join();
+  }
+  try {
+    writeManifest();
+  } catch (Exception &e) {
+    std::cerr << "WARNING: unable to write manifest of " << path_
+              << ", changes since the last sync are lost: " << e.what()
+              << '\n';
+  }
+}
+
+std::string LogStructuredDirectory::pathIn(const std::string &dir,
+                                           const std::string &fname) {
+  std::string ret(dir);
+  if (!ret.empty() && ret.back() != '/')
+    ret.push_back('/');
+  return ret.append(fname);
+}
+
+std::string LogStructuredDirectory::logPathIn(const std::string &dir,
+                                              uint64_t log) {
+  return pathIn(dir, "log." + std::to_string(log));
+}
+
+// Returns true and sets id if fname is the name of a log.
+static bool parseLogName(const std::string &fname, uint64_t &id) {
+  if (fname.size() <= 4 || fname.compare(0, 4, "log.") != 0)
+    return false;
+  id = 0;
+  for (size_t i = 4; i < fname.size(); i++) {
+    if (fname[i] < '0' || fname[i] > '9')
+      return false;
+    id = id * 10 + static_cast<uint64_t>(fname[i] - '0');
+  }
+  return true;
+}
+
+[[noreturn]] static void throwCorrupted(const std::string &path,
+                                        const char *what) {
+  throw Exception(Exception::Code::IndexCorruptionException,
+                  std::string("In LogStructuredDirectory::recover(): ")
+                      .append(path)
+                      .append(": ")
+                      .append(what));
+}
+
+void LogStructuredDirectory::recover() {
+  // Called by the constructor only, so nothing needs locking
+  std::vector<uint64_t> found;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(path_, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    uint64_t id;
+    if (parseLogName(it->path().filename().string(), id)) {
+      found.push_back(id);
+      nextLog_ = std::max(nextLog_, id + 1);
+    }
+  }
+  if (ec)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In LogStructuredDirectory::recover(): ")
+                        .append(path_)
+                        .append(": ")
+                        .append(ec.message()));
+
+  std::string manifest = pathIn(path_, kManifestName);
+  if (::access(manifest.c_str(), F_OK) == 0) {
+    auto fd = std::make_shared<const FileDescriptor>(
+        FileDescriptor::open(manifest, O_RDONLY));
+    uint64_t size = fd->size(manifest);
+    FSIndexInput input(fd, manifest, 0, size);
+    input.verifyChecksumFooter(size);
+    input.seek(0);
+    if (input.readInt32() != kManifestMagic)
+      throwCorrupted(manifest, "bad magic number");
+    uint32_t count = input.readVarint32();
+    std::string name;
+    while (count--) {
+      input.readString(name);
+      auto info = std::make_shared<FileInfo>();
+      info->length = input.readVarint64();
+      uint32_t numExtents = input.readVarint32();
+      uint64_t total = 0;
+      while (numExtents--) {
+        Extent extent;
+        extent.log = input.readVarint64();
+        extent.offset = input.readVarint64();
+        extent.length = input.readVarint64();
+        auto log = logs_.find(extent.log);
+        if (log == logs_.end()) {
+          std::string path = logPath(extent.log);
+          Log opened;
+          opened.fd = std::make_shared<const FileDescriptor>(
+              FileDescriptor::open(path, O_RDWR));
+          opened.size = opened.fd->size(path);
+          log = logs_.emplace(extent.log, std::move(opened)).first;
+        }
+        if (extent.offset + extent.length > log->second.size)
+          throwCorrupted(manifest, "extent lies past the end of its log");
+        extent.fd = log->second.fd;
+        log->second.liveBytes += extent.length;
+        total += extent.length;
+        info->extents.push_back(std::move(extent));
+      }
+      if (total != info->length)
+        throwCorrupted(manifest, "file length doesn't match its extents");
+      files_[name] = std::move(info);
+    }
+  }
+
+  // Logs which the manifest doesn't reference hold nothing but bytes of files
+  // which were never made durable
+  for (uint64_t id : found)
+    if (!logs_.count(id) && ::unlink(logPath(id).c_str()) && errno != ENOENT)
+      throwIOError("LogStructuredDirectory::recover()", logPath(id), errno);
+  ::unlink(pathIn(path_, kManifestTmpName).c_str());
+
+  // Logs may end with garbage, so appending always starts in a new one
+  rollLocked();
+}
+
+void LogStructuredDirectory::rollLocked() {
+  uint64_t id = nextLog_;
+  std::string path = logPath(id);
+  Log log;
+  log.fd = std::make_shared<const FileDescriptor>(
+      FileDescriptor::open(path, O_RDWR | O_CREAT | O_EXCL));
+  logs_.emplace(id, std::move(log));
+  nextLog_ = id + 1;
+  activeLog_ = id;
+}
+
+LogStructuredDirectory::Extent LogStructuredDirectory::append(const char *data,
+                                                              size_t size) {
+  Extent extent;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    Log *log = &logs_.at(activeLog_);
+    if (log->size && log->size + size > maxLogSize_) {
+      rollLocked();
+      log = &logs_.at(activeLog_);
+    }
+    extent.log = activeLog_;
+    extent.offset = log->size;
+    extent.length = size;
+    extent.fd = log->fd;
+    log->size += size;
+    log->liveBytes += size;
+  }
+  // Writers own disjoint ranges of the log, so they don't need the lock
+  try {
+    extent.fd->pwrite(data, size, extent.offset, logPath(extent.log));
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(mu_);
+    releaseLocked(extent);
+    throw;
+  }
+  // Only now, or writeManifest() could sync the log before the bytes are in
+  // it, and then skip it once the file that references them is committed.
+  // The extent is live, so the log is still there.
+  std::lock_guard<std::mutex> guard(mu_);
+  logs_.at(extent.log).dirty = true;
+  return extent;
+}
+
+void LogStructuredDirectory::releaseLocked(const Extent &extent) {
+  auto log = logs_.find(extent.log);
+  if (log != logs_.end())
+    log->second.liveBytes -= extent.length;
+  garbageBytes_ += extent.length;
+}
+
+void LogStructuredDirectory::commit(const std::string &fname,
+                                    std::shared_ptr<const FileInfo> info) {
+  std::lock_guard<std::mutex> guard(mu_);
+  auto it = files_.find(fname);
+  if (it == files_.end() || it->second) {
+    // Can't happen: the name is reserved by createOutput(), and
+    // deleteFile()/rename() refuse to touch it until it's committed
+    std::cerr << "WARNING: " << fname
+              << " is not reserved in the directory, its contents are lost\n";
+    for (auto &extent : info->extents)
+      releaseLocked(extent);
+    return;
+  }
+  it->second = std::move(info);
+  version_++;
+}
+
+void LogStructuredDirectory::abandon(const std::string &fname,
+                                     const FileInfo &info) {
+  std::lock_guard<std::mutex> guard(mu_);
+  for (auto &extent : info.extents)
+    releaseLocked(extent);
+  auto it = files_.find(fname);
+  if (it != files_.end() && !it->second)
+    files_.erase(it);
+}
+
+void LogStructuredDirectory::writeManifest() {
+  std::lock_guard<std::mutex> manifestGuard(manifestMu_);
+  std::vector<std::pair<std::string, std::shared_ptr<const FileInfo>>> files;
+  std::vector<std::pair<uint64_t, std::shared_ptr<const FileDescriptor>>> dirty;
+  uint64_t version;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    if (version_ == manifestVersion_)
+      return;
+    version = version_;
+    files.reserve(files_.size());
+    for (auto &f : files_)
+      if (f.second)
+        files.emplace_back(f.first, f.second);
+    for (auto &log : logs_)
+      if (log.second.dirty) {
+        dirty.emplace_back(log.first, log.second.fd);
+        log.second.dirty = false;
+      }
+  }
+
+  // The manifest must never reference bytes which are not durable
+  try {
+    for (auto &log : dirty)
+      log.second->datasync(logPath(log.first));
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (auto &log : dirty) {
+      auto it = logs_.find(log.first);
+      if (it != logs_.end())
+        it->second.dirty = true;
+    }
+    throw;
+  }
+
+  std::string tmp = pathIn(path_, kManifestTmpName);
+  {
+    FSIndexOutput output(FileDescriptor::open(tmp, O_WRONLY | O_CREAT | O_TRUNC),
+                         tmp);
+    output.enableChecksum();
+    output.writeInt32(kManifestMagic);
+    output.writeVarint32(static_cast<uint32_t>(files.size()));
+    for (auto &f : files) {
+      output.writeString(f.first);
+      output.writeVarint64(f.second->length);
+      output.writeVarint32(static_cast<uint32_t>(f.second->extents.size()));
+      for (auto &extent : f.second->extents) {
+        output.writeVarint64(extent.log);
+        output.writeVarint64(extent.offset);
+        output.writeVarint64(extent.length);
+      }
+    }
+    output.writeChecksumFooter().sync();
+  }
+  std::string manifest = pathIn(path_, kManifestName);
+  if (std::rename(tmp.c_str(), manifest.c_str()))
+    throwIOError("LogStructuredDirectory::writeManifest()", manifest, errno);
+  FileDescriptor::open(path_, O_RDONLY | O_DIRECTORY).sync(path_);
+  manifestVersion_ = version;
+}
+
+void LogStructuredDirectory::moveFilesOut(
+    const std::unordered_set<uint64_t> &victims) {
+  std::vector<std::pair<std::string, std::shared_ptr<const FileInfo>>> todo;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (auto &f : files_) {
+      if (!f.second)
+        continue;
+      for (auto &extent : f.second->extents)
+        if (victims.count(extent.log)) {
+          todo.emplace_back(f.first, f.second);
+          break;
+        }
+    }
+  }
+
+  std::unique_ptr<char[]> buffer(new char[kCopyBufferSize]);
+  for (auto &f : todo) {
+    const FileInfo &old = *f.second;
+    auto moved = std::make_shared<FileInfo>();
+    moved->length = old.length;
+    moved->extents.reserve(old.extents.size());
+    // Appended by us, and given back if the file can't be replaced
+    std::vector<Extent> fresh;
+    try {
+      for (auto &extent : old.extents) {
+        if (!victims.count(extent.log)) {
+          moved->extents.push_back(extent);
+          continue;
+        }
+        for (uint64_t done = 0; done < extent.length;) {
+          size_t size = static_cast<size_t>(
+              std::min<uint64_t>(kCopyBufferSize, extent.length - done));
+          std::string path = logPath(extent.log);
+          if (extent.fd->pread(buffer.get(), size, extent.offset + done,
+                               path) != size)
+            throwIOError("LogStructuredDirectory::compact()", path, EIO);
+          fresh.reserve(fresh.size() + 1);
+          moved->extents.reserve(moved->extents.size() + 1);
+          fresh.push_back(append(buffer.get(), size));
+          Extent &last = fresh.back();
+          if (!moved->extents.empty() &&
+              moved->extents.back().log == last.log &&
+              moved->extents.back().offset + moved->extents.back().length ==
+                  last.offset)
+            moved->extents.back().length += last.length;
+          else
+            moved->extents.push_back(last);
+          done += size;
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(mu_);
+      for (auto &extent : fresh)
+        releaseLocked(extent);
+      throw;
+    }
+
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = files_.find(f.first);
+    if (it != files_.end() && it->second == f.second) {
+      for (auto &extent : old.extents)
+        if (victims.count(extent.log))
+          releaseLocked(extent);
+      it->second = std::move(moved);
+      version_++;
+    } else {
+      // deleted or renamed meanwhile; the victim stays for the next time
+      for (auto &extent : fresh)
+        releaseLocked(extent);
+    }
+  }
+}
+
+uint64_t LogStructuredDirectory::compact() {
+  std::lock_guard<std::mutex> compactGuard(compactMu_);
+  std::unordered_set<uint64_t> victims;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    garbageBytes_ = 0;
+    for (auto &log : logs_)
+      if (log.first != activeLog_ &&
+          static_cast<double>(log.second.size - log.second.liveBytes) >=
+              kCompactionGarbageRatio * static_cast<double>(log.second.size))
+        victims.insert(log.first);
+  }
+  if (victims.empty())
+    return 0;
+  moveFilesOut(victims);
+
+  // Nothing references a log whose live bytes dropped to zero, and nothing
+  // ever will, since only the active log is appended to. Once the manifest
+  // stops referencing it too, it can go.
+  std::vector<uint64_t> dead;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (uint64_t id : victims)
+      if (!logs_.at(id).liveBytes)
+        dead.push_back(id);
+  }
+  if (dead.empty())
+    return 0;
+  writeManifest();
+  uint64_t reclaimed = 0;
+  for (uint64_t id : dead) {
+    std::string path = logPath(id);
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      auto it = logs_.find(id);
+      reclaimed += it->second.size;
+      // Open inputs keep their own references to the descriptor
+      logs_.erase(it);
+    }
+    if (::unlink(path.c_str()))
+      throwIOError("LogStructuredDirectory::compact()", path, errno);
+  }
+  return reclaimed;
+}
+
+void LogStructuredDirectory::backgroundLoop() {
+  std::unique_lock<std::mutex> lock(bgMu_);
+  while (true) {
+    bgCv_.wait_for(lock, std::chrono::milliseconds(kCompactionIntervalMillis),
+                   [this] { return bgStop_ || bgWakeUp_; });
+    if (bgStop_)
+      return;
+    bgWakeUp_ = false;
+    lock.unlock();
+    try {
+      compact();
+    } catch (Exception &e) {
+      // garbage stays until the next attempt
+      std::cerr << "WARNING: background compaction of " << path_
+                << " failed: " << e.what() << '\n';
+    }
+    lock.lock();
+  }
+}
+
+uint64_t LogStructuredDirectory::logBytes() {
+  std::lock_guard<std::mutex> guard(mu_);
+  uint64_t ret = 0;
+  for (auto &log : logs_)
+    ret += log.second.size;
+  return ret;
+}
+
+uint64_t LogStructuredDirectory::liveBytes() {
+  std::lock_guard<std::mutex> guard(mu_);
+  uint64_t ret = 0;
+  for (auto &log : logs_)
+    ret += log.second.liveBytes;
+  return ret;
+}
+
+void LogStructuredDirectory::releaseLock(const std::string &fname) noexcept {
+  std::lock_guard<std::mutex> guard(mu_);
+  locks_.erase(fname);
+}
+
+std::vector<std::string> LogStructuredDirectory::listAll() {
+  std::lock_guard<std::mutex> guard(mu_);
+  std::vector<std::string> ret;
+  ret.reserve(files_.size() + locks_.size());
+  for (auto &f : files_)
+    ret.push_back(f.first);
+  ret.insert(ret.end(), locks_.begin(), locks_.end());
+  return ret;
+}
+
+void LogStructuredDirectory::deleteFile(const std::string &fname) {
+  // Destroyed outside of the lock, since it may close log descriptors
+  std::shared_ptr<const FileInfo> info;
+  bool wakeUp;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = files_.find(fname);
+    if (it == files_.end())
+      throw Exception(
+          Exception::Code::FileNotFoundException,
+          std::string("In LogStructuredDirectory::deleteFile(): File named ")
+              .append(fname)
+              .append(" doesn't exist in LogStructuredDirectory"));
+    if (!it->second)
+      throw Exception(
+          Exception::Code::IOErrorException,
+          std::string("In LogStructuredDirectory::deleteFile(): File named ")
+              .append(fname)
+              .append(" is still being written"));
+    info = std::move(it->second);
+    files_.erase(it);
+    version_++;
+    for (auto &extent : info->extents)
+      releaseLocked(extent);
+    wakeUp = garbageBytes_ >= maxLogSize_ / 2;
+  }
+  if (wakeUp && bgThread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(bgMu_);
+      bgWakeUp_ = true;
+    }
+    bgCv_.notify_one();
+  }
+}
+
+uint64_t LogStructuredDirectory::fileLength(const std::string &fname) {
+  std::lock_guard<std::mutex> guard(mu_);
+  auto it = files_.find(fname);
+  if (it == files_.end()) {
+    if (locks_.count(fname))
+      return 0;
+    throw Exception(
+        Exception::Code::FileNotFoundException,
+        std::string("In LogStructuredDirectory::fileLength(): File named ")
+            .append(fname)
+            .append(" doesn't exist in LogStructuredDirectory"));
+  }
+  return it->second ? it->second->length : 0;
+}
+
+std::unique_ptr<IndexOutput>
+LogStructuredDirectory::createOutput(const std::string &fname,
+                                     const IOContext &context) {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    if (files_.count(fname) || locks_.count(fname))
+      throw Exception(
+          Exception::Code::FileAlreadyExistsException,
+          std::string("In LogStructuredDirectory::createOutput(): File named ")
+              .append(fname)
+              .append(" already exists in LogStructuredDirectory"));
+    files_.emplace(fname, nullptr);
+  }
+  std::unique_ptr<IndexOutput> output;
+  try {
+    output.reset(new LogIndexOutput(this, fname));
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(mu_);
+    files_.erase(fname);
+    throw;
+  }
+  track(*output, context);
+  return output;
+}
+
+void LogStructuredDirectory::rename(const std::string &src,
+                                   const std::string &target) {
+  std::lock_guard<std::mutex> guard(mu_);
+  auto it = files_.find(src);
+  if (it == files_.end())
+    throw Exception(
+        Exception::Code::FileNotFoundException,
+        std::string("In LogStructuredDirectory::rename(): File named ")
+            .append(src)
+            .append(" doesn't exist in LogStructuredDirectory"));
+  if (!it->second)
+    throw Exception(
+        Exception::Code::IOErrorException,
+        std::string("In LogStructuredDirectory::rename(): File named ")
+            .append(src)
+            .append(" is still being written"));
+  if (files_.count(target) || locks_.count(target))
+    throw Exception(
+        Exception::Code::FileAlreadyExistsException,
+        std::string("In LogStructuredDirectory::rename(): File named ")
+            .append(target)
+            .append(" already exists in LogStructuredDirectory"));
+  files_.emplace(target, it->second);
+  files_.erase(src);
+  version_++;
+}
+
+void LogStructuredDirectory::replace(const std::string &src,
+                                     const std::string &target) {
+  // Destroyed outside of the lock, since it may close log descriptors
+  std::shared_ptr<const FileInfo> old;
+  std::lock_guard<std::mutex> guard(mu_);
+  auto it = files_.find(src);
+  if (it == files_.end())
+    throw Exception(
+        Exception::Code::FileNotFoundException,
+        std::string("In LogStructuredDirectory::replace(): File named ")
+            .append(src)
+            .append(" doesn't exist in LogStructuredDirectory"));
+  auto replaced = files_.find(target);
+  if (!it->second || (replaced != files_.end() && !replaced->second) ||
+      locks_.count(target))
+    throw Exception(
+        Exception::Code::IOErrorException,
+        std::string("In LogStructuredDirectory::replace(): File named ")
+            .append(it->second ? target : src)
+            .append(" is still being written or is locked"));
+  if (replaced == it)
+    return;
+  std::shared_ptr<const FileInfo> info = std::move(it->second);
+  files_.erase(it);
+  if (replaced != files_.end()) {
+    old = std::move(replaced->second);
+    for (auto &extent : old->extents)
+      releaseLocked(extent);
+    replaced->second = std::move(info);
+  } else {
+    files_.emplace(target, std::move(info));
+  }
+  version_++;
+}
+
+std::unique_ptr<IndexInput>
+LogStructuredDirectory::openInput(const std::string &fname,
+                                  const IOContext &context) {
+  std::shared_ptr<const FileInfo> info;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto it = files_.find(fname);
+    if (it == files_.end())
+      throw Exception(
+          Exception::Code::FileNotFoundException,
+          std::string("In LogStructuredDirectory::openInput(): File named ")
+              .append(fname)
+              .append(" doesn't exist in LogStructuredDirectory"));
+    if (!it->second)
+      throw Exception(
+          Exception::Code::IOErrorException,
+          std::string("In LogStructuredDirectory::openInput(): File named ")
+              .append(fname)
+              .append(" is still being written"));
+    info = it->second;
+  }
+  uint64_t length = info->length;
+  std::unique_ptr<IndexInput> input(
+      new LogIndexInput(std::move(info), path_, 0, length));
+  track(*input, context);
+  return input;
+}
+
+std::unique_ptr<LockFile>
+LogStructuredDirectory::obtainLock(const std::string &fname) {
+  std::lock_guard<std::mutex> guard(mu_);
+  if (files_.count(fname) || locks_.count(fname)) // lock is held by someone
+    return std::unique_ptr<LockFile>();
+  locks_.insert(fname);
+  try {
+    return std::unique_ptr<LockFile>(
+        new LogStructuredDirectoryLockFile(this, fname));
+  } catch (...) {
+    locks_.erase(fname);
+    throw;
+  }
+}
+
+bool LogStructuredDirectory::fileExists(const std::string &fname) {
+  std::lock_guard<std::mutex> guard(mu_);
+  return files_.count(fname) || locks_.count(fname);
+}
+
+bool LogStructuredDirectory::fileCommitted(const std::string &fname) {
+  std::lock_guard<std::mutex> guard(mu_);
+  auto it = files_.find(fname);
+  return it != files_.end() && it->second;
+}
+
+void LogStructuredDirectory::deleteSegment(const std::string &segment) noexcept {
+  try {
+    for (auto &fname : listSegment(segment)) {
+      try {
+        deleteFile(fname);
+      } catch (Exception &) {
+        // keep deleting the rest (locks and files being written stay)
+      }
+    }
+  } catch (...) {
+    std::cerr << "WARNING: segment " << segment << " is not deleted\n";
+  }
+}
+
+void LogStructuredDirectory::sync(const std::vector<std::string> &fnames) {
+  if (fnames.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (auto &fname : fnames) {
+      auto it = files_.find(fname);
+      if (it == files_.end())
+        throw Exception(
+            Exception::Code::FileNotFoundException,
+            std::string("In LogStructuredDirectory::sync(): File named ")
+                .append(fname)
+                .append(" doesn't exist in LogStructuredDirectory"));
+      if (!it->second)
+        throw Exception(
+            Exception::Code::IOErrorException,
+            std::string("In LogStructuredDirectory::sync(): File named ")
+                .append(fname)
+                .append(" is still being written"));
+    }
+  }
+  writeManifest();
+}
+
+} // namespace lucanthrope
@@ -0,0 +1,25 @@
+// PRIVATE HEADER
+#pragma once
+
+#include <string>
+
+#include "storage/LockFile.h"
+#include "storage/LogStructuredDirectory.h"
+
+namespace lucanthrope {
+
+class LogStructuredDirectoryLockFile : public LockFile {
+private:
+  LogStructuredDirectory *parent;
+  std::string name;
+
+public:
+  LogStructuredDirectoryLockFile(LogStructuredDirectory *dir,
+                                 const std::string &fname)
+      : parent(dir), name(fname) {}
+  virtual ~LogStructuredDirectoryLockFile() override {
+    parent->releaseLock(name);
+  }
+};
+
+} // namespace lucanthrope
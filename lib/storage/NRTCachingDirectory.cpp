@@ -0,0 +1,284 @@
+#include <algorithm> // sort(), unique()
+#include <iostream>
+#include <mutex>
+#include <utility> // move()
+
+#include "IO/IndexInput.h"
+#include "IO/IndexOutput.h"
+#include "common/Exception.h"
+#include "storage/LockFile.h"
+#include "storage/NRTCachingDirectory.h"
+
+namespace lucanthrope {
+
+NRTCachingDirectory::NRTCachingDirectory(Directory &delegate,
+                                         uint64_t maxFileSize,
+                                         uint64_t maxCachedBytes,
+                                         bool backgroundUncache)
+    : delegate_(delegate), maxFileSize_(maxFileSize),
+      maxCachedBytes_(maxCachedBytes) {
+  if (backgroundUncache)
+    bgThread_ = std::thread([this] { backgroundLoop(); });
+}
+
+NRTCachingDirectory::~NRTCachingDirectory() {
+  if (bgThread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> guard(bgMu_);
+      bgStop_ = true;
+    }
+    bgCv_.notify_one();
+    bgThread_.join();
+  }
+  try {
+    unCacheAll();
+  } catch (Exception &e) {
+    std::cerr << "WARNING: unable to move cached files to the delegate "
+                 "directory, they are lost: "
+              << e.what() << '\n';
+  }
+}
+
+void NRTCachingDirectory::backgroundLoop() {
+  std::unique_lock<std::mutex> lock(bgMu_);
+  while (true) {
+    bgCv_.wait(lock, [this] { return bgStop_ || bgWakeUp_; });
+    if (bgStop_)
+      return;
+    bgWakeUp_ = false;
+    lock.unlock();
+    try {
+      unCacheAll();
+    } catch (Exception &e) {
+      // Files stay in the cache; the next attempt will be made on the next
+      // wake-up, or by sync()
+      std::cerr << "WARNING: background uncaching failed: " << e.what()
+                << '\n';
+    }
+    lock.lock();
+  }
+}
+
+bool NRTCachingDirectory::unCacheLocked(const std::string &fname) {
+  // Not cached, or still being written. A committed file stays committed,
+  // and can't be deleted or renamed meanwhile (uncacheMu_ is held), so any
+  // error from here on is a real one.
+  if (!cache_.fileCommitted(fname))
+    return false;
+  std::unique_ptr<IndexInput> input =
+      cache_.openInput(fname, IOContext(IOContext::ReadOnce));
+  uint64_t length = cache_.fileLength(fname);
+  std::unique_ptr<IndexOutput> output =
+      delegate_.createOutput(fname, IOContext(IOContext::Flush, length));
+  try {
+    output->copyBytes(*input, length);
+    output->flush();
+  } catch (...) {
+    output.reset();
+    try {
+      delegate_.deleteFile(fname);
+    } catch (...) {
+    }
+    throw;
+  }
+  output.reset();
+  input.reset();
+  cache_.deleteFile(fname);
+  return true;
+}
+
+void NRTCachingDirectory::unCacheAll() {
+  std::vector<std::string> moved;
+  for (auto &fname : cache_.listAll()) {
+    std::lock_guard<std::mutex> guard(uncacheMu_);
+    if (unCacheLocked(fname))
+      moved.push_back(fname);
+  }
+  delegate_.sync(moved);
+}
+
+bool NRTCachingDirectory::unCache(const std::string &fname) {
+  {
+    std::lock_guard<std::mutex> guard(uncacheMu_);
+    if (!unCacheLocked(fname))
+      return false;
+  }
+  delegate_.sync({fname});
+  return true;
+}
+
+void NRTCachingDirectory::sync(const std::vector<std::string> &fnames) {
+  std::vector<std::string> durable;
+  durable.reserve(fnames.size());
+  for (auto &fname : fnames) {
+    std::lock_guard<std::mutex> guard(uncacheMu_);
+    unCacheLocked(fname);
+    // still being written, if it's in the cache
+    if (!cache_.fileExists(fname))
+      durable.push_back(fname);
+  }
+  // One group commit for both moved files and files which were created in
+  // the delegate directly
+  delegate_.sync(durable);
+}
+
+std::vector<std::string> NRTCachingDirectory::listAll() {
+  std::vector<std::string> ret = cache_.listAll();
+  std::vector<std::string> delegated = delegate_.listAll();
+  ret.insert(ret.end(), delegated.begin(), delegated.end());
+  // a file which is being moved out of the cache is present in both
+  std::sort(ret.begin(), ret.end());
+  ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+  return ret;
+}
+
+void NRTCachingDirectory::deleteFile(const std::string &fname) {
+  std::lock_guard<std::mutex> guard(uncacheMu_);
+  if (cache_.fileExists(fname))
+    cache_.deleteFile(fname);
+  else
+    delegate_.deleteFile(fname);
+}
+
+uint64_t NRTCachingDirectory::fileLength(const std::string &fname) {
+  if (cache_.fileExists(fname)) {
+    try {
+      return cache_.fileLength(fname);
+    } catch (Exception &e) {
+      if (e.code() != Exception::Code::FileNotFoundException)
+        throw;
+      // just moved to the delegate
+    }
+  }
+  return delegate_.fileLength(fname);
+}
+
+std::unique_ptr<IndexOutput>
+NRTCachingDirectory::createOutput(const std::string &fname,
+                                  const IOContext &context) {
+  if (fileExists(fname))
+    throw Exception(
+        Exception::Code::FileAlreadyExistsException,
+        std::string("In NRTCachingDirectory::createOutput(): File named ")
+            .append(fname)
+            .append(" already exists in NRTCachingDirectory"));
+  uint64_t used = cache_.ramBytesUsed();
+  const uint64_t expectedSize = context.expectedSize;
+  bool cacheIt =
+      expectedSize <= maxFileSize_ && used + expectedSize <= maxCachedBytes_;
+  if (bgThread_.joinable() && (!cacheIt || used > maxCachedBytes_ / 2)) {
+    {
+      std::lock_guard<std::mutex> guard(bgMu_);
+      bgWakeUp_ = true;
+    }
+    bgCv_.notify_one();
+  }
+  if (cacheIt)
+    return cache_.createOutput(fname, context);
+  return delegate_.createOutput(fname, context);
+}
+
+void NRTCachingDirectory::rename(const std::string &src,
+                                 const std::string &target) {
+  std::lock_guard<std::mutex> guard(uncacheMu_);
+  if (cache_.fileExists(src)) {
+    if (delegate_.fileExists(target))
+      throw Exception(
+          Exception::Code::FileAlreadyExistsException,
+          std::string("In NRTCachingDirectory::rename(): File named ")
+              .append(target)
+              .append(" already exists in NRTCachingDirectory"));
+    cache_.rename(src, target);
+  } else {
+    if (cache_.fileExists(target))
+      throw Exception(
+          Exception::Code::FileAlreadyExistsException,
+          std::string("In NRTCachingDirectory::rename(): File named ")
+              .append(target)
+              .append(" already exists in NRTCachingDirectory"));
+    delegate_.rename(src, target);
+  }
+}
+
+void NRTCachingDirectory::replace(const std::string &src,
+                                  const std::string &target) {
+  std::lock_guard<std::mutex> guard(uncacheMu_);
+  if (cache_.fileExists(src)) {
+    if (!delegate_.fileExists(target)) {
+      cache_.replace(src, target);
+      return;
+    }
+    // The old target is in the delegate, maybe durably, so the new one must
+    // replace it there: dropping it for a cached file would leave a crash
+    // with neither
+    if (!unCacheLocked(src))
+      throw Exception(
+          Exception::Code::IOErrorException,
+          std::string("In NRTCachingDirectory::replace(): File named ")
+              .append(src)
+              .append(" is still being written"));
+  }
+  delegate_.replace(src, target);
+  // a cached target hid the new one until now
+  if (cache_.fileExists(target))
+    cache_.deleteFile(target);
+}
+
+std::unique_ptr<IndexInput>
+NRTCachingDirectory::openInput(const std::string &fname,
+                               const IOContext &context) {
+  if (cache_.fileExists(fname)) {
+    try {
+      return cache_.openInput(fname, context);
+    } catch (Exception &e) {
+      if (e.code() != Exception::Code::FileNotFoundException)
+        throw;
+      // just moved to the delegate
+    }
+  }
+  return delegate_.openInput(fname, context);
+}
+
+IOCounters NRTCachingDirectory::getIOStats(IOContext::Context context) {
+  IOCounters ret = cache_.getIOStats(context);
+  IOCounters delegated = delegate_.getIOStats(context);
+  ret.bytesRead += delegated.bytesRead;
+  ret.readOps += delegated.readOps;
+  ret.bytesWritten += delegated.bytesWritten;
+  ret.writeOps += delegated.writeOps;
+  return ret;
+}
+
+void NRTCachingDirectory::setMergeRateLimiter(
+    std::shared_ptr<RateLimiter> rateLimiter) {
+  Directory::setMergeRateLimiter(rateLimiter);
+  delegate_.setMergeRateLimiter(std::move(rateLimiter));
+}
+
+std::unique_ptr<LockFile>
+NRTCachingDirectory::obtainLock(const std::string &fname) {
+  return delegate_.obtainLock(fname);
+}
+
+bool NRTCachingDirectory::fileExists(const std::string &fname) {
+  return cache_.fileExists(fname) || delegate_.fileExists(fname);
+}
+
+bool NRTCachingDirectory::fileCommitted(const std::string &fname) {
+  if (cache_.fileExists(fname))
+    return cache_.fileCommitted(fname);
+  return delegate_.fileCommitted(fname);
+}
+
+void NRTCachingDirectory::deleteSegment(const std::string &segment) noexcept {
+  try {
+    std::lock_guard<std::mutex> guard(uncacheMu_);
+    cache_.deleteSegment(segment);
+    delegate_.deleteSegment(segment);
+  } catch (...) {
+    // std::mutex::lock() failed; nothing we can do here
+    std::cerr << "WARNING: segment " << segment << " is not deleted\n";
+  }
+}
+
+} // namespace lucanthrope
@@ -1,12 +1,16 @@
+#include <algorithm> // min()
+#include <future>
 #include <iostream>
 #include <mutex>
 #include <string_view>
+#include <utility> // pair
 
 #include "IO/IndexInput.h"
 #include "IO/IndexOutput.h"
 #include "IO/RAMFileIndexInput.h"  // private header
 #include "IO/RAMFileIndexOutput.h" // private header
 #include "common/Exception.h"
+#include "common/ThreadPool.h"
 #include "storage/RAMDirectory.h"
 #include "storage/RAMDirectoryLockFile.h" // private header
 
@@ -14,18 +18,97 @@ namespace lucanthrope {
 
 const RAMDirectory::RAMFile RAMDirectory::dummy_file;
 
+void RAMDirectory::insertLocked(const std::string &fname, RAMFile *file) {
+  auto it = files.emplace(fname, file).first;
+  std::string_view segment = segmentOf(fname);
+  auto seg = segments_.end();
+  // Bytes of the segment's bucket array which are already counted
+  uint64_t counted = 0;
+  try {
+    seg = segments_.try_emplace(std::string(segment)).first;
+    if (!seg->second.empty())
+      counted = seg->second.bucket_count() * sizeof(void *);
+    seg->second.insert(&*it);
+  } catch (...) {
+    if (seg != segments_.end() && seg->second.empty())
+      segments_.erase(seg);
+    files.erase(it);
+    throw;
+  }
+  keyBytes_ += heapBytes(it->first);
+  if (seg->second.size() == 1) {
+    keyBytes_ += heapBytes(seg->first);
+    segmentBytes_ += kSegmentEntryBytes;
+  }
+  segmentBytes_ += seg->second.bucket_count() * sizeof(void *) - counted;
+  if (file->account && file->account != blockBytes_)
+    sharedBytes_ += file->charged;
+}
+
+void RAMDirectory::eraseLocked(
+    std::unordered_map<std::string, RAMFile *>::iterator it) {
+  auto seg = segments_.find(std::string(segmentOf(it->first)));
+  seg->second.erase(&*it);
+  // Erasing never shrinks the bucket array, so it is only uncounted together
+  // with the segment
+  if (seg->second.empty()) {
+    keyBytes_ -= heapBytes(seg->first);
+    segmentBytes_ -=
+        kSegmentEntryBytes + seg->second.bucket_count() * sizeof(void *);
+    segments_.erase(seg);
+  }
+  keyBytes_ -= heapBytes(it->first);
+  if (it->second->account && it->second->account != blockBytes_)
+    sharedBytes_ -= it->second->charged;
+  files.erase(it);
+}
+
+uint64_t RAMDirectory::ramBytesUsedLocked() const {
+  return blockBytes_->load() + sharedBytes_ + keyBytes_ + segmentBytes_ +
+         segments_.bucket_count() * sizeof(void *) +
+         files.size() * (kFileTableEntryBytes + kSegmentFileEntryBytes) +
+         files.bucket_count() * sizeof(void *);
+}
+
+uint64_t RAMDirectory::ramBytesUsed() {
+  std::lock_guard<std::mutex> guard(mu_);
+  return ramBytesUsedLocked();
+}
+
+void RAMDirectory::setRAMBudget(uint64_t ramBudget, Directory *fallback) {
+  std::lock_guard<std::mutex> guard(mu_);
+  ramBudget_ = ramBudget;
+  fallback_ = fallback;
+}
+
+uint64_t RAMDirectory::getRAMBudget() {
+  std::lock_guard<std::mutex> guard(mu_);
+  return ramBudget_;
+}
+
 RAMDirectory::~RAMDirectory() {
   std::lock_guard<std::mutex> guard(mu_);
+  for (auto &p : files)
+    if (p.second != &dummy_file)
+      p.second->unref(); // readers and snapshots may still hold it
+}
+
+std::unique_ptr<RAMDirectory> RAMDirectory::snapshot() {
+  std::unique_ptr<RAMDirectory> ret(new RAMDirectory());
+  // Nobody else can see ret yet, but its invariants are maintained under its
+  // mutex anyway
+  std::lock_guard<std::mutex> ret_guard(ret->mu_);
+  std::lock_guard<std::mutex> guard(mu_);
+  ret->files.reserve(files.size());
   for (auto &p : files) {
-    if (p.second != &dummy_file) {
-      RAMFile *file = p.second;
-      assert(file->refs_ == 1 &&
-             "Attempt to deallocate a file that is open for reading!");
-      file->refs_--; // have to do that so that assertion in RAMFile's
-                     // destructor is passed
-      delete p.second;
-    }
+    if (p.second == &dummy_file) // skip lock files and uncommited files
+      continue;
+    ret->insertLocked(p.first, p.second);
+    // If insertLocked() throws, ret's destructor drops references which
+    // were taken so far
+    p.second->refs_++;
   }
+  return ret;
 }
 
 // When commit() is called, it is guaranteed that a pair (fname, &dummy_file) is
@@ -40,15 +123,6 @@ void RAMDirectory::commit(const std::string &fname, RAMFile *file) noexcept {
   files[fname] = file;
 }
 
-void RAMDirectory::unrefReader(const RAMFile *file) noexcept {
-  // mutex is toggled manually so that a file's deallocation doesn't block
-  mu_.lock();
-  int c = --file->refs_;
-  mu_.unlock();
-  if (!c) {
-    delete file;
-  }
-}
 
 void RAMDirectory::releaseLock(const std::string &fname) noexcept {
   std::lock_guard<std::mutex> guard(mu_);
@@ -65,14 +139,22 @@ void RAMDirectory::releaseLock(const std::string &fname) noexcept {
   }
   assert(it->second == &dummy_file && "Lock file refers to unknown RAMFile, "
                                       "RAMDirectory's invariants do not hold!");
-  files.erase(it);
+  eraseLocked(it);
 }
 
 std::vector<std::string> RAMDirectory::listAll() {
   std::vector<std::string> ret;
-  std::lock_guard<std::mutex> guard(mu_);
-  for (auto &f : files) {
-    ret.push_back(f.first);
+  Directory *fallback;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (auto &f : files) {
+      ret.push_back(f.first);
+    }
+    fallback = fallback_;
+  }
+  if (fallback) {
+    std::vector<std::string> spilled = fallback->listAll();
+    ret.insert(ret.end(), spilled.begin(), spilled.end());
   }
   return ret;
 }
@@ -88,10 +170,15 @@ void RAMDirectory::deleteFile(const std::string &fname) {
     assert(file != &dummy_file &&
            "Attempt to delete an uncommited file; a file may be deleted only "
            "after it were commited");
-    files.erase(it); // won't throw
+    eraseLocked(it); // won't throw
     ref_count = --file->refs_;
   }
+  Directory *fallback = fallback_;
   mu_.unlock();
+  if (!file && fallback) {
+    fallback->deleteFile(fname);
+    return;
+  }
   if (!file)
     throw Exception(Exception::Code::FileNotFoundException,
                     std::string("In RAMDirectory::deleteFile(): File named ")
@@ -103,8 +190,13 @@ void RAMDirectory::deleteFile(const std::string &fname) {
 }
 
 uint64_t RAMDirectory::fileLength(const std::string &fname) {
-  std::lock_guard<std::mutex> guard(mu_);
+  std::unique_lock<std::mutex> lock(mu_);
   auto it = files.find(fname);
+  if (it == files.end() && fallback_) {
+    Directory *fallback = fallback_;
+    lock.unlock();
+    return fallback->fileLength(fname);
+  }
   if (it == files.end())
     throw Exception(Exception::Code::FileNotFoundException,
                     std::string("In RAMDirectory::fileLength(): File named ")
@@ -114,20 +206,65 @@ uint64_t RAMDirectory::fileLength(const std::string &fname) {
 }
 
 std::unique_ptr<IndexOutput>
-RAMDirectory::createOutput(const std::string &fname) {
-  std::lock_guard<std::mutex> guard(mu_);
+RAMDirectory::createOutput(const std::string &fname,
+                           const IOContext &context) {
+  std::unique_lock<std::mutex> lock(mu_);
   auto it = files.find(fname);
   if (it != files.end())
     throw Exception(Exception::Code::FileAlreadyExistsException,
                     std::string("In RAMDirectory::createOutput(): File named ")
                         .append(fname)
                         .append(" already exists in RAMDirectory"));
-  // 'files[fname] = const_cast<RAMFile *>(&dummy_file)' can throw
-  // (theoretically); protect against that with unique_ptr
-  std::unique_ptr<IndexOutput> output(new RAMFileIndexOutput(this, fname));
-  // Insert file's name into files map only after RAMFileIndexOutput was
-  // successfully allocated.
-  files[fname] = const_cast<RAMFile *>(&dummy_file);
+  if (ramBudget_ &&
+      ramBytesUsedLocked() + context.expectedSize >= ramBudget_) {
+    if (!fallback_)
+      throw Exception(
+          Exception::Code::RAMBudgetExceededException,
+          std::string("In RAMDirectory::createOutput(): cannot create file ")
+              .append(fname)
+              .append(", RAM budget of ")
+              .append(std::to_string(ramBudget_))
+              .append(" bytes is exhausted"));
+    // Reserve the name, so that nobody creates it in RAM while fallback is
+    // creating it; fallback itself refuses names it already has.
+    insertLocked(fname, const_cast<RAMFile *>(&dummy_file));
+    Directory *fallback = fallback_;
+    lock.unlock();
+    std::unique_ptr<IndexOutput> output;
+    try {
+      output = fallback->createOutput(fname, context);
+    } catch (...) {
+      releaseLock(fname);
+      throw;
+    }
+    releaseLock(fname);
+    return output;
+  }
+  // Insert file's name into files map before anything else, so that nobody
+  // else can create it in RAM or in fallback; the name is released if
+  // anything below throws.
+  insertLocked(fname, const_cast<RAMFile *>(&dummy_file));
+  Directory *fallback = fallback_;
+  // Don't hold the mutex while fallback is doing I/O; RAMFileIndexOutput
+  // doesn't need it either.
+  lock.unlock();
+  std::unique_ptr<IndexOutput> output;
+  try {
+    // A file with the same name may have been spilled earlier
+    if (fallback && fallback->fileExists(fname))
+      throw Exception(
+          Exception::Code::FileAlreadyExistsException,
+          std::string("In RAMDirectory::createOutput(): File named ")
+              .append(fname)
+              .append(" already exists in RAMDirectory"));
+    output.reset(new RAMFileIndexOutput(this, fname));
+  } catch (...) {
+    releaseLock(fname);
+    throw;
+  }
+  // From now on, the name is released by output's destructor, which commits
+  // the file
+  track(*output, context);
 
   // As far as i understand C++17, using std::move() is absolutely necessary
   // here: unique_ptr doesn't have a copy constructor, which is required to
@@ -157,42 +294,150 @@ RAMDirectory::createOutput(const std::string &fname) {
 }
 
 void RAMDirectory::rename(const std::string &src, const std::string &target) {
-  std::lock_guard<std::mutex> guard(mu_);
+  std::unique_lock<std::mutex> lock(mu_);
+  if (files.find(target) != files.end())
+    throw Exception(Exception::Code::FileAlreadyExistsException,
+                    std::string("In RAMDirectory::rename(): File named ")
+                        .append(target)
+                        .append(" already exists in RAMDirectory"));
   auto it_src = files.find(src);
+  if (fallback_) {
+    bool held = it_src != files.end();
+    // The target name must not be taken in either directory. It is reserved
+    // while fallback is asked about it (or renames a spilled file to it), so
+    // that nobody creates it in RAM meanwhile.
+    insertLocked(target, const_cast<RAMFile *>(&dummy_file));
+    Directory *fallback = fallback_;
+    lock.unlock();
+    if (!held) {
+      // Spilled files are renamed within fallback directory, which refuses
+      // targets it already has
+      try {
+        fallback->rename(src, target);
+      } catch (...) {
+        releaseLock(target);
+        throw;
+      }
+      releaseLock(target);
+      return;
+    }
+    bool spilled;
+    try {
+      spilled = fallback->fileExists(target);
+    } catch (...) {
+      releaseLock(target);
+      throw;
+    }
+    lock.lock();
+    eraseLocked(files.find(target));
+    if (spilled)
+      throw Exception(Exception::Code::FileAlreadyExistsException,
+                      std::string("In RAMDirectory::rename(): File named ")
+                          .append(target)
+                          .append(" already exists in RAMDirectory"));
+    // src may have been deleted or renamed while the mutex was released
+    it_src = files.find(src);
+  }
   if (it_src == files.end())
     throw Exception(Exception::Code::FileNotFoundException,
                     std::string("In RAMDirectory::rename(): File named ")
                         .append(src)
                         .append(" is not found in RAMDirectory"));
+  RAMFile *file = it_src->second;
+  insertLocked(target, file);
+  eraseLocked(it_src);
+}
+
+void RAMDirectory::replace(const std::string &src,
+                           const std::string &target) {
+  // mutex is toggled manually so that a file's deallocation doesn't block
+  std::unique_lock<std::mutex> lock(mu_);
   auto it_target = files.find(target);
-  if (it_target != files.end())
-    throw Exception(Exception::Code::FileAlreadyExistsException,
-                    std::string("In RAMDirectory::rename(): File named ")
+  if (it_target != files.end() && it_target->second == &dummy_file)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In RAMDirectory::replace(): File named ")
                         .append(target)
-                        .append(" already exists in RAMDirectory"));
-  files[target] = it_src->second;
-  files.erase(it_src);
+                        .append(" is still being written or is locked"));
+  auto it_src = files.find(src);
+  Directory *fallback = fallback_;
+  if (it_src == files.end() && fallback) {
+    // Spilled files are replaced within fallback directory. A file of ours
+    // named target hides the new one until it's dropped, so the name never
+    // goes missing.
+    lock.unlock();
+    fallback->replace(src, target);
+    lock.lock();
+    it_target = files.find(target);
+    if (it_target == files.end() || it_target->second == &dummy_file)
+      return;
+    RAMFile *old = it_target->second;
+    eraseLocked(it_target);
+    int ref_count = --old->refs_;
+    lock.unlock();
+    if (!ref_count)
+      delete old;
+    return;
+  }
+  if (it_src == files.end())
+    throw Exception(Exception::Code::FileNotFoundException,
+                    std::string("In RAMDirectory::replace(): File named ")
+                        .append(src)
+                        .append(" is not found in RAMDirectory"));
+  if (it_src->second == &dummy_file)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In RAMDirectory::replace(): File named ")
+                        .append(src)
+                        .append(" is still being written"));
+  if (it_src == it_target)
+    return;
+  RAMFile *file = it_src->second;
+  RAMFile *old = nullptr;
+  int ref_count = 1;
+  if (it_target != files.end()) {
+    old = it_target->second;
+    eraseLocked(it_target);
+    ref_count = --old->refs_;
+  }
+  insertLocked(target, file);
+  // insertLocked() may have rehashed the table
+  eraseLocked(files.find(src));
+  lock.unlock();
+  if (!ref_count)
+    delete old;
+  // Names are unique across the two directories, so a spilled file named
+  // target, which ours now hides, is the old target
+  if (!old && fallback && fallback->fileExists(target))
+    fallback->deleteFile(target);
 }
 
-std::unique_ptr<IndexInput> RAMDirectory::openInput(const std::string &fname) {
-  std::lock_guard<std::mutex> guard(mu_);
+std::unique_ptr<IndexInput> RAMDirectory::openInput(const std::string &fname,
+                                                    const IOContext &context) {
+  std::unique_lock<std::mutex> lock(mu_);
   auto it = files.find(fname);
+  if (it == files.end() && fallback_) {
+    Directory *fallback = fallback_;
+    lock.unlock();
+    return fallback->openInput(fname, context);
+  }
   if (it == files.end())
     throw Exception(Exception::Code::FileNotFoundException,
                     std::string("In RAMDirectory::openInput(): File named ")
                         .append(fname)
                         .append(" is not found in RAMDirectory"));
   RAMFile *file = it->second;
-  assert(file != &dummy_file &&
-         "Attempt to read an uncommited file; a file may be read only "
-         "after it were commited");
-  RAMFileIndexInput *input = new RAMFileIndexInput(file);
+  if (file == &dummy_file)
+    throw Exception(Exception::Code::IOErrorException,
+                    std::string("In RAMDirectory::openInput(): File named ")
+                        .append(fname)
+                        .append(" is not commited yet"));
+  std::unique_ptr<IndexInput> input(new RAMFileIndexInput(file));
   // Increment reference count only after RAMFileIndexInput was successfully
   // allocated; otherwise, will introduce a leak (file's reference count will
   // never reach 0) if bad_alloc was successfully handled afterwards (it is
   // extremely unlikely, but let's try to be truly exception-safe here).
   file->refs_++;
-  return std::unique_ptr<IndexInput>(input);
+  track(*input, context);
+  return input;
 }
 
 std::unique_ptr<LockFile> RAMDirectory::obtainLock(const std::string &fname) {
@@ -208,33 +453,303 @@ std::unique_ptr<LockFile> RAMDirectory::obtainLock(const std::string &fname) {
   // successfully allocated; otherwise, it would be impossible to unlock
   // directory if bad_alloc was successfully handled afterwards (it is extremely
   // unlikely, but let's try to be truly exception-safe here).
-  files[fname] = const_cast<RAMFile *>(&dummy_file);
+  insertLocked(fname, const_cast<RAMFile *>(&dummy_file));
   return std::move(lock);
 }
 
 bool RAMDirectory::fileExists(const std::string &fname) {
-  std::lock_guard<std::mutex> guard(mu_);
+  std::unique_lock<std::mutex> lock(mu_);
   auto it = files.find(fname);
   if (it != files.end())
     return true;
+  if (fallback_) {
+    Directory *fallback = fallback_;
+    lock.unlock();
+    return fallback->fileExists(fname);
+  }
+  return false;
+}
+
+bool RAMDirectory::fileCommitted(const std::string &fname) {
+  std::unique_lock<std::mutex> lock(mu_);
+  auto it = files.find(fname);
+  if (it != files.end())
+    return it->second != &dummy_file;
+  if (fallback_) {
+    Directory *fallback = fallback_;
+    lock.unlock();
+    return fallback->fileCommitted(fname);
+  }
   return false;
 }
 
+std::vector<std::string>
+RAMDirectory::listSegment(const std::string &segment) {
+  std::vector<std::string> ret;
+  Directory *fallback;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto seg = segments_.find(segment);
+    if (seg != segments_.end()) {
+      ret.reserve(seg->second.size());
+      for (FileEntry *entry : seg->second)
+        ret.push_back(entry->first);
+    }
+    fallback = fallback_;
+  }
+  if (fallback) {
+    std::vector<std::string> spilled = fallback->listSegment(segment);
+    ret.insert(ret.end(), spilled.begin(), spilled.end());
+  }
+  return ret;
+}
+
 void RAMDirectory::deleteSegment(const std::string &segment) noexcept {
-  std::lock_guard<std::mutex> guard(mu_);
-  size_t size = segment.size();
-  for (auto &pair : files) {
-    if (pair.first.size() >= size && segment == pair.first.substr(0, size)) {
-      assert(pair.second == &dummy_file &&
-             "Attempt to delete an uncommited file in exception handler; it is "
-             "should not be possible with RAMDirectory's invariants, something "
-             "is broken!");
-      RAMFile *file = pair.second;
-      files.erase(pair.first);
-      if (--file->refs_ == 0)
-        delete file;
+  // Files which are not referenced anymore; they are deallocated after the
+  // mutex is released
+  std::vector<RAMFile *> garbage;
+  Directory *fallback;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    auto seg = segments_.find(segment);
+    if (seg != segments_.end()) {
+      try {
+        garbage.reserve(seg->second.size());
+      } catch (...) {
+        // no memory for the list; deallocate the files inline instead
+      }
+      for (auto it = seg->second.begin(); it != seg->second.end();) {
+        FileEntry *entry = *it++;
+        // Uncommitted files and locks are left to their owners
+        if (entry->second == &dummy_file)
+          continue;
+        // eraseLocked() erases seg together with its last file
+        bool last = it == seg->second.end();
+        RAMFile *file = entry->second;
+        eraseLocked(files.find(entry->first)); // won't throw
+        if (--file->refs_ == 0) {
+          if (garbage.size() < garbage.capacity())
+            garbage.push_back(file);
+          else
+            delete file;
+        }
+        if (last)
+          break;
+      }
+    }
+    fallback = fallback_;
+  }
+  for (RAMFile *file : garbage)
+    delete file;
+  if (fallback)
+    fallback->deleteSegment(segment);
+}
+
+void RAMDirectory::sync(const std::vector<std::string> &fnames) {
+  std::vector<std::string> spilled;
+  Directory *fallback;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    for (auto &fname : fnames)
+      if (files.find(fname) == files.end())
+        spilled.push_back(fname);
+    fallback = fallback_;
+  }
+  if (spilled.empty())
+    return;
+  if (!fallback)
+    throw Exception(Exception::Code::FileNotFoundException,
+                    std::string("In RAMDirectory::sync(): File named ")
+                        .append(spilled.front())
+                        .append(" is not found in RAMDirectory"));
+  fallback->sync(spilled);
+}
+
+// Files are loaded in chunks of this many bytes, so that a single huge file
+// is loaded by several threads.
+static constexpr uint64_t kLoadChunkSize = 16 * 1024 * 1024;
+
+void RAMDirectory::loadFrom(Directory &src, size_t numThreads) {
+  static_assert(kLoadChunkSize % RAMFile::kBlockSize == 0,
+                "Load chunks must consist of whole blocks");
+  std::vector<std::string> names = src.listAll();
+  std::vector<std::pair<std::string, uint64_t>> spilled;
+  // copied[i] is set once spilled[i] is copied to fallback, so that it can be
+  // deleted again if loading fails (copyFrom() cleans up after itself)
+  std::vector<char> copied;
+  Directory *fallback = nullptr;
+  // Files which are being loaded are not registered in files map, so nobody
+  // else can see them. They are owned by this vector until they are committed.
+  std::vector<RAMFile *> loaded;
+  auto release = [&] {
+    for (RAMFile *file : loaded)
+      delete file;
+    for (size_t i = 0; i < copied.size(); i++) {
+      if (!copied[i])
+        continue;
+      try {
+        fallback->deleteFile(spilled[i].first);
+      } catch (...) {
+        // the load's own error is the one to report
+      }
+    }
+  };
+
+  try {
+    uint64_t projected;
+    uint64_t budget;
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      fallback = fallback_;
+      projected = ramBytesUsedLocked();
+      budget = ramBudget_;
+    }
+    for (auto &name : names) {
+      uint64_t length = src.fileLength(name);
+      if (budget && projected + length >= budget) {
+        if (!fallback)
+          throw Exception(
+              Exception::Code::RAMBudgetExceededException,
+              std::string("In RAMDirectory::loadFrom(): cannot load file ")
+                  .append(name)
+                  .append(", RAM budget of ")
+                  .append(std::to_string(budget))
+                  .append(" bytes would be exceeded"));
+        spilled.emplace_back(name, length);
+        continue;
+      }
+      loaded.push_back(nullptr); // so that new RAMFile can't leak
+      loaded.back() = new RAMFile(this, name);
+      RAMFile *file = loaded.back();
+      size_t num_blocks = (length + RAMFile::kBlockSize - 1) / RAMFile::kBlockSize;
+      file->blocks_.reserve(num_blocks);
+      for (size_t i = 0; i < num_blocks; i++)
+        file->alloc();
+      file->length = length;
+      projected += length;
+    }
+
+    ThreadPool pool(numThreads);
+    std::vector<std::future<void>> results;
+    for (RAMFile *file : loaded) {
+      for (uint64_t offset = 0; offset < file->length;
+           offset += kLoadChunkSize) {
+        results.push_back(pool.submit([&src, file, offset] {
+          uint64_t end = std::min(offset + kLoadChunkSize, file->length);
+          std::unique_ptr<IndexInput> input =
+              src.openInput(file->name, IOContext(IOContext::ReadOnce));
+          if (offset)
+            input->seek(offset);
+          for (uint64_t block_start = offset; block_start < end;
+               block_start += RAMFile::kBlockSize) {
+            size_t n = static_cast<size_t>(
+                std::min<uint64_t>(RAMFile::kBlockSize, end - block_start));
+            char *block = file->blocks_[block_start / RAMFile::kBlockSize];
+            if (input->read(block, n) != n)
+              throw Exception(Exception::Code::IndexCorruptionException,
+                              std::string("In RAMDirectory::loadFrom(): file ")
+                                  .append(file->name)
+                                  .append(" is shorter than expected"));
+          }
+        }));
+      }
+    }
+    copied.assign(spilled.size(), 0);
+    for (size_t i = 0; i < spilled.size(); i++)
+      results.push_back(pool.submit([&src, fallback, &spilled, &copied, i] {
+        fallback->copyFrom(src, spilled[i].first, spilled[i].first);
+        copied[i] = 1;
+      }));
+    waitAll(results);
+
+    std::lock_guard<std::mutex> guard(mu_);
+    auto check = [this](const std::string &name) {
+      if (files.find(name) != files.end())
+        throw Exception(Exception::Code::FileAlreadyExistsException,
+                        std::string("In RAMDirectory::loadFrom(): File named ")
+                            .append(name)
+                            .append(" already exists in RAMDirectory"));
+    };
+    for (RAMFile *file : loaded)
+      check(file->name);
+    for (auto &file : spilled)
+      check(file.first);
+    files.reserve(files.size() + loaded.size());
+    size_t inserted = 0;
+    try {
+      for (; inserted < loaded.size(); inserted++)
+        insertLocked(loaded[inserted]->name, loaded[inserted]);
+    } catch (...) {
+      // segments_ couldn't grow; all or nothing
+      while (inserted--)
+        eraseLocked(files.find(loaded[inserted]->name));
+      throw;
+    }
+    for (RAMFile *file : loaded)
+      file->refs_ = 1;
+    loaded.clear();
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+void RAMDirectory::persistTo(Directory &dst, size_t numThreads) {
+  // Files may be renamed after they are pinned, so we need to remember names
+  // under which they were found (RAMFile::name is the name it was created with)
+  std::vector<std::pair<std::string, RAMFile *>> pinned;
+  Directory *fallback;
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    pinned.reserve(files.size());
+    for (auto &p : files)
+      if (p.second != &dummy_file) // skip lock files and uncommited files
+        pinned.emplace_back(p.first, p.second);
+    // Pin files only after nothing can throw anymore
+    for (auto &p : pinned)
+      p.second->refs_++;
+    fallback = fallback_;
+  }
+
+  try {
+    ThreadPool pool(numThreads);
+    std::vector<std::future<void>> results;
+    for (auto &p : pinned) {
+      results.push_back(pool.submit([&dst, &p] {
+        RAMFile *file = p.second;
+        std::unique_ptr<IndexOutput> output =
+            dst.createOutput(p.first,
+                             IOContext(IOContext::Flush, file->length));
+        for (uint64_t block_start = 0; block_start < file->length;
+             block_start += RAMFile::kBlockSize) {
+          size_t n = static_cast<size_t>(std::min<uint64_t>(
+              RAMFile::kBlockSize, file->length - block_start));
+          output->write(file->blocks_[block_start / RAMFile::kBlockSize], n);
+        }
+        output->flush();
+      }));
     }
+    std::vector<std::string> names;
+    names.reserve(pinned.size());
+    for (auto &p : pinned)
+      names.push_back(p.first);
+    if (fallback)
+      for (auto &name : fallback->listAll()) {
+        results.push_back(pool.submit([&dst, fallback, name] {
+          dst.copyFrom(*fallback, name, name);
+        }));
+        names.push_back(name);
+      }
+    waitAll(results);
+    // One group commit instead of a sync per file
+    dst.sync(names);
+  } catch (...) {
+    for (auto &p : pinned)
+      p.second->unref();
+    throw;
   }
+  for (auto &p : pinned)
+    p.second->unref();
 }
 
-} // namespace lucanthrope
\ No newline at end of file
+} // namespace lucanthrope
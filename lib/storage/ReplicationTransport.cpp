@@ -0,0 +1,357 @@
+#include <cerrno>
+#include <thread>
+#include <utility> // move()
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include "IO/FileDescriptor.h" // private header
+#include "IO/IndexInput.h"
+#include "common/Exception.h"
+#include "storage/Directory.h"
+#include "storage/ReplicationTransport.h"
+
+namespace lucanthrope {
+
+std::vector<ReplicationTransport::FileInfo> DirectoryTransport::listFiles() {
+  std::vector<FileInfo> ret;
+  for (auto &fname : dir_.listAll()) {
+    FileInfo info;
+    info.name = fname;
+    try {
+      if (!dir_.fileCommitted(fname)) {
+        if (!dir_.fileExists(fname))
+          continue; // deleted meanwhile
+        // still being written, or a lock
+        info.committed = false;
+        ret.push_back(std::move(info));
+        continue;
+      }
+      info.length = dir_.fileLength(fname);
+      std::unique_ptr<IndexInput> input =
+          dir_.openInput(fname, IOContext(IOContext::ReadOnce));
+      info.hasChecksum = input->readChecksumFooter(info.length, info.checksum);
+    } catch (Exception &e) {
+      // Only a file which is really gone may be left out: replicas delete
+      // what the primary doesn't list
+      if (e.code() == Exception::Code::FileNotFoundException &&
+          !dir_.fileExists(fname))
+        continue;
+      throw;
+    }
+    ret.push_back(std::move(info));
+  }
+  return ret;
+}
+
+void DirectoryTransport::readChunk(const std::string &fname, uint64_t offset,
+                                   uint64_t length, char *out) {
+  std::unique_ptr<IndexInput> input =
+      dir_.openInput(fname, IOContext(IOContext::ReadOnce));
+  bool complete = offset <= dir_.fileLength(fname);
+  if (complete) {
+    input->seek(offset);
+    complete = input->read(out, length) == length;
+  }
+  if (!complete)
+    throw Exception(Exception::Code::IndexCorruptionException,
+                    std::string("In DirectoryTransport::readChunk(): ")
+                        .append(fname)
+                        .append(" is shorter than ")
+                        .append(std::to_string(offset + length))
+                        .append(" bytes"));
+}
+
+// Wire format, all integers are little-endian:
+//   request:  Int32 size, then Int8 op, Int32 name size, name, Int64 offset,
+//             Int64 length
+//   response: Int8 status (0, or 1 + Exception::Code), Int64 payload size,
+//             payload (file list, chunk bytes, or error message)
+static constexpr char kOpList = 1;
+static constexpr char kOpRead = 2;
+// Size of a request without its name
+static constexpr size_t kRequestFixedSize = 1 + 4 + 8 + 8;
+// Size of an entry of the file list without its name
+static constexpr size_t kListEntryFixedSize = 4 + 8 + 1 + 8 + 1;
+
+[[noreturn]] static void throwMalformed(const char *what) {
+  throw Exception(Exception::Code::IOErrorException,
+                  std::string("In LocalSocketTransport: malformed ")
+                      .append(what));
+}
+
+static void putInt(std::string &buf, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++, value >>= 8)
+    buf.push_back(static_cast<char>(value & 0xff));
+}
+
+static uint64_t getInt(const char *&p, int bytes) {
+  uint64_t ret = 0;
+  for (int i = bytes - 1; i >= 0; i--)
+    ret = (ret << 8) | static_cast<unsigned char>(p[i]);
+  p += bytes;
+  return ret;
+}
+
+static void sendAll(int fd, const char *data, size_t size) {
+#ifdef MSG_NOSIGNAL
+  const int flags = MSG_NOSIGNAL; // a closed peer is an error, not a signal
+#else
+  const int flags = 0;
+#endif
+  while (size) {
+    ssize_t n = ::send(fd, data, size, flags);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throwIOError("send()", "replication socket", errno);
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+}
+
+// Returns false if the peer closed the connection before the first byte.
+static bool recvAll(int fd, char *data, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = ::recv(fd, data + done, size - done, 0);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throwIOError("recv()", "replication socket", errno);
+    }
+    if (n == 0) {
+      if (!done)
+        return false;
+      throwIOError("recv()", "replication socket", ECONNRESET);
+    }
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+static void sendResponse(int fd, char status, const char *payload,
+                         uint64_t size) {
+  std::string header;
+  header.push_back(status);
+  putInt(header, size, 8);
+  sendAll(fd, header.data(), header.size());
+  sendAll(fd, payload, static_cast<size_t>(size));
+}
+
+// Serves requests of one connection until the client closes it, or the
+// connection breaks, and then shuts it down, so that the client doesn't wait
+// for responses which never come.
+static void serve(DirectoryTransport &server, int fd) {
+  try {
+    std::string request;
+    char sizeBuf[4];
+    while (recvAll(fd, sizeBuf, sizeof(sizeBuf))) {
+      const char *size = sizeBuf;
+      request.resize(static_cast<size_t>(getInt(size, 4)));
+      if (!recvAll(fd, &request[0], request.size()))
+        break;
+      std::string payload;
+      try {
+        if (request.size() < kRequestFixedSize)
+          throwMalformed("request");
+        const char *p = request.data();
+        char op = *p++;
+        size_t nameSize = static_cast<size_t>(getInt(p, 4));
+        if (nameSize > request.size() - kRequestFixedSize)
+          throwMalformed("request");
+        std::string name(p, nameSize);
+        p += nameSize;
+        uint64_t offset = getInt(p, 8);
+        uint64_t length = getInt(p, 8);
+        if (op == kOpList) {
+          for (auto &info : server.listFiles()) {
+            putInt(payload, info.name.size(), 4);
+            payload.append(info.name);
+            putInt(payload, info.length, 8);
+            payload.push_back(info.hasChecksum ? 1 : 0);
+            putInt(payload, info.checksum, 8);
+            payload.push_back(info.committed ? 1 : 0);
+          }
+        } else if (op == kOpRead) {
+          payload.resize(static_cast<size_t>(length));
+          server.readChunk(name, offset, length, &payload[0]);
+        } else {
+          throw Exception(Exception::Code::IOErrorException,
+                          std::string_view("In LocalSocketTransport: unknown "
+                                           "request"));
+        }
+      } catch (Exception &e) {
+        std::string msg(e.what());
+        sendResponse(fd, static_cast<char>(1 + e.code()), msg.data(),
+                     msg.size());
+        continue;
+      }
+      sendResponse(fd, 0, payload.data(), payload.size());
+    }
+  } catch (...) {
+    // the connection is broken, or a request couldn't be served at all (e.g.
+    // out of memory); the client finds out on its side
+  }
+  ::shutdown(fd, SHUT_RDWR);
+}
+
+struct LocalSocketTransport::Connection {
+  FileDescriptor client;
+  FileDescriptor server;
+  std::thread thread;
+};
+
+LocalSocketTransport::LocalSocketTransport(Directory &primary,
+                                           size_t numConnections)
+    : server_(primary) {
+  if (!numConnections)
+    numConnections = 1;
+  try {
+    for (size_t i = 0; i < numConnections; i++) {
+      int fds[2];
+      if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+        throwIOError("socketpair()", "replication socket", errno);
+      connections_.emplace_back(new Connection());
+      connect(*connections_.back());
+      idle_.push_back(connections_.back().get());
+    }
+  } catch (...) {
+    closeAll();
+    throw;
+  }
+}
+
+LocalSocketTransport::~LocalSocketTransport() { closeAll(); }
+
+void LocalSocketTransport::connect(Connection &connection) {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+    throwIOError("socketpair()", "replication socket", errno);
+  connection.client = FileDescriptor(fds[0]);
+  connection.server = FileDescriptor(fds[1]);
+  int fd = fds[1];
+  try {
+    connection.thread = std::thread([this, fd] { serve(server_, fd); });
+  } catch (...) {
+    disconnect(connection);
+    throw;
+  }
+}
+
+void LocalSocketTransport::disconnect(Connection &connection) {
+  // EOF makes the serving thread return
+  if (connection.client)
+    ::shutdown(connection.client.get(), SHUT_RDWR);
+  if (connection.thread.joinable())
+    connection.thread.join();
+  connection.client = FileDescriptor();
+  connection.server = FileDescriptor();
+}
+
+void LocalSocketTransport::closeAll() {
+  for (auto &connection : connections_)
+    disconnect(*connection);
+  connections_.clear();
+}
+
+LocalSocketTransport::Connection *LocalSocketTransport::acquire() {
+  std::unique_lock<std::mutex> lock(mu_);
+  cv_.wait(lock, [this] { return !idle_.empty(); });
+  Connection *ret = idle_.back();
+  idle_.pop_back();
+  return ret;
+}
+
+void LocalSocketTransport::release(Connection *connection) {
+  {
+    std::lock_guard<std::mutex> guard(mu_);
+    idle_.push_back(connection); // reserved by the constructor, can't throw
+  }
+  cv_.notify_one();
+}
+
+std::string LocalSocketTransport::call(const std::string &request, char *out,
+                                       uint64_t outLength) {
+  Connection *connection = acquire();
+  std::string payload;
+  char status;
+  try {
+    // a connection which broke is replaced once it's needed again
+    if (!connection->client)
+      connect(*connection);
+    int fd = connection->client.get();
+    std::string framed;
+    putInt(framed, request.size(), 4);
+    framed.append(request);
+    sendAll(fd, framed.data(), framed.size());
+    char header[9];
+    if (!recvAll(fd, header, sizeof(header)))
+      throwIOError("recv()", "replication socket", ECONNRESET);
+    const char *p = header;
+    status = *p++;
+    uint64_t size = getInt(p, 8);
+    if (!status && out) {
+      if (size != outLength)
+        throwIOError("LocalSocketTransport::readChunk()", "replication socket",
+                     EPROTO);
+      if (!recvAll(fd, out, static_cast<size_t>(size)))
+        throwIOError("recv()", "replication socket", ECONNRESET);
+    } else {
+      payload.resize(static_cast<size_t>(size));
+      if (!recvAll(fd, &payload[0], payload.size()))
+        throwIOError("recv()", "replication socket", ECONNRESET);
+    }
+  } catch (...) {
+    // the stream is out of sync, or broken; it's closed, and the next call
+    // which gets the connection opens a new one
+    disconnect(*connection);
+    release(connection);
+    throw;
+  }
+  release(connection);
+  if (status)
+    throw Exception(static_cast<Exception::Code>(status - 1), payload);
+  return payload;
+}
+
+std::vector<ReplicationTransport::FileInfo> LocalSocketTransport::listFiles() {
+  std::string request;
+  request.push_back(kOpList);
+  putInt(request, 0, 4);
+  putInt(request, 0, 8);
+  putInt(request, 0, 8);
+  std::string payload = call(request, nullptr, 0);
+  std::vector<FileInfo> ret;
+  const char *end = payload.data() + payload.size();
+  for (const char *p = payload.data(); p != end;) {
+    FileInfo info;
+    if (static_cast<size_t>(end - p) < kListEntryFixedSize)
+      throwMalformed("file list");
+    size_t size = static_cast<size_t>(getInt(p, 4));
+    if (static_cast<size_t>(end - p) < size + kListEntryFixedSize - 4)
+      throwMalformed("file list");
+    info.name.assign(p, size);
+    p += size;
+    info.length = getInt(p, 8);
+    info.hasChecksum = *p++ != 0;
+    info.checksum = getInt(p, 8);
+    info.committed = *p++ != 0;
+    ret.push_back(std::move(info));
+  }
+  return ret;
+}
+
+void LocalSocketTransport::readChunk(const std::string &fname, uint64_t offset,
+                                     uint64_t length, char *out) {
+  std::string request;
+  request.push_back(kOpRead);
+  putInt(request, fname.size(), 4);
+  request.append(fname);
+  putInt(request, offset, 8);
+  putInt(request, length, 8);
+  call(request, out, length);
+}
+
+} // namespace lucanthrope
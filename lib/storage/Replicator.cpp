@@ -0,0 +1,220 @@
+#include <algorithm> // min()
+#include <future>
+#include <utility> // move()
+
+#include "IO/CRC32C.h"
+#include "IO/IndexInput.h"
+#include "IO/IndexOutput.h"
+#include "common/Exception.h"
+#include "common/ThreadPool.h"
+#include "storage/Directory.h"
+#include "storage/Replicator.h"
+
+namespace lucanthrope {
+
+static bool endsWith(const std::string &s, std::string_view suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Replicator::Replicator(ReplicationTransport &source, Directory &replica,
+                       size_t numThreads, uint64_t chunkSize)
+    : source_(source), replica_(replica),
+      chunkSize_(chunkSize ? chunkSize : kDefaultChunkSize),
+      pool_(new ThreadPool(numThreads)),
+      filter_([](const std::string &fname) { return !endsWith(fname, ".lock"); }) {
+}
+
+Replicator::~Replicator() = default;
+
+void Replicator::setFilter(std::function<bool(const std::string &)> filter) {
+  filter_ = std::move(filter);
+}
+
+bool Replicator::upToDate(const ReplicationTransport::FileInfo &info) {
+  try {
+    if (!replica_.fileExists(info.name) ||
+        replica_.fileLength(info.name) != info.length)
+      return false;
+    if (!info.hasChecksum)
+      return true;
+    std::unique_ptr<IndexInput> input =
+        replica_.openInput(info.name, IOContext(IOContext::ReadOnce));
+    uint64_t checksum;
+    return input->readChecksumFooter(info.length, checksum) &&
+           checksum == info.checksum;
+  } catch (Exception &) {
+    return false; // unreadable, so copy it again
+  }
+}
+
+void Replicator::copy(const std::vector<ReplicationTransport::FileInfo> &files,
+                      Stats &stats) {
+  struct Chunk {
+    size_t file = 0;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    std::future<std::unique_ptr<char[]>> data;
+  };
+  std::vector<Chunk> chunks;
+  for (size_t i = 0; i < files.size(); i++) {
+    uint64_t offset = 0;
+    do { // an empty file gets one empty chunk
+      chunks.emplace_back();
+      chunks.back().file = i;
+      chunks.back().offset = offset;
+      chunks.back().length = std::min(chunkSize_, files[i].length - offset);
+      offset += chunks.back().length;
+    } while (offset < files[i].length);
+  }
+
+  // Chunks are fetched by the pool up to window chunks ahead, and written here
+  // in order, so at most window chunks are held in memory
+  const size_t window = 2 * pool_->size();
+  size_t submitted = 0;
+  std::vector<std::string> created;
+  std::unique_ptr<IndexOutput> output;
+  uint32_t crc = 0;
+  try {
+    for (size_t c = 0; c < chunks.size(); c++) {
+      for (; submitted < chunks.size() && submitted < c + window; submitted++) {
+        Chunk &chunk = chunks[submitted];
+        if (!chunk.length)
+          continue;
+        const std::string &fname = files[chunk.file].name;
+        chunk.data = pool_->submit([this, &fname, &chunk] {
+          std::unique_ptr<char[]> data(new char[chunk.length]);
+          source_.readChunk(fname, chunk.offset, chunk.length, data.get());
+          return data;
+        });
+      }
+      Chunk &chunk = chunks[c];
+      const ReplicationTransport::FileInfo &info = files[chunk.file];
+      if (!chunk.offset) {
+        std::string tmp = info.name + std::string(kTempSuffix);
+        output = replica_.createOutput(
+            tmp, IOContext(IOContext::Default, info.length));
+        created.push_back(std::move(tmp));
+        crc = 0;
+      }
+      if (chunk.length) {
+        std::unique_ptr<char[]> data = chunk.data.get();
+        output->write(data.get(), chunk.length);
+        // The checksum covers everything but itself
+        uint64_t covered = info.length - sizeof(uint64_t);
+        if (info.hasChecksum && chunk.offset < covered)
+          crc = CRC32C::extend(
+              crc, data.get(),
+              static_cast<size_t>(
+                  std::min(chunk.length, covered - chunk.offset)));
+      }
+      if (chunk.offset + chunk.length == info.length) {
+        output->flush();
+        output.reset();
+        if (info.hasChecksum && crc != info.checksum)
+          throw Exception(Exception::Code::IndexCorruptionException,
+                          std::string("In Replicator::replicate(): copy of ")
+                              .append(info.name)
+                              .append(" doesn't match its checksum"));
+        stats.filesCopied++;
+        stats.bytesCopied += info.length;
+      }
+    }
+  } catch (...) {
+    // Fetches in flight reference chunks and files
+    for (size_t c = 0; c < submitted; c++)
+      if (chunks[c].data.valid())
+        chunks[c].data.wait();
+    output.reset();
+    for (auto &tmp : created) {
+      try {
+        replica_.deleteFile(tmp);
+      } catch (Exception &) {
+        // the next replicate() removes it
+      }
+    }
+    throw;
+  }
+}
+
+Replicator::Stats Replicator::replicate(const std::string &commitFile) {
+  Stats stats;
+  std::vector<ReplicationTransport::FileInfo> files;
+  for (auto &info : source_.listFiles())
+    if (!endsWith(info.name, kTempSuffix) && filter_(info.name))
+      files.push_back(std::move(info));
+
+  // Leftovers of a failed run
+  for (auto &fname : replica_.listAll()) {
+    if (!endsWith(fname, kTempSuffix))
+      continue;
+    try {
+      replica_.deleteFile(fname);
+    } catch (Exception &) {
+      // copying over it will fail and tell why
+    }
+  }
+
+  std::vector<ReplicationTransport::FileInfo> stale;
+  std::unordered_set<std::string> current;
+  for (auto &info : files) {
+    if (!info.committed) {
+      // Can't be copied yet; if it was installed before, the replica keeps
+      // its copy until the primary lists the file as gone
+      if (installed_.count(info.name))
+        current.insert(info.name);
+      continue;
+    }
+    current.insert(info.name);
+    if (upToDate(info))
+      stats.filesUpToDate++;
+    else
+      stale.push_back(info);
+  }
+  copy(stale, stats);
+
+  std::vector<std::string> names;
+  names.reserve(stale.size());
+  for (auto &info : stale)
+    names.push_back(info.name + std::string(kTempSuffix));
+  replica_.sync(names);
+
+  // A file which is already there changed, which write-once files never do,
+  // but a commit file without a generation may; it's replaced in one step,
+  // so the replica always has one
+  auto install = [this](const std::string &fname) {
+    replica_.replace(fname + std::string(kTempSuffix), fname);
+  };
+  names.clear();
+  bool commit = false;
+  for (auto &info : stale) {
+    if (info.name == commitFile) {
+      commit = true;
+      continue;
+    }
+    install(info.name);
+    names.push_back(info.name);
+  }
+  // Everything the commit file references must be durable before it is
+  replica_.sync(names);
+  if (commit) {
+    install(commitFile);
+    replica_.sync({commitFile});
+  }
+
+  for (auto &fname : installed_) {
+    if (current.count(fname))
+      continue;
+    try {
+      replica_.deleteFile(fname);
+      stats.filesDeleted++;
+    } catch (Exception &e) {
+      if (e.code() != Exception::Code::FileNotFoundException)
+        throw;
+    }
+  }
+  installed_ = std::move(current);
+  return stats;
+}
+
+} // namespace lucanthrope
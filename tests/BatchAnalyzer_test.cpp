@@ -0,0 +1,219 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lucanthrope/analysis/Analysis.h"
+#include "lucanthrope/analysis/BatchAnalyzer.h"
+#include "lucanthrope/analysis/StopAnalyzer.h"
+#include "lucanthrope/analysis/TermInterner.h"
+#include "lucanthrope/document/Document.h"
+
+using namespace lucanthrope;
+
+static std::string makeText(size_t seed, size_t words) {
+  static const char *const vocabulary[] = {
+      "The",   "index", "of",   "a",        "batch", "Analyzer", "threads",
+      "tokens", "and",  "term", "position", "offset", "document", "field"};
+  std::string text;
+  for (size_t i = 0; i < words; i++) {
+    size_t x = (seed * 2654435761u + i * 40503u) >> 3;
+    text.append(vocabulary[x % 14]);
+    if (x % 17 == 0) // a term of its own
+      text.append(std::string(1, 'a' + seed % 26) + "word");
+    text.append(i % 7 ? " " : ". ");
+  }
+  return text;
+}
+
+static std::vector<Document> makeDocuments(size_t n) {
+  std::vector<Document> docs(n);
+  for (size_t d = 0; d < n; d++) {
+    docs[d].add(Field::keyword("id", "Doc " + std::to_string(d)));
+    docs[d].add(Field::text("title", makeText(d, 3 + d % 5)));
+    if (d % 3) // bodies of very different lengths
+      docs[d].add(
+          Field::unstored("body", makeText(d + 1000, (d % 50 + 1) * 20)));
+    if (d % 5 == 0)
+      docs[d].add(Field::text(
+          "stream", std::unique_ptr<std::istream>(
+                        new std::istringstream(makeText(d + 7, 30)))));
+    docs[d].add(Field::text("title", makeText(d + 3, 4)));
+  }
+  return docs;
+}
+
+// Analyzes documents on this thread, one field at a time
+static BatchAnalyzer::Result
+analyzeSerially(Analyzer &analyzer, const std::vector<Document> &docs) {
+  BatchAnalyzer::Result result;
+  std::unordered_map<std::string, uint32_t> ids;
+  for (const Document &doc : docs) {
+    BatchAnalyzer::DocumentTokens tokens;
+    std::unordered_map<std::string, uint64_t> positions;
+    uint32_t f = 0;
+    for (const Field &field : doc) {
+      if (field.isTokenized()) {
+        tokens.fields.push_back(f);
+        tokens.fieldStarts.push_back(tokens.size());
+        std::istringstream text(field.isStringValue() ? field.getStringValue()
+                                                      : "");
+        std::unique_ptr<TokenStream> stream = analyzer.getTokenStream(
+            field.isStringValue() ? text : field.getIStreamValue(),
+            field.getName());
+        while (stream->next()) {
+          const Token &tok = stream->getToken();
+          auto it = ids.emplace(tok.termText, result.terms.size()).first;
+          if (it->second == result.terms.size())
+            result.terms.intern(tok.termText);
+          tokens.termIds.push_back(it->second);
+          tokens.positions.push_back(positions[field.getName()]++);
+          tokens.startOffsets.push_back(tok.startPos);
+          tokens.endOffsets.push_back(tok.endPos);
+        }
+      }
+      f++;
+    }
+    tokens.fieldStarts.push_back(tokens.size());
+    result.documents.push_back(std::move(tokens));
+  }
+  return result;
+}
+
+static void assertSame(const BatchAnalyzer::Result &a,
+                       const BatchAnalyzer::Result &b) {
+  assert(a.terms.size() == b.terms.size());
+  for (TermInterner::TermId id = 0; id < a.terms.size(); id++)
+    assert(a.terms.term(id) == b.terms.term(id));
+  assert(a.documents.size() == b.documents.size());
+  for (size_t d = 0; d < a.documents.size(); d++) {
+    const BatchAnalyzer::DocumentTokens &x = a.documents[d];
+    const BatchAnalyzer::DocumentTokens &y = b.documents[d];
+    assert(x.fields == y.fields && x.fieldStarts == y.fieldStarts);
+    assert(x.termIds == y.termIds && x.positions == y.positions);
+    assert(x.startOffsets == y.startOffsets && x.endOffsets == y.endOffsets);
+  }
+}
+
+// Throws on the field named "bad"
+class FailingAnalyzer : public Analyzer {
+private:
+  StopAnalyzer analyzer;
+
+public:
+  virtual std::unique_ptr<TokenStream>
+  getTokenStream(std::istream &input,
+                 std::string_view fieldName = std::string_view()) override {
+    return static_cast<Analyzer &>(analyzer).getTokenStream(input, fieldName);
+  }
+
+  virtual TokenStream &
+  reusableTokenStream(std::istream &input,
+                      std::string_view fieldName = std::string_view()) override {
+    if (fieldName == "bad")
+      throw std::runtime_error("bad field");
+    return Analyzer::reusableTokenStream(input, fieldName);
+  }
+
+  virtual TokenStream &
+  reusableTokenStream(std::string_view text,
+                      std::string_view fieldName = std::string_view()) override {
+    if (fieldName == "bad")
+      throw std::runtime_error("bad field");
+    return Analyzer::reusableTokenStream(text, fieldName);
+  }
+};
+
+// One large text, tokenized in chunks, is tokenized as a whole would be
+static void testAnalyzeText(Analyzer &analyzer) {
+  // without whitespace for longer than a chunk, and than a read of the
+  // istream version with one thread
+  std::string text;
+  for (size_t i = 0; text.size() < 5 * BatchAnalyzer::kMinChunkSize; i++)
+    text.append(i % 3 ? "ab." : "Cd,");
+  text.append(makeText(1, 600000));
+  text.append("\n\t end");
+  std::vector<Document> whole(1);
+  whole[0].add(Field::text("body", text));
+  BatchAnalyzer::Result expected = analyzeSerially(analyzer, whole);
+  assert(expected.documents[0].size() > 1000000);
+
+  for (size_t threads : {1, 3, 8}) {
+    BatchAnalyzer batch(analyzer, threads);
+    assertSame(batch.analyzeText(text, "body"), expected);
+    std::istringstream input(text);
+    assertSame(batch.analyzeText(input, "body"), expected);
+    // a text of less than a chunk, and an empty one
+    BatchAnalyzer::Result small = batch.analyzeText("The end, the END");
+    assert(small.terms.size() == 1 && small.terms.term(0) == "end");
+    assert((small.documents[0].positions == std::vector<uint64_t>{0, 1}));
+    assert((small.documents[0].startOffsets == std::vector<uint64_t>{4, 13}));
+    assert((small.documents[0].fieldStarts == std::vector<uint64_t>{0, 2}));
+    std::istringstream empty;
+    BatchAnalyzer::Result none = batch.analyzeText(empty);
+    assert(none.documents.size() == 1 && none.documents[0].size() == 0);
+    assert((none.documents[0].fieldStarts == std::vector<uint64_t>{0, 0}));
+  }
+}
+
+int main() {
+  StopAnalyzer analyzer;
+  std::vector<Document> docs = makeDocuments(500);
+  BatchAnalyzer::Result expected = analyzeSerially(analyzer, docs);
+  assert(expected.terms.size() > 30);
+
+  // the same, whatever the number of threads
+  for (size_t threads : {1, 3, 8}) {
+    BatchAnalyzer batch(analyzer, threads);
+    std::vector<Document> fresh = makeDocuments(500);
+    assertSame(batch.analyze(fresh), expected);
+    // a second batch of the same analyzer
+    std::vector<Document> few = makeDocuments(2);
+    BatchAnalyzer::Result small = batch.analyze(few);
+    assert(small.documents.size() == 2);
+    // not the keyword
+    assert(small.documents[0].fields == (std::vector<uint32_t>{1, 2, 3}));
+    assert(small.documents[1].fields == (std::vector<uint32_t>{1, 2, 3}));
+    assert(small.terms.size() <= expected.terms.size());
+  }
+
+  // the second title continues the positions of the first
+  size_t checked = 0;
+  for (const BatchAnalyzer::DocumentTokens &doc : expected.documents) {
+    size_t last = doc.fields.size() - 1;
+    if (doc.fieldStarts[last] != doc.fieldStarts[last + 1]) {
+      assert(doc.positions[doc.fieldStarts[last]] ==
+             doc.fieldStarts[1] - doc.fieldStarts[0]);
+      checked++;
+    }
+  }
+  assert(checked > 100);
+
+  BatchAnalyzer batch(analyzer, 4);
+  assert(batch.analyze(nullptr, 0).documents.empty());
+
+  FailingAnalyzer failing;
+  BatchAnalyzer failingBatch(failing, 4);
+  std::vector<Document> bad = makeDocuments(100);
+  bad[57].add(Field::text("bad", "field"));
+  bool thrown = false;
+  try {
+    failingBatch.analyze(bad);
+  } catch (std::runtime_error &e) {
+    thrown = true;
+  }
+  assert(thrown);
+  std::vector<Document> good = makeDocuments(100);
+  assert(failingBatch.analyze(good).documents.size() == 100);
+
+  testAnalyzeText(analyzer);
+
+  std::cout << "BatchAnalyzer test passed\n";
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/storage/BlockCache.h"
+#include "lucanthrope/storage/FSDirectory.h"
+
+using namespace lucanthrope;
+
+static std::shared_ptr<BlockCache::Block> makeBlock(size_t size) {
+  auto block = std::make_shared<BlockCache::Block>();
+  block->data.reset(new char[size]);
+  block->size = size;
+  return block;
+}
+
+int main() {
+  // Eviction and pinning, with a single shard so that the budget is exact
+  {
+    const size_t block_size = 1024;
+    BlockCache cache(64 * block_size, block_size, 1);
+    BlockCache::FileKey hot{1, 1, 1};
+    BlockCache::FileKey cold{1, 2, 1};
+    BlockCache::FileKey pinned{1, 3, 1};
+    BlockCache::FileKey warm{1, 4, 1};
+    cache.pinFile(pinned);
+    for (uint64_t i = 0; i < 8; i++)
+      cache.put(pinned, i, makeBlock(block_size));
+    for (uint64_t i = 0; i < 16; i++) {
+      cache.put(hot, i, makeBlock(block_size));
+      cache.get(hot, i);
+      cache.get(hot, i);
+      // a single hit in the small queue is enough to be promoted
+      cache.put(warm, i, makeBlock(block_size));
+      cache.get(warm, i);
+    }
+    // scan of cold blocks must not flush hot blocks out of the cache
+    for (uint64_t i = 0; i < 1000; i++)
+      cache.put(cold, i, makeBlock(block_size));
+    for (uint64_t i = 0; i < 16; i++)
+      assert(cache.get(hot, i) && cache.get(warm, i));
+    for (uint64_t i = 0; i < 8; i++)
+      assert(cache.get(pinned, i));
+    BlockCache::Stats stats = cache.getStats();
+    assert(stats.bytesUsed <= cache.getBudget());
+    assert(stats.evictions > 0);
+    std::cout << "hits: " << stats.hits << ", misses: " << stats.misses
+              << ", evictions: " << stats.evictions
+              << ", blocks: " << stats.blocks << '\n';
+    cache.invalidateFile(hot);
+    assert(!cache.get(hot, 0));
+  }
+
+  // FSDirectory inputs read through the cache
+  std::filesystem::path root =
+      std::filesystem::temp_directory_path() / "lucanthrope_block_cache_test";
+  std::filesystem::remove_all(root);
+  try {
+    FSDirectory dir(root.string());
+    std::shared_ptr<BlockCache> cache(new BlockCache(1 << 20, 4096, 4));
+    dir.setBlockCache(cache);
+    const uint64_t size = 100000;
+    {
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_0.dat");
+      for (uint64_t i = 0; i < size / 8; i++)
+        out->writeInt64(i);
+    }
+    for (int pass = 0; pass < 2; pass++) {
+      std::unique_ptr<IndexInput> in = dir.openInput("_0.dat");
+      for (uint64_t i = 0; i < size / 8; i++)
+        assert(in->readInt64() == i);
+      assert(in->eof());
+      in->seek(8 * 7777);
+      assert(in->readInt64() == 7777);
+      in->seek(8);
+      assert(in->readInt64() == 1);
+    }
+    BlockCache::Stats stats = cache->getStats();
+    assert(stats.misses == (size + 4095) / 4096);
+    std::cout << "FSDirectory: hits: " << stats.hits
+              << ", misses: " << stats.misses << '\n';
+
+    dir.pinFile("_0.dat");
+    dir.deleteFile("_0.dat");
+    assert(cache->getStats().blocks == 0);
+
+    // a block read short, because the file shrank after it was opened, isn't
+    // cached: readers which see the whole block again read it again
+    {
+      {
+        std::unique_ptr<IndexOutput> out = dir.createOutput("_1.dat");
+        for (uint64_t i = 0; i < size / 8; i++)
+          out->writeInt64(i + 1);
+      }
+      std::unique_ptr<IndexInput> first = dir.openInput("_1.dat");
+      std::unique_ptr<IndexInput> second = dir.openInput("_1.dat");
+      std::string path = (root / "_1.dat").string();
+      std::filesystem::resize_file(path, 100);
+      assert(first->readInt64() == 1);
+      std::filesystem::resize_file(path, size);
+      second->seek(8 * 12);
+      assert(second->readInt64() == 12 + 1);
+      second->seek(8 * 20);
+      assert(second->readInt64() == 0); // the regrown tail reads zeroes
+    }
+  } catch (std::exception &e) {
+    std::cout << e.what() << '\n';
+    std::filesystem::remove_all(root);
+    return 1;
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/analysis/Chain.h"
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/LowerCaseFilter.h"
+#include "lucanthrope/analysis/PerfectHashSet.h"
+#include "lucanthrope/analysis/StopFilter.h"
+
+using namespace lucanthrope;
+
+static std::vector<Token> tokensOf(TokenStream &stream) {
+  std::vector<Token> ret;
+  while (stream.next())
+    ret.push_back(stream.getToken());
+  return ret;
+}
+
+static bool sameTokens(const std::vector<Token> &a,
+                       const std::vector<Token> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].termText != b[i].termText || a[i].startPos != b[i].startPos ||
+        a[i].endPos != b[i].endPos || a[i].type != b[i].type)
+      return false;
+  return true;
+}
+
+// A stage which isn't a filter: drops terms longer than 5 characters
+struct ShortTermsStage {
+  bool accept(TokenView &view) { return view.termLength <= 5; }
+};
+
+int main() {
+  std::string text = "The Quick brown FOX, jumps over THE lazy dog; "
+                     "IT is the Dog's bone. A b c";
+  static constexpr StaticPerfectHashSet<4> stopWordSet({"the", "it", "is", "a"});
+  PerfectHashSet stopWords = stopWordSet.set();
+
+  // the same tokens as the chain of TokenFilters
+  std::istringstream input(text);
+  std::unique_ptr<TokenStream> tokenizer(new WhiteSpaceTokenizer<>(input));
+  std::unique_ptr<TokenStream> lower(new LowerCaseFilter(std::move(tokenizer)));
+  StopFilter filters(std::move(lower), stopWords);
+  std::vector<Token> expected = tokensOf(filters);
+  assert(expected.size() == 11);
+
+  std::istringstream chainInput(text);
+  Chain<WhiteSpaceTokenizer<>, LowerCaseFilter, StopFilter> chain(
+      chainInput, LowerCaseFilter::Stage(), StopFilter::Stage(stopWords));
+  assert(sameTokens(tokensOf(chain), expected));
+
+  // from memory, with a stage type of its own, through the TokenStream
+  // interface
+  std::unique_ptr<TokenStream> stream(
+      new Chain<WhiteSpaceTokenizer<>, LowerCaseFilter, StopFilter,
+                ShortTermsStage>(std::string_view(text),
+                                 LowerCaseFilter::Stage(),
+                                 StopFilter::Stage(stopWords),
+                                 ShortTermsStage()));
+  std::vector<std::string> terms;
+  while (stream->next())
+    terms.emplace_back(stream->getTokenView().termText());
+  assert((terms == std::vector<std::string>{"quick", "brown", "fox,", "jumps",
+                                            "over", "lazy", "dog;", "dog's",
+                                            "bone.", "b", "c"}));
+
+  // no filters at all
+  Chain<LowerCaseTokenizer> tokenizerOnly{std::string_view(text)};
+  size_t count = 0;
+  while (tokenizerOnly.advance())
+    count++;
+  assert(count == 18);
+
+  std::cout << "Chain test passed\n";
+  return 0;
+}
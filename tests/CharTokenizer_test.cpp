@@ -1,7 +1,115 @@
 #include "lucanthrope/analysis/CharTokenizer.h"
 
+#include <cassert>
+#include <cstddef>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <vector>
+
+// Tokenizes text with whitespace as token boundaries, one character at a time.
+static std::vector<lucanthrope::Token> expectedTokens(const std::string &text) {
+  std::vector<lucanthrope::Token> ret;
+  size_t start = 0;
+  for (size_t i = 0; i <= text.size(); i++) {
+    if (i < text.size() && text[i] != ' ' && text[i] != '\t' && text[i] != '\n')
+      continue;
+    if (i > start)
+      ret.emplace_back(text.substr(start, i - start), start, i);
+    start = i + 1;
+  }
+  return ret;
+}
+
+static void assertTokens(lucanthrope::Tokenizer &tokenizer,
+                         const std::vector<lucanthrope::Token> &expected) {
+  size_t i = 0;
+  while (tokenizer.next()) {
+    const lucanthrope::Token &tok = tokenizer.getToken();
+    assert(i < expected.size());
+    assert(tok.termText == expected[i].termText);
+    assert(tok.startPos == expected[i].startPos);
+    assert(tok.endPos == expected[i].endPos);
+    i++;
+  }
+  assert(i == expected.size());
+  assert(!tokenizer.next());
+}
+
+// CharClass::find() and CharScanner agree with the lookup table for every byte value, at
+// every offset of SIMD blocks.
+static void testCharClass() {
+  using namespace lucanthrope;
+  assert(isCharClass<isalpha_predicate>::value);
+  assert(!isCharClass<noop_normalizer>::value);
+  for (int c = 0; c < 256; c++) {
+    char ch = static_cast<char>(c);
+    assert(isalpha_predicate()(ch) ==
+           ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')));
+    assert(iswhitespace_predicate()(ch) == (c != ' ' && c != '\t' && c != '\n'));
+  }
+  std::string bytes;
+  for (int i = 0; i < 1000; i++)
+    bytes.push_back(static_cast<char>((i * 37 + i / 13) % 256));
+  const char *end = bytes.data() + bytes.size();
+  for (size_t from = 0; from < 200; from++) {
+    for (bool member : {true, false}) {
+      const char *expected = bytes.data() + from;
+      while (expected != end && isalpha_predicate()(*expected) != member)
+        expected++;
+      assert(isalpha_predicate::find(bytes.data() + from, end, member) ==
+             expected);
+      expected = bytes.data() + from;
+      while (expected != end && iswhitespace_predicate()(*expected) != member)
+        expected++;
+      assert(iswhitespace_predicate::find(bytes.data() + from, end, member) ==
+             expected);
+    }
+  }
+  // a scanner reusing block bitmasks finds the same run boundaries
+  CharScanner<isalpha_predicate> scanner;
+  bool member = true;
+  for (const char *p = bytes.data() + 3; p != end; member = !member) {
+    const char *next = isalpha_predicate::find(p, end, member);
+    assert(scanner.find(p, end, member) == next);
+    p = next;
+  }
+  // runs longer than SIMD blocks, and no match at all
+  std::string letters(300, 'q');
+  assert(isalpha_predicate::find(letters.data(), letters.data() + 300, false) ==
+         letters.data() + 300);
+  letters[150] = '1';
+  assert(isalpha_predicate::find(letters.data(), letters.data() + 300, false) ==
+         letters.data() + 150);
+}
+
+// Tokens which span chunks, including one longer than a chunk, come out the
+// same from an istream and from memory.
+static void testChunkBoundaries() {
+  using namespace lucanthrope;
+  constexpr size_t chunk = WhiteSpaceTokenizer<>::kChunkSize;
+  std::string text = "  leading";
+  while (text.size() < 3 * chunk) {
+    text.append(text.size() % 7 + 1, 'a' + text.size() % 26);
+    text.push_back(text.size() % 3 ? ' ' : '\n');
+  }
+  text.resize(chunk - 3);
+  text.append("spanning ");
+  text.append(chunk + 10, 'x');
+  text.append("\t\t");
+  while (text.size() < 3 * chunk + 1)
+    text.append("word ");
+  text.append("last");
+  std::vector<Token> expected = expectedTokens(text);
+
+  std::istringstream stream(text);
+  WhiteSpaceTokenizer<> streamTokenizer(stream);
+  assertTokens(streamTokenizer, expected);
+  WhiteSpaceTokenizer<> memoryTokenizer{std::string_view(text)};
+  assertTokens(memoryTokenizer, expected);
+  WhiteSpaceTokenizer<> emptyTokenizer{std::string_view()};
+  assertTokens(emptyTokenizer, {});
+}
 
 int main() {
   using namespace lucanthrope;
@@ -110,5 +218,9 @@ int main() {
               << custom_alpha_char_tokizer_y->getToken().toString() << '\n';
   }
 
+  testCharClass();
+  testChunkBoundaries();
+  std::cout << "\nCharTokenizer test passed\n";
+
   return 0;
 }
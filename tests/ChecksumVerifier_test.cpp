@@ -0,0 +1,142 @@
+#include <cassert>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/IO/CRC32C.h"
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/ChecksumVerifier.h"
+#include "lucanthrope/storage/CompoundFileWriter.h"
+#include "lucanthrope/storage/FSDirectory.h"
+#include "lucanthrope/storage/LockFile.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+
+using namespace lucanthrope;
+
+static void testCRC32C() {
+  const std::string check = "123456789";
+  assert(CRC32C::extend(0, check.data(), check.size()) == 0xe3069283);
+  assert(CRC32C::extend(0, nullptr, 0) == 0);
+
+  std::string data;
+  for (int i = 0; i < 100000; i++)
+    data.push_back(static_cast<char>(i * 31 + i / 7));
+  uint32_t whole = CRC32C::extend(0, data.data(), data.size());
+  // incremental and combined checksums agree with the whole one
+  for (size_t split : {size_t(0), size_t(1), size_t(7), size_t(4096),
+                       size_t(99999), data.size()}) {
+    uint32_t a = CRC32C::extend(0, data.data(), split);
+    uint32_t b = CRC32C::extend(0, data.data() + split, data.size() - split);
+    assert(CRC32C::extend(a, data.data() + split, data.size() - split) ==
+           whole);
+    assert(CRC32C::combine(a, b, data.size() - split) == whole);
+  }
+}
+
+static void writeFile(Directory &dir, const std::string &fname, size_t size,
+                      bool footer) {
+  std::unique_ptr<IndexOutput> out = dir.createOutput(fname);
+  out->enableChecksum();
+  for (size_t i = 0; i < size; i++)
+    out->writeByte(static_cast<char>(i * 13 + fname.size()));
+  if (footer)
+    out->writeChecksumFooter();
+}
+
+static const ChecksumVerifier::FileResult &
+resultOf(const std::vector<ChecksumVerifier::FileResult> &results,
+         const std::string &fname) {
+  for (auto &result : results)
+    if (result.name == fname)
+      return result;
+  assert(false && "file is not verified");
+  return results.front();
+}
+
+static void testDirectory(Directory &dir) {
+  writeFile(dir, "_0.small", 10, true);
+  writeFile(dir, "_0.empty", 0, true);
+  writeFile(dir, "_0.big", 3 * 1024 * 1024 + 5, true);
+  writeFile(dir, "_0.raw", 1000, false);
+  {
+    CompoundFileWriter writer(dir, "_1");
+    writer.addFile(dir, "_0.small");
+    writer.addFile(dir, "_0.big");
+    writer.finish();
+  }
+  std::unique_ptr<IndexInput> in = dir.openInput("_0.big");
+  in->verifyChecksumFooter(dir.fileLength("_0.big"));
+
+  // chunks much smaller than files
+  ChecksumVerifier verifier(4, 256 * 1024);
+  std::vector<ChecksumVerifier::FileResult> results = verifier.verify(dir);
+  assert(results.size() == 6);
+  for (const char *fname : {"_0.small", "_0.empty", "_0.big", "_1.cfs",
+                            "_1.cfe"}) {
+    const ChecksumVerifier::FileResult &result = resultOf(results, fname);
+    assert(result.status == ChecksumVerifier::Status::Ok);
+    assert(result.actual == result.expected);
+  }
+  assert(resultOf(results, "_0.raw").status ==
+         ChecksumVerifier::Status::NoChecksum);
+  assert(resultOf(results, "_0.big").length == 3 * 1024 * 1024 + 5 + 16);
+}
+
+int main() {
+  namespace fs = std::filesystem;
+  fs::path root = fs::temp_directory_path() / "lucanthrope_checksum_test";
+  fs::remove_all(root);
+  try {
+    testCRC32C();
+    {
+      RAMDirectory dir;
+      testDirectory(dir);
+      // lock files are reported, not thrown
+      std::unique_ptr<LockFile> lock = dir.obtainLock("write.lock");
+      ChecksumVerifier verifier(2);
+      auto results = verifier.verify(dir, {"_0.small", "write.lock", "none"});
+      assert(results[0].status == ChecksumVerifier::Status::Ok);
+      assert(results[1].status != ChecksumVerifier::Status::Ok);
+      assert(results[2].status == ChecksumVerifier::Status::Error);
+    }
+    {
+      FSDirectory dir(root.string(), true);
+      testDirectory(dir);
+      // flip one byte in the middle of a big file
+      {
+        std::fstream f((root / "_0.big").string(),
+                       std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(2 * 1024 * 1024 + 3);
+        f.put('\x7f' ^ static_cast<char>((2 * 1024 * 1024 + 3) * 13 + 6));
+      }
+      ChecksumVerifier verifier(3, 1024 * 1024);
+      auto results = verifier.verify(dir);
+      const ChecksumVerifier::FileResult &big = resultOf(results, "_0.big");
+      assert(big.status == ChecksumVerifier::Status::Corrupted);
+      assert(big.actual != big.expected);
+      std::cout << "verified " << big.length << " bytes at "
+                << big.megabytesPerSecond() << " MB/s\n";
+      bool thrown = false;
+      try {
+        dir.openInput("_0.big")->verifyChecksumFooter(dir.fileLength("_0.big"));
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::IndexCorruptionException);
+        thrown = true;
+      }
+      assert(thrown);
+    }
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    fs::remove_all(root);
+    return 1;
+  }
+  fs::remove_all(root);
+  std::cout << "ChecksumVerifier test passed\n";
+  return 0;
+}
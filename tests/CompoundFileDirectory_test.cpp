@@ -0,0 +1,145 @@
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/BlockCache.h"
+#include "lucanthrope/storage/CompoundFileDirectory.h"
+#include "lucanthrope/storage/CompoundFileWriter.h"
+#include "lucanthrope/storage/Directory.h"
+#include "lucanthrope/storage/FSDirectory.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+
+using namespace lucanthrope;
+
+// Sizes of packed files; include empty files and files which span several
+// RAMFile blocks and BlockCache blocks
+static const std::vector<uint64_t> kSizes = {0, 1, 100, 4095, 4096, 4097,
+                                             70000, 0, 12345};
+
+static std::string nameOf(size_t i) {
+  return "_7." + std::to_string(i);
+}
+
+static char byteOf(size_t i, uint64_t j) {
+  return static_cast<char>((i * 7 + j * 31) % 251);
+}
+
+static void writeFiles(Directory &dir) {
+  for (size_t i = 0; i < kSizes.size(); i++) {
+    std::unique_ptr<IndexOutput> out = dir.createOutput(nameOf(i));
+    for (uint64_t j = 0; j < kSizes[i]; j++)
+      out->writeByte(byteOf(i, j));
+  }
+}
+
+static void pack(Directory &dir) {
+  CompoundFileWriter writer(dir, "_7");
+  for (size_t i = 0; i < kSizes.size(); i++)
+    writer.addFile(dir, nameOf(i));
+  writer.finish();
+}
+
+static void check(Directory &dir) {
+  CompoundFileDirectory cfs(dir, "_7");
+  assert(cfs.listAll().size() == kSizes.size());
+  for (size_t i = 0; i < kSizes.size(); i++) {
+    assert(cfs.fileExists(nameOf(i)));
+    assert(cfs.fileLength(nameOf(i)) == kSizes[i]);
+    std::unique_ptr<IndexInput> in = cfs.openInput(nameOf(i));
+    for (uint64_t j = 0; j < kSizes[i]; j++)
+      assert(in->readByte() == byteOf(i, j));
+    assert(in->eof());
+    if (kSizes[i] < 2)
+      continue;
+    // seek inside the slice, and a slice of a slice
+    uint64_t mid = kSizes[i] / 2;
+    in->seek(mid);
+    assert(in->readByte() == byteOf(i, mid));
+    in->seek(kSizes[i]);
+    assert(in->eof());
+    std::unique_ptr<IndexInput> sub = in->slice(1, kSizes[i] - 2);
+    in.reset(); // slices may outlive their parents
+    for (uint64_t j = 1; j + 1 < kSizes[i]; j++)
+      assert(sub->readByte() == byteOf(i, j));
+    assert(sub->eof());
+  }
+  assert(!cfs.fileExists("_7.cfs"));
+
+  bool thrown = false;
+  try {
+    cfs.createOutput("_7.x");
+  } catch (Exception &e) {
+    assert(e.code() == Exception::Code::UnsupportedOperationException);
+    thrown = true;
+  }
+  assert(thrown);
+  thrown = false;
+  try {
+    std::unique_ptr<IndexInput> in = cfs.openInput("_7.0");
+    in->slice(1, 1);
+  } catch (Exception &e) {
+    assert(e.code() == Exception::Code::IndexCorruptionException);
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+int main() {
+  namespace fs = std::filesystem;
+  fs::path tmp = fs::temp_directory_path() / "lucanthrope_cfs_test";
+  try {
+    RAMDirectory ram;
+    writeFiles(ram);
+    pack(ram);
+    for (size_t i = 0; i < kSizes.size(); i++)
+      ram.deleteFile(nameOf(i));
+    check(ram);
+    std::cout << "RAMDirectory: ok\n";
+
+    fs::remove_all(tmp);
+    {
+      FSDirectory dir(tmp.string());
+      writeFiles(dir);
+      pack(dir);
+      check(dir);
+      std::cout << "FSDirectory: ok\n";
+      dir.setUseMMap(true);
+      check(dir);
+      std::cout << "FSDirectory with mmap: ok\n";
+      dir.setUseMMap(false);
+      dir.setBlockCache(std::make_shared<BlockCache>(1 << 20, 8192, 2));
+      check(dir);
+      std::cout << "FSDirectory with block cache: ok\n";
+
+      // a failed writer leaves nothing behind
+      {
+        CompoundFileWriter writer(dir, "_8");
+        writer.addFile(dir, nameOf(1));
+        bool thrown = false;
+        try {
+          writer.addFile(dir, nameOf(1));
+        } catch (Exception &e) {
+          assert(e.code() == Exception::Code::FileAlreadyExistsException);
+          thrown = true;
+        }
+        assert(thrown);
+      }
+      assert(!dir.fileExists("_8.cfs") && !dir.fileExists("_8.cfe"));
+    }
+    fs::remove_all(tmp);
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    fs::remove_all(tmp);
+    return 1;
+  }
+  std::cout << "CompoundFileDirectory test passed\n";
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "lucanthrope/IO/IOStats.h"
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/IO/RateLimiter.h"
+#include "lucanthrope/storage/IOContext.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+
+using namespace lucanthrope;
+
+static double writeFile(Directory &dir, const std::string &name, uint64_t size,
+                        const IOContext &context) {
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::string chunk(4096, 'x');
+    std::unique_ptr<IndexOutput> out = dir.createOutput(name, context);
+    for (uint64_t written = 0; written < size; written += chunk.size())
+      out->write(chunk.data(), chunk.size());
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main() {
+  try {
+    RAMDirectory dir;
+    const uint64_t kSize = 400 * 1024;
+
+    writeFile(dir, "_0.flush", kSize, IOContext(IOContext::Flush, kSize));
+    IOCounters flush = dir.getIOStats(IOContext::Flush);
+    assert(flush.bytesWritten == kSize && flush.writeOps > 0);
+    assert(dir.getIOStats(IOContext::Merge).bytesWritten == 0);
+
+    {
+      std::unique_ptr<IndexInput> in =
+          dir.openInput("_0.flush", IOContext(IOContext::Search));
+      std::string buf(kSize, '\0');
+      assert(in->read(buf.data(), buf.size()) == kSize);
+    }
+    IOCounters search = dir.getIOStats(IOContext::Search);
+    assert(search.bytesRead == kSize && search.readOps > 0);
+    assert(dir.getIOStats(IOContext::Default).bytesRead == 0);
+
+    // 1 MB/s with 100 KB burst: 400 KB take at least ~0.3 s
+    auto limiter = std::make_shared<RateLimiter>(1024 * 1024);
+    dir.setMergeRateLimiter(limiter);
+    double unthrottled =
+        writeFile(dir, "_1.flush", kSize, IOContext(IOContext::Flush));
+    double throttled =
+        writeFile(dir, "_1.merge", kSize, IOContext(IOContext::Merge));
+    std::cout << "flush: " << unthrottled << " s, merge at 1 MB/s: "
+              << throttled << " s, paused for "
+              << limiter->getPausedNanos() / 1e9 << " s\n";
+    assert(throttled >= 0.25);
+    assert(limiter->getPausedNanos() > 0);
+    assert(dir.getIOStats(IOContext::Merge).bytesWritten == kSize);
+
+    // limiting can be switched off
+    limiter->setRate(0);
+    double unlimited =
+        writeFile(dir, "_2.merge", kSize, IOContext(IOContext::Merge));
+    assert(unlimited < throttled);
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::cout << "Directory I/O stats test passed\n";
+  return 0;
+}
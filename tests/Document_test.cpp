@@ -1,5 +1,9 @@
+#include "lucanthrope/common/Exception.h"
 #include "lucanthrope/document/Document.h"
 
+#include <cassert>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <sstream>
@@ -22,5 +26,47 @@ int main() {
   it->getIStreamValue().read(buf, 100);
   std::cout << "istream value field: "
             << std::string(buf, it->getIStreamValue().gcount()) << '\n';
+
+  // span values refer to the caller's bytes
+  std::string buffer = "title one|body of the first document|title two";
+  ByteSpan all{buffer, nullptr};
+  doc.add(Field::text("title", all.slice(0, 9)));
+  doc.add(Field::unstored("body", all.slice(10, 26)));
+  it = doc.find("body");
+  assert(it != doc.end() && it->isSpanValue() && !it->isStringValue());
+  assert(!it->isStored() && it->isTokenized());
+  assert(it->getTextValue().data() == buffer.data() + 10);
+  assert(it->getTextValue() == "body of the first document");
+  assert(doc.find("title")->getTextValue() == "title one");
+  assert(doc.find("some field 1")->getTextValue() == "some string value");
+  std::cout << doc.toString() << '\n';
+
+  // or to a mapping of a file, which they share
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "lucanthrope_document_test";
+  std::ofstream(path) << "mapped file value";
+  {
+    ByteSpan mapped = ByteSpan::mapFile(path.string());
+    Document mappedDoc;
+    mappedDoc.add(Field::unstored("file", mapped.slice(7, 10)));
+    mapped = ByteSpan();
+    assert(mappedDoc.find("file")->getTextValue() == "file value");
+    assert(mappedDoc.find("file")->getSpanValue().owner.use_count() == 1);
+  }
+  // an empty file makes an empty value
+  std::ofstream(path, std::ios::trunc);
+  {
+    Document mappedDoc;
+    mappedDoc.add(Field::unstored("file", ByteSpan::mapFile(path.string())));
+    assert(mappedDoc.find("file")->getTextValue().empty());
+  }
+  std::filesystem::remove(path);
+  bool thrown = false;
+  try {
+    ByteSpan::mapFile(path.string());
+  } catch (const Exception &e) {
+    thrown = e.code() == Exception::Code::FileNotFoundException;
+  }
+  assert(thrown);
   return 0;
 }
\ No newline at end of file
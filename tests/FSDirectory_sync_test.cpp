@@ -0,0 +1,127 @@
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/FSDirectory.h"
+
+using namespace lucanthrope;
+
+static std::vector<std::string> writeFiles(Directory &dir,
+                                           const std::string &prefix,
+                                           int count) {
+  std::vector<std::string> ret;
+  std::string payload(16 * 1024, 'p');
+  for (int i = 0; i < count; i++) {
+    ret.push_back(prefix + "." + std::to_string(i));
+    std::unique_ptr<IndexOutput> out = dir.createOutput(ret.back());
+    out->write(payload.data(), payload.size());
+  }
+  return ret;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+int main() {
+  namespace fs = std::filesystem;
+  fs::path root = fs::temp_directory_path() / "lucanthrope_sync_test";
+  fs::remove_all(root);
+  try {
+    FSDirectory dir(root.string());
+    const int kFiles = 32;
+
+    // baseline: one IndexOutput::sync() per file
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::string payload(16 * 1024, 'p');
+      for (int i = 0; i < kFiles; i++) {
+        std::unique_ptr<IndexOutput> out =
+            dir.createOutput("_0." + std::to_string(i));
+        out->write(payload.data(), payload.size());
+        out->sync();
+      }
+    }
+    double serial = secondsSince(start);
+
+    std::vector<std::string> names = writeFiles(dir, "_1", kFiles);
+    start = std::chrono::steady_clock::now();
+    dir.sync(names);
+    double batched = secondsSince(start);
+    std::cout << kFiles << " files: serial " << serial << " s, batched "
+              << batched << " s\n";
+
+    // concurrent requests are merged
+    std::vector<std::vector<std::string>> perThread;
+    for (int t = 0; t < 8; t++)
+      perThread.push_back(writeFiles(dir, "_" + std::to_string(t + 2), 8));
+    std::vector<std::thread> threads;
+    start = std::chrono::steady_clock::now();
+    for (auto &fnames : perThread)
+      threads.emplace_back([&dir, &fnames] { dir.sync(fnames); });
+    for (auto &t : threads)
+      t.join();
+    std::cout << "8 threads x 8 files: " << secondsSince(start) << " s\n";
+
+#ifdef __linux__
+    dir.setUseSyncFS(true);
+    dir.sync(names);
+    dir.setUseSyncFS(false);
+#endif
+
+    // a missing file fails the whole batch
+    bool thrown = false;
+    try {
+      dir.sync({names[0], "missing"});
+    } catch (Exception &e) {
+      assert(e.code() == Exception::Code::FileNotFoundException);
+      thrown = true;
+    }
+    assert(thrown);
+    dir.sync({}); // no-op
+
+    // renaming to a name which appears meanwhile never overwrites it: of
+    // concurrent renames to one target, exactly one succeeds
+    for (int round = 0; round < 50; round++) {
+      std::string target = "_r" + std::to_string(round) + ".target";
+      std::vector<std::string> sources =
+          writeFiles(dir, "_r" + std::to_string(round), 4);
+      std::vector<std::thread> renamers;
+      std::vector<int> renamed(sources.size());
+      for (size_t i = 0; i < sources.size(); i++)
+        renamers.emplace_back([&dir, &sources, &target, &renamed, i] {
+          try {
+            dir.rename(sources[i], target);
+            renamed[i] = 1;
+          } catch (Exception &e) {
+            assert(e.code() == Exception::Code::FileAlreadyExistsException);
+          }
+        });
+      for (auto &t : renamers)
+        t.join();
+      int count = 0;
+      for (size_t i = 0; i < sources.size(); i++) {
+        count += renamed[i];
+        assert(dir.fileExists(sources[i]) == !renamed[i]);
+      }
+      assert(count == 1 && dir.fileExists(target));
+    }
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    fs::remove_all(root);
+    return 1;
+  }
+  fs::remove_all(root);
+  std::cout << "FSDirectory sync test passed\n";
+  return 0;
+}
@@ -0,0 +1,250 @@
+#include <cassert>
+#include <chrono>
+#include <csignal>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/FSDirectory.h"
+#include "lucanthrope/storage/LockFile.h"
+#include "lucanthrope/storage/LogStructuredDirectory.h"
+
+#include <sys/resource.h>
+
+using namespace lucanthrope;
+
+static std::string contentsOf(const std::string &fname, size_t size) {
+  std::string ret;
+  for (size_t i = 0; i < size; i++)
+    ret.push_back(static_cast<char>('a' + (fname.size() + i * 7) % 26));
+  return ret;
+}
+
+static void writeFile(Directory &dir, const std::string &fname, size_t size) {
+  std::string payload = contentsOf(fname, size);
+  std::unique_ptr<IndexOutput> out = dir.createOutput(fname);
+  out->write(payload.data(), payload.size());
+}
+
+static void checkFile(Directory &dir, const std::string &fname, size_t size) {
+  assert(dir.fileLength(fname) == size);
+  std::unique_ptr<IndexInput> in = dir.openInput(fname);
+  std::string got(size, '\0');
+  assert(in->read(&got[0], size) == size);
+  assert(in->eof());
+  assert(got == contentsOf(fname, size));
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Creates, syncs and deletes count small files, like a flush of a tiny
+// segment does.
+static double churn(Directory &dir, const std::string &prefix, int count) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::string> names;
+  for (int i = 0; i < count; i++) {
+    names.push_back(prefix + "." + std::to_string(i));
+    writeFile(dir, names.back(), 4096);
+  }
+  dir.sync(names);
+  for (auto &fname : names)
+    dir.deleteFile(fname);
+  return secondsSince(start);
+}
+
+int main() {
+  namespace fs = std::filesystem;
+  fs::path root = fs::temp_directory_path() / "lucanthrope_log_test";
+  fs::remove_all(root);
+  try {
+    const uint64_t kLogSize = 256 * 1024;
+    std::vector<std::string> names;
+    {
+      LogStructuredDirectory dir(root.string(), kLogSize);
+      // small files and a file which spans several logs
+      for (int i = 0; i < 100; i++) {
+        names.push_back("_" + std::to_string(i % 10) + "." + std::to_string(i));
+        writeFile(dir, names.back(), 100 * i);
+      }
+      writeFile(dir, "_big.bin", 3 * kLogSize + 17);
+      for (auto &fname : names)
+        checkFile(dir, fname, 100 * std::stoi(fname.substr(3)));
+      checkFile(dir, "_big.bin", 3 * kLogSize + 17);
+      assert(dir.logBytes() > kLogSize);
+
+      // slices and seeks across extents
+      std::unique_ptr<IndexInput> in = dir.openInput("_big.bin");
+      std::string expected = contentsOf("_big.bin", 3 * kLogSize + 17);
+      std::unique_ptr<IndexInput> slice = in->slice(kLogSize - 5, 10);
+      std::string got(10, '\0');
+      assert(slice->read(&got[0], 10) == 10 && slice->eof());
+      assert(got == expected.substr(kLogSize - 5, 10));
+      in->seek(2 * kLogSize + 3);
+      assert(in->readByte() == expected[2 * kLogSize + 3]);
+      in->seek(1);
+      assert(in->readByte() == expected[1]);
+
+      // outputs are append-only
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_x.tmp");
+      out->writeInt32(1);
+      bool thrown = false;
+      try {
+        out->seek(0);
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::UnsupportedOperationException);
+        thrown = true;
+      }
+      assert(thrown);
+      // not readable until closed
+      thrown = false;
+      try {
+        dir.openInput("_x.tmp");
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::IOErrorException);
+        thrown = true;
+      }
+      assert(thrown);
+      out.reset();
+      assert(dir.fileLength("_x.tmp") == 4);
+      dir.rename("_x.tmp", "_x.bin");
+      assert(!dir.fileExists("_x.tmp") && dir.fileExists("_x.bin"));
+      // replace() gives the old file's extents back
+      writeFile(dir, "_x.tmp", 10);
+      uint64_t liveBefore = dir.liveBytes();
+      dir.replace("_x.tmp", "_x.bin");
+      assert(!dir.fileExists("_x.tmp") && dir.liveBytes() == liveBefore - 4);
+      checkFile(dir, "_x.bin", 10);
+      out = dir.createOutput("_x.tmp");
+      out->writeInt32(1);
+      out.reset();
+      dir.replace("_x.tmp", "_x.bin");
+
+      {
+        std::unique_ptr<LockFile> lock = dir.obtainLock("write.lock");
+        assert(lock);
+        assert(!dir.obtainLock("write.lock"));
+        assert(dir.fileExists("write.lock"));
+      }
+      assert(!dir.fileExists("write.lock"));
+
+      // concurrent writers
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; t++)
+        threads.emplace_back([&dir, t] {
+          for (int i = 0; i < 20; i++)
+            writeFile(dir, "_t" + std::to_string(t) + "." + std::to_string(i),
+                      70000);
+        });
+      for (auto &t : threads)
+        t.join();
+      for (int t = 0; t < 4; t++)
+        for (int i = 0; i < 20; i++)
+          checkFile(dir, "_t" + std::to_string(t) + "." + std::to_string(i),
+                    70000);
+
+      // a file whose last flush fails is dropped, not committed truncated;
+      // writes fail once the file size limit is 0
+      uint64_t live = dir.liveBytes();
+      std::signal(SIGXFSZ, SIG_IGN);
+      rlimit limit;
+      getrlimit(RLIMIT_FSIZE, &limit);
+      rlimit none = limit;
+      none.rlim_cur = 0;
+      out = dir.createOutput("_f.bin");
+      std::string payload = contentsOf("_f.bin", 70000);
+      out->write(payload.data(), payload.size());
+      setrlimit(RLIMIT_FSIZE, &none);
+      out.reset();
+      setrlimit(RLIMIT_FSIZE, &limit);
+      std::signal(SIGXFSZ, SIG_DFL);
+      assert(!dir.fileExists("_f.bin") && dir.liveBytes() == live);
+
+      names.push_back("_big.bin");
+      names.push_back("_x.bin");
+      dir.sync(names);
+      thrown = false;
+      try {
+        dir.sync({"missing"});
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::FileNotFoundException);
+        thrown = true;
+      }
+      assert(thrown);
+    }
+
+    // only synced files survive a reopen; the threads' files were written to
+    // the manifest by the destructor, delete them now
+    {
+      LogStructuredDirectory dir(root.string(), kLogSize);
+      for (auto &fname : names)
+        assert(dir.fileExists(fname));
+      checkFile(dir, "_big.bin", 3 * kLogSize + 17);
+      checkFile(dir, "_3.23", 2300);
+      for (int t = 0; t < 4; t++)
+        dir.deleteSegment("_t" + std::to_string(t));
+      dir.deleteSegment("_big");
+      for (int i = 1; i < 10; i++)
+        dir.deleteSegment("_" + std::to_string(i));
+
+      // an input opened before compaction keeps working
+      std::unique_ptr<IndexInput> in = dir.openInput("_0.90");
+      uint64_t before = dir.logBytes();
+      uint64_t reclaimed = dir.compact();
+      std::cout << "compaction reclaimed " << reclaimed << " of " << before
+                << " bytes, " << dir.liveBytes() << " live\n";
+      assert(reclaimed > 0 && dir.logBytes() < before);
+      std::string got(9000, '\0');
+      assert(in->read(&got[0], 9000) == 9000);
+      assert(got == contentsOf("_0.90", 9000));
+      for (int i = 0; i < 100; i += 10)
+        checkFile(dir, "_0." + std::to_string(i), 100 * i);
+      assert(dir.openInput("_x.bin")->readInt32() == 1);
+    }
+    {
+      LogStructuredDirectory dir(root.string(), kLogSize);
+      std::vector<std::string> left = dir.listAll();
+      assert(left.size() == 11);
+      for (int i = 0; i < 100; i += 10)
+        checkFile(dir, "_0." + std::to_string(i), 100 * i);
+    }
+
+    // background compaction
+    {
+      LogStructuredDirectory dir(root.string(), kLogSize, true);
+      for (int round = 0; round < 4; round++)
+        churn(dir, "_c" + std::to_string(round), 64);
+      auto start = std::chrono::steady_clock::now();
+      while (dir.logBytes() > 2 * kLogSize && secondsSince(start) < 10)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      assert(dir.logBytes() <= 2 * kLogSize);
+    }
+
+    // small file churn against a plain file system directory
+    {
+      FSDirectory fsDir((root / "fs").string());
+      LogStructuredDirectory logDir((root / "log").string());
+      double plain = churn(fsDir, "_0", 200);
+      double logged = churn(logDir, "_0", 200);
+      std::cout << "200 small files: FSDirectory " << plain
+                << " s, LogStructuredDirectory " << logged << " s\n";
+    }
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    fs::remove_all(root);
+    return 1;
+  }
+  fs::remove_all(root);
+  std::cout << "LogStructuredDirectory test passed\n";
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/storage/FSDirectory.h"
+#include "lucanthrope/storage/NRTCachingDirectory.h"
+
+using namespace lucanthrope;
+
+static void writeFile(Directory &dir, const std::string &name, size_t size) {
+  std::unique_ptr<IndexOutput> out = dir.createOutput(name, IOContext(IOContext::Flush, size));
+  out->writeString(name);
+  for (size_t i = name.size() + 1; i < size; i++)
+    out->writeByte(static_cast<char>(i));
+}
+
+// Files start with the name they were created with
+static void checkFile(Directory &dir, const std::string &name,
+                      const std::string &original) {
+  std::unique_ptr<IndexInput> in = dir.openInput(name);
+  std::string buf;
+  in->readString(buf);
+  assert(buf == original);
+}
+
+static void checkFile(Directory &dir, const std::string &name) {
+  checkFile(dir, name, name);
+}
+
+int main() {
+  std::filesystem::path root =
+      std::filesystem::temp_directory_path() / "lucanthrope_nrt_test";
+  std::filesystem::remove_all(root);
+  try {
+    FSDirectory disk(root.string());
+    {
+      NRTCachingDirectory nrt(disk, 64 * 1024, 1024 * 1024);
+      writeFile(nrt, "_0.small", 1000);
+      writeFile(nrt, "_0.large", 100 * 1024);
+      assert(!disk.fileExists("_0.small") && disk.fileExists("_0.large"));
+      std::vector<std::string> cached = nrt.listCachedFiles();
+      assert(cached.size() == 1 && cached[0] == "_0.small");
+      assert(nrt.listAll().size() == 2);
+      checkFile(nrt, "_0.small");
+      checkFile(nrt, "_0.large");
+
+      nrt.rename("_0.small", "_1.small");
+      nrt.sync({"_1.small", "_0.large"});
+      assert(disk.fileExists("_1.small") && nrt.listCachedFiles().empty());
+      checkFile(nrt, "_1.small", "_0.small");
+
+      // a file which is still being written stays in the cache
+      {
+        std::unique_ptr<IndexOutput> out =
+            nrt.createOutput("_4.small", IOContext(IOContext::Flush, 10));
+        out->writeString("_4.small");
+        assert(!nrt.unCache("_4.small") && !disk.fileExists("_4.small"));
+      }
+      assert(nrt.unCache("_4.small") && disk.fileExists("_4.small"));
+      assert(!nrt.unCache("_4.small"));
+      checkFile(nrt, "_4.small");
+
+      // replace() keeps the new file where the old one was durable
+      writeFile(nrt, "_5.small", 10);
+      nrt.replace("_5.small", "_4.small");
+      assert(!nrt.fileExists("_5.small") && nrt.listCachedFiles().empty());
+      checkFile(nrt, "_4.small", "_5.small");
+      writeFile(nrt, "_5.small", 10);
+      writeFile(nrt, "_6.small", 10);
+      nrt.replace("_6.small", "_5.small");
+      assert(nrt.listCachedFiles().size() == 1);
+      checkFile(nrt, "_5.small", "_6.small");
+      nrt.deleteFile("_5.small");
+
+      // destructor moves everything to disk
+      writeFile(nrt, "_2.small", 10);
+      nrt.deleteFile("_0.large");
+    }
+    assert(disk.fileExists("_2.small") && !disk.fileExists("_0.large"));
+
+    {
+      NRTCachingDirectory nrt(disk, 64 * 1024, 128 * 1024, true);
+      for (int i = 0; i < 10; i++)
+        writeFile(nrt, "_3.f" + std::to_string(i), 32 * 1024);
+      // the cache is more than half full, background thread has been woken
+      for (int i = 0; i < 100 && disk.listAll().size() < 5; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      std::cout << disk.listAll().size() << " files on disk, "
+                << nrt.listCachedFiles().size() << " files in RAM ("
+                << nrt.ramBytesUsed() << " bytes)\n";
+      for (int i = 0; i < 10; i++)
+        checkFile(nrt, "_3.f" + std::to_string(i));
+    }
+    assert(disk.listAll().size() == 13);
+  } catch (std::exception &e) {
+    std::cout << e.what() << '\n';
+    std::filesystem::remove_all(root);
+    return 1;
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "lucanthrope/analysis/Analysis.h"
+#include "lucanthrope/analysis/PerFieldAnalyzerWrapper.h"
+#include "lucanthrope/analysis/StopAnalyzer.h"
+#include "lucanthrope/analysis/WhiteSpaceAnalyzer.h"
+
+static size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+  allocations++;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace lucanthrope;
+
+// Remembers the field name it was last asked to analyze
+class RecordingAnalyzer : public Analyzer {
+private:
+  WhiteSpaceAnalyzer analyzer;
+
+public:
+  std::string lastField;
+
+  virtual std::unique_ptr<TokenStream>
+  getTokenStream(std::istream &input,
+                 std::string_view fieldName = std::string_view()) override {
+    lastField = fieldName;
+    return static_cast<Analyzer &>(analyzer).getTokenStream(input, fieldName);
+  }
+
+  virtual TokenStream &
+  reusableTokenStream(std::istream &input,
+                      std::string_view fieldName = std::string_view()) override {
+    lastField = fieldName;
+    return Analyzer::reusableTokenStream(input, fieldName);
+  }
+};
+
+static size_t count(TokenStream &stream) {
+  size_t ret = 0;
+  while (stream.next())
+    ret++;
+  return ret;
+}
+
+int main() {
+  RecordingAnalyzer whiteSpace;
+  StopAnalyzer stop;
+  PerFieldAnalyzerWrapper wrapper(whiteSpace);
+  const std::string body = "body of a field with a name longer than SSO";
+  wrapper.addAnalyzer(body, &stop);
+  PerFieldAnalyzerWrapper::FieldId bodyId = wrapper.fieldId(body);
+  PerFieldAnalyzerWrapper::FieldId titleId = wrapper.fieldId("title");
+  assert(bodyId == 0 && titleId == 1);
+  assert(wrapper.fieldId(body) == bodyId);
+  assert(&wrapper.getAnalyzer(bodyId) == &stop);
+  assert(&wrapper.getAnalyzer(titleId) == &whiteSpace);
+  assert(&wrapper.getAnalyzer(std::string_view(body)) == &stop);
+  assert(&wrapper.getAnalyzer("unknown") == &whiteSpace);
+  assert(&wrapper.getAnalyzer(std::string_view()) == &whiteSpace);
+
+  // a field with an id may get its analyzer later
+  wrapper.addAnalyzer("title", &stop);
+  assert(wrapper.fieldId("title") == titleId);
+  assert(&wrapper.getAnalyzer(titleId) == &stop);
+  wrapper.addAnalyzer("title", &whiteSpace);
+
+  // the field name reaches the analyzer
+  std::istringstream input("The wrapper and the Analyzers");
+  assert(count(*wrapper.getTokenStream(input, "unknown")) == 5);
+  assert(whiteSpace.lastField == "unknown");
+  input.clear();
+  input.seekg(0);
+  assert(count(*wrapper.getTokenStream(input, titleId)) == 5);
+  assert(whiteSpace.lastField == "title");
+  input.clear();
+  input.seekg(0);
+  assert(count(*wrapper.getTokenStream(input, bodyId)) == 2);
+  input.clear();
+  input.seekg(0);
+  assert(count(wrapper.reusableTokenStream(input, "other")) == 5);
+  assert(whiteSpace.lastField == "other");
+
+  // dispatch doesn't allocate, by name or by id
+  std::string_view bodyName = body;
+  for (int i = 0; i < 2; i++) { // make every stream
+    input.clear();
+    input.seekg(0);
+    count(wrapper.reusableTokenStream(input, bodyName));
+    input.clear();
+    input.seekg(0);
+    count(wrapper.reusableTokenStream(input, titleId));
+  }
+  size_t before = allocations;
+  size_t tokens = 0;
+  for (int i = 0; i < 1000; i++) {
+    input.clear();
+    input.seekg(0);
+    tokens += count(wrapper.reusableTokenStream(input, bodyName));
+    input.clear();
+    input.seekg(0);
+    tokens += count(wrapper.reusableTokenStream(input, bodyId));
+    assert(&wrapper.getAnalyzer(bodyName) == &stop);
+  }
+  assert(allocations == before);
+  assert(tokens == 1000 * 4);
+  std::cout << "PerFieldAnalyzerWrapper test passed\n";
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "lucanthrope/analysis/PerfectHashSet.h"
+#include "lucanthrope/analysis/StopAnalyzer.h"
+
+using namespace lucanthrope;
+
+// Lookups work at compile time
+static_assert(StopAnalyzer::EnglishStopWordSet.set().contains("the"));
+static_assert(StopAnalyzer::EnglishStopWordSet.set().contains("a"));
+static_assert(!StopAnalyzer::EnglishStopWordSet.set().contains("then."));
+static_assert(!StopAnalyzer::EnglishStopWordSet.set().contains(""));
+
+static void testStatic() {
+  PerfectHashSet set = StopAnalyzer::EnglishStopWordSet.set();
+  std::unordered_set<std::string> words(
+      std::begin(StopAnalyzer::EnglishStopWords),
+      std::end(StopAnalyzer::EnglishStopWords));
+  for (auto &word : words)
+    assert(set.contains(word));
+  // every string of up to 2 letters, and some longer ones
+  std::vector<std::string> probes = {"", "theirs", "wit", "withe", "The",
+                                     "thes", "tho", "wer"};
+  for (char a = 'a'; a <= 'z'; a++) {
+    probes.emplace_back(1, a);
+    for (char b = 'a'; b <= 'z'; b++)
+      probes.push_back(std::string(1, a) + b);
+  }
+  for (auto &probe : probes)
+    assert(set.contains(probe) == (words.count(probe) != 0));
+  assert(!PerfectHashSet().contains("a"));
+}
+
+static void testDynamic() {
+  std::vector<std::string> words;
+  for (int i = 0; i < 20000; i++)
+    words.push_back("w" + std::to_string(i * 7919 % 100003));
+  words.push_back("w0"); // duplicates are ignored
+  words.push_back("");
+  DynamicPerfectHashSet dynamic(words);
+  assert(dynamic.size() == 20001);
+  PerfectHashSet set = dynamic.set();
+  for (auto &word : words)
+    assert(set.contains(word));
+  std::unordered_set<std::string> expected(words.begin(), words.end());
+  for (int i = 0; i < 100003; i += 3) {
+    std::string probe = "w" + std::to_string(i);
+    assert(set.contains(probe) == (expected.count(probe) != 0));
+    assert(!set.contains(probe + "x"));
+  }
+
+  DynamicPerfectHashSet empty(std::vector<std::string>{});
+  assert(!empty.set().contains(""));
+  DynamicPerfectHashSet one(std::vector<std::string>{"one"});
+  assert(one.set().contains("one"));
+  assert(!one.set().contains("two"));
+}
+
+int main() {
+  testStatic();
+  testDynamic();
+  std::cout << "PerfectHashSet test passed\n";
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "lucanthrope/analysis/Chain.h"
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/PorterStemFilter.h"
+
+using namespace lucanthrope;
+
+// A word, its Porter stem and its English stem, from the Snowball reference
+// implementation
+struct Stems {
+  const char *word;
+  const char *porter;
+  const char *english;
+};
+
+static const Stems kStems[] = {
+    {"caresses", "caress", "caress"},
+    {"ponies", "poni", "poni"},
+    {"ties", "ti", "tie"},
+    {"cats", "cat", "cat"},
+    {"feed", "feed", "feed"},
+    {"agreed", "agre", "agre"},
+    {"plastered", "plaster", "plaster"},
+    {"bled", "bled", "bled"},
+    {"motoring", "motor", "motor"},
+    {"sing", "sing", "sing"},
+    {"conflated", "conflat", "conflat"},
+    {"troubled", "troubl", "troubl"},
+    {"sized", "size", "size"},
+    {"hopping", "hop", "hop"},
+    {"falling", "fall", "fall"},
+    {"filing", "file", "file"},
+    {"happy", "happi", "happi"},
+    {"sky", "sky", "sky"},
+    {"relational", "relat", "relat"},
+    {"conditional", "condit", "condit"},
+    {"rational", "ration", "ration"},
+    {"digitizer", "digit", "digit"},
+    {"vietnamization", "vietnam", "vietnam"},
+    {"operator", "oper", "oper"},
+    {"hopefulness", "hope", "hope"},
+    {"sensibiliti", "sensibl", "sensibl"},
+    {"formative", "form", "format"},
+    {"electrical", "electr", "electr"},
+    {"allowance", "allow", "allow"},
+    {"adjustable", "adjust", "adjust"},
+    {"replacement", "replac", "replac"},
+    {"homologou", "homolog", "homologou"},
+    {"communism", "commun", "communism"},
+    {"effective", "effect", "effect"},
+    {"controll", "control", "control"},
+    {"generously", "gener", "generous"},
+    {"generate", "gener", "generat"},
+    {"communication", "commun", "communic"},
+    {"arsenal", "arsen", "arsenal"},
+    {"skies", "ski", "sky"},
+    {"dying", "dy", "die"},
+    {"news", "new", "news"},
+    {"innings", "in", "inning"},
+    {"proceed", "proce", "proceed"},
+    {"succeeding", "succeed", "succeed"},
+    {"earring", "ear", "earring"},
+    {"outing", "out", "outing"},
+    {"atlas", "atla", "atlas"},
+    {"gently", "gentli", "gentl"},
+    {"idly", "idli", "idl"},
+    {"consistently", "consist", "consist"},
+    {"knightly", "knightli", "knight"},
+    {"saying", "sai", "say"},
+    {"crying", "cry", "cri"},
+    {"is", "i", "is"},
+    {"a", "a", "a"},
+    {"dog's", "dog'", "dog"},
+    {"internationalizations", "internation", "internation"},
+    {"antidisestablishmentarianism", "antidisestablishmentarian",
+     "antidisestablishmentarian"},
+};
+
+template <typename Stemmer> static std::string stem(std::string word) {
+  word.resize(Stemmer::stem(word.data(), word.size()));
+  return word;
+}
+
+template <typename Stemmer>
+static std::string cachedStem(StemCache<Stemmer> &cache, std::string word) {
+  word.resize(cache.stem(word.data(), word.size()));
+  return word;
+}
+
+static void testStemmers() {
+  for (const Stems &stems : kStems) {
+    assert(stem<PorterStemmer>(stems.word) == stems.porter);
+    assert(stem<EnglishStemmer>(stems.word) == stems.english);
+  }
+  assert(stem<PorterStemmer>("") == "");
+  assert(stem<EnglishStemmer>("") == "");
+  // non-ASCII bytes are consonants
+  assert(stem<EnglishStemmer>("caf\xc3\xa9s") == "caf\xc3\xa9");
+}
+
+static void testCache() {
+  // many more words than slots, so words evict each other, long ones bypass
+  // the cache, and every word is stemmed both ways, repeatedly
+  StemCache<EnglishStemmer> cache;
+  std::vector<std::string> words;
+  for (const Stems &stems : kStems)
+    words.push_back(stems.word);
+  for (int i = 0; i < 3 * int(StemCache<EnglishStemmer>::kSlots); i++)
+    words.push_back("relat" + std::to_string(i) + "ionally");
+  for (int round = 0; round < 3; round++)
+    for (const std::string &word : words)
+      assert(cachedStem(cache, word) == stem<EnglishStemmer>(word));
+  for (const Stems &stems : kStems)
+    for (int i = 0; i < 3; i++)
+      assert(cachedStem(cache, stems.word) == stems.english);
+
+  // each Stemmer has its own cache, and each thread its own
+  assert(static_cast<void *>(&StemCache<PorterStemmer>::local()) !=
+         static_cast<void *>(&StemCache<EnglishStemmer>::local()));
+  StemCache<PorterStemmer> *other = nullptr;
+  std::thread([&other] { other = &StemCache<PorterStemmer>::local(); }).join();
+  assert(other != &StemCache<PorterStemmer>::local());
+}
+
+template <typename Stream> static std::string terms(Stream &stream) {
+  std::string ret;
+  while (stream.next())
+    ret.append(stream.getTokenView().termText()).push_back(' ');
+  return ret;
+}
+
+static void testFilters() {
+  const std::string text =
+      "The Ponies were Running; running ponies, generously GENERATED news";
+  Chain<LowerCaseTokenizer, PorterStemFilter> porter{
+      std::string_view(text), PorterStemFilter::Stage()};
+  assert(terms(porter) == "the poni were run run poni gener gener new ");
+
+  // as a TokenFilter, through the virtual interface
+  std::istringstream input(text);
+  EnglishStemFilter filter(std::make_unique<LowerCaseTokenizer>(input));
+  TokenStream &stream = filter;
+  assert(terms(stream) == "the poni were run run poni generous generat news ");
+
+  // positions are those of the surface forms
+  Chain<LowerCaseTokenizer, EnglishStemFilter> english{
+      std::string_view("skies dying"), EnglishStemFilter::Stage()};
+  std::vector<TokenView> views;
+  while (english.next())
+    views.push_back(english.getTokenView());
+  assert(views.size() == 2);
+  assert(views[1].termText() == "die");
+  assert(views[0].startPos == 0 && views[0].endPos == 5);
+  assert(views[1].startPos == 6 && views[1].endPos == 11);
+}
+
+int main() {
+  testStemmers();
+  testCache();
+  testFilters();
+  std::cout << "PorterStemFilter test passed\n";
+  return 0;
+}
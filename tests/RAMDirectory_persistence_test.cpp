@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/Directory.h"
+#include "lucanthrope/storage/FSDirectory.h"
+#include "lucanthrope/storage/LockFile.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+
+using namespace lucanthrope;
+
+// Contents of file i: byte j is (i + j * 31) % 251
+static void writeFile(Directory &dir, const std::string &name, uint64_t size,
+                      unsigned seed) {
+  std::unique_ptr<IndexOutput> out = dir.createOutput(name);
+  for (uint64_t j = 0; j < size; j++)
+    out->writeByte(static_cast<char>((seed + j * 31) % 251));
+}
+
+static void checkFile(Directory &dir, const std::string &name, uint64_t size,
+                      unsigned seed) {
+  assert(dir.fileLength(name) == size);
+  if (!size)
+    return;
+  std::unique_ptr<IndexInput> in = dir.openInput(name);
+  for (uint64_t j = 0; j < size; j++)
+    assert(in->readByte() == static_cast<char>((seed + j * 31) % 251));
+  assert(in->eof());
+}
+
+int main() {
+  const std::vector<uint64_t> sizes = {0, 1, 4095, 4096, 4097, 100000,
+                                       20 * 1024 * 1024 + 17};
+  std::filesystem::path root =
+      std::filesystem::temp_directory_path() / "lucanthrope_persistence_test";
+  std::filesystem::remove_all(root);
+  try {
+    // FSDirectory basics
+    {
+      FSDirectory fs((root / "basics").string());
+      writeFile(fs, "_0.a", 70000, 1);
+      checkFile(fs, "_0.a", 70000, 1);
+      fs.rename("_0.a", "_0.b");
+      assert(!fs.fileExists("_0.a") && fs.fileExists("_0.b"));
+      {
+        std::unique_ptr<IndexInput> in = fs.openInput("_0.b");
+        in->seek(65537);
+        assert(in->readByte() == static_cast<char>((1 + 65537 * 31) % 251));
+        in->seek(3);
+        assert(in->readByte() == static_cast<char>((1 + 3 * 31) % 251));
+      }
+      {
+        std::unique_ptr<LockFile> lock = fs.obtainLock("write.lock");
+        assert(lock && !fs.obtainLock("write.lock"));
+      }
+      assert(!fs.fileExists("write.lock"));
+      fs.deleteSegment("_0");
+      assert(fs.listAll().empty());
+    }
+
+    // RAM -> disk -> RAM
+    RAMDirectory ram;
+    for (size_t i = 0; i < sizes.size(); i++)
+      writeFile(ram, "_1.f" + std::to_string(i), sizes[i], i);
+    FSDirectory image((root / "image").string());
+    ram.persistTo(image, 4);
+    for (size_t i = 0; i < sizes.size(); i++)
+      checkFile(image, "_1.f" + std::to_string(i), sizes[i], i);
+
+    for (bool mmap : {false, true}) {
+      image.setUseMMap(mmap);
+      RAMDirectory restored;
+      restored.loadFrom(image, 4);
+      std::vector<std::string> files = restored.listAll();
+      assert(files.size() == sizes.size());
+      for (size_t i = 0; i < sizes.size(); i++)
+        checkFile(restored, "_1.f" + std::to_string(i), sizes[i], i);
+      std::cout << "restored " << files.size() << " files"
+                << (mmap ? " with mmap" : "") << ", "
+                << restored.ramBytesUsed() << " bytes in RAM\n";
+      bool thrown = false;
+      try {
+        restored.loadFrom(image);
+      } catch (Exception &e) {
+        thrown = e.code() == Exception::Code::FileAlreadyExistsException;
+      }
+      assert(thrown && restored.listAll().size() == sizes.size());
+    }
+
+    // a failed load leaves nothing behind in fallback either
+    {
+      RAMDirectory fallback;
+      RAMDirectory restored;
+      writeFile(restored, "_1.f3", 10, 3);
+      restored.setRAMBudget(1, &fallback);
+      bool thrown = false;
+      try {
+        restored.loadFrom(image, 4);
+      } catch (Exception &e) {
+        thrown = e.code() == Exception::Code::FileAlreadyExistsException;
+      }
+      assert(thrown && fallback.listAll().empty());
+      assert(restored.listAll().size() == 1);
+      checkFile(restored, "_1.f3", 10, 3);
+    }
+  } catch (std::exception &e) {
+    std::cout << e.what() << '\n';
+    std::filesystem::remove_all(root);
+    return 1;
+  }
+  std::filesystem::remove_all(root);
+  return 0;
+}
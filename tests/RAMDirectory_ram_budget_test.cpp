@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/Directory.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+
+int main() {
+  using namespace lucanthrope;
+  try {
+    RAMDirectory fallback;
+    RAMDirectory dir;
+    const uint64_t empty = dir.ramBytesUsed();
+    std::cout << "empty directory: " << empty << " bytes\n";
+
+    std::string payload(3 * 4096, 'x');
+    {
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_0.dat");
+      out->write(payload.data(), payload.size());
+    }
+    const uint64_t one_file = dir.ramBytesUsed();
+    std::cout << "after writing " << payload.size() << " bytes: " << one_file
+              << " bytes\n";
+    assert(one_file >= empty + payload.size());
+
+    // deleted file which is still open is accounted until it is closed
+    {
+      std::unique_ptr<IndexInput> in = dir.openInput("_0.dat");
+      dir.deleteFile("_0.dat");
+      assert(dir.ramBytesUsed() >= empty + payload.size());
+    }
+    assert(dir.ramBytesUsed() < empty + payload.size());
+
+    // budget without fallback: fail fast
+    dir.setRAMBudget(dir.ramBytesUsed() + 1);
+    {
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_1.dat");
+      out->write(payload.data(), payload.size());
+    }
+    bool thrown = false;
+    try {
+      dir.createOutput("_2.dat");
+    } catch (Exception &e) {
+      assert(e.code() == Exception::Code::RAMBudgetExceededException);
+      std::cout << e.what() << '\n';
+      thrown = true;
+    }
+    assert(thrown);
+
+    // budget with fallback: spill
+    dir.setRAMBudget(dir.getRAMBudget(), &fallback);
+    {
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_2.dat");
+      out->writeString("spilled");
+    }
+    assert(fallback.fileExists("_2.dat"));
+    assert(dir.fileExists("_2.dat"));
+    std::vector<std::string> files = dir.listAll();
+    std::sort(files.begin(), files.end());
+    assert(files.size() == 2 && files[0] == "_1.dat" && files[1] == "_2.dat");
+    {
+      std::unique_ptr<IndexInput> in = dir.openInput("_2.dat");
+      std::string buf;
+      in->readString(buf);
+      assert(buf == "spilled");
+    }
+    dir.rename("_2.dat", "_3.dat");
+    assert(fallback.fileExists("_3.dat"));
+    dir.deleteFile("_3.dat");
+    assert(!dir.fileExists("_3.dat") && fallback.listAll().empty());
+
+    // names are unique across both directories
+    {
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_4.dat");
+    }
+    thrown = false;
+    try {
+      dir.rename("_1.dat", "_4.dat");
+    } catch (Exception &e) {
+      assert(e.code() == Exception::Code::FileAlreadyExistsException);
+      thrown = true;
+    }
+    assert(thrown && dir.fileExists("_1.dat"));
+    dir.setRAMBudget(0, &fallback);
+    thrown = false;
+    try {
+      dir.createOutput("_4.dat");
+    } catch (Exception &e) {
+      assert(e.code() == Exception::Code::FileAlreadyExistsException);
+      thrown = true;
+    }
+    assert(thrown);
+    dir.rename("_1.dat", "_5.dat");
+    assert(dir.fileExists("_5.dat") && !fallback.fileExists("_5.dat"));
+
+    // replace() drops the old target wherever it is
+    dir.replace("_5.dat", "_4.dat");
+    assert(!dir.fileExists("_5.dat") && !fallback.fileExists("_4.dat"));
+    assert(dir.fileLength("_4.dat") == payload.size());
+    dir.setRAMBudget(1, &fallback);
+    {
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_6.dat");
+      out->writeString("spilled");
+    }
+    dir.replace("_6.dat", "_4.dat");
+    assert(!dir.fileExists("_6.dat") && fallback.fileExists("_4.dat"));
+    files = dir.listAll();
+    assert(std::count(files.begin(), files.end(), "_4.dat") == 1);
+    {
+      std::unique_ptr<IndexInput> in = dir.openInput("_4.dat");
+      std::string buf;
+      in->readString(buf);
+      assert(buf == "spilled");
+    }
+
+    // concurrent creators of one name, some over budget and some not, never
+    // make two files
+    for (int round = 0; round < 200; round++) {
+      std::string name = "_c" + std::to_string(round) + ".dat";
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; t++)
+        threads.emplace_back([&dir, &fallback, &name, t] {
+          dir.setRAMBudget(t % 2 ? 1 : 0, &fallback);
+          try {
+            dir.createOutput(name);
+          } catch (Exception &e) {
+            assert(e.code() == Exception::Code::FileAlreadyExistsException);
+          }
+        });
+      for (auto &thread : threads)
+        thread.join();
+      std::vector<std::string> all = dir.listAll();
+      assert(std::count(all.begin(), all.end(), name) == 1);
+    }
+  } catch (std::exception &e) {
+    std::cout << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/Directory.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+
+using namespace lucanthrope;
+
+static void writeFile(Directory &dir, const std::string &fname) {
+  std::unique_ptr<IndexOutput> out = dir.createOutput(fname);
+  out->write(fname.data(), fname.size());
+}
+
+static std::vector<std::string> sorted(std::vector<std::string> v) {
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+int main() {
+  try {
+    assert(Directory::segmentOf("_3.cfs") == "_3");
+    assert(Directory::segmentOf("_3_1.del") == "_3");
+    assert(Directory::segmentOf("_3") == "_3");
+    assert(Directory::segmentOf("segments.gen") == "segments");
+
+    RAMDirectory fallback;
+    RAMDirectory dir;
+    for (const char *fname :
+         {"_1.fdt", "_1.fdx", "_1_2.del", "_10.fdt", "_10.fdx", "_2.fdt"})
+      writeFile(dir, fname);
+    assert(sorted(dir.listSegment("_1")) ==
+           sorted({"_1.fdt", "_1.fdx", "_1_2.del"}));
+    assert(dir.listSegment("_10").size() == 2);
+    assert(dir.listSegment("_3").empty());
+
+    // "_1" is a prefix of "_10", but it's a different segment
+    dir.deleteSegment("_1");
+    assert(sorted(dir.listAll()) == sorted({"_10.fdt", "_10.fdx", "_2.fdt"}));
+    assert(dir.listSegment("_1").empty());
+
+    // a file which is being written is left to its writer, a file which is
+    // open for reading stays readable
+    {
+      std::unique_ptr<IndexInput> in = dir.openInput("_10.fdt");
+      std::unique_ptr<IndexOutput> out = dir.createOutput("_10.tmp");
+      dir.deleteSegment("_10");
+      assert(!dir.fileExists("_10.fdt"));
+      assert(dir.fileExists("_10.tmp"));
+      char buf[7];
+      in->read(buf, sizeof(buf));
+      assert(std::string(buf, sizeof(buf)) == "_10.fdt");
+    }
+    dir.deleteSegment("_10");
+    assert(dir.listAll() == std::vector<std::string>{"_2.fdt"});
+
+    // renaming moves a file between segments
+    dir.rename("_2.fdt", "_4.fdt");
+    assert(dir.listSegment("_2").empty());
+    assert(dir.listSegment("_4") == std::vector<std::string>{"_4.fdt"});
+    dir.deleteSegment("_4");
+    assert(dir.listAll().empty());
+
+    // spilled files are deleted too
+    dir.setRAMBudget(1, &fallback);
+    writeFile(dir, "_5.fdt");
+    assert(fallback.fileExists("_5.fdt"));
+    assert(dir.listSegment("_5") == std::vector<std::string>{"_5.fdt"});
+    dir.deleteSegment("_5");
+    assert(!fallback.fileExists("_5.fdt"));
+    dir.setRAMBudget(0);
+
+    // deleting a segment costs time proportional to its size, not to the size
+    // of the directory
+    const int kSegments = 20000;
+    for (int i = 0; i < kSegments; i++) {
+      writeFile(dir, "_" + std::to_string(i) + ".fdt");
+      writeFile(dir, "_" + std::to_string(i) + ".fdx");
+    }
+    // segment index bytes are accounted incrementally, and return to what
+    // they were when the same files are deleted and created again
+    const uint64_t used = dir.ramBytesUsed();
+    for (int i = 0; i < kSegments; i++)
+      dir.deleteFile("_" + std::to_string(i) + ".fdx");
+    assert(dir.ramBytesUsed() < used);
+    for (int i = 0; i < kSegments; i++)
+      writeFile(dir, "_" + std::to_string(i) + ".fdx");
+    assert(dir.ramBytesUsed() == used);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kSegments; i++)
+      dir.deleteSegment("_" + std::to_string(i));
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "deleted " << kSegments << " segments in " << elapsed.count()
+              << " s\n";
+    assert(dir.listAll().empty());
+    for (int i = 0; i < kSegments; i++) {
+      writeFile(dir, "_" + std::to_string(i) + ".fdt");
+      writeFile(dir, "_" + std::to_string(i) + ".fdx");
+    }
+    assert(dir.ramBytesUsed() == used);
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::cout << "RAMDirectory segments test passed\n";
+  return 0;
+}
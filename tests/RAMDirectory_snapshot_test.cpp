@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/storage/LockFile.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+
+using namespace lucanthrope;
+
+static void writeFile(Directory &dir, const std::string &fname,
+                      const std::string &contents) {
+  std::unique_ptr<IndexOutput> out = dir.createOutput(fname);
+  out->write(contents.data(), contents.size());
+}
+
+static std::string readFile(Directory &dir, const std::string &fname) {
+  std::unique_ptr<IndexInput> in = dir.openInput(fname);
+  std::string ret(dir.fileLength(fname), '\0');
+  in->read(ret.data(), ret.size());
+  return ret;
+}
+
+static std::vector<std::string> sorted(std::vector<std::string> v) {
+  std::sort(v.begin(), v.end());
+  return v;
+}
+
+int main() {
+  try {
+    std::string big(100 * 4096 + 17, 'b');
+    std::unique_ptr<RAMDirectory> dir(new RAMDirectory());
+    writeFile(*dir, "_0.a", "zero");
+    writeFile(*dir, "_0.b", big);
+    const uint64_t used = dir->ramBytesUsed();
+
+    // files which are being written, and locks are not part of a snapshot
+    std::unique_ptr<IndexOutput> pending = dir->createOutput("_1.a");
+    std::unique_ptr<LockFile> lock = dir->obtainLock("write.lock");
+    std::unique_ptr<RAMDirectory> snap = dir->snapshot();
+    pending->write("one", 3);
+    pending.reset();
+    lock.reset();
+    assert(sorted(snap->listAll()) == sorted({"_0.a", "_0.b"}));
+    assert(sorted(dir->listAll()) == sorted({"_0.a", "_0.b", "_1.a"}));
+    assert(readFile(*snap, "_0.b") == big);
+    // shared files are counted by both directories
+    assert(snap->ramBytesUsed() >= big.size());
+
+    // writes, deletes and renames are private to each directory
+    writeFile(*snap, "_2.a", "two");
+    assert(!dir->fileExists("_2.a"));
+    dir->deleteFile("_0.a");
+    assert(readFile(*snap, "_0.a") == "zero");
+    snap->rename("_0.b", "_3.b");
+    assert(dir->fileExists("_0.b") && !dir->fileExists("_3.b"));
+    assert(readFile(*dir, "_0.b") == big);
+
+    // a snapshot of a snapshot, and readers outliving their directories
+    std::unique_ptr<RAMDirectory> snap2 = snap->snapshot();
+    std::unique_ptr<IndexInput> in = dir->openInput("_0.b");
+    dir.reset();
+    snap.reset();
+    assert(readFile(*snap2, "_3.b") == big);
+    std::string buf(big.size(), '\0');
+    in->read(buf.data(), buf.size());
+    assert(buf == big);
+    in.reset();
+    assert(sorted(snap2->listAll()) == sorted({"_0.a", "_2.a", "_3.b"}));
+    assert(snap2->ramBytesUsed() >= big.size());
+    std::cout << "original: " << used << " bytes, snapshot of snapshot: "
+              << snap2->ramBytesUsed() << " bytes\n";
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::cout << "RAMDirectory snapshot test passed\n";
+  return 0;
+}
@@ -0,0 +1,237 @@
+#include <cassert>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/IO/IndexInput.h"
+#include "lucanthrope/IO/IndexOutput.h"
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/FSDirectory.h"
+#include "lucanthrope/storage/LockFile.h"
+#include "lucanthrope/storage/RAMDirectory.h"
+#include "lucanthrope/storage/ReplicationTransport.h"
+#include "lucanthrope/storage/Replicator.h"
+
+using namespace lucanthrope;
+
+static void writeFile(Directory &dir, const std::string &fname, size_t size,
+                      bool footer, int seed = 0) {
+  if (dir.fileExists(fname))
+    dir.deleteFile(fname);
+  std::unique_ptr<IndexOutput> out = dir.createOutput(fname);
+  out->enableChecksum();
+  for (size_t i = 0; i < size; i++)
+    out->writeByte(static_cast<char>(i * 13 + fname.size() + seed));
+  if (footer)
+    out->writeChecksumFooter();
+}
+
+static std::string contentsOf(Directory &dir, const std::string &fname) {
+  std::string ret(dir.fileLength(fname), '\0');
+  if (!ret.empty())
+    dir.openInput(fname)->read(&ret[0], ret.size());
+  return ret;
+}
+
+static void assertSame(Directory &primary, Directory &replica) {
+  std::vector<std::string> fnames = replica.listAll();
+  for (auto &fname : fnames) {
+    assert(fname.find(Replicator::kTempSuffix) == std::string::npos);
+    assert(contentsOf(primary, fname) == contentsOf(replica, fname));
+  }
+  for (auto &fname : primary.listAll())
+    assert(fname == "write.lock" || replica.fileExists(fname));
+}
+
+// Reports wrong checksums, as if the primary's file changed in flight.
+class LyingTransport : public DirectoryTransport {
+public:
+  using DirectoryTransport::DirectoryTransport;
+
+  virtual std::vector<FileInfo> listFiles() override {
+    std::vector<FileInfo> ret = DirectoryTransport::listFiles();
+    for (auto &info : ret)
+      info.checksum ^= 1;
+    return ret;
+  }
+};
+
+// Fails to open files for reading while fail is set, as if the disk did,
+// and runs out of memory while crash is set.
+class FailingDirectory : public RAMDirectory {
+public:
+  bool fail = false;
+  bool crash = false;
+
+  virtual std::unique_ptr<IndexInput>
+  openInput(const std::string &fname,
+            const IOContext &context = IOContext()) override {
+    if (crash)
+      throw std::bad_alloc();
+    if (fail)
+      throw Exception(Exception::Code::IOErrorException,
+                      std::string("In FailingDirectory::openInput(): ")
+                          .append(fname));
+    return RAMDirectory::openInput(fname, context);
+  }
+};
+
+static void testReplicate(Directory &primary, Directory &replica,
+                          ReplicationTransport &transport) {
+  std::unique_ptr<LockFile> lock = primary.obtainLock("write.lock");
+  writeFile(primary, "_0.a", 1000, true);
+  writeFile(primary, "_0.b", 3 * 1024 * 1024 + 7, false);
+  writeFile(primary, "_0.empty", 0, false);
+  writeFile(primary, "segments_1", 100, true);
+
+  // chunks much smaller than files
+  Replicator replicator(transport, replica, 3, 256 * 1024);
+  Replicator::Stats stats = replicator.replicate("segments_1");
+  assert(stats.filesCopied == 4);
+  assert(stats.filesUpToDate == 0);
+  assert(stats.bytesCopied == 1016 + 3 * 1024 * 1024 + 7 + 116);
+  assert(!replica.fileExists("write.lock"));
+  assertSame(primary, replica);
+
+  stats = replicator.replicate("segments_1");
+  assert(stats.filesCopied == 0);
+  assert(stats.filesUpToDate == 4);
+
+  // a new commit: one file gone, one new, the commit file rewritten
+  primary.deleteFile("_0.a");
+  writeFile(primary, "_1.a", 5000, true);
+  writeFile(primary, "segments_1", 100, true, 1);
+  stats = replicator.replicate("segments_1");
+  assert(stats.filesCopied == 2);
+  assert(stats.filesUpToDate == 2);
+  assert(stats.filesDeleted == 1);
+  assert(!replica.fileExists("_0.a"));
+  assertSame(primary, replica);
+}
+
+int main() {
+  namespace fs = std::filesystem;
+  fs::path root = fs::temp_directory_path() / "lucanthrope_replicator_test";
+  fs::remove_all(root);
+  try {
+    {
+      RAMDirectory primary, replica;
+      DirectoryTransport transport(primary);
+      testReplicate(primary, replica, transport);
+    }
+    {
+      FSDirectory primary((root / "primary").string());
+      FSDirectory replica((root / "replica").string());
+      LocalSocketTransport transport(primary, 3);
+      testReplicate(primary, replica, transport);
+
+      // the primary's errors come through the socket with their codes
+      char buf[16];
+      bool thrown = false;
+      try {
+        transport.readChunk("none", 0, sizeof(buf), buf);
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::FileNotFoundException);
+        thrown = true;
+      }
+      assert(thrown);
+      thrown = false;
+      try {
+        transport.readChunk("_1.a", 5010, sizeof(buf), buf);
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::IndexCorruptionException);
+        thrown = true;
+      }
+      assert(thrown);
+      transport.readChunk("_1.a", 0, sizeof(buf), buf);
+    }
+    {
+      // a connection which breaks is replaced, not reused
+      FailingDirectory primary;
+      writeFile(primary, "_0.a", 1000, true);
+      LocalSocketTransport transport(primary, 1);
+      char buf[16];
+      primary.crash = true;
+      for (int i = 0; i < 2; i++) {
+        bool thrown = false;
+        try {
+          transport.readChunk("_0.a", 0, sizeof(buf), buf);
+        } catch (Exception &e) {
+          assert(e.code() == Exception::Code::IOErrorException);
+          thrown = true;
+        }
+        assert(thrown);
+      }
+      primary.crash = false;
+      transport.readChunk("_0.a", 0, sizeof(buf), buf);
+      assert(buf[1] == static_cast<char>(13 + 4));
+      assert(transport.listFiles().size() == 1);
+    }
+    {
+      // a copy which doesn't match its checksum is not installed
+      RAMDirectory primary, replica;
+      writeFile(primary, "_0.a", 1000, true);
+      writeFile(replica, "_0.a", 10, false);
+      LyingTransport transport(primary);
+      Replicator replicator(transport, replica, 2);
+      bool thrown = false;
+      try {
+        replicator.replicate();
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::IndexCorruptionException);
+        thrown = true;
+      }
+      assert(thrown);
+      assert(replica.listAll().size() == 1);
+      assert(replica.fileLength("_0.a") == 10);
+    }
+    {
+      // a file which the primary is rewriting is kept on the replica, and a
+      // file which the primary fails to read is not taken for a deleted one
+      FailingDirectory primary;
+      RAMDirectory replica;
+      writeFile(primary, "_0.a", 1000, true);
+      writeFile(primary, "_0.b", 10, false);
+      DirectoryTransport transport(primary);
+      Replicator replicator(transport, replica, 2);
+      assert(replicator.replicate().filesCopied == 2);
+      primary.deleteFile("_0.a");
+      {
+        std::unique_ptr<IndexOutput> out = primary.createOutput("_0.a");
+        Replicator::Stats stats = replicator.replicate();
+        assert(stats.filesCopied == 0 && stats.filesDeleted == 0);
+        assert(replica.fileLength("_0.a") == 1016);
+        out->writeByte(1);
+      }
+      Replicator::Stats stats = replicator.replicate();
+      assert(stats.filesCopied == 1 && stats.filesUpToDate == 1);
+      assert(replica.fileLength("_0.a") == 1);
+
+      primary.fail = true;
+      bool thrown = false;
+      try {
+        replicator.replicate();
+      } catch (Exception &e) {
+        assert(e.code() == Exception::Code::IOErrorException);
+        thrown = true;
+      }
+      assert(thrown);
+      assert(replica.fileExists("_0.a") && replica.fileExists("_0.b"));
+      primary.fail = false;
+      primary.deleteFile("_0.b");
+      assert(replicator.replicate().filesDeleted == 1);
+      assert(!replica.fileExists("_0.b"));
+    }
+  } catch (std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    fs::remove_all(root);
+    return 1;
+  }
+  fs::remove_all(root);
+  std::cout << "Replicator test passed\n";
+  return 0;
+}
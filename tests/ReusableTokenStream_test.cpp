@@ -0,0 +1,364 @@
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "lucanthrope/analysis/Analysis.h"
+#include "lucanthrope/analysis/PerFieldAnalyzerWrapper.h"
+#include "lucanthrope/analysis/SimpleAnalyzer.h"
+#include "lucanthrope/analysis/StopAnalyzer.h"
+#include "lucanthrope/analysis/WhiteSpaceAnalyzer.h"
+
+static size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+  allocations++;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace lucanthrope;
+
+static const char *const texts[] = {
+    "The quick brown fox jumps over the lazy dog",
+    "",
+    "  an Index of THE tokens, and the streams\n",
+    "x",
+    "Reusing a stream must not leak state from a longer previous field into "
+    "this one"};
+
+static std::vector<Token> collect(TokenStream &stream) {
+  std::vector<Token> ret;
+  while (stream.next())
+    ret.push_back(stream.getToken());
+  return ret;
+}
+
+static bool sameTokens(const std::vector<Token> &a,
+                       const std::vector<Token> &b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].termText != b[i].termText || a[i].startPos != b[i].startPos ||
+        a[i].endPos != b[i].endPos)
+      return false;
+  return true;
+}
+
+// reusableTokenStream() gives the tokens of getTokenStream(), from one stream
+static void testSameTokens(Analyzer &analyzer) {
+  TokenStream *first = nullptr;
+  for (int round = 0; round < 2; round++) {
+    for (const char *text : texts) {
+      std::istringstream fresh(text), reused(text);
+      std::vector<Token> expected = collect(*analyzer.getTokenStream(fresh));
+      TokenStream &stream = analyzer.reusableTokenStream(reused);
+      if (!first)
+        first = &stream;
+      assert(&stream == first);
+      assert(sameTokens(collect(stream), expected));
+      // and of text in memory
+      assert(&analyzer.reusableTokenStream(std::string_view(text)) == first);
+      assert(sameTokens(collect(*first), expected));
+    }
+  }
+}
+
+// A tokenizer which only reads istreams: words between spaces, without
+// offsets
+class IStreamTokenizer : public Tokenizer {
+private:
+  std::string word;
+
+public:
+  IStreamTokenizer(std::istream &input) : Tokenizer(input) {}
+
+  virtual bool next() override {
+    if (!(*input_ >> word))
+      return false;
+    view.term = &word[0];
+    view.termLength = word.size();
+    return true;
+  }
+};
+
+class IStreamAnalyzer : public Analyzer {
+  virtual std::unique_ptr<TokenStream>
+  getTokenStream(std::istream &input,
+                 [[maybe_unused]] std::string_view fieldName =
+                     std::string_view()) override {
+    return std::unique_ptr<TokenStream>(new IStreamTokenizer(input));
+  }
+};
+
+// Lower-cases the "body" field only
+class FieldAwareAnalyzer : public Analyzer {
+public:
+  virtual std::unique_ptr<TokenStream>
+  getTokenStream(std::istream &input, std::string_view fieldName) override {
+    if (fieldName == "body")
+      return std::unique_ptr<TokenStream>(new LowerCaseTokenizer(input));
+    return std::unique_ptr<TokenStream>(new WhiteSpaceTokenizer<>(input));
+  }
+};
+
+// Each field gets the stream its analyzer builds for it, unless the analyzer
+// builds the same one for all fields
+static void testFields() {
+  FieldAwareAnalyzer analyzer;
+  const std::string_view fields[] = {
+      "body", "id", "a field name too long to be stored inline"};
+  for (int round = 0; round < 2; round++) {
+    for (std::string_view field : fields) {
+      for (const char *text : texts) {
+        std::istringstream fresh(text), reused(text);
+        std::vector<Token> expected =
+            collect(*analyzer.getTokenStream(fresh, field));
+        assert(sameTokens(collect(analyzer.reusableTokenStream(reused, field)),
+                          expected));
+        assert(sameTokens(
+            collect(analyzer.reusableTokenStream(std::string_view(text), field)),
+            expected));
+      }
+    }
+  }
+  std::istringstream input(texts[0]);
+  TokenStream &body = analyzer.reusableTokenStream(input, "body");
+  TokenStream &id = analyzer.reusableTokenStream(texts[0], "id");
+  TokenStream &bodyAgain = analyzer.reusableTokenStream(texts[0], "body");
+  assert(&id != &body && &bodyAgain == &body);
+  std::vector<Token> bodyTokens =
+      collect(analyzer.reusableTokenStream("Hello World", "body"));
+  std::vector<Token> idTokens =
+      collect(analyzer.reusableTokenStream("Hello World", "id"));
+  assert(bodyTokens.size() == 2 && bodyTokens[1].termText == "world");
+  assert(idTokens.size() == 2 && idTokens[1].termText == "World");
+
+  StopAnalyzer stop;
+  TokenStream &any = stop.reusableTokenStream(texts[0], "body");
+  TokenStream &other = stop.reusableTokenStream(texts[0], "id");
+  assert(&other == &any);
+}
+
+// Every thread gets its own stream
+static void testThreads(Analyzer &analyzer) {
+  std::istringstream input(texts[0]);
+  TokenStream *mine = &analyzer.reusableTokenStream(input);
+  TokenStream *theirs[2] = {nullptr, nullptr};
+  // both threads are alive until both are done, since the streams of a
+  // thread go when it exits
+  std::atomic<int> done(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; t++)
+    threads.emplace_back([&analyzer, &theirs, &done, t] {
+      for (int i = 0; i < 100; i++) {
+        std::istringstream input(texts[i % 5]);
+        TokenStream &stream = analyzer.reusableTokenStream(input);
+        assert(!theirs[t] || theirs[t] == &stream);
+        theirs[t] = &stream;
+        std::istringstream fresh(texts[i % 5]);
+        assert(sameTokens(collect(stream),
+                          collect(*analyzer.getTokenStream(fresh))));
+      }
+      done++;
+      while (done != 2)
+        std::this_thread::yield();
+    });
+  for (auto &thread : threads)
+    thread.join();
+  assert(theirs[0] && theirs[1] && theirs[0] != theirs[1]);
+  assert(theirs[0] != mine && theirs[1] != mine);
+  std::istringstream again(texts[2]);
+  assert(&analyzer.reusableTokenStream(again) == mine);
+}
+
+// Fields are analyzed by their analyzers' streams
+static void testPerField() {
+  WhiteSpaceAnalyzer whiteSpace;
+  StopAnalyzer stop;
+  PerFieldAnalyzerWrapper wrapper(whiteSpace);
+  wrapper.addAnalyzer("body", &stop);
+  std::istringstream a(texts[2]), b(texts[2]), c(texts[2]);
+  TokenStream &bodyStream = wrapper.reusableTokenStream(a, "body");
+  assert(&bodyStream == &stop.reusableTokenStream(b));
+  assert(collect(bodyStream).size() == 3); // index tokens streams
+  TokenStream &titleStream = wrapper.reusableTokenStream(a, "title");
+  assert(&titleStream == &whiteSpace.reusableTokenStream(c));
+  a.clear();
+  a.seekg(0);
+  assert(collect(wrapper.reusableTokenStream(a, "title")).size() == 8);
+}
+
+// Counts the streams alive
+class CountedTokenizer : public IStreamTokenizer {
+public:
+  static std::atomic<int> live;
+
+  CountedTokenizer(std::istream &input) : IStreamTokenizer(input) { live++; }
+  virtual ~CountedTokenizer() { live--; }
+};
+
+std::atomic<int> CountedTokenizer::live(0);
+
+class CountedAnalyzer : public Analyzer {
+public:
+  virtual std::unique_ptr<TokenStream>
+  getTokenStream(std::istream &input,
+                 [[maybe_unused]] std::string_view fieldName =
+                     std::string_view()) override {
+    return std::unique_ptr<TokenStream>(new CountedTokenizer(input));
+  }
+};
+
+// Streams are destroyed when their thread exits or releases them, or with
+// their analyzer, so threads which come and go don't pile them up
+static void testRelease() {
+  {
+    CountedAnalyzer analyzer;
+    analyzer.reusableTokenStream(texts[0]);
+    for (int round = 0; round < 10; round++) {
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; t++)
+        threads.emplace_back([&analyzer] {
+          analyzer.reusableTokenStream(texts[0], "a");
+          analyzer.reusableTokenStream(texts[0], "b");
+        });
+      for (auto &thread : threads)
+        thread.join();
+      assert(CountedTokenizer::live == 1);
+    }
+
+    // a released stream is made again when it's needed again
+    analyzer.releaseThreadStreams();
+    assert(CountedTokenizer::live == 0);
+    TokenStream &stream = analyzer.reusableTokenStream(texts[2]);
+    assert(CountedTokenizer::live == 1);
+    assert(collect(stream).size() == 8);
+    analyzer.releaseThreadStreams();
+    analyzer.releaseThreadStreams();
+    assert(CountedTokenizer::live == 0);
+
+    // a wrapper releases the streams of its analyzers
+    CountedAnalyzer body;
+    PerFieldAnalyzerWrapper wrapper(analyzer);
+    wrapper.addAnalyzer("body", &body);
+    wrapper.reusableTokenStream(texts[0], "body");
+    wrapper.reusableTokenStream(texts[0], "title");
+    assert(CountedTokenizer::live == 2);
+    wrapper.releaseThreadStreams();
+    assert(CountedTokenizer::live == 0);
+  }
+
+  // a thread may outlive the analyzers it used
+  std::atomic<int> step(0);
+  std::thread thread;
+  {
+    CountedAnalyzer analyzer;
+    thread = std::thread([&analyzer, &step] {
+      analyzer.reusableTokenStream(texts[0]);
+      step = 1;
+      while (step != 2)
+        std::this_thread::yield();
+    });
+    while (step != 1)
+      std::this_thread::yield();
+    assert(CountedTokenizer::live == 1);
+  }
+  assert(CountedTokenizer::live == 0);
+  step = 2;
+  thread.join();
+  assert(CountedTokenizer::live == 0);
+}
+
+// Once every thread's stream is made, analyzing a field doesn't allocate
+static void testNoAllocations() {
+  StopAnalyzer analyzer;
+  std::istringstream input;
+  std::string text = texts[4];
+  input.str(text);
+  std::istringstream fresh(text);
+  size_t expected = collect(*analyzer.getTokenStream(fresh)).size();
+  for (int i = 0; i < 2; i++) { // warm up
+    TokenStream &stream = analyzer.reusableTokenStream(input);
+    while (stream.next())
+      ;
+    input.clear();
+    input.seekg(0);
+  }
+  size_t before = allocations;
+  size_t tokens = 0;
+  for (int i = 0; i < 1000; i++) {
+    TokenStream &stream = analyzer.reusableTokenStream(input);
+    while (stream.next())
+      tokens += stream.getTokenView().termLength != 0;
+    input.clear();
+    input.seekg(0);
+  }
+  assert(allocations == before);
+  assert(tokens == 1000 * expected);
+
+  // nor does analyzing text in memory, which needs no istream
+  analyzer.reusableTokenStream(text);
+  before = allocations;
+  tokens = 0;
+  for (int i = 0; i < 1000; i++) {
+    TokenStream &stream = analyzer.reusableTokenStream(text);
+    while (stream.next())
+      tokens++;
+  }
+  assert(allocations == before);
+  assert(tokens == 1000 * expected);
+}
+
+int main() {
+  {
+    StopAnalyzer analyzer;
+    testSameTokens(analyzer);
+    testThreads(analyzer);
+  }
+  {
+    SimpleAnalyzer analyzer;
+    testSameTokens(analyzer);
+    testThreads(analyzer);
+  }
+  {
+    WhiteSpaceAnalyzer analyzer;
+    testSameTokens(analyzer);
+    testThreads(analyzer);
+  }
+  {
+    // text in memory goes through an istream of the stream's own
+    IStreamAnalyzer analyzer;
+    testSameTokens(analyzer);
+    testThreads(analyzer);
+  }
+  {
+    // a new analyzer doesn't get the streams of a destroyed one
+    StopAnalyzer first;
+    std::istringstream input(texts[0]);
+    first.reusableTokenStream(input);
+    SimpleAnalyzer second;
+    input.clear();
+    input.seekg(0);
+    assert(collect(second.reusableTokenStream(input)).size() == 9);
+  }
+  testFields();
+  testPerField();
+  testRelease();
+  testNoAllocations();
+  std::cout << "ReusableTokenStream test passed\n";
+  return 0;
+}
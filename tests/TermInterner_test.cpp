@@ -0,0 +1,78 @@
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lucanthrope/analysis/Chain.h"
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/TermInterner.h"
+
+using namespace lucanthrope;
+
+static void testIds() {
+  TermInterner terms;
+  assert(terms.size() == 0);
+  assert(terms.find("a") == TermInterner::kNoTerm);
+  // ids are dense and stable across many rehashes; the empty term and terms
+  // with the same bytes in another order are terms like any other
+  std::unordered_map<std::string, TermInterner::TermId> expected;
+  for (int i = 0; i < 100000; i++) {
+    std::string term = "t" + std::to_string(i * 7919 % 50021);
+    if (i % 1000 == 0)
+      term = std::string(i / 1000, 'x'); // long ones too, and ""
+    auto it = expected.emplace(term, expected.size()).first;
+    assert(terms.intern(term) == it->second);
+  }
+  assert(terms.size() == expected.size());
+  for (auto &[term, id] : expected) {
+    assert(terms.find(term) == id);
+    assert(terms.term(id) == term);
+  }
+  assert(terms.find("t") == TermInterner::kNoTerm);
+  assert(terms.find("t1x") == TermInterner::kNoTerm);
+  // interning doesn't count occurrences
+  assert(terms.documentTerms().empty());
+  assert(terms.frequency(0) == 0 && terms.documentFrequency(0) == 0);
+}
+
+static void testFrequencies() {
+  TermInterner terms(4);
+  std::istringstream first("the cat and the hat and the bat");
+  Chain<LowerCaseTokenizer> chain(first);
+  assert(terms.addAll(chain) == 8);
+  std::vector<std::string> seen;
+  for (TermInterner::TermId id : terms.documentTerms())
+    seen.emplace_back(terms.term(id));
+  assert((seen == std::vector<std::string>{"the", "cat", "and", "hat", "bat"}));
+  assert(terms.frequency(terms.find("the")) == 3);
+  assert(terms.frequency(terms.find("and")) == 2);
+  assert(terms.frequency(terms.find("bat")) == 1);
+  terms.endDocument();
+  assert(terms.documentTerms().empty());
+  assert(terms.frequency(terms.find("the")) == 0);
+
+  // a TokenStream, through the virtual interface
+  std::istringstream second("The Dog and THE dog");
+  LowerCaseTokenizer tokenizer(second);
+  TokenStream &stream = tokenizer;
+  assert(terms.addAll(stream) == 5);
+  assert(terms.size() == 6);
+  assert(terms.documentTerms().size() == 3);
+  assert(terms.frequency(terms.find("dog")) == 2);
+  assert(terms.frequency(terms.find("cat")) == 0);
+  assert(terms.documentFrequency(terms.find("the")) == 2);
+  assert(terms.documentFrequency(terms.find("cat")) == 1);
+  assert(terms.documentFrequency(terms.find("dog")) == 1);
+  terms.endDocument();
+  terms.endDocument(); // of an empty document
+  assert(terms.documentFrequency(terms.find("the")) == 2);
+}
+
+int main() {
+  testIds();
+  testFrequencies();
+  std::cout << "TermInterner test passed\n";
+  return 0;
+}
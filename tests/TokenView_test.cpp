@@ -0,0 +1,118 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lucanthrope/analysis/Analysis.h"
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/LowerCaseFilter.h"
+#include "lucanthrope/analysis/StopAnalyzer.h"
+
+static size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+  allocations++;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace lucanthrope;
+
+static std::string makeText(size_t words) {
+  static const char *const vocabulary[] = {"The", "Index", "of",
+                                           "a",   "Token", "StreaMing",
+                                           "is",  "THE",   "longestwordhere"};
+  std::string text;
+  for (size_t i = 0; i < words; i++)
+    text.append(vocabulary[(i * 7 + i / 3) % 9]).append(i % 5 ? " " : ".\n");
+  return text;
+}
+
+// Filters rewrite the tokenizer's buffer in place, and getToken() still
+// returns owning copies.
+static void testInPlace() {
+  std::string text = "Hello, Token VIEW";
+  std::unique_ptr<TokenStream> tokenizer(
+      new WhiteSpaceTokenizer<>(std::string_view(text)));
+  TokenStream *source = tokenizer.get();
+  LowerCaseFilter filter(std::move(tokenizer));
+  std::vector<std::string> terms;
+  while (filter.next()) {
+    const TokenView &view = filter.getTokenView();
+    assert(view.term == source->getTokenView().term);
+    terms.emplace_back(view.termText());
+    const Token &tok = filter.getToken();
+    assert(tok.termText == view.termText());
+    assert(text.substr(tok.startPos, tok.endPos - tok.startPos).size() ==
+           view.termLength);
+  }
+  assert((terms == std::vector<std::string>{"hello,", "token", "view"}));
+  assert(text == "Hello, Token VIEW");
+}
+
+// One token, far into a large text, e.g. of a chunk of analyzeText()
+class FarStream : public TokenStream {
+private:
+  std::string term = "far";
+  bool done = false;
+
+public:
+  virtual bool next() override {
+    if (done)
+      return false;
+    done = true;
+    view.term = &term[0];
+    view.termLength = term.size();
+    view.startPos = (uint64_t(1) << 32) + 5;
+    view.endPos = view.startPos + term.size();
+    return true;
+  }
+  virtual void reset(std::istream &) override { done = false; }
+};
+
+// getToken() keeps offsets past 2^31
+static void testLargeOffsets() {
+  FarStream stream;
+  assert(stream.next());
+  const Token &tok = stream.getToken();
+  assert(tok.startPos == (uint64_t(1) << 32) + 5);
+  assert(tok.endPos == (uint64_t(1) << 32) + 8);
+  assert(tok.toString() == "[type: <no type>, text: far, start: 4294967301, "
+                           "end: 4294967304]");
+}
+
+// Once buffers have grown, analysis allocates nothing per token.
+static void testNoAllocations() {
+  std::string text = makeText(200000);
+  std::istringstream input(text);
+  StopAnalyzer analyzer;
+  std::unique_ptr<TokenStream> stream = analyzer.getTokenStream(input);
+  size_t tokens = 0;
+  for (; tokens < 1000; tokens++)
+    assert(stream->next());
+  size_t before = allocations;
+  while (stream->next())
+    tokens++;
+  assert(allocations == before);
+  std::cout << tokens << " tokens after warm-up, "
+            << allocations - before << " allocations\n";
+}
+
+int main() {
+  testInPlace();
+  testLargeOffsets();
+  testNoAllocations();
+  std::cout << "TokenView test passed\n";
+  return 0;
+}
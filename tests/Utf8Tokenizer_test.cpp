@@ -0,0 +1,234 @@
+#include "lucanthrope/analysis/Utf8Tokenizer.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lucanthrope/analysis/Chain.h"
+#include "lucanthrope/analysis/CharTokenizer.h"
+#include "lucanthrope/analysis/Utf8.h"
+#include "lucanthrope/analysis/Utf8LowerCaseFilter.h"
+
+using namespace lucanthrope;
+
+static std::string encoded(char32_t cp) {
+  char buf[4];
+  return std::string(buf, utf8::encode(cp, buf));
+}
+
+// Tokenizes text one code point at a time, lower casing terms if lower.
+static std::vector<Token> expectedTokens(std::string_view text, bool lower) {
+  std::vector<Token> ret;
+  std::string term;
+  size_t start = 0;
+  const char *p = text.data();
+  const char *end = p + text.size();
+  while (true) {
+    char32_t cp = 0;
+    size_t n = p == end ? 0 : utf8::decode(p, end, cp);
+    if (n && unicode::isTokenChar(cp)) {
+      if (term.empty())
+        start = p - text.data();
+      term += encoded(lower ? unicode::toLower(cp) : cp);
+    } else if (!term.empty()) {
+      ret.emplace_back(term, start, p - text.data());
+      term.clear();
+    }
+    if (!n)
+      return ret;
+    p += n;
+  }
+}
+
+static void assertTokens(Tokenizer &tokenizer,
+                         const std::vector<Token> &expected) {
+  size_t i = 0;
+  while (tokenizer.next()) {
+    const Token &tok = tokenizer.getToken();
+    assert(i < expected.size());
+    assert(tok.termText == expected[i].termText);
+    assert(tok.startPos == expected[i].startPos);
+    assert(tok.endPos == expected[i].endPos);
+    i++;
+  }
+  assert(i == expected.size());
+  assert(!tokenizer.next());
+}
+
+static void testCodec() {
+  for (char32_t cp = 0; cp <= 0x10ffff; cp++) {
+    if (cp >= 0xd800 && cp <= 0xdfff)
+      continue;
+    std::string bytes = encoded(cp);
+    assert(bytes.size() == utf8::encodedLength(cp));
+    char32_t decoded;
+    assert(utf8::decode(bytes.data(), bytes.data() + bytes.size(), decoded) ==
+           bytes.size());
+    assert(decoded == cp);
+    assert(utf8::completeEnd(bytes.data(), bytes.data() + bytes.size()) ==
+           bytes.data() + bytes.size());
+    if (bytes.size() > 1) // cut short
+      assert(utf8::completeEnd(bytes.data(), bytes.data() + bytes.size() - 1) ==
+             bytes.data());
+  }
+  // stray continuation, overlong, surrogate, beyond U+10FFFF, cut short
+  for (std::string_view invalid :
+       {"\x80", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+        "\xe2\x82", "\xff"}) {
+    char32_t cp;
+    assert(utf8::decode(invalid.data(), invalid.data() + invalid.size(), cp) ==
+           1);
+    assert(cp == utf8::kReplacement);
+  }
+
+  std::string bytes;
+  for (int i = 0; i < 200; i++)
+    bytes.push_back(static_cast<char>(i * 97 % 256 & (i % 3 ? 0xff : 0x7f)));
+  for (size_t from = 0; from + 64 <= bytes.size(); from++) {
+    uint64_t expected = 0;
+    for (size_t i = 0; i < 64; i++)
+      expected |= static_cast<uint64_t>(bytes[from + i] < 0) << i;
+    assert(utf8::nonAsciiMask64(bytes.data() + from) == expected);
+  }
+}
+
+static void testProperties() {
+  for (char32_t cp = 0; cp < 128; cp++) {
+    assert(unicode::isTokenChar(cp) ==
+           isalpha_predicate::contains(static_cast<char>(cp)));
+    assert(unicode::toLower(cp) ==
+           static_cast<char32_t>(tolower_normalizer()(static_cast<char>(cp))));
+  }
+  assert(unicode::isTokenChar(U'é') && unicode::isTokenChar(U'ß'));
+  assert(unicode::isTokenChar(U'Ж') && unicode::isTokenChar(U'中'));
+  assert(unicode::isTokenChar(0x0301)); // combining acute accent
+  assert(unicode::isTokenChar(0x093f)); // Devanagari vowel sign i
+  assert(!unicode::isTokenChar(0x00a0) && !unicode::isTokenChar(0x3000));
+  assert(!unicode::isTokenChar(U'€') && !unicode::isTokenChar(0x0661));
+  assert(!unicode::isTokenChar(utf8::kReplacement));
+  assert(!unicode::isTokenChar(0x10ffff));
+  assert(unicode::toLower(U'Ä') == U'ä' && unicode::toLower(U'ä') == U'ä');
+  assert(unicode::toLower(U'Σ') == U'σ' && unicode::toLower(U'Ж') == U'ж');
+  assert(unicode::toLower(0x0130) == U'i');
+  assert(unicode::toLower(0x023a) == 0x2c65); // gets longer in UTF-8
+  assert(unicode::toLower(0x1e9e) == U'ß');   // gets shorter
+  assert(unicode::toLower(U'中') == U'中');
+}
+
+static void testTokenize() {
+  std::string_view text = "Größe: Ünïcödé naïve 東京タワー,Привет мир—"
+                          "हिन्दी x\xff\x80y "
+                          "ȺȾ café";
+  Utf8Tokenizer<> tokenizer(text);
+  std::vector<std::string> terms;
+  while (tokenizer.next())
+    terms.emplace_back(tokenizer.getTokenView().termText());
+  std::vector<std::string> expected = {
+      "Größe", "Ünïcödé", "naïve", "東京タワー", "Привет", "мир",
+      "हिन्दी", "x",       "y",     "ȺȾ",         "café"};
+  assert(terms == expected);
+
+  Utf8LowerCaseTokenizer lower(text);
+  terms.clear();
+  while (lower.next())
+    terms.emplace_back(lower.getTokenView().termText());
+  expected = {"größe", "ünïcödé", "naïve", "東京タワー", "привет", "мир",
+              "हिन्दी", "x",       "y",     "ⱥⱦ",         "café"};
+  assert(terms == expected);
+
+  Utf8Tokenizer<> offsets(text);
+  assertTokens(offsets, expectedTokens(text, false));
+
+  // on ASCII text, the same as LowerCaseTokenizer
+  std::string ascii;
+  for (int i = 0; i < 5000; i++)
+    ascii += static_cast<char>(i * 31 % 127 + 1);
+  std::vector<Token> asciiTokens;
+  LowerCaseTokenizer reference{std::string_view(ascii)};
+  while (reference.next())
+    asciiTokens.push_back(reference.getToken());
+  Utf8LowerCaseTokenizer utf8Tokenizer{std::string_view(ascii)};
+  assertTokens(utf8Tokenizer, asciiTokens);
+}
+
+// Sequences cut by chunks, and tokens which span chunks, come out the same
+// from an istream and from memory.
+static void testChunkBoundaries() {
+  constexpr size_t chunk = Utf8Tokenizer<>::kChunkSize;
+  static const char *const words[] = {"Ελληνικά", "𝒜lpha", "straße", "ÉTÉ",
+                                      "中文",     "ok",     "Ⱥx",     "émoji😀"};
+  std::string text;
+  for (size_t i = 0; text.size() < 4 * chunk; i++) {
+    // a sequence cut 1, 2 and 3 bytes after its start
+    if (text.size() + 8 > chunk * (text.size() / chunk + 1) &&
+        text.size() / chunk < 3) {
+      text.append(chunk * (text.size() / chunk + 1) - text.size() -
+                      text.size() / chunk - 1,
+                  ' ');
+      text.append("𝒜𝒜𝒜𝒜");
+      continue;
+    }
+    text.append(words[i % 8]);
+    text.append(i % 5 ? " " : "..\n");
+  }
+  text.append("\xf0\x9d"); // ends with an incomplete sequence
+  for (bool lower : {false, true}) {
+    std::vector<Token> expected = expectedTokens(text, lower);
+    std::istringstream stream(text);
+    std::unique_ptr<Tokenizer> streamTokenizer;
+    std::unique_ptr<Tokenizer> memoryTokenizer;
+    if (lower) {
+      streamTokenizer.reset(new Utf8LowerCaseTokenizer(stream));
+      memoryTokenizer.reset(new Utf8LowerCaseTokenizer(std::string_view(text)));
+    } else {
+      streamTokenizer.reset(new Utf8Tokenizer<>(stream));
+      memoryTokenizer.reset(new Utf8Tokenizer<>(std::string_view(text)));
+    }
+    assertTokens(*streamTokenizer, expected);
+    assertTokens(*memoryTokenizer, expected);
+  }
+  Utf8Tokenizer<> empty{std::string_view()};
+  assertTokens(empty, {});
+}
+
+static std::string filtered(std::string_view text) {
+  Chain<Utf8Tokenizer<>, Utf8LowerCaseFilter> chain(
+      text, Utf8LowerCaseFilter::Stage());
+  std::string ret;
+  while (chain.advance())
+    ret.append(chain.getTokenView().termText()).push_back(' ');
+  return ret;
+}
+
+static void testLowerCaseFilter() {
+  assert(filtered("HELLO WORLDWIDEWEB ABCDEFGHIJKLMNOPQRSTUVWXYZ") ==
+         "hello worldwideweb abcdefghijklmnopqrstuvwxyz ");
+  assert(filtered("ÀÉÎ Straße ΣΊΣΥΦΟΣ İSTANBUL ẞ") ==
+         "àéî straße σίσυφοσ istanbul ß ");
+  // terms which get longer
+  assert(filtered("Ⱥ ȺȾ ABCDEFGHȺ Ⱥabc") == "ⱥ ⱥⱦ abcdefghⱥ ⱥabc ");
+  // a LowerCaseFilter over a tokenizer, with invalid bytes left alone
+  std::istringstream input("ÅNGSTRÖM \xff\xfe BIG");
+  Utf8LowerCaseFilter filter(
+      std::unique_ptr<TokenStream>(new WhiteSpaceTokenizer<>(input)));
+  std::vector<std::string> terms;
+  while (filter.next())
+    terms.emplace_back(filter.getTokenView().termText());
+  assert((terms == std::vector<std::string>{"ångström", "\xff\xfe", "big"}));
+}
+
+int main() {
+  testCodec();
+  testProperties();
+  testTokenize();
+  testChunkBoundaries();
+  testLowerCaseFilter();
+  std::cout << "Utf8Tokenizer test passed\n";
+  return 0;
+}
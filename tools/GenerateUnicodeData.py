@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Generates include/lucanthrope/analysis/UnicodeData.h, the Unicode tables of
+the UTF-8 analysis classes, from the Unicode Character Database of the Python
+which runs it (unicodedata.unidata_version).
+
+Usage: tools/GenerateUnicodeData.py > include/lucanthrope/analysis/UnicodeData.h
+
+Each code point has a pair of properties: whether it's a token character (a
+letter, general category L*, or a combining mark, M*, so that words written
+with combining marks aren't split) and the difference between its simple
+lower case mapping and itself. There are less than 256 distinct pairs, so a
+code point's pair is a byte; bytes are looked up through a two-stage table of
+blocks of 2**BLOCK_SHIFT code points, of which identical blocks are stored
+once.
+"""
+
+import sys
+import unicodedata
+
+BLOCK_SHIFT = 7
+MAX_CODE_POINT = 0x10FFFF
+
+
+def properties(cp):
+    c = chr(cp)
+    token_char = unicodedata.category(c)[0] in "LM"
+    lower = c.lower()
+    # str.lower() is the full mapping; where it's longer than one code point
+    # (only U+0130), its first code point is the simple mapping
+    return token_char, ord(lower[0]) - cp
+
+
+def rows(values, indent="    ", width=80):
+    line = indent
+    for value in values:
+        if len(line) + len(value) + 2 > width and line != indent:
+            yield line.rstrip()
+            line = indent
+        line += value + ", "
+    if line != indent:
+        yield line.rstrip()
+
+
+def main():
+    pairs = {(False, 0): 0}
+    byte_of = []
+    for cp in range(MAX_CODE_POINT + 1):
+        byte_of.append(pairs.setdefault(properties(cp), len(pairs)))
+    if len(pairs) > 256:
+        sys.exit("too many distinct properties for a byte")
+
+    block_size = 1 << BLOCK_SHIFT
+    last = max(cp for cp, b in enumerate(byte_of) if b)
+    num_blocks = (last >> BLOCK_SHIFT) + 1
+    limit = num_blocks << BLOCK_SHIFT
+    blocks = {}
+    block_index = []
+    for b in range(num_blocks):
+        block = tuple(byte_of[b * block_size:(b + 1) * block_size])
+        block_index.append(blocks.setdefault(block, len(blocks)))
+    if len(blocks) > 256:
+        sys.exit("too many distinct blocks for a byte")
+    block_data = [v for block in blocks for v in block]
+
+    out = [
+        "// Generated by tools/GenerateUnicodeData.py from the Unicode "
+        "Character",
+        "// Database %s; do not edit." % unicodedata.unidata_version,
+        "",
+        "#pragma once",
+        "",
+        "#include <cstdint>",
+        "",
+        "namespace lucanthrope {",
+        "",
+        "namespace unicode_data {",
+        "",
+        'constexpr char kVersion[] = "%s";' % unicodedata.unidata_version,
+        "",
+        "struct Properties {",
+        "  bool tokenChar;     // a letter or a combining mark",
+        "  int32_t lowerDelta; // simple lower case mapping minus the code "
+        "point",
+        "};",
+        "",
+        "constexpr Properties kProperties[] = {",
+    ]
+    by_index = sorted(pairs, key=pairs.get)
+    out += rows(("{%s, %d}" % ("true" if t else "false", d)
+                 for t, d in by_index))
+    out += [
+        "};",
+        "",
+        "// Code points from kLimit on have kProperties[0]; the properties of",
+        "// cp < kLimit are",
+        "//   kProperties[kBlockData[kBlockIndex[cp >> kBlockShift] << "
+        "kBlockShift |",
+        "//                          (cp & ((1 << kBlockShift) - 1))]]",
+        "constexpr char32_t kLimit = 0x%X;" % limit,
+        "constexpr unsigned kBlockShift = %d;" % BLOCK_SHIFT,
+        "",
+        "constexpr uint8_t kBlockIndex[] = {",
+    ]
+    out += rows((str(v) for v in block_index))
+    out += ["};", "", "constexpr uint8_t kBlockData[] = {"]
+    out += rows((str(v) for v in block_data))
+    out += [
+        "};",
+        "",
+        "} // namespace unicode_data",
+        "",
+        "} // namespace lucanthrope",
+    ]
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+// Verifies checksum footers of every file in an index folder, in parallel.
+//
+// Usage: VerifyChecksums [-threads N] [-chunk MB] [-mmap] <path>
+//
+// Prints one line per file (length, throughput, status) and a summary. Exits
+// with 0 if nothing is corrupted or unreadable, 1 otherwise, and 2 on bad
+// usage.
+
+#include <chrono>
+#include <cstdlib> // strtoull()
+#include <cstring> // strcmp()
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "lucanthrope/common/Exception.h"
+#include "lucanthrope/storage/ChecksumVerifier.h"
+#include "lucanthrope/storage/FSDirectory.h"
+
+using namespace lucanthrope;
+
+static int usage(const char *argv0) {
+  std::cerr << "Usage: " << argv0
+            << " [-threads N] [-chunk MB] [-mmap] <path>\n";
+  return 2;
+}
+
+static const char *statusOf(const ChecksumVerifier::FileResult &result) {
+  switch (result.status) {
+  case ChecksumVerifier::Status::Ok:
+    return "OK";
+  case ChecksumVerifier::Status::Corrupted:
+    return "CORRUPTED";
+  case ChecksumVerifier::Status::NoChecksum:
+    return "NO CHECKSUM";
+  case ChecksumVerifier::Status::Error:
+    return "ERROR";
+  }
+  return "?";
+}
+
+int main(int argc, char **argv) {
+  size_t threads = 0;
+  uint64_t chunkSize = ChecksumVerifier::kDefaultChunkSize;
+  bool useMMap = false;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "-threads") && i + 1 < argc)
+      threads = std::strtoull(argv[++i], nullptr, 10);
+    else if (!std::strcmp(argv[i], "-chunk") && i + 1 < argc)
+      chunkSize = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+    else if (!std::strcmp(argv[i], "-mmap"))
+      useMMap = true;
+    else if (argv[i][0] != '-' && !path)
+      path = argv[i];
+    else
+      return usage(argv[0]);
+  }
+  if (!path)
+    return usage(argv[0]);
+
+  try {
+    FSDirectory dir(path, useMMap);
+    ChecksumVerifier verifier(threads, chunkSize);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ChecksumVerifier::FileResult> results = verifier.verify(dir);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    uint64_t bytes = 0;
+    size_t bad = 0, unchecked = 0;
+    std::cout << std::fixed << std::setprecision(1);
+    for (auto &result : results) {
+      std::cout << std::left << std::setw(32) << result.name << std::right
+                << std::setw(14) << result.length << " B " << std::setw(9)
+                << result.megabytesPerSecond() << " MB/s  "
+                << statusOf(result);
+      switch (result.status) {
+      case ChecksumVerifier::Status::Ok:
+        bytes += result.length;
+        break;
+      case ChecksumVerifier::Status::Corrupted:
+        std::cout << " (expected " << std::hex << result.expected
+                  << ", actual " << result.actual << std::dec << ')';
+        bad++;
+        break;
+      case ChecksumVerifier::Status::NoChecksum:
+        unchecked++;
+        break;
+      case ChecksumVerifier::Status::Error:
+        std::cout << " (" << result.error << ')';
+        bad++;
+        break;
+      }
+      std::cout << '\n';
+    }
+    std::cout << results.size() << " files, " << bytes << " bytes verified in "
+              << seconds << " s ("
+              << (seconds > 0 ? bytes / (1 << 20) / seconds : 0.0)
+              << " MB/s); " << bad << " corrupted or unreadable, "
+              << unchecked << " without checksum\n";
+    return bad ? 1 : 0;
+  } catch (Exception &e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+}